@@ -1176,6 +1176,9 @@ FF_Error_t FF_PushEntryWithContext( FF_IOManager_t *pxIOManager, uint32_t ulEntr
 		if( pxContext->pxBuffer != NULL )
 		{
 			memcpy( pxContext->pxBuffer->pucBuffer + ( ulRelItem * FF_SIZEOF_DIRECTORY_ENTRY ), pEntryBuffer, FF_SIZEOF_DIRECTORY_ENTRY );
+
+			/* Let users of cached directory listings know that they are out of date. */
+			pxIOManager->ulDirChanges++;
 		}
 	}
 
@@ -136,6 +136,7 @@ const struct _FFFUNCTIONTAB
 	{ "FF_BytesLeft",             FF_GETMOD_FUNC( FF_BYTESLEFT ) },
 	{ "FF_SetFileTime",           FF_GETMOD_FUNC( FF_SETFILETIME ) },
 	{ "FF_InitBuf",               FF_GETMOD_FUNC( FF_INITBUF ) },
+	{ "FF_Allocate",              FF_GETMOD_FUNC( FF_ALLOCATE ) },
 
 /*----- FF_FAT - The FreeRTOS+FAT FAT handling routines */
 	{ "FF_getFATEntry",           FF_GETMOD_FUNC( FF_GETFATENTRY ) },
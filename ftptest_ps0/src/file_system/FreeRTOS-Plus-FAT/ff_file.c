@@ -51,6 +51,11 @@ static int32_t FF_WritePartial( FF_FILE *pxFile, uint32_t ulItemLBA, uint32_t ul
 static uint32_t FF_SetCluster( FF_FILE *pxFile, FF_Error_t *pxError );
 static uint32_t FF_FileLBA( FF_FILE *pxFile );
 
+#if( ffconfigFILE_EXTENT_MAP != 0 )
+	static FF_Error_t FF_MapExtents( FF_FILE *pxFile );
+	static void FF_FindExtent( FF_FILE *pxFile, uint32_t ulNewCluster, uint32_t *pulFromCluster, uint32_t *pulFromAddress );
+#endif
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -393,6 +398,18 @@ FF_FindParams_t xFindParams;
 							xError = ( FF_Error_t ) ( FF_ERR_FILE_ALREADY_OPEN | FF_OPEN );
 							break;
 						}
+
+						#if( ffconfigFILE_EXTENT_MAP != 0 )
+						{
+							if( ( pxFile->usExtentCount == 0 ) && ( pxFileChain->usExtentCount != 0 ) )
+							{
+								/* Both handles are read-only so the cluster chain
+								can not change: the map can be shared. */
+								memcpy( pxFile->xExtents, pxFileChain->xExtents, sizeof( pxFile->xExtents ) );
+								pxFile->usExtentCount = pxFileChain->usExtentCount;
+							}
+						}
+						#endif
 					}
 
 					if( pxFileChain->pxNext == NULL )
@@ -1449,23 +1466,47 @@ FF_IOManager_t *pxIOManager = pxFile->pxIOManager;
 uint32_t ulNewCluster = FF_getClusterChainNumber( pxIOManager, pxFile->ulFilePointer, 1 );
 FF_Error_t xResult = FF_ERR_NONE;
 uint32_t ulReturn;
+uint32_t ulFromCluster;		/* Relative cluster number where the traversal starts. */
+uint32_t ulFromAddress;		/* And its address. */
 
-	if( ulNewCluster > pxFile->ulCurrentCluster )
+	if( ulNewCluster != pxFile->ulCurrentCluster )
 	{
-		FF_LockFAT( pxIOManager );
+		if( ulNewCluster > pxFile->ulCurrentCluster )
 		{
-			pxFile->ulAddrCurrentCluster = FF_TraverseFAT( pxIOManager, pxFile->ulAddrCurrentCluster,
-				ulNewCluster - pxFile->ulCurrentCluster, &xResult );
+			ulFromCluster = pxFile->ulCurrentCluster;
+			ulFromAddress = pxFile->ulAddrCurrentCluster;
 		}
-		FF_UnlockFAT( pxIOManager );
-	}
-	else if( ulNewCluster < pxFile->ulCurrentCluster )
-	{
-		FF_LockFAT( pxIOManager );
+		else
 		{
-			pxFile->ulAddrCurrentCluster = FF_TraverseFAT( pxIOManager, pxFile->ulObjectCluster, ulNewCluster, &xResult );
+			ulFromCluster = 0;
+			ulFromAddress = pxFile->ulObjectCluster;
+		}
+
+		#if( ffconfigFILE_EXTENT_MAP != 0 )
+		{
+			/* Only look at the map when seeking, and when the cluster chain can
+			not change because the file is opened read-only. */
+			if( ( ( ulNewCluster - ulFromCluster ) > 1ul ) &&
+				( ( pxFile->ucMode & ( FF_MODE_WRITE | FF_MODE_APPEND ) ) == 0 ) )
+			{
+				FF_FindExtent( pxFile, ulNewCluster, &ulFromCluster, &ulFromAddress );
+			}
+		}
+		#endif
+
+		if( ulNewCluster != ulFromCluster )
+		{
+			FF_LockFAT( pxIOManager );
+			{
+				ulFromAddress = FF_TraverseFAT( pxIOManager, ulFromAddress, ulNewCluster - ulFromCluster, &xResult );
+			}
+			FF_UnlockFAT( pxIOManager );
+		}
+
+		if( FF_isERR( xResult ) == pdFALSE )
+		{
+			pxFile->ulAddrCurrentCluster = ulFromAddress;
 		}
-		FF_UnlockFAT( pxIOManager );
 	}
 	else
 	{
@@ -1487,6 +1528,137 @@ uint32_t ulReturn;
 }	/* FF_SetCluster() */
 /*-----------------------------------------------------------*/
 
+#if( ffconfigFILE_EXTENT_MAP != 0 )
+/**
+ *	@private
+ *	@brief	Follow the cluster chain of a file once, and store the runs of
+ *	@brief	contiguous clusters in pxFile->xExtents[].
+ *
+ *	@param	pxFile       The file handle, opened for reading
+ *
+ *	@return	FF_ERR_NONE on success
+ *	@return	Possible error returned by FF_getFATEntry()
+ **/
+static FF_Error_t FF_MapExtents( FF_FILE *pxFile )
+{
+FF_IOManager_t *pxIOManager = pxFile->pxIOManager;
+uint32_t ulBytesPerCluster = pxIOManager->xPartition.usBlkSize * pxIOManager->xPartition.ulSectorsPerCluster;
+uint32_t ulClusterCount = ( pxFile->ulFileSize + ulBytesPerCluster - 1 ) / ulBytesPerCluster;
+uint32_t ulCluster = pxFile->ulObjectCluster;
+uint32_t ulFileCluster = 0;
+UBaseType_t uxCount = 0;
+FF_Extent_t *pxExtent = NULL;
+FF_Error_t xError = FF_ERR_NONE;
+FF_Error_t xTempError;
+FF_FATBuffers_t xFATBuffers;
+
+	FF_InitFATBuffers( &xFATBuffers, FF_MODE_READ );
+
+	FF_LockFAT( pxIOManager );
+	{
+		while( ulFileCluster < ulClusterCount )
+		{
+			if( ( pxExtent != NULL ) && ( ulCluster == ( pxExtent->ulCluster + pxExtent->ulCount ) ) )
+			{
+				/* The run continues. */
+				pxExtent->ulCount++;
+			}
+			else if( uxCount < ffconfigFILE_EXTENT_MAP )
+			{
+				pxExtent = &( pxFile->xExtents[ uxCount ] );
+				pxExtent->ulFileCluster = ulFileCluster;
+				pxExtent->ulCluster = ulCluster;
+				pxExtent->ulCount = 1;
+				uxCount++;
+			}
+			else
+			{
+				/* The map is full.  Clusters after the last run will be found
+				by following the FAT from the end of that run. */
+				break;
+			}
+
+			ulFileCluster++;
+
+			if( ulFileCluster < ulClusterCount )
+			{
+				ulCluster = FF_getFATEntry( pxIOManager, ulCluster, &xError, &xFATBuffers );
+
+				if( ( FF_isERR( xError ) != pdFALSE ) || ( FF_isEndOfChain( pxIOManager, ulCluster ) != pdFALSE ) )
+				{
+					break;
+				}
+			}
+		}
+	}
+	FF_UnlockFAT( pxIOManager );
+
+	xTempError = FF_ReleaseFATBuffers( pxIOManager, &xFATBuffers );
+
+	if( FF_isERR( xError ) == pdFALSE )
+	{
+		xError = xTempError;
+	}
+
+	if( FF_isERR( xError ) == pdFALSE )
+	{
+		pxFile->usExtentCount = ( uint16_t ) uxCount;
+	}
+
+	return xError;
+}	/* FF_MapExtents() */
+/*-----------------------------------------------------------*/
+
+/**
+ *	@private
+ *	@brief	Use the extent map to find a better place to start following the
+ *	@brief	FAT to relative cluster 'ulNewCluster'.  The map is made when
+ *	@brief	it is needed for the first time.
+ *
+ *	@param	pxFile          The file handle, opened for reading
+ *	@param	ulNewCluster    The relative cluster number that must be found
+ *	@param	pulFromCluster  In: a relative cluster number <= ulNewCluster, out: a closer one
+ *	@param	pulFromAddress  In/out: the address of *pulFromCluster
+ **/
+static void FF_FindExtent( FF_FILE *pxFile, uint32_t ulNewCluster, uint32_t *pulFromCluster, uint32_t *pulFromAddress )
+{
+FF_Extent_t *pxExtent;
+UBaseType_t uxIndex;
+uint32_t ulLastCluster;
+
+	if( pxFile->usExtentCount == 0 )
+	{
+		/* When this fails, the FAT will just be followed as usual. */
+		( void ) FF_MapExtents( pxFile );
+	}
+
+	for( uxIndex = pxFile->usExtentCount; uxIndex > 0; uxIndex-- )
+	{
+		pxExtent = &( pxFile->xExtents[ uxIndex - 1 ] );
+
+		if( pxExtent->ulFileCluster <= ulNewCluster )
+		{
+			ulLastCluster = pxExtent->ulFileCluster + pxExtent->ulCount - 1;
+
+			if( ulNewCluster <= ulLastCluster )
+			{
+				/* Found within this run: no need to read the FAT. */
+				*pulFromCluster = ulNewCluster;
+				*pulFromAddress = pxExtent->ulCluster + ( ulNewCluster - pxExtent->ulFileCluster );
+			}
+			else if( ulLastCluster > *pulFromCluster )
+			{
+				/* Beyond the map: start from the end of the last run. */
+				*pulFromCluster = ulLastCluster;
+				*pulFromAddress = pxExtent->ulCluster + pxExtent->ulCount - 1;
+			}
+			break;
+		}
+	}
+}	/* FF_FindExtent() */
+/*-----------------------------------------------------------*/
+#endif /* ffconfigFILE_EXTENT_MAP */
+
 static int32_t FF_ReadPartial( FF_FILE *pxFile, uint32_t ulItemLBA, uint32_t ulRelBlockPos, uint32_t ulCount,
 	uint8_t *pucBuffer, FF_Error_t *pxError )
 {
@@ -2865,10 +3037,12 @@ FF_Error_t xError;
 			/* File is not deleted and it was opened for writing or updating */
 			ulClusterSize = pxFile->pxIOManager->xPartition.usBlkSize * pxFile->pxIOManager->xPartition.ulSectorsPerCluster;
 
-			if( ( ( pxFile->ulFileSize % ulClusterSize ) == 0 ) && ( pxFile->ulObjectCluster != 0ul ) )
+			if( ( ( ( pxFile->ulFileSize % ulClusterSize ) == 0 ) || ( ( pxFile->ulValidFlags & FF_VALID_FLAG_ALLOCATED ) != 0 ) ) &&
+				( pxFile->ulObjectCluster != 0ul ) )
 			{
 				/* The file's length is a multiple of cluster size.  This means
-				that an extra cluster has been reserved, which wasn't necessary. */
+				that an extra cluster has been reserved, which wasn't necessary.
+				Or FF_Allocate() has reserved more clusters than were written. */
 				xError = FF_Truncate( pxFile, pdTRUE );
 			}
 
@@ -2985,6 +3159,53 @@ FF_Error_t FF_SetEof( FF_FILE *pxFile )
 }	/* FF_SetEof() */
 /*-----------------------------------------------------------*/
 
+/**
+*	@public
+*	@brief	Reserve the clusters for a file of 'ulSize' bytes in one go, like
+*			fallocate().  Subsequent writes up to that size will not have to
+*			look for free clusters nor update the FAT.  The file size itself
+*			is not changed: clusters that have not been written to are
+*			released again by FF_Close().
+*
+*	@param	pxFile		FF_FILE object that was opened for writing.
+*	@param	ulSize		The expected size of the file in bytes.
+*
+*	@return 0 on sucess.
+*	@return negative if some error occurred
+*
+**/
+FF_Error_t FF_Allocate( FF_FILE *pxFile, uint32_t ulSize )
+{
+FF_Error_t xError;
+
+	xError = FF_CheckValid( pxFile );
+
+	if( FF_isERR( xError ) == pdFALSE )
+	{
+		if( ( pxFile->ucMode & FF_MODE_WRITE ) == 0 )
+		{
+			xError = ( FF_Error_t ) ( FF_ERR_FILE_NOT_OPENED_IN_WRITE_MODE | FF_ALLOCATE );
+		}
+		else if( ulSize > pxFile->ulFileSize )
+		{
+		uint32_t ulChainLength = pxFile->ulChainLength;
+
+			/* FF_ExtendFile() only adds clusters when the chain is too short. */
+			xError = FF_ExtendFile( pxFile, ulSize );
+
+			/* When the disk got full, part of the clusters may have been added
+			already.  FF_Close() must release those as well. */
+			if( ( FF_isERR( xError ) == pdFALSE ) || ( pxFile->ulChainLength > ulChainLength ) )
+			{
+				pxFile->ulValidFlags |= FF_VALID_FLAG_ALLOCATED;
+			}
+		}
+	}
+
+	return xError;
+}	/* FF_Allocate() */
+/*-----------------------------------------------------------*/
+
 /**
 *	@public
 *	@brief	Truncate a file to 'pxFile->ulFileSize'
@@ -3015,8 +3236,8 @@ uint32_t ulClustersNeeded;
 	if( bClosing != pdFALSE )
 	{
 		/* The handle will be closed after truncating.  This function is called
-		because Filesize is an exact multiple of ulClusterSize. */
-		ulClustersNeeded = pxFile->ulFileSize / ulClusterSize;
+		because Filesize is an exact multiple of ulClusterSize, or because
+		clusters were reserved by FF_Allocate().  Keep the rounded-up number. */
 	}
 	else
 	{
@@ -261,6 +261,32 @@ int iReturn, ff_errno;
 }
 /*-----------------------------------------------------------*/
 
+int ff_fallocate( FF_FILE *pxStream, size_t uxSize )
+{
+FF_Error_t xError;
+int iReturn, ff_errno;
+
+	/* Reserve the clusters for a file of 'uxSize' bytes. */
+	xError = FF_Allocate( pxStream, ( uint32_t ) uxSize );
+
+	ff_errno = prvFFErrorToErrno( xError );
+
+	if( ff_errno == 0 )
+	{
+		iReturn = 0;
+	}
+	else
+	{
+		iReturn = -1;
+	}
+
+	/* Store the errno to thread local storage. */
+	stdioSET_ERRNO( ff_errno );
+
+	return iReturn;
+}
+/*-----------------------------------------------------------*/
+
 void ff_rewind( FF_FILE *pxStream )
 {
 	ff_fseek( pxStream, 0, FF_SEEK_SET );
@@ -1545,6 +1571,36 @@ FF_Error_t xError;
 }
 /*-----------------------------------------------------------*/
 
+/* Get a counter that changes each time any directory on the disk that holds
+'pcPath' is changed. */
+int ff_dirchanges( const char *pcPath, uint32_t *pulChanges )
+{
+FF_DirHandler_t xHandler;
+int iResult;
+
+	/* In case a CWD is used, get the absolute path */
+	pcPath = prvABSPath( pcPath );
+	/* Find the i/o manager which can handle this path */
+	if( FF_FS_Find( pcPath, &xHandler ) == pdFALSE )
+	{
+		iResult = -1;
+
+		/* Store the errno to thread local storage. */
+		stdioSET_ERRNO( pdFREERTOS_ERRNO_ENXIO );	/* No such device or address */
+	}
+	else
+	{
+		*pulChanges = xHandler.pxManager->ulDirChanges;
+		iResult = 0;
+
+		/* Store the errno to thread local storage. */
+		stdioSET_ERRNO( 0 );
+	}
+
+	return iResult;
+}
+/*-----------------------------------------------------------*/
+
 int ff_finddir(const char *pcPath )
 {
 int iResult;
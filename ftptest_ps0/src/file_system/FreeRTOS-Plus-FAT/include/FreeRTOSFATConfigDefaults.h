@@ -416,6 +416,16 @@ will be removed. */
 	#define ffconfigFILE_EXTEND_FLUSHES_BUFFERS		1
 #endif
 
+#if !defined( ffconfigFILE_EXTENT_MAP )
+	/* When a file that was opened for reading is seeked in, the FAT has to be
+	followed cluster by cluster from the start of the file.  When
+	ffconfigFILE_EXTENT_MAP is non-zero, each file handle will keep a map of up
+	to this many runs of contiguous clusters.  The map is made at the first
+	seek, and handles that open the same file for reading will copy it.  Seeks
+	can then be done without reading the FAT. */
+	#define ffconfigFILE_EXTENT_MAP				0
+#endif
+
 #if !defined( FF_PRINTF )
 	#define	FF_PRINTF FF_PRINTF
 	static portINLINE void FF_PRINTF( const char *pcFormat, ... )
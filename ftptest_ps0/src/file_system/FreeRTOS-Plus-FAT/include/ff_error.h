@@ -145,6 +145,7 @@
 #define FF_SETFILETIME				( ( 24		<< FF_FUNCTION_SHIFT ) | FF_MODULE_FILE )
 #define FF_INITBUF					( ( 25		<< FF_FUNCTION_SHIFT ) | FF_MODULE_FILE )
 #define FF_SETEOF					( ( 26		<< FF_FUNCTION_SHIFT ) | FF_MODULE_FILE )
+#define FF_ALLOCATE					( ( 27		<< FF_FUNCTION_SHIFT ) | FF_MODULE_FILE )
 
 /*----- FF_FAT - The FreeRTOS+FAT FAT handling routines. */
 #define FF_GETFATENTRY				( ( 1		<< FF_FUNCTION_SHIFT ) | FF_MODULE_FAT )
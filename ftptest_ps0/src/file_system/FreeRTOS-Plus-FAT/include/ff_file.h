@@ -53,6 +53,16 @@ struct xDEV_NODE
 };
 #endif
 
+#if( ffconfigFILE_EXTENT_MAP != 0 )
+	/* A run of contiguous clusters within the cluster chain of a file. */
+	typedef struct xFF_EXTENT
+	{
+		uint32_t ulFileCluster;		/* Cluster number relative to the start of the file. */
+		uint32_t ulCluster;			/* Address of the first cluster of the run. */
+		uint32_t ulCount;			/* Number of clusters in the run. */
+	} FF_Extent_t;
+#endif
+
 typedef struct _FF_FILE
 {
 	FF_IOManager_t *pxIOManager;			/* Ioman Pointer! */
@@ -73,6 +83,11 @@ typedef struct _FF_FILE
 	uint8_t ucMode;					/* Mode that File Was opened in. */
 	uint16_t usDirEntry;			/* Dirent Entry Number describing this file. */
 
+#if( ffconfigFILE_EXTENT_MAP != 0 )
+	uint16_t usExtentCount;			/* Number of valid entries in xExtents, 0 when not mapped yet. */
+	FF_Extent_t xExtents[ ffconfigFILE_EXTENT_MAP ];	/* Only used for files opened read-only. */
+#endif
+
 #if( ffconfigDEV_SUPPORT != 0 )
 	struct SFileCache *pxDevNode;
 #endif
@@ -81,6 +96,7 @@ typedef struct _FF_FILE
 
 #define FF_VALID_FLAG_INVALID	0x00000001
 #define FF_VALID_FLAG_DELETED	0x00000002
+#define FF_VALID_FLAG_ALLOCATED	0x00000004	/* Clusters were reserved with FF_Allocate(). */
 
 /*---------- PROTOTYPES */
 /* PUBLIC (Interfaces): */
@@ -123,6 +139,7 @@ typedef struct _FF_FILE
 #endif
 
 FF_Error_t FF_SetEof( FF_FILE *pFile );
+FF_Error_t FF_Allocate( FF_FILE *pFile, uint32_t ulSize );
 
 FF_Error_t FF_Close( FF_FILE *pFile );
 int32_t FF_GetC( FF_FILE *pFile );
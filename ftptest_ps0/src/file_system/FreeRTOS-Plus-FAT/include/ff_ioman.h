@@ -288,6 +288,7 @@ typedef struct _FF_IOMAN
 	FF_HashTable_t	xHashCache[ ffconfigHASH_CACHE_DEPTH ];
 #endif
 	void			*pvFATLockHandle;
+	uint32_t		ulDirChanges;		/* Incremented each time a directory entry is written. */
 } FF_IOManager_t;
 
 /* Bit values for 'FF_IOManager_t::ucFlags': */
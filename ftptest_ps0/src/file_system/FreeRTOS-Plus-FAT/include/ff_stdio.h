@@ -178,6 +178,7 @@ int ff_fclose( FF_FILE *pxStream );
  * http://www.freertos.org/FreeRTOS-Plus/FreeRTOS_Plus_FAT/Standard_File_System_API.html
  *-----------------------------------------------------------*/
 int ff_fseek( FF_FILE *pxStream, long lOffset, int iWhence );
+int ff_fallocate( FF_FILE *pxStream, size_t uxSize );
 void ff_rewind( FF_FILE *pxStream );
 long ff_ftell( FF_FILE *pxStream );
 int ff_feof( FF_FILE *pxStream );
@@ -321,6 +322,7 @@ size_t ff_filelength( FF_FILE *pxFile );
 int ff_findfirst( const char *pcDirectory, FF_FindData_t *pxFindData );
 int ff_findnext( FF_FindData_t *pxFindData );
 int ff_isdirempty(const char *pcPath );
+int ff_dirchanges( const char *pcPath, uint32_t *pulChanges );
 
 
 /* _RB_ What to do regarding documentation for the definitions below here. */
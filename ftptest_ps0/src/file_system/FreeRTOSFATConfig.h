@@ -331,5 +331,10 @@ implementation, so I have to set it to 1 here, so it is not defined. */
 conform with the coding standard, so use this function with care! */
 #define ffconfigUSE_DELTREE					1
 
+/* Every file handle keeps a map of up to 16 runs of contiguous clusters, so
+that a seek (e.g. after an FTP REST command) does not have to follow the FAT
+from the start of the file. */
+#define ffconfigFILE_EXTENT_MAP				16
+
 #endif /* _FF_CONFIG_H_ */
 
@@ -0,0 +1,330 @@
+/*
+ * FreeRTOS+TCP V2.3.2
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file FreeRTOS_Slab.c
+ * @brief A slab allocator with per-type caches for the objects that are
+ *        created and deleted often by FreeRTOS+TCP and the TCP servers.
+ */
+
+/* Standard includes. */
+#include <stdint.h>
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* FreeRTOS+TCP includes. */
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_Slab.h"
+
+#if ( ipconfigUSE_SLAB_ALLOCATOR == 1 )
+
+/** @brief Every object is preceded by a header, rounded up to the alignment of the heap. */
+    #define slabHEADER_SIZE    ( ( ( sizeof( SlabHeader_t ) + ( size_t ) portBYTE_ALIGNMENT ) - 1U ) & ~( ( size_t ) portBYTE_ALIGNMENT - 1U ) )
+
+    struct xSLAB_CLASS;
+
+/** @brief The header in front of every object. */
+    typedef struct xSLAB_HEADER
+    {
+        struct xSLAB_CLASS * pxClass;       /**< The owner of the object, NULL when it was allocated with pvPortMalloc(). */
+        struct xSLAB_HEADER * pxNextFree;   /**< The next object in the free list, only valid while the object is free. */
+    } SlabHeader_t;
+
+/** @brief A cache of objects of the same size. */
+    typedef struct xSLAB_CLASS
+    {
+        size_t uxStride;          /**< Size of the object plus its header. */
+        SlabHeader_t * pxFree;    /**< The list of free objects. */
+        SlabStats_t xStats;       /**< Usage statistics. */
+    } SlabClass_t;
+
+/** @brief The size classes of every type. */
+    static SlabClass_t xSlabClasses[ eSlabTypeCount ][ ipconfigSLAB_SIZE_CLASSES ];
+
+/** @brief The number of allocations that could not be served by a size class. */
+    static uint32_t ulSlabFallbacks[ eSlabTypeCount ];
+
+/** @brief The names of the types, used when logging. */
+    static const char * const pcSlabNames[ eSlabTypeCount ] =
+    {
+        "socket",
+        "stream",
+        "client",
+        "segments"
+    };
+
+/*
+ * Take a new chunk from the heap and add its objects to the free list.
+ */
+    static BaseType_t prvSlabGrow( SlabClass_t * pxClass );
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Take a chunk of ipconfigSLAB_CHUNK_SIZE bytes from the heap, or a
+ *        single object when it is larger than a chunk, and put the new
+ *        objects in the free list of the size class.
+ *
+ * @param[in] pxClass: The size class that has run out of objects.
+ *
+ * @return pdPASS if the heap had enough space, otherwise pdFAIL.
+ */
+    static BaseType_t prvSlabGrow( SlabClass_t * pxClass )
+    {
+        size_t uxCount = ( size_t ) ipconfigSLAB_CHUNK_SIZE / pxClass->uxStride;
+        size_t uxIndex;
+        uint8_t * pucChunk;
+        SlabHeader_t * pxHeader;
+        BaseType_t xReturn = pdFAIL;
+
+        if( uxCount == 0U )
+        {
+            uxCount = 1U;
+        }
+
+        pucChunk = ( uint8_t * ) pvPortMalloc( uxCount * pxClass->uxStride );
+
+        if( pucChunk != NULL )
+        {
+            for( uxIndex = 0U; uxIndex < uxCount; uxIndex++ )
+            {
+                pxHeader = ( SlabHeader_t * ) ( pucChunk + ( uxIndex * pxClass->uxStride ) );
+                pxHeader->pxClass = pxClass;
+                pxHeader->pxNextFree = pxClass->pxFree;
+                pxClass->pxFree = pxHeader;
+            }
+
+            pxClass->xStats.uxCreated += ( UBaseType_t ) uxCount;
+            xReturn = pdPASS;
+        }
+
+        return xReturn;
+    }
+    /*-----------------------------------------------------------*/
+
+/**
+ * @brief Allocate an object.  The size class of the type with the same
+ *        object size is used.  When there is none, a free size class is
+ *        claimed.  When all size classes are in use by other sizes, the
+ *        object is allocated with pvPortMalloc().
+ *
+ * @param[in] eType: The type of the object.
+ * @param[in] uxSize: The number of bytes needed.
+ *
+ * @return A pointer to the object, or NULL when the heap is exhausted.
+ */
+    void * pvSlabMalloc( eSlabType_t eType,
+                         size_t uxSize )
+    {
+        SlabClass_t * pxClass = NULL;
+        SlabHeader_t * pxHeader = NULL;
+        size_t uxStride;
+        UBaseType_t uxIndex;
+
+        configASSERT( eType < eSlabTypeCount );
+
+        /* The objects must be aligned as well as the header. */
+        uxStride = slabHEADER_SIZE + ( ( ( uxSize + ( size_t ) portBYTE_ALIGNMENT ) - 1U ) & ~( ( size_t ) portBYTE_ALIGNMENT - 1U ) );
+
+        vTaskSuspendAll();
+        {
+            for( uxIndex = 0U; uxIndex < ( UBaseType_t ) ipconfigSLAB_SIZE_CLASSES; uxIndex++ )
+            {
+                SlabClass_t * pxCandidate = &( xSlabClasses[ eType ][ uxIndex ] );
+
+                if( pxCandidate->uxStride == uxStride )
+                {
+                    pxClass = pxCandidate;
+                    break;
+                }
+
+                if( ( pxCandidate->uxStride == 0U ) && ( pxClass == NULL ) )
+                {
+                    /* Remember the first unused size class, but keep on
+                     * looking for a class with the right size. */
+                    pxClass = pxCandidate;
+                }
+            }
+
+            if( ( pxClass != NULL ) && ( pxClass->uxStride == 0U ) )
+            {
+                pxClass->uxStride = uxStride;
+                pxClass->xStats.uxObjectSize = uxStride - slabHEADER_SIZE;
+            }
+
+            if( pxClass != NULL )
+            {
+                if( ( pxClass->pxFree != NULL ) || ( prvSlabGrow( pxClass ) != pdFAIL ) )
+                {
+                    pxHeader = pxClass->pxFree;
+                    pxClass->pxFree = pxHeader->pxNextFree;
+                    pxHeader->pxNextFree = NULL;
+
+                    pxClass->xStats.uxInUse++;
+                    pxClass->xStats.ulAllocCount++;
+
+                    if( pxClass->xStats.uxMaxInUse < pxClass->xStats.uxInUse )
+                    {
+                        pxClass->xStats.uxMaxInUse = pxClass->xStats.uxInUse;
+                    }
+                }
+                else
+                {
+                    pxClass->xStats.ulFailCount++;
+                }
+            }
+            else
+            {
+                ulSlabFallbacks[ eType ]++;
+            }
+        }
+        ( void ) xTaskResumeAll();
+
+        if( pxClass == NULL )
+        {
+            /* All size classes are taken by objects of a different size. */
+            pxHeader = ( SlabHeader_t * ) pvPortMalloc( uxStride );
+
+            if( pxHeader != NULL )
+            {
+                pxHeader->pxClass = NULL;
+                pxHeader->pxNextFree = NULL;
+            }
+        }
+
+        if( pxHeader == NULL )
+        {
+            FreeRTOS_debug_printf( ( "pvSlabMalloc: %s of %u bytes failed\n", pcSlabNames[ eType ], ( unsigned ) uxSize ) );
+        }
+
+        return ( pxHeader != NULL ) ? ( void * ) ( ( ( uint8_t * ) pxHeader ) + slabHEADER_SIZE ) : NULL;
+    }
+    /*-----------------------------------------------------------*/
+
+/**
+ * @brief Return an object to its size class.
+ *
+ * @param[in] pvObject: The object, as returned by pvSlabMalloc().
+ */
+    void vSlabFree( void * pvObject )
+    {
+        SlabHeader_t * pxHeader;
+        SlabClass_t * pxClass;
+
+        if( pvObject != NULL )
+        {
+            pxHeader = ( SlabHeader_t * ) ( ( ( uint8_t * ) pvObject ) - slabHEADER_SIZE );
+            pxClass = pxHeader->pxClass;
+
+            if( pxClass == NULL )
+            {
+                vPortFree( pxHeader );
+            }
+            else
+            {
+                vTaskSuspendAll();
+                {
+                    configASSERT( pxClass->xStats.uxInUse > 0U );
+
+                    pxHeader->pxNextFree = pxClass->pxFree;
+                    pxClass->pxFree = pxHeader;
+                    pxClass->xStats.uxInUse--;
+                }
+                ( void ) xTaskResumeAll();
+            }
+        }
+    }
+    /*-----------------------------------------------------------*/
+
+/**
+ * @brief Get the statistics of a size class.
+ *
+ * @param[in] eType: The type of object.
+ * @param[in] uxClass: The index of the size class, less than ipconfigSLAB_SIZE_CLASSES.
+ * @param[out] pxStats: Receives a copy of the statistics.
+ *
+ * @return pdPASS when the parameters are valid, otherwise pdFAIL.
+ */
+    BaseType_t xSlabGetStats( eSlabType_t eType,
+                              UBaseType_t uxClass,
+                              SlabStats_t * pxStats )
+    {
+        BaseType_t xReturn = pdFAIL;
+
+        if( ( eType < eSlabTypeCount ) && ( uxClass < ( UBaseType_t ) ipconfigSLAB_SIZE_CLASSES ) && ( pxStats != NULL ) )
+        {
+            vTaskSuspendAll();
+            {
+                *pxStats = xSlabClasses[ eType ][ uxClass ].xStats;
+            }
+            ( void ) xTaskResumeAll();
+
+            xReturn = pdPASS;
+        }
+
+        return xReturn;
+    }
+    /*-----------------------------------------------------------*/
+
+/**
+ * @brief Log one line for every size class that has been used.
+ */
+    void vSlabPrintStats( void )
+    {
+        SlabStats_t xStats;
+        BaseType_t xType;
+        UBaseType_t uxClass;
+
+        for( xType = 0; xType < ( BaseType_t ) eSlabTypeCount; xType++ )
+        {
+            for( uxClass = 0U; uxClass < ( UBaseType_t ) ipconfigSLAB_SIZE_CLASSES; uxClass++ )
+            {
+                if( ( xSlabGetStats( ( eSlabType_t ) xType, uxClass, &( xStats ) ) != pdFAIL ) && ( xStats.uxObjectSize != 0U ) )
+                {
+                    FreeRTOS_printf( ( "Slab %-8s %6u bytes: created %3u in use %3u max %3u allocs %5lu failed %lu\n",
+                                       pcSlabNames[ xType ],
+                                       ( unsigned ) xStats.uxObjectSize,
+                                       ( unsigned ) xStats.uxCreated,
+                                       ( unsigned ) xStats.uxInUse,
+                                       ( unsigned ) xStats.uxMaxInUse,
+                                       xStats.ulAllocCount,
+                                       xStats.ulFailCount ) );
+                }
+            }
+
+            if( ulSlabFallbacks[ xType ] != 0UL )
+            {
+                FreeRTOS_printf( ( "Slab %-8s %lu allocations without a size class\n",
+                                   pcSlabNames[ xType ],
+                                   ulSlabFallbacks[ xType ] ) );
+            }
+        }
+    }
+    /*-----------------------------------------------------------*/
+
+#endif /* ipconfigUSE_SLAB_ALLOCATOR */
@@ -180,6 +180,11 @@ static BaseType_t prvDetermineSocketSize( BaseType_t xDomain,
  */
     static StreamBuffer_t * prvTCPCreateStream( FreeRTOS_Socket_t * pxSocket,
                                                 BaseType_t xIsInputStream );
+
+/*
+ * Calculate the LENGTH of a stream buffer for a given stream size.
+ */
+    static size_t prvTCPStreamLength( size_t uxStreamSize );
 #endif /* ipconfigUSE_TCP == 1 */
 
 #if ( ipconfigUSE_TCP == 1 )
@@ -197,9 +202,28 @@ static BaseType_t prvDetermineSocketSize( BaseType_t xDomain,
 /*
  * When a child socket gets closed, make sure to update the child-count of the parent
  */
-    static void prvTCPSetSocketCount( FreeRTOS_Socket_t const * pxSocketToDelete );
+    static FreeRTOS_Socket_t * prvTCPSetSocketCount( FreeRTOS_Socket_t const * pxSocketToDelete );
 #endif /* ipconfigUSE_TCP == 1 */
 
+#if ( ipconfigUSE_TCP == 1 ) && ( ipconfigTCP_LISTEN_CHILD_POOL == 1 )
+
+/*
+ * Fill the pool of idle child sockets of a listening socket up to its backlog.
+ */
+    static void prvTCPChildPoolFill( FreeRTOS_Socket_t * pxSocket );
+
+/*
+ * Return a closed child socket to the pool of its listening socket.
+ */
+    static void prvTCPChildPoolPut( FreeRTOS_Socket_t * pxParent,
+                                    FreeRTOS_Socket_t * pxSocket );
+
+/*
+ * Free all idle child sockets of a listening socket that is being closed.
+ */
+    static void prvTCPChildPoolFree( FreeRTOS_Socket_t * pxSocket );
+#endif /* ( ipconfigUSE_TCP == 1 ) && ( ipconfigTCP_LISTEN_CHILD_POOL == 1 ) */
+
 #if ( ipconfigUSE_TCP == 1 )
 
 /*
@@ -224,7 +248,20 @@ static BaseType_t prvDetermineSocketSize( BaseType_t xDomain,
 /* Executed by the IP-task, it will check all sockets belonging to a set */
     static void prvFindSelectedSocket( SocketSelect_t * pxSocketSet );
 
+/* Find out which of the events of interest have occurred for a socket. */
+    static EventBits_t prvSocketSelectBits( FreeRTOS_Socket_t * pxSocket );
+
 #endif /* ipconfigSUPPORT_SELECT_FUNCTION == 1 */
+
+#if ( ipconfigSUPPORT_SELECT_FUNCTION == 1 ) && ( ipconfigSELECT_USES_READY_LIST == 1 )
+
+/* Put a socket on the ready list of its socket set, if it is not there yet. */
+    static void prvSocketSetReady( FreeRTOS_Socket_t * pxSocket );
+
+/* Remove a socket from the ready list of its socket set. */
+    static void prvSocketClearReady( FreeRTOS_Socket_t * pxSocket );
+
+#endif /* ( ipconfigSUPPORT_SELECT_FUNCTION == 1 ) && ( ipconfigSELECT_USES_READY_LIST == 1 ) */
 /*-----------------------------------------------------------*/
 
 /** @brief The list that contains mappings between sockets and port numbers.
@@ -459,6 +496,13 @@ Socket_t FreeRTOS_socket( BaseType_t xDomain,
                 vListInitialiseItem( &( pxSocket->xBoundSocketListItem ) );
                 listSET_LIST_ITEM_OWNER( &( pxSocket->xBoundSocketListItem ), ipPOINTER_CAST( void *, pxSocket ) );
 
+                #if ( ipconfigSUPPORT_SELECT_FUNCTION == 1 ) && ( ipconfigSELECT_USES_READY_LIST == 1 )
+                    {
+                        vListInitialiseItem( &( pxSocket->xReadyListItem ) );
+                        listSET_LIST_ITEM_OWNER( &( pxSocket->xReadyListItem ), ipPOINTER_CAST( void *, pxSocket ) );
+                    }
+                #endif
+
                 pxSocket->xReceiveBlockTime = ipconfigSOCK_DEFAULT_RECEIVE_BLOCK_TIME;
                 pxSocket->xSendBlockTime = ipconfigSOCK_DEFAULT_SEND_BLOCK_TIME;
                 pxSocket->ucSocketOptions = ( uint8_t ) FREERTOS_SO_UDPCKSUM_OUT;
@@ -523,6 +567,12 @@ Socket_t FreeRTOS_socket( BaseType_t xDomain,
             ( void ) memset( pxSocketSet, 0, sizeof( *pxSocketSet ) );
             pxSocketSet->xSelectGroup = xEventGroupCreate();
 
+            #if ( ipconfigSELECT_USES_READY_LIST == 1 )
+                {
+                    vListInitialise( &( pxSocketSet->xReadyList ) );
+                }
+            #endif
+
             if( pxSocketSet->xSelectGroup == NULL )
             {
                 vPortFree( pxSocketSet );
@@ -555,6 +605,20 @@ Socket_t FreeRTOS_socket( BaseType_t xDomain,
 
         iptraceMEM_STATS_DELETE( pxSocketSet );
 
+        #if ( ipconfigSELECT_USES_READY_LIST == 1 )
+            {
+                /* Sockets which are still in the set must not refer to the list. */
+                vTaskSuspendAll();
+                {
+                    while( listCURRENT_LIST_LENGTH( &( pxSocketSet->xReadyList ) ) > 0U )
+                    {
+                        ( void ) uxListRemove( listGET_HEAD_ENTRY( &( pxSocketSet->xReadyList ) ) );
+                    }
+                }
+                ( void ) xTaskResumeAll();
+            }
+        #endif
+
         vEventGroupDelete( pxSocketSet->xSelectGroup );
         vPortFree( pxSocketSet );
     }
@@ -589,9 +653,22 @@ Socket_t FreeRTOS_socket( BaseType_t xDomain,
 
         if( ( pxSocket->xSelectBits & ( ( EventBits_t ) eSELECT_ALL ) ) != ( EventBits_t ) 0U )
         {
+            SocketSelect_t * pxPrevious = pxSocket->pxSocketSet;
+
             /* Adding a socket to a socket set. */
             pxSocket->pxSocketSet = ( SocketSelect_t * ) xSocketSet;
 
+            #if ( ipconfigSELECT_USES_READY_LIST == 1 )
+                if( ( pxPrevious != NULL ) && ( pxPrevious != pxSocketSet ) )
+                {
+                    /* It may still be on the ready list of its previous set,
+                     * which must not return it any more. */
+                    prvSocketClearReady( pxSocket );
+                }
+            #else
+                ( void ) pxPrevious;
+            #endif
+
             /* Now have the IP-task call vSocketSelect() to see if the set contains
              * any sockets which are 'ready' and set the proper bits. */
             prvFindSelectedSocket( pxSocketSet );
@@ -626,10 +703,29 @@ Socket_t FreeRTOS_socket( BaseType_t xDomain,
 
         if( ( pxSocket->xSelectBits & ( ( EventBits_t ) eSELECT_ALL ) ) != ( EventBits_t ) 0U )
         {
+            SocketSelect_t * pxPrevious = pxSocket->pxSocketSet;
+
             pxSocket->pxSocketSet = ( SocketSelect_t * ) xSocketSet;
+
+            #if ( ipconfigSELECT_USES_READY_LIST == 1 )
+                if( ( pxPrevious != NULL ) && ( pxPrevious != pxSocket->pxSocketSet ) )
+                {
+                    /* Moved to another set, see FreeRTOS_FD_SET(). */
+                    prvSocketClearReady( pxSocket );
+                    prvFindSelectedSocket( pxSocket->pxSocketSet );
+                }
+            #else
+                ( void ) pxPrevious;
+            #endif
         }
         else
         {
+            #if ( ipconfigSELECT_USES_READY_LIST == 1 )
+                {
+                    prvSocketClearReady( pxSocket );
+                }
+            #endif
+
             /* disconnect it from the socket set */
             pxSocket->pxSocketSet = NULL;
         }
@@ -749,6 +845,206 @@ Socket_t FreeRTOS_socket( BaseType_t xDomain,
 #endif /* ipconfigSUPPORT_SELECT_FUNCTION */
 /*-----------------------------------------------------------*/
 
+#if ( ipconfigSUPPORT_SELECT_FUNCTION == 1 ) && ( ipconfigSELECT_USES_READY_LIST == 1 )
+
+/**
+ * @brief Put a socket on the ready list of its socket set.  Called by the
+ *        IP-task when an event has occurred for the socket.
+ *
+ * @param[in] pxSocket: The socket that has an event.
+ */
+    static void prvSocketSetReady( FreeRTOS_Socket_t * pxSocket )
+    {
+        SocketSelect_t * pxSocketSet = pxSocket->pxSocketSet;
+
+        if( ( pxSocketSet != NULL ) &&
+            ( listIS_CONTAINED_WITHIN( &( pxSocketSet->xReadyList ), &( pxSocket->xReadyListItem ) ) == pdFALSE ) )
+        {
+            vTaskSuspendAll();
+            {
+                if( listLIST_ITEM_CONTAINER( &( pxSocket->xReadyListItem ) ) != NULL )
+                {
+                    /* It is still on the ready list of a previous set. */
+                    ( void ) uxListRemove( &( pxSocket->xReadyListItem ) );
+                }
+
+                vListInsertEnd( &( pxSocketSet->xReadyList ), &( pxSocket->xReadyListItem ) );
+            }
+            ( void ) xTaskResumeAll();
+        }
+    }
+    /*-----------------------------------------------------------*/
+
+/**
+ * @brief Remove a socket from the ready list of its socket set.
+ *
+ * @param[in] pxSocket: The socket that is closed or removed from its set.
+ */
+    static void prvSocketClearReady( FreeRTOS_Socket_t * pxSocket )
+    {
+        vTaskSuspendAll();
+        {
+            if( listLIST_ITEM_CONTAINER( &( pxSocket->xReadyListItem ) ) != NULL )
+            {
+                ( void ) uxListRemove( &( pxSocket->xReadyListItem ) );
+            }
+        }
+        ( void ) xTaskResumeAll();
+    }
+    /*-----------------------------------------------------------*/
+
+/**
+ * @brief Attach a user value to a socket, which will be returned by
+ *        FreeRTOS_select_ready() along with the socket.  A child socket of a
+ *        listening socket inherits the value of its parent.
+ *
+ * @param[in] xSocket: The socket.
+ * @param[in] pvContext: The value, e.g. a pointer to the owner of the socket.
+ */
+    void FreeRTOS_FD_SetContext( Socket_t xSocket,
+                                 void * pvContext )
+    {
+        FreeRTOS_Socket_t * pxSocket = ( FreeRTOS_Socket_t * ) xSocket;
+
+        configASSERT( pxSocket != NULL );
+
+        pxSocket->pvSelectContext = pvContext;
+    }
+    /*-----------------------------------------------------------*/
+
+/**
+ * @brief An alternative for FreeRTOS_select(): wait for sockets in a set to
+ *        become ready, and return only those sockets.  The IP-task puts a
+ *        socket on the ready list of its set as soon as an event occurs, so
+ *        the sockets without events are never inspected.
+ *        The events are level-triggered: a socket stays on the ready list as
+ *        long as the condition lasts, e.g. while there is data to be read.
+ *
+ * @param[in] xSocketSet: The socket set.
+ * @param[out] pxReady: An array that receives the sockets with their events.
+ * @param[in] xMaxCount: The number of elements in pxReady.
+ * @param[in] xBlockTimeTicks: Maximum time to wait for a socket to become ready.
+ *
+ * @return The number of sockets stored in pxReady, zero when the time-out was
+ *         reached or when the socket set was signalled.
+ */
+    BaseType_t FreeRTOS_select_ready( SocketSet_t xSocketSet,
+                                      SocketReady_t * pxReady,
+                                      BaseType_t xMaxCount,
+                                      TickType_t xBlockTimeTicks )
+    {
+        SocketSelect_t * pxSocketSet = ( SocketSelect_t * ) xSocketSet;
+        TimeOut_t xTimeOut;
+        TickType_t xRemainingTime = xBlockTimeTicks;
+        BaseType_t xCount = 0;
+        EventBits_t uxResult;
+
+        configASSERT( xSocketSet != NULL );
+        configASSERT( pxReady != NULL );
+
+        vTaskSetTimeOutState( &xTimeOut );
+
+        for( ; ; )
+        {
+            vTaskSuspendAll();
+            {
+                UBaseType_t uxLength = listCURRENT_LIST_LENGTH( &( pxSocketSet->xReadyList ) );
+
+                /* Visit every socket on the list once.  A socket that is still
+                 * ready is moved to the end, so that all sockets get their turn. */
+                while( ( uxLength > 0U ) && ( xCount < xMaxCount ) )
+                {
+                    ListItem_t * pxItem = listGET_HEAD_ENTRY( &( pxSocketSet->xReadyList ) );
+                    FreeRTOS_Socket_t * pxSocket = ipCAST_PTR_TO_TYPE_PTR( FreeRTOS_Socket_t, listGET_LIST_ITEM_OWNER( pxItem ) );
+                    EventBits_t xEvents;
+
+                    uxLength--;
+                    ( void ) uxListRemove( pxItem );
+
+                    if( pxSocket->pxSocketSet != pxSocketSet )
+                    {
+                        /* The socket has moved to another set, e.g. one of
+                         * another task: it is not reported, nor put back. */
+                        xEvents = 0U;
+                    }
+                    else
+                    {
+                        /* Events that were reported by the IP-task, plus the
+                         * conditions that still hold. */
+                        xEvents = ( pxSocket->xSocketBits | prvSocketSelectBits( pxSocket ) ) &
+                                  pxSocket->xSelectBits & ( ( EventBits_t ) ( eSELECT_READ | eSELECT_WRITE | eSELECT_EXCEPT ) );
+                        pxSocket->xSocketBits = 0U;
+
+                        #if ( ipconfigUSE_TCP == 1 )
+                            if( pxSocket->ucProtocol == ( uint8_t ) FREERTOS_IPPROTO_TCP )
+                            {
+                                /* Below a low-water mark, the condition does not
+                                 * count: the socket would be returned over and over
+                                 * while the owner can not make progress.  A closing
+                                 * connection is still reported as eSELECT_EXCEPT. */
+                                if( FreeRTOS_recvcount( pxSocket ) < ( BaseType_t ) pxSocket->uxSelectRxLow )
+                                {
+                                    xEvents &= ~( ( EventBits_t ) eSELECT_READ );
+                                }
+
+                                if( FreeRTOS_tx_space( pxSocket ) < ( BaseType_t ) pxSocket->uxSelectTxLow )
+                                {
+                                    xEvents &= ~( ( EventBits_t ) eSELECT_WRITE );
+                                }
+                            }
+                        #endif /* ipconfigUSE_TCP == 1 */
+                    }
+
+                    if( xEvents != 0U )
+                    {
+                        pxReady[ xCount ].xSocket = ( Socket_t ) pxSocket;
+                        pxReady[ xCount ].xEvents = xEvents;
+                        pxReady[ xCount ].pvContext = pxSocket->pvSelectContext;
+                        xCount++;
+
+                        vListInsertEnd( &( pxSocketSet->xReadyList ), pxItem );
+                    }
+                }
+            }
+            ( void ) xTaskResumeAll();
+
+            if( xCount != 0 )
+            {
+                break;
+            }
+
+            /* Wait until the IP-task reports an event. */
+            uxResult = xEventGroupWaitBits( pxSocketSet->xSelectGroup, ( ( EventBits_t ) eSELECT_ALL ), pdTRUE, pdFALSE, xRemainingTime );
+
+            #if ( ipconfigSUPPORT_SIGNALS != 0 )
+                {
+                    if( ( uxResult & ( ( EventBits_t ) eSELECT_INTR ) ) != 0U )
+                    {
+                        FreeRTOS_debug_printf( ( "FreeRTOS_select_ready: interrupted\n" ) );
+                        break;
+                    }
+                }
+            #endif /* ipconfigSUPPORT_SIGNALS */
+
+            if( xTaskCheckForTimeOut( &xTimeOut, &xRemainingTime ) != pdFALSE )
+            {
+                if( uxResult == 0U )
+                {
+                    break;
+                }
+
+                /* An event came in just in time: have one more look at the
+                 * ready list without blocking. */
+                xRemainingTime = 0U;
+            }
+        }
+
+        return xCount;
+    }
+
+#endif /* ( ipconfigSUPPORT_SELECT_FUNCTION == 1 ) && ( ipconfigSELECT_USES_READY_LIST == 1 ) */
+/*-----------------------------------------------------------*/
+
 #if ( ipconfigSUPPORT_SELECT_FUNCTION == 1 )
 
 /**
@@ -1480,6 +1776,10 @@ void * vSocketClose( FreeRTOS_Socket_t * pxSocket )
 {
     NetworkBufferDescriptor_t * pxNetworkBuffer;
 
+    #if ( ipconfigUSE_TCP == 1 ) && ( ipconfigTCP_LISTEN_CHILD_POOL == 1 )
+        FreeRTOS_Socket_t * pxPoolParent = NULL;
+    #endif
+
     #if ( ipconfigUSE_TCP == 1 )
         {
             /* For TCP: clean up a little more. */
@@ -1497,26 +1797,62 @@ void * vSocketClose( FreeRTOS_Socket_t * pxSocket )
                     }
                 #endif /* ipconfigUSE_TCP_WIN */
 
-                /* Free the input and output streams */
-                if( pxSocket->u.xTCP.rxStream != NULL )
-                {
-                    iptraceMEM_STATS_DELETE( pxSocket->u.xTCP.rxStream );
-                    vPortFreeLarge( pxSocket->u.xTCP.rxStream );
-                }
+                #if ( ipconfigTCP_LISTEN_CHILD_POOL == 1 )
+                    {
+                        /* In case this is a child socket, make sure the child-count of the
+                         * parent socket is decreased.  The parent will take the socket
+                         * back as long as its pool is not full. */
+                        pxPoolParent = prvTCPSetSocketCount( pxSocket );
+
+                        if( ( pxPoolParent != NULL ) &&
+                            ( ( ( UBaseType_t ) pxPoolParent->u.xTCP.usChildCount + ( UBaseType_t ) pxPoolParent->u.xTCP.usChildPoolCount ) >=
+                              ( UBaseType_t ) pxPoolParent->u.xTCP.usBacklog ) )
+                        {
+                            pxPoolParent = NULL;
+                        }
 
-                if( pxSocket->u.xTCP.txStream != NULL )
+                        /* A listening socket owns the idle children in its pool. */
+                        prvTCPChildPoolFree( pxSocket );
+                    }
+                #endif /* ipconfigTCP_LISTEN_CHILD_POOL */
+
+                /* Free the input and output streams, unless the socket is kept
+                 * in a pool, in which case they will be used again. */
+                #if ( ipconfigTCP_LISTEN_CHILD_POOL == 1 )
+                    if( pxPoolParent == NULL )
+                #endif
                 {
-                    iptraceMEM_STATS_DELETE( pxSocket->u.xTCP.txStream );
-                    vPortFreeLarge( pxSocket->u.xTCP.txStream );
+                    if( pxSocket->u.xTCP.rxStream != NULL )
+                    {
+                        iptraceMEM_STATS_DELETE( pxSocket->u.xTCP.rxStream );
+                        vPortFreeStream( pxSocket->u.xTCP.rxStream );
+                    }
+
+                    if( pxSocket->u.xTCP.txStream != NULL )
+                    {
+                        iptraceMEM_STATS_DELETE( pxSocket->u.xTCP.txStream );
+                        vPortFreeStream( pxSocket->u.xTCP.txStream );
+                    }
                 }
 
-                /* In case this is a child socket, make sure the child-count of the
-                 * parent socket is decreased. */
-                prvTCPSetSocketCount( pxSocket );
+                #if ( ipconfigTCP_LISTEN_CHILD_POOL == 0 )
+                    {
+                        /* In case this is a child socket, make sure the child-count of the
+                         * parent socket is decreased. */
+                        ( void ) prvTCPSetSocketCount( pxSocket );
+                    }
+                #endif
             }
         }
     #endif /* ipconfigUSE_TCP == 1 */
 
+    #if ( ipconfigSUPPORT_SELECT_FUNCTION == 1 ) && ( ipconfigSELECT_USES_READY_LIST == 1 )
+        {
+            /* FreeRTOS_select_ready() must not return a closed socket. */
+            prvSocketClearReady( pxSocket );
+        }
+    #endif
+
     /* Socket must be unbound first, to ensure no more packets are queued on
      * it. */
     if( socketSOCKET_IS_BOUND( pxSocket ) )
@@ -1551,11 +1887,6 @@ void * vSocketClose( FreeRTOS_Socket_t * pxSocket )
         }
     }
 
-    if( pxSocket->xEventGroup != NULL )
-    {
-        vEventGroupDelete( pxSocket->xEventGroup );
-    }
-
     #if ( ipconfigUSE_TCP == 1 ) && ( ipconfigHAS_DEBUG_PRINTF != 0 )
         {
             if( pxSocket->ucProtocol == ( uint8_t ) FREERTOS_IPPROTO_TCP )
@@ -1570,9 +1901,24 @@ void * vSocketClose( FreeRTOS_Socket_t * pxSocket )
         }
     #endif /* ( ipconfigUSE_TCP == 1 ) && ( ipconfigHAS_DEBUG_PRINTF != 0 ) */
 
-    /* And finally, after all resources have been freed, free the socket space */
-    iptraceMEM_STATS_DELETE( pxSocket );
-    vPortFreeSocket( pxSocket );
+    #if ( ipconfigUSE_TCP == 1 ) && ( ipconfigTCP_LISTEN_CHILD_POOL == 1 )
+        if( pxPoolParent != NULL )
+        {
+            /* Keep the socket space, its event group and its streams. */
+            prvTCPChildPoolPut( pxPoolParent, pxSocket );
+        }
+        else
+    #endif /* ( ipconfigUSE_TCP == 1 ) && ( ipconfigTCP_LISTEN_CHILD_POOL == 1 ) */
+    {
+        if( pxSocket->xEventGroup != NULL )
+        {
+            vEventGroupDelete( pxSocket->xEventGroup );
+        }
+
+        /* And finally, after all resources have been freed, free the socket space */
+        iptraceMEM_STATS_DELETE( pxSocket );
+        vPortFreeSocket( pxSocket );
+    }
 
     return NULL;
 } /* Tested */
@@ -1587,12 +1933,16 @@ void * vSocketClose( FreeRTOS_Socket_t * pxSocket )
  *        keep a pointer to it.
  *
  * @param[in] pxSocketToDelete: The socket being closed.
+ *
+ * @return The listening parent socket of a child socket, or NULL when
+ *         the socket being closed is not a child socket.
  */
-    static void prvTCPSetSocketCount( FreeRTOS_Socket_t const * pxSocketToDelete )
+    static FreeRTOS_Socket_t * prvTCPSetSocketCount( FreeRTOS_Socket_t const * pxSocketToDelete )
     {
         const ListItem_t * pxIterator;
         const ListItem_t * pxEnd = listGET_END_MARKER( &xBoundTCPSocketsList );
         FreeRTOS_Socket_t * pxOtherSocket;
+        FreeRTOS_Socket_t * pxParent = NULL;
         uint16_t usLocalPort = pxSocketToDelete->usLocalPort;
 
         for( pxIterator = listGET_NEXT( pxEnd );
@@ -1611,9 +1961,17 @@ void * vSocketClose( FreeRTOS_Socket_t * pxSocket )
                                          pxOtherSocket->u.xTCP.usChildCount,
                                          pxOtherSocket->u.xTCP.usBacklog,
                                          ( pxOtherSocket->u.xTCP.usChildCount == 1U ) ? "" : "ren" ) );
+
+                if( pxOtherSocket != pxSocketToDelete )
+                {
+                    pxParent = pxOtherSocket;
+                }
+
                 break;
             }
         }
+
+        return pxParent;
     }
 
 
@@ -1621,6 +1979,197 @@ void * vSocketClose( FreeRTOS_Socket_t * pxSocket )
 
 /*-----------------------------------------------------------*/
 
+#if ( ipconfigUSE_TCP == 1 ) && ( ipconfigTCP_LISTEN_CHILD_POOL == 1 )
+
+/**
+ * @brief Create idle child sockets for a listening socket, until the number of
+ *        children plus the number of idle children equals the backlog.
+ *        When an allocation fails, the pool just stays smaller: the IP-task
+ *        will create a new socket when the pool is empty.
+ *
+ * @param[in] pxSocket: The listening socket.
+ */
+    static void prvTCPChildPoolFill( FreeRTOS_Socket_t * pxSocket )
+    {
+        FreeRTOS_Socket_t * pxChild;
+
+        while( ( ( UBaseType_t ) pxSocket->u.xTCP.usChildCount + ( UBaseType_t ) pxSocket->u.xTCP.usChildPoolCount ) <
+               ( UBaseType_t ) pxSocket->u.xTCP.usBacklog )
+        {
+            pxChild = ( FreeRTOS_Socket_t * ) FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP );
+
+            if( ( pxChild == NULL ) || ( pxChild == FREERTOS_INVALID_SOCKET ) )
+            {
+                break;
+            }
+
+            pxChild->u.xTCP.pxChildPool = pxSocket->u.xTCP.pxChildPool;
+            pxSocket->u.xTCP.pxChildPool = pxChild;
+            pxSocket->u.xTCP.usChildPoolCount++;
+        }
+
+        FreeRTOS_debug_printf( ( "Pool: Socket %u has %u idle child%s\n",
+                                 pxSocket->usLocalPort,
+                                 pxSocket->u.xTCP.usChildPoolCount,
+                                 ( pxSocket->u.xTCP.usChildPoolCount == 1U ) ? "" : "ren" ) );
+    }
+    /*-----------------------------------------------------------*/
+
+/**
+ * @brief Take an idle child socket from the pool of a listening socket.
+ *        Called by the IP-task when a SYN has been received.
+ *
+ * @param[in] pxSocket: The listening socket.
+ *
+ * @return An idle child socket, or NULL when the pool is empty.
+ */
+    FreeRTOS_Socket_t * pxTCPChildPoolTake( FreeRTOS_Socket_t * pxSocket )
+    {
+        FreeRTOS_Socket_t * pxChild = pxSocket->u.xTCP.pxChildPool;
+
+        if( pxChild != NULL )
+        {
+            pxSocket->u.xTCP.pxChildPool = pxChild->u.xTCP.pxChildPool;
+            pxSocket->u.xTCP.usChildPoolCount--;
+            pxChild->u.xTCP.pxChildPool = NULL;
+        }
+
+        return pxChild;
+    }
+    /*-----------------------------------------------------------*/
+
+/**
+ * @brief A child socket that was taken from the pool has just received the
+ *        properties of its parent.  Streams of a previous connection are
+ *        only kept when they still have the requested size.
+ *
+ * @param[in] pxSocket: The child socket.
+ */
+    void vTCPChildPoolCheckStreams( FreeRTOS_Socket_t * pxSocket )
+    {
+        if( ( pxSocket->u.xTCP.rxStream != NULL ) &&
+            ( pxSocket->u.xTCP.rxStream->LENGTH != prvTCPStreamLength( pxSocket->u.xTCP.uxRxStreamSize ) ) )
+        {
+            iptraceMEM_STATS_DELETE( pxSocket->u.xTCP.rxStream );
+            vPortFreeStream( pxSocket->u.xTCP.rxStream );
+            pxSocket->u.xTCP.rxStream = NULL;
+        }
+
+        if( ( pxSocket->u.xTCP.txStream != NULL ) &&
+            ( pxSocket->u.xTCP.txStream->LENGTH != prvTCPStreamLength( pxSocket->u.xTCP.uxTxStreamSize ) ) )
+        {
+            iptraceMEM_STATS_DELETE( pxSocket->u.xTCP.txStream );
+            vPortFreeStream( pxSocket->u.xTCP.txStream );
+            pxSocket->u.xTCP.txStream = NULL;
+        }
+
+        if( pxSocket->u.xTCP.rxStream != NULL )
+        {
+            /* prvTCPCreateStream() will not be called, determine the limits here. */
+            if( pxSocket->u.xTCP.uxLittleSpace == 0UL )
+            {
+                pxSocket->u.xTCP.uxLittleSpace = ( sock20_PERCENT * pxSocket->u.xTCP.uxRxStreamSize ) / sock100_PERCENT;
+            }
+
+            if( pxSocket->u.xTCP.uxEnoughSpace == 0UL )
+            {
+                pxSocket->u.xTCP.uxEnoughSpace = ( sock80_PERCENT * pxSocket->u.xTCP.uxRxStreamSize ) / sock100_PERCENT;
+            }
+        }
+    }
+    /*-----------------------------------------------------------*/
+
+/**
+ * @brief Return a closed and unbound child socket to the pool of its parent.
+ *        The socket is cleared as if it was just created by FreeRTOS_socket(),
+ *        but it keeps its event group and its (emptied) streams.
+ *
+ * @param[in] pxParent: The listening socket.
+ * @param[in] pxSocket: The child socket that was closed.
+ */
+    static void prvTCPChildPoolPut( FreeRTOS_Socket_t * pxParent,
+                                    FreeRTOS_Socket_t * pxSocket )
+    {
+        EventGroupHandle_t xEventGroup = pxSocket->xEventGroup;
+        StreamBuffer_t * pxRxStream = pxSocket->u.xTCP.rxStream;
+        StreamBuffer_t * pxTxStream = pxSocket->u.xTCP.txStream;
+        size_t uxSocketSize = ( sizeof( *pxSocket ) - sizeof( pxSocket->u ) ) + sizeof( pxSocket->u.xTCP );
+
+        ( void ) memset( pxSocket, 0, uxSocketSize );
+
+        pxSocket->xEventGroup = xEventGroup;
+        ( void ) xEventGroupClearBits( xEventGroup, ( EventBits_t ) eSOCKET_ALL );
+
+        if( pxRxStream != NULL )
+        {
+            vStreamBufferClear( pxRxStream );
+            pxSocket->u.xTCP.rxStream = pxRxStream;
+        }
+
+        if( pxTxStream != NULL )
+        {
+            vStreamBufferClear( pxTxStream );
+            pxSocket->u.xTCP.txStream = pxTxStream;
+        }
+
+        vListInitialiseItem( &( pxSocket->xBoundSocketListItem ) );
+        listSET_LIST_ITEM_OWNER( &( pxSocket->xBoundSocketListItem ), ipPOINTER_CAST( void *, pxSocket ) );
+
+        #if ( ipconfigSUPPORT_SELECT_FUNCTION == 1 ) && ( ipconfigSELECT_USES_READY_LIST == 1 )
+            {
+                vListInitialiseItem( &( pxSocket->xReadyListItem ) );
+                listSET_LIST_ITEM_OWNER( &( pxSocket->xReadyListItem ), ipPOINTER_CAST( void *, pxSocket ) );
+            }
+        #endif
+
+        pxSocket->ucProtocol = ( uint8_t ) FREERTOS_IPPROTO_TCP;
+        pxSocket->u.xTCP.usCurMSS = ( uint16_t ) ipconfigTCP_MSS;
+        pxSocket->u.xTCP.usInitMSS = ( uint16_t ) ipconfigTCP_MSS;
+
+        pxSocket->u.xTCP.pxChildPool = pxParent->u.xTCP.pxChildPool;
+        pxParent->u.xTCP.pxChildPool = pxSocket;
+        pxParent->u.xTCP.usChildPoolCount++;
+    }
+    /*-----------------------------------------------------------*/
+
+/**
+ * @brief Free the idle child sockets of a listening socket.
+ *
+ * @param[in] pxSocket: The listening socket being closed.
+ */
+    static void prvTCPChildPoolFree( FreeRTOS_Socket_t * pxSocket )
+    {
+        FreeRTOS_Socket_t * pxChild;
+
+        while( pxSocket->u.xTCP.pxChildPool != NULL )
+        {
+            pxChild = pxSocket->u.xTCP.pxChildPool;
+            pxSocket->u.xTCP.pxChildPool = pxChild->u.xTCP.pxChildPool;
+
+            if( pxChild->u.xTCP.rxStream != NULL )
+            {
+                iptraceMEM_STATS_DELETE( pxChild->u.xTCP.rxStream );
+                vPortFreeStream( pxChild->u.xTCP.rxStream );
+            }
+
+            if( pxChild->u.xTCP.txStream != NULL )
+            {
+                iptraceMEM_STATS_DELETE( pxChild->u.xTCP.txStream );
+                vPortFreeStream( pxChild->u.xTCP.txStream );
+            }
+
+            vEventGroupDelete( pxChild->xEventGroup );
+            iptraceMEM_STATS_DELETE( pxChild );
+            vPortFreeSocket( pxChild );
+        }
+
+        pxSocket->u.xTCP.usChildPoolCount = 0U;
+    }
+
+#endif /* ( ipconfigUSE_TCP == 1 ) && ( ipconfigTCP_LISTEN_CHILD_POOL == 1 ) */
+
+/*-----------------------------------------------------------*/
+
 #if ( ipconfigUSE_TCP == 1 )
 
 /**
@@ -2047,6 +2596,34 @@ BaseType_t FreeRTOS_setsockopt( Socket_t xSocket,
                    }
                     xReturn = 0;
                     break;
+
+                #if ( ipconfigSUPPORT_SELECT_FUNCTION == 1 ) && ( ipconfigSELECT_USES_READY_LIST == 1 )
+                    case FREERTOS_SO_SELECT_RCVLOWAT: /* Report eSELECT_READ once this many bytes can be read. */
+                    case FREERTOS_SO_SELECT_SNDLOWAT: /* Report eSELECT_WRITE once this many bytes can be queued. */
+                       {
+                           if( pxSocket->ucProtocol != ( uint8_t ) FREERTOS_IPPROTO_TCP )
+                           {
+                               break; /* will return -pdFREERTOS_ERRNO_EINVAL */
+                           }
+
+                           if( lOptionName == FREERTOS_SO_SELECT_RCVLOWAT )
+                           {
+                               pxSocket->uxSelectRxLow = *( ( const size_t * ) pvOptionValue );
+                           }
+                           else
+                           {
+                               pxSocket->uxSelectTxLow = *( ( const size_t * ) pvOptionValue );
+                           }
+
+                           if( pxSocket->pxSocketSet != NULL )
+                           {
+                               /* With a lower mark, the socket may be ready now. */
+                               prvFindSelectedSocket( pxSocket->pxSocketSet );
+                           }
+                       }
+                        xReturn = 0;
+                        break;
+                #endif /* ( ipconfigSUPPORT_SELECT_FUNCTION == 1 ) && ( ipconfigSELECT_USES_READY_LIST == 1 ) */
             #endif /* ipconfigUSE_TCP == 1 */
 
         default:
@@ -2584,6 +3161,13 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t * pxSocket )
                 if( xSelectBits != 0UL )
                 {
                     pxSocket->xSocketBits |= xSelectBits;
+
+                    #if ( ipconfigSELECT_USES_READY_LIST == 1 )
+                        {
+                            prvSocketSetReady( pxSocket );
+                        }
+                    #endif
+
                     ( void ) xEventGroupSetBits( pxSocket->pxSocketSet->xSelectGroup, xSelectBits );
                 }
             }
@@ -3578,6 +4162,17 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t * pxSocket )
                 pxSocket->u.xTCP.bits.bReuseSocket = pdTRUE;
             }
 
+            #if ( ipconfigTCP_LISTEN_CHILD_POOL == 1 )
+                {
+                    /* The pool must be filled before the IP-task sees the
+                     * eTCP_LISTEN state. */
+                    if( pxSocket->u.xTCP.bits.bReuseSocket == pdFALSE_UNSIGNED )
+                    {
+                        prvTCPChildPoolFill( pxSocket );
+                    }
+                }
+            #endif /* ipconfigTCP_LISTEN_CHILD_POOL */
+
             vTCPStateChange( pxSocket, eTCP_LISTEN );
         }
 
@@ -3832,6 +4427,29 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t * pxSocket )
 
 #if ( ipconfigUSE_TCP == 1 )
 
+/**
+ * @brief Calculate the LENGTH of a stream buffer that can hold a given
+ *        number of bytes.
+ *
+ * @param[in] uxStreamSize: The requested stream size.
+ *
+ * @return The stream size plus 4 (or 8) bytes, rounded down to a multiple
+ *         of sizeof( size_t ).
+ */
+    static size_t prvTCPStreamLength( size_t uxStreamSize )
+    {
+        size_t uxLength = uxStreamSize;
+
+        /* Add an extra 4 (or 8) bytes. */
+        uxLength += sizeof( size_t );
+
+        /* And make the length a multiple of sizeof( size_t ). */
+        uxLength &= ~( sizeof( size_t ) - 1U );
+
+        return uxLength;
+    }
+    /*-----------------------------------------------------------*/
+
 /**
  * @brief Create the stream buffer for the given socket.
  *
@@ -3868,15 +4486,11 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t * pxSocket )
             uxLength = pxSocket->u.xTCP.uxTxStreamSize;
         }
 
-        /* Add an extra 4 (or 8) bytes. */
-        uxLength += sizeof( size_t );
-
-        /* And make the length a multiple of sizeof( size_t ). */
-        uxLength &= ~( sizeof( size_t ) - 1U );
+        uxLength = prvTCPStreamLength( uxLength );
 
         uxSize = ( sizeof( *pxBuffer ) + uxLength ) - sizeof( pxBuffer->ucArray );
 
-        pxBuffer = ipCAST_PTR_TO_TYPE_PTR( StreamBuffer_t, pvPortMallocLarge( uxSize ) );
+        pxBuffer = ipCAST_PTR_TO_TYPE_PTR( StreamBuffer_t, pvPortMallocStream( uxSize ) );
 
         if( pxBuffer == NULL )
         {
@@ -4526,6 +5140,118 @@ BaseType_t xSocketValid( Socket_t xSocket )
 
 #if ( ipconfigSUPPORT_SELECT_FUNCTION == 1 )
 
+/**
+ * @brief Find out which of the events that the owner of a socket set is
+ *        interested in, have occurred for a socket.
+ *
+ * @param[in] pxSocket: The socket to be checked.
+ *
+ * @return A combination of eSELECT_READ, eSELECT_WRITE and eSELECT_EXCEPT.
+ */
+    static EventBits_t prvSocketSelectBits( FreeRTOS_Socket_t * pxSocket )
+    {
+        EventBits_t xSocketBits;
+
+        xSocketBits = 0;
+
+        #if ( ipconfigUSE_TCP == 1 )
+            if( pxSocket->ucProtocol == ( uint8_t ) FREERTOS_IPPROTO_TCP )
+            {
+                /* Check if the socket has already been accepted by the
+                 * owner.  If not, it is useless to return it from a
+                 * select(). */
+                BaseType_t bAccepted = pdFALSE;
+
+                if( pxSocket->u.xTCP.bits.bPassQueued == pdFALSE_UNSIGNED )
+                {
+                    if( pxSocket->u.xTCP.bits.bPassAccept == pdFALSE_UNSIGNED )
+                    {
+                        bAccepted = pdTRUE;
+                    }
+                }
+
+                /* Is the set owner interested in READ events? */
+                if( ( pxSocket->xSelectBits & ( EventBits_t ) eSELECT_READ ) != ( EventBits_t ) 0U )
+                {
+                    if( pxSocket->u.xTCP.ucTCPState == ( uint8_t ) eTCP_LISTEN )
+                    {
+                        if( ( pxSocket->u.xTCP.pxPeerSocket != NULL ) && ( pxSocket->u.xTCP.pxPeerSocket->u.xTCP.bits.bPassAccept != pdFALSE_UNSIGNED ) )
+                        {
+                            xSocketBits |= ( EventBits_t ) eSELECT_READ;
+                        }
+                    }
+                    else if( ( pxSocket->u.xTCP.bits.bReuseSocket != pdFALSE_UNSIGNED ) && ( pxSocket->u.xTCP.bits.bPassAccept != pdFALSE_UNSIGNED ) )
+                    {
+                        /* This socket has the re-use flag. After connecting it turns into
+                         * a connected socket. Set the READ event, so that accept() will be called. */
+                        xSocketBits |= ( EventBits_t ) eSELECT_READ;
+                    }
+                    else if( ( bAccepted != 0 ) && ( FreeRTOS_recvcount( pxSocket ) > 0 ) )
+                    {
+                        xSocketBits |= ( EventBits_t ) eSELECT_READ;
+                    }
+                    else
+                    {
+                        /* Nothing. */
+                    }
+                }
+
+                /* Is the set owner interested in EXCEPTION events? */
+                if( ( pxSocket->xSelectBits & ( EventBits_t ) eSELECT_EXCEPT ) != 0U )
+                {
+                    if( ( pxSocket->u.xTCP.ucTCPState == ( uint8_t ) eCLOSE_WAIT ) || ( pxSocket->u.xTCP.ucTCPState == ( uint8_t ) eCLOSED ) )
+                    {
+                        xSocketBits |= ( EventBits_t ) eSELECT_EXCEPT;
+                    }
+                }
+
+                /* Is the set owner interested in WRITE events? */
+                if( ( pxSocket->xSelectBits & ( EventBits_t ) eSELECT_WRITE ) != 0U )
+                {
+                    BaseType_t bMatch = pdFALSE;
+
+                    if( bAccepted != 0 )
+                    {
+                        if( FreeRTOS_tx_space( pxSocket ) > 0 )
+                        {
+                            bMatch = pdTRUE;
+                        }
+                    }
+
+                    if( bMatch == pdFALSE )
+                    {
+                        if( ( pxSocket->u.xTCP.bits.bConnPrepared != pdFALSE_UNSIGNED ) &&
+                            ( pxSocket->u.xTCP.ucTCPState >= ( uint8_t ) eESTABLISHED ) &&
+                            ( pxSocket->u.xTCP.bits.bConnPassed == pdFALSE_UNSIGNED ) )
+                        {
+                            pxSocket->u.xTCP.bits.bConnPassed = pdTRUE;
+                            bMatch = pdTRUE;
+                        }
+                    }
+
+                    if( bMatch != pdFALSE )
+                    {
+                        xSocketBits |= ( EventBits_t ) eSELECT_WRITE;
+                    }
+                }
+            }
+            else
+        #endif /* ipconfigUSE_TCP == 1 */
+        {
+            /* Select events for UDP are simpler. */
+            if( ( ( pxSocket->xSelectBits & ( EventBits_t ) eSELECT_READ ) != 0U ) &&
+                ( listCURRENT_LIST_LENGTH( &( pxSocket->u.xUDP.xWaitingPacketsList ) ) > 0U ) )
+            {
+                xSocketBits |= ( EventBits_t ) eSELECT_READ;
+            }
+
+            /* The WRITE and EXCEPT bits are not used for UDP */
+        } /* if( pxSocket->ucProtocol == FREERTOS_IPPROTO_TCP ) */
+
+        return xSocketBits;
+    }
+    /*-----------------------------------------------------------*/
+
 /**
  * @brief This internal non-blocking function will check all sockets that belong
  *        to a select set.  The events bits of each socket will be updated, and it
@@ -4577,105 +5303,20 @@ BaseType_t xSocketValid( Socket_t xSocket )
                     continue;
                 }
 
-                xSocketBits = 0;
-
-                #if ( ipconfigUSE_TCP == 1 )
-                    if( pxSocket->ucProtocol == ( uint8_t ) FREERTOS_IPPROTO_TCP )
-                    {
-                        /* Check if the socket has already been accepted by the
-                         * owner.  If not, it is useless to return it from a
-                         * select(). */
-                        BaseType_t bAccepted = pdFALSE;
-
-                        if( pxSocket->u.xTCP.bits.bPassQueued == pdFALSE_UNSIGNED )
-                        {
-                            if( pxSocket->u.xTCP.bits.bPassAccept == pdFALSE_UNSIGNED )
-                            {
-                                bAccepted = pdTRUE;
-                            }
-                        }
-
-                        /* Is the set owner interested in READ events? */
-                        if( ( pxSocket->xSelectBits & ( EventBits_t ) eSELECT_READ ) != ( EventBits_t ) 0U )
-                        {
-                            if( pxSocket->u.xTCP.ucTCPState == ( uint8_t ) eTCP_LISTEN )
-                            {
-                                if( ( pxSocket->u.xTCP.pxPeerSocket != NULL ) && ( pxSocket->u.xTCP.pxPeerSocket->u.xTCP.bits.bPassAccept != pdFALSE_UNSIGNED ) )
-                                {
-                                    xSocketBits |= ( EventBits_t ) eSELECT_READ;
-                                }
-                            }
-                            else if( ( pxSocket->u.xTCP.bits.bReuseSocket != pdFALSE_UNSIGNED ) && ( pxSocket->u.xTCP.bits.bPassAccept != pdFALSE_UNSIGNED ) )
-                            {
-                                /* This socket has the re-use flag. After connecting it turns into
-                                 * a connected socket. Set the READ event, so that accept() will be called. */
-                                xSocketBits |= ( EventBits_t ) eSELECT_READ;
-                            }
-                            else if( ( bAccepted != 0 ) && ( FreeRTOS_recvcount( pxSocket ) > 0 ) )
-                            {
-                                xSocketBits |= ( EventBits_t ) eSELECT_READ;
-                            }
-                            else
-                            {
-                                /* Nothing. */
-                            }
-                        }
+                xSocketBits = prvSocketSelectBits( pxSocket );
 
-                        /* Is the set owner interested in EXCEPTION events? */
-                        if( ( pxSocket->xSelectBits & ( EventBits_t ) eSELECT_EXCEPT ) != 0U )
-                        {
-                            if( ( pxSocket->u.xTCP.ucTCPState == ( uint8_t ) eCLOSE_WAIT ) || ( pxSocket->u.xTCP.ucTCPState == ( uint8_t ) eCLOSED ) )
-                            {
-                                xSocketBits |= ( EventBits_t ) eSELECT_EXCEPT;
-                            }
-                        }
+                /* Each socket keeps its own event flags, which are looked-up
+                 * by FreeRTOS_FD_ISSSET() */
+                pxSocket->xSocketBits = xSocketBits;
 
-                        /* Is the set owner interested in WRITE events? */
-                        if( ( pxSocket->xSelectBits & ( EventBits_t ) eSELECT_WRITE ) != 0U )
+                #if ( ipconfigSELECT_USES_READY_LIST == 1 )
+                    {
+                        if( xSocketBits != 0U )
                         {
-                            BaseType_t bMatch = pdFALSE;
-
-                            if( bAccepted != 0 )
-                            {
-                                if( FreeRTOS_tx_space( pxSocket ) > 0 )
-                                {
-                                    bMatch = pdTRUE;
-                                }
-                            }
-
-                            if( bMatch == pdFALSE )
-                            {
-                                if( ( pxSocket->u.xTCP.bits.bConnPrepared != pdFALSE_UNSIGNED ) &&
-                                    ( pxSocket->u.xTCP.ucTCPState >= ( uint8_t ) eESTABLISHED ) &&
-                                    ( pxSocket->u.xTCP.bits.bConnPassed == pdFALSE_UNSIGNED ) )
-                                {
-                                    pxSocket->u.xTCP.bits.bConnPassed = pdTRUE;
-                                    bMatch = pdTRUE;
-                                }
-                            }
-
-                            if( bMatch != pdFALSE )
-                            {
-                                xSocketBits |= ( EventBits_t ) eSELECT_WRITE;
-                            }
+                            prvSocketSetReady( pxSocket );
                         }
                     }
-                    else
-                #endif /* ipconfigUSE_TCP == 1 */
-                {
-                    /* Select events for UDP are simpler. */
-                    if( ( ( pxSocket->xSelectBits & ( EventBits_t ) eSELECT_READ ) != 0U ) &&
-                        ( listCURRENT_LIST_LENGTH( &( pxSocket->u.xUDP.xWaitingPacketsList ) ) > 0U ) )
-                    {
-                        xSocketBits |= ( EventBits_t ) eSELECT_READ;
-                    }
-
-                    /* The WRITE and EXCEPT bits are not used for UDP */
-                } /* if( pxSocket->ucProtocol == FREERTOS_IPPROTO_TCP ) */
-
-                /* Each socket keeps its own event flags, which are looked-up
-                 * by FreeRTOS_FD_ISSSET() */
-                pxSocket->xSocketBits = xSocketBits;
+                #endif
 
                 /* The ORed value will be used to set the bits in the event
                  * group. */
@@ -4787,6 +5428,35 @@ BaseType_t xSocketValid( Socket_t xSocket )
 #endif /* ipconfigSUPPORT_SIGNALS */
 /*-----------------------------------------------------------*/
 
+#if ( ipconfigSUPPORT_SIGNALS != 0 ) && ( ipconfigSUPPORT_SELECT_FUNCTION == 1 )
+
+/**
+ * @brief Send a signal to the task which is waiting in FreeRTOS_select() for
+ *        a socket set.  The call to select() will return zero.
+ *
+ * @param[in] xSocketSet: The socket set that will be signalled.
+ */
+    BaseType_t FreeRTOS_SignalSocketSet( SocketSet_t xSocketSet )
+    {
+        SocketSelect_t * pxSocketSet = ( SocketSelect_t * ) xSocketSet;
+        BaseType_t xReturn;
+
+        if( ( pxSocketSet == NULL ) || ( pxSocketSet->xSelectGroup == NULL ) )
+        {
+            xReturn = -pdFREERTOS_ERRNO_EINVAL;
+        }
+        else
+        {
+            ( void ) xEventGroupSetBits( pxSocketSet->xSelectGroup, ( EventBits_t ) eSELECT_INTR );
+            xReturn = 0;
+        }
+
+        return xReturn;
+    }
+
+#endif /* ( ipconfigSUPPORT_SIGNALS != 0 ) && ( ipconfigSUPPORT_SELECT_FUNCTION == 1 ) */
+/*-----------------------------------------------------------*/
+
 #if 0
     #if ( ipconfigSUPPORT_SELECT_FUNCTION == 1 )
         struct pollfd
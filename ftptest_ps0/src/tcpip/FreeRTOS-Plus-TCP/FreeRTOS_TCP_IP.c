@@ -3747,8 +3747,20 @@
                 }
                 else
                 {
-                    FreeRTOS_Socket_t * pxNewSocket = ( FreeRTOS_Socket_t * )
-                                                      FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP );
+                    FreeRTOS_Socket_t * pxNewSocket = NULL;
+
+                    #if ( ipconfigTCP_LISTEN_CHILD_POOL == 1 )
+                        {
+                            /* Use an idle child socket, if the listening socket has one. */
+                            pxNewSocket = pxTCPChildPoolTake( pxSocket );
+                        }
+                    #endif /* ipconfigTCP_LISTEN_CHILD_POOL */
+
+                    if( pxNewSocket == NULL )
+                    {
+                        pxNewSocket = ( FreeRTOS_Socket_t * )
+                                      FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP );
+                    }
 
                     if( ( pxNewSocket == NULL ) || ( pxNewSocket == FREERTOS_INVALID_SOCKET ) )
                     {
@@ -3826,6 +3838,14 @@
         pxNewSocket->u.xTCP.uxRxWinSize = pxSocket->u.xTCP.uxRxWinSize;
         pxNewSocket->u.xTCP.uxTxWinSize = pxSocket->u.xTCP.uxTxWinSize;
 
+        #if ( ipconfigTCP_LISTEN_CHILD_POOL == 1 )
+            {
+                /* A socket from the pool may still own the streams of its
+                 * previous connection. */
+                vTCPChildPoolCheckStreams( pxNewSocket );
+            }
+        #endif /* ipconfigTCP_LISTEN_CHILD_POOL */
+
         #if ( ipconfigSOCKET_HAS_USER_SEMAPHORE == 1 )
             {
                 pxNewSocket->pxUserSemaphore = pxSocket->pxUserSemaphore;
@@ -3849,6 +3869,12 @@
                 {
                     pxNewSocket->pxSocketSet = pxSocket->pxSocketSet;
                     pxNewSocket->xSelectBits = pxSocket->xSelectBits | ( ( EventBits_t ) eSELECT_READ ) | ( ( EventBits_t ) eSELECT_EXCEPT );
+
+                    #if ( ipconfigSELECT_USES_READY_LIST == 1 )
+                        {
+                            pxNewSocket->pvSelectContext = pxSocket->pvSelectContext;
+                        }
+                    #endif
                 }
             }
         #endif /* ipconfigSUPPORT_SELECT_FUNCTION */
@@ -452,7 +452,7 @@
             /* Allocate space for 'xTCPSegments' and store them in 'xSegmentList'. */
 
             vListInitialise( &xSegmentList );
-            xTCPSegments = ipCAST_PTR_TO_TYPE_PTR( TCPSegment_t, pvPortMallocLarge( ( size_t ) ipconfigTCP_WIN_SEG_COUNT * sizeof( xTCPSegments[ 0 ] ) ) );
+            xTCPSegments = ipCAST_PTR_TO_TYPE_PTR( TCPSegment_t, pvPortMallocSegments( ( size_t ) ipconfigTCP_WIN_SEG_COUNT * sizeof( xTCPSegments[ 0 ] ) ) );
 
             if( xTCPSegments == NULL )
             {
@@ -918,7 +918,7 @@
              * function. */
             if( xTCPSegments != NULL )
             {
-                vPortFreeLarge( xTCPSegments );
+                vPortFreeSegments( xTCPSegments );
                 xTCPSegments = NULL;
             }
         }
@@ -237,12 +237,59 @@
     #define FreeRTOS_flush_logging()    do {} while( ipFALSE_BOOL )
 #endif
 
+/* When ipconfigUSE_SLAB_ALLOCATOR is 1, sockets, stream buffers, the TCP
+ * window segments and the clients of the TCP servers are allocated from
+ * per-type caches, see FreeRTOS_Slab.c.  Objects go back to their cache when
+ * they are freed, they are never returned to the heap. */
+#ifndef ipconfigUSE_SLAB_ALLOCATOR
+    #define ipconfigUSE_SLAB_ALLOCATOR    0
+#endif
+
+/* The number of different object sizes that each type can cache. */
+#ifndef ipconfigSLAB_SIZE_CLASSES
+    #define ipconfigSLAB_SIZE_CLASSES    4
+#endif
+
+/* The number of bytes that a cache takes from the heap when it runs out of
+ * objects.  Objects that are larger than this are taken one by one. */
+#ifndef ipconfigSLAB_CHUNK_SIZE
+    #define ipconfigSLAB_CHUNK_SIZE    8192U
+#endif
+
+#if ( ipconfigUSE_SLAB_ALLOCATOR == 1 )
+    #ifndef pvPortMallocSocket
+        #define pvPortMallocSocket( x )    pvSlabMalloc( eSlabSocket, x )
+    #endif
+
+    #ifndef vPortFreeSocket
+        #define vPortFreeSocket( ptr )    vSlabFree( ptr )
+    #endif
+
+    #ifndef pvPortMallocStream
+        #define pvPortMallocStream( x )    pvSlabMalloc( eSlabStream, x )
+    #endif
+
+    #ifndef vPortFreeStream
+        #define vPortFreeStream( ptr )    vSlabFree( ptr )
+    #endif
+
+    #ifndef pvPortMallocSegments
+        #define pvPortMallocSegments( x )    pvSlabMalloc( eSlabWinSegments, x )
+    #endif
+
+    #ifndef vPortFreeSegments
+        #define vPortFreeSegments( ptr )    vSlabFree( ptr )
+    #endif
+#endif /* ipconfigUSE_SLAB_ALLOCATOR */
+
 /* Malloc functions. Within most applications of FreeRTOS, the couple
  * pvPortMalloc()/vPortFree() will be used.
  * If there is also SDRAM, the user may decide to use a different memory
  * allocator:
  * MallocLarge is used to allocate large TCP buffers (for Rx/Tx)
  * MallocSocket is used to allocate the space for the sockets
+ * MallocStream is used to allocate the stream buffers of TCP sockets
+ * MallocSegments is used to allocate the pool of TCP window segments
  */
 #ifndef pvPortMallocLarge
     #define pvPortMallocLarge( x )    pvPortMalloc( x )
@@ -260,6 +307,22 @@
     #define vPortFreeSocket( ptr )    vPortFree( ptr )
 #endif
 
+#ifndef pvPortMallocStream
+    #define pvPortMallocStream( x )    pvPortMallocLarge( x )
+#endif
+
+#ifndef vPortFreeStream
+    #define vPortFreeStream( ptr )    vPortFreeLarge( ptr )
+#endif
+
+#ifndef pvPortMallocSegments
+    #define pvPortMallocSegments( x )    pvPortMallocLarge( x )
+#endif
+
+#ifndef vPortFreeSegments
+    #define vPortFreeSegments( ptr )    vPortFreeLarge( ptr )
+#endif
+
 /*
  * At several places within the library, random numbers are needed:
  * - DHCP:    For creating a DHCP transaction number
@@ -582,6 +645,18 @@
     #define ipconfigSUPPORT_SELECT_FUNCTION    0
 #endif
 
+/* When set to 1, the IP-task keeps a list of ready sockets for every socket
+ * set, which can be retrieved with FreeRTOS_select_ready().  Only available
+ * when ipconfigSUPPORT_SELECT_FUNCTION is 1. */
+#ifndef ipconfigSELECT_USES_READY_LIST
+    #define ipconfigSELECT_USES_READY_LIST    0
+#endif
+
+#if ( ipconfigSUPPORT_SELECT_FUNCTION == 0 )
+    #undef ipconfigSELECT_USES_READY_LIST
+    #define ipconfigSELECT_USES_READY_LIST    0
+#endif
+
 #ifndef ipconfigTCP_KEEP_ALIVE
     #define ipconfigTCP_KEEP_ALIVE    0
 #endif
@@ -609,6 +684,14 @@
     #define ipconfigTCP_HANG_PROTECTION_TIME    30U
 #endif
 
+/* When set to 1, a listening TCP socket creates its child sockets in advance
+ * (as many as its backlog) and takes them back when they get closed.  A burst
+ * of incoming connections can then be served by the IP-task without having to
+ * allocate sockets and streams from the heap. */
+#ifndef ipconfigTCP_LISTEN_CHILD_POOL
+    #define ipconfigTCP_LISTEN_CHILD_POOL    0
+#endif
+
 #ifndef ipconfigTCP_IP_SANITY
     #define ipconfigTCP_IP_SANITY    0
 #endif
@@ -638,6 +638,10 @@
                                             * TCP win segments */
             uint8_t ucTCPState;            /**< TCP state: see eTCP_STATE */
             struct xSOCKET * pxPeerSocket; /**< for server socket: child, for child socket: parent */
+            #if ( ipconfigTCP_LISTEN_CHILD_POOL == 1 )
+                struct xSOCKET * pxChildPool; /**< for server socket: first idle child, for an idle child: next idle child */
+                uint16_t usChildPoolCount;    /**< In case of a listening socket: number of idle children in pxChildPool */
+            #endif /* ipconfigTCP_LISTEN_CHILD_POOL */
             #if ( ipconfigTCP_KEEP_ALIVE == 1 )
                 uint8_t ucKeepRepCount;
                 TickType_t xLastAliveTime; /**< The last value of keepalive time.*/
@@ -737,6 +741,12 @@
 
             EventBits_t xSocketBits;          /**< These bits indicate the events which have actually occurred.
                                                * They are maintained by the IP-task */
+            #if ( ipconfigSELECT_USES_READY_LIST == 1 )
+                ListItem_t xReadyListItem;    /**< Used to reference the socket from the ready list of its socket set. */
+                void * pvSelectContext;       /**< The user value returned by FreeRTOS_select_ready(). */
+                size_t uxSelectRxLow;         /**< eSELECT_READ is not reported while fewer bytes can be read, see FREERTOS_SO_SELECT_RCVLOWAT. */
+                size_t uxSelectTxLow;         /**< eSELECT_WRITE is not reported while less space is free, see FREERTOS_SO_SELECT_SNDLOWAT. */
+            #endif /* ipconfigSELECT_USES_READY_LIST */
         #endif /* ipconfigSUPPORT_SELECT_FUNCTION */
         /* TCP/UDP specific fields: */
         /* Before accessing any member of this structure, it should be confirmed */
@@ -847,6 +857,22 @@
  */
     void * vSocketClose( FreeRTOS_Socket_t * pxSocket );
 
+    #if ( ipconfigUSE_TCP == 1 ) && ( ipconfigTCP_LISTEN_CHILD_POOL == 1 )
+
+/*
+ * Defined in FreeRTOS_Sockets.c
+ * Take an idle child socket from the pool of a listening socket, or return
+ * NULL when the pool is empty.
+ */
+        FreeRTOS_Socket_t * pxTCPChildPoolTake( FreeRTOS_Socket_t * pxSocket );
+
+/*
+ * A child socket taken from the pool may still own the streams of its
+ * previous connection.  Keep them only when their size is still correct.
+ */
+        void vTCPChildPoolCheckStreams( FreeRTOS_Socket_t * pxSocket );
+    #endif /* ( ipconfigUSE_TCP == 1 ) && ( ipconfigTCP_LISTEN_CHILD_POOL == 1 ) */
+
 /*
  * Send the event eEvent to the IP task event queue, using a block time of
  * zero.  Return pdPASS if the message was sent successfully, otherwise return
@@ -898,6 +924,12 @@
             /** @brief Event group for the socket select function.
              */
             EventGroupHandle_t xSelectGroup;
+            #if ( ipconfigSELECT_USES_READY_LIST == 1 )
+
+                /** @brief The sockets of this set for which an event has occurred.
+                 */
+                List_t xReadyList;
+            #endif /* ipconfigSELECT_USES_READY_LIST */
         } SocketSelect_t;
 
         extern ipDECL_CAST_PTR_FUNC_FOR_TYPE( SocketSelect_t );
@@ -0,0 +1,99 @@
+/*
+ * FreeRTOS+TCP V2.3.2
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/*
+ *  FreeRTOS_Slab.h
+ *
+ *  A slab allocator for objects that are created and deleted often: sockets,
+ *  stream buffers, the clients of the TCP servers and the pool of TCP window
+ *  segments.  Every type has a small number of size classes, each with its
+ *  own list of free objects.  Objects are taken from the heap in chunks and
+ *  they are never returned to the heap, so allocation and release take a
+ *  constant time and the heap does not get fragmented.
+ */
+
+#ifndef FREERTOS_SLAB_H
+
+    #define FREERTOS_SLAB_H
+
+    #ifdef __cplusplus
+        extern "C" {
+    #endif
+
+    #if ( ipconfigUSE_SLAB_ALLOCATOR == 1 )
+
+/** @brief The types of objects that have their own caches. */
+        typedef enum eSLAB_TYPE
+        {
+            eSlabSocket = 0,  /**< FreeRTOS_Socket_t, UDP and TCP. */
+            eSlabStream,      /**< StreamBuffer_t of a TCP socket. */
+            eSlabTCPClient,   /**< TCPClient_t of the FTP and HTTP servers. */
+            eSlabWinSegments, /**< The pool of TCP window segments. */
+            eSlabTypeCount
+        } eSlabType_t;
+
+/** @brief Usage statistics of a single size class. */
+        typedef struct xSLAB_STATS
+        {
+            size_t uxObjectSize;     /**< Size of the objects, 0 when the class is not used yet. */
+            UBaseType_t uxCreated;   /**< Number of objects taken from the heap. */
+            UBaseType_t uxInUse;     /**< Number of objects currently allocated. */
+            UBaseType_t uxMaxInUse;  /**< The highest value of uxInUse. */
+            uint32_t ulAllocCount;   /**< Number of successful allocations. */
+            uint32_t ulFailCount;    /**< Number of allocations that failed. */
+        } SlabStats_t;
+
+/*
+ * Allocate an object of a given type and size.  Returns NULL when the heap
+ * is exhausted.
+ */
+        void * pvSlabMalloc( eSlabType_t eType,
+                             size_t uxSize );
+
+/*
+ * Return an object to the cache from where it was allocated.
+ */
+        void vSlabFree( void * pvObject );
+
+/*
+ * Get the statistics of size class 'uxClass' of a type.  Returns pdFAIL when
+ * the parameters are out of range.
+ */
+        BaseType_t xSlabGetStats( eSlabType_t eType,
+                                  UBaseType_t uxClass,
+                                  SlabStats_t * pxStats );
+
+/*
+ * Log the statistics of all size classes in use, using FreeRTOS_printf().
+ */
+        void vSlabPrintStats( void );
+
+    #endif /* ipconfigUSE_SLAB_ALLOCATOR */
+
+    #ifdef __cplusplus
+        } /* extern "C" */
+    #endif
+
+#endif /* !defined( FREERTOS_SLAB_H ) */
@@ -137,6 +137,11 @@
 
     #define FREERTOS_SO_SET_LOW_HIGH_WATER            ( 18 )
 
+    #if ( ipconfigSUPPORT_SELECT_FUNCTION == 1 ) && ( ipconfigSELECT_USES_READY_LIST == 1 )
+        #define FREERTOS_SO_SELECT_RCVLOWAT           ( 19 ) /* FreeRTOS_select_ready() reports eSELECT_READ once this many bytes can be read, parameter is pointer to size_t */
+        #define FREERTOS_SO_SELECT_SNDLOWAT           ( 20 ) /* FreeRTOS_select_ready() reports eSELECT_WRITE once this many bytes can be queued, parameter is pointer to size_t */
+    #endif
+
     #define FREERTOS_NOT_LAST_IN_FRAGMENTED_PACKET    ( 0x80 ) /* For internal use only, but also part of an 8-bit bitwise value. */
     #define FREERTOS_FRAGMENTED_PACKET                ( 0x40 ) /* For internal use only, but also part of an 8-bit bitwise value. */
 
@@ -294,6 +299,12 @@
  * version). */
             BaseType_t FreeRTOS_SignalSocketFromISR( Socket_t xSocket,
                                                      BaseType_t * pxHigherPriorityTaskWoken );
+
+            #if ( ipconfigSUPPORT_SELECT_FUNCTION == 1 )
+                /* Send a signal to the task which is waiting in select() for
+                 * a socket set, even if the set contains no sockets. */
+                BaseType_t FreeRTOS_SignalSocketSet( SocketSet_t xSocketSet );
+            #endif
         #endif /* ipconfigSUPPORT_SIGNALS */
 
 /* Return the remote address and IP port. */
@@ -497,6 +508,24 @@
         BaseType_t FreeRTOS_select( SocketSet_t xSocketSet,
                                     TickType_t xBlockTimeTicks );
 
+        #if ( ipconfigSELECT_USES_READY_LIST == 1 )
+
+/* A socket that is returned by FreeRTOS_select_ready(). */
+            typedef struct xSOCKET_READY
+            {
+                Socket_t xSocket;    /**< The socket for which events have occurred. */
+                EventBits_t xEvents; /**< A combination of eSELECT_READ, eSELECT_WRITE and eSELECT_EXCEPT. */
+                void * pvContext;    /**< The value given to FreeRTOS_FD_SetContext(). */
+            } SocketReady_t;
+
+            void FreeRTOS_FD_SetContext( Socket_t xSocket,
+                                         void * pvContext );
+            BaseType_t FreeRTOS_select_ready( SocketSet_t xSocketSet,
+                                              SocketReady_t * pxReady,
+                                              BaseType_t xMaxCount,
+                                              TickType_t xBlockTimeTicks );
+        #endif /* ipconfigSELECT_USES_READY_LIST */
+
     #endif /* ipconfigSUPPORT_SELECT_FUNCTION */
 
     #ifdef __cplusplus
@@ -260,6 +260,10 @@ extern UBaseType_t uxRand();
  * (and associated) API function is available. */
 #define ipconfigSUPPORT_SELECT_FUNCTION                       1
 
+/* Let FreeRTOS_select_ready() return only the sockets that have events, so
+ * that the servers do not have to visit every client. */
+#define ipconfigSELECT_USES_READY_LIST                        ( 1 )
+
 /* If ipconfigFILTER_OUT_NON_ETHERNET_II_FRAMES is set to 1 then Ethernet frames
  * that are not in Ethernet II format will be dropped.  This option is included for
  * potential future IP stack developments. */
@@ -307,6 +311,15 @@ extern UBaseType_t uxRand();
 #define ipconfigTCP_HANG_PROTECTION         ( 1 )
 #define ipconfigTCP_HANG_PROTECTION_TIME    ( 30 )
 
+/* Listening sockets create their child sockets in advance, as many as their
+ * backlog, and recycle them when they get closed. */
+#define ipconfigTCP_LISTEN_CHILD_POOL       ( 1 )
+
+/* Sockets, stream buffers, TCP window segments and the clients of the FTP and
+ * HTTP servers are allocated from per-type caches, which never return memory
+ * to the heap.  This avoids fragmentation of the heap after many sessions. */
+#define ipconfigUSE_SLAB_ALLOCATOR          ( 1 )
+
 /* Include support for TCP keep-alive messages. */
 #define ipconfigTCP_KEEP_ALIVE              ( 1 )
 #define ipconfigTCP_KEEP_ALIVE_INTERVAL     ( 20 ) /* in seconds */
@@ -345,8 +358,104 @@ FTP and HTTP servers both execute in the standard server task. */
 #define ipconfigHTTP_RX_BUFSIZE             ( ( 256 * 1024 ) - 1 )
 #define ipconfigHTTP_RX_WINSIZE             ( 12 )
 
+/* The HTTP server answers 'Range' requests with '206 Partial Content', so
+that downloads can be resumed or fetched in pieces.  Up to this number of
+ranges are sent in one multipart/byteranges reply. */
+#define ipconfigHTTP_MAX_RANGES             ( 8 )
+
+/* Up to this number of small files are kept in RAM by the HTTP server, together
+with the header of the reply, so that repeated requests do not access the disk.
+Files that are changed through FTP are checked again before being served. */
+#define ipconfigHTTP_CACHE_COUNT            ( 16 )
+#define ipconfigHTTP_CACHE_MAX_FILE         ( 32 * 1024 )
+
+/* Files are sent with an ETag and a Last-Modified header, taken from the FAT
+directory entry, so that browsers can poll pages with a conditional GET and
+get a '304 Not Modified' while nothing has changed. */
+#define ipconfigHTTP_HAS_VALIDATORS         ( 1 )
+
+/* A browser that accepts gzip gets 'bundle.js.gz' when it asks for 'bundle.js',
+if that exists.  The compressed files are made on the PC and uploaded with FTP. */
+#define ipconfigHTTP_HAS_GZIP               ( 1 )
+
+/* Web tools can store files, e.g. configuration bundles, with an HTTP PUT or
+POST to the URL of the file. */
+#define ipconfigHTTP_HAS_UPLOAD             ( 1 )
+
 //#define ipconfigTCP_FILE_BUFFER_SIZE        ( 8 * 1460 )
 
+/* When 1, RETR reads whole clusters of the file directly into the TX stream
+of the data socket, in stead of copying them through pcFileBuffer.  It stays
+off until it has been measured to be faster on the RAM disk. */
+#define ipconfigFTP_TX_ZERO_COPY            ( 0 )
+
+/* When a client does not announce the file size with ALLO, STOR reserves the
+clusters of the new file in steps of this many bytes. */
+#define ipconfigFTP_STOR_ALLOCATE_SIZE      ( 256 * 1024 )
+
+/* Listings made by LIST and MLSD are kept in a cache, so that mirroring
+clients that list the same directories again and again do not make the
+server read and format them each time.  A listing is sent from the cache
+until any directory on the disk changes. */
+#define ipconfigFTP_LIST_CACHE_COUNT        ( 4 )
+#define ipconfigFTP_LIST_CACHE_SIZE         ( 16 * 1024 )
+
+/* Keep a few passive data sockets bound and listening, so that PASV and EPSV
+can be answered without creating a new socket. */
+#define ipconfigFTP_PASV_POOL_SIZE          ( 4 )
+
+/* Accept 'MODE Z': RETR and STOR data are sent as a zlib stream, which saves
+a lot of bandwidth for text files.  Each compressed transfer allocates its own
+compressor (about 20 KB with a 4 KB window) or decompressor (about 34 KB). */
+#define ipconfigFTP_HAS_MODE_Z              ( 1 )
+#define ipconfigFTP_DEFLATE_LEVEL           ( 6 )
+#define ipconfigFTP_DEFLATE_WINDOW_BITS     ( 12 )
+
+/* Accept HASH, XCRC and XMD5, so that a client can verify a transfer without
+downloading the file again.  The digest of a file that is received with STOR
+is calculated on the fly, so that checking an upload costs no extra reading. */
+#define ipconfigFTP_HAS_HASH                ( 1 )
+#define ipconfigFTP_HASH_ON_STORE           ( 1 )
+
+/* Calculate a CRC-32 of every upload and keep it in a ".crc32" index next to
+the file, so that uploads can be validated without reading them again.  See
+'SITE CRC' and 'SITE CRCCHECK'. */
+#define ipconfigFTP_STORE_CRC               ( 1 )
+
+/* Files stored in "/mem" go straight to memory buffers or callbacks that the
+application registered with FreeRTOS_FTPAddMemorySink(), not to the disk.
+Likewise, memory regions registered with FreeRTOS_FTPAddMemorySource() can be
+retrieved from "/mem" as read-only files, without a copy on the RAM disk. */
+#define ipconfigFTP_MEMORY_SINK_COUNT       ( 4 )
+#define ipconfigFTP_MEMORY_SOURCE_COUNT     ( 4 )
+#define ipconfigFTP_MEMORY_DIRECTORY        "/mem"
+
+/* Keep statistics of every FTP session: the number of bytes and files, and of
+each transfer the time spent in the file system and waiting for the network.
+They are shown with 'SITE STATS' and read with FreeRTOS_FTPGetStats().  The
+global timer of the Cortex-A9 is used to measure time in microseconds. */
+#define ipconfigFTP_HAS_STATS               ( 1 )
+extern uint32_t ulFTPStatsClock( void );
+#define ipconfigFTP_STATS_CLOCK()           ulFTPStatsClock()
+#define ipconfigFTP_STATS_CLOCK_HZ          ( 1000000ul )
+
+/* The clients of the servers are divided among this number of tasks, so that
+a slow file access of one client does not hold up the others.  The workers
+are woken up with a signal when a client is handed over to them. */
+#define ipconfigTCP_SERVER_MAX_WORKERS      ( 4 )
+#define ipconfigSUPPORT_SIGNALS             ( 1 )
+
+/* The HTTP server closes connections that have been idle for 30 seconds, or
+of which the peer has disappeared.  The server task wakes up when the first of
+these time-outs expires. */
+#define ipconfigHTTP_IDLE_TIMEOUT_MS        ( 30000 )
+
+/* A client may transfer at most this number of bytes each time it is called,
+so that a bulk transfer does not delay the other clients of the same worker.
+It is a multiple of the cluster size.  A rate limit per client, in bytes per
+second, can be set with ipconfigTCP_SERVER_RATE_LIMIT. */
+#define ipconfigTCP_SERVER_QUANTUM          ( 64u * 1024u )
+
 #define portINLINE                          __inline
 
 #endif /* FREERTOS_IP_CONFIG_H */
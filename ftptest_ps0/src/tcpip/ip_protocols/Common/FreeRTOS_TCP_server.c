@@ -31,6 +31,7 @@
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
 #include "task.h"
+#include "queue.h"
 
 /* FreeRTOS+TCP includes. */
 #include "FreeRTOS_IP.h"
@@ -49,6 +50,29 @@
 	static void prvReceiveNewClient( TCPServer_t * pxServer,
 									 BaseType_t xIndex,
 									 Socket_t xNexSocket );
+	static void prvAddClient( TCPServer_t * pxServer,
+							  TCPClient_t * pxClient );
+	static void prvAcceptClients( TCPServer_t * pxServer );
+	static BaseType_t prvCallClient( TCPClient_t * pxClient );
+	static TickType_t prvBlockingTime( TCPServer_t * pxServer,
+									   TickType_t xBlockingTime );
+	#if ( ipconfigSELECT_USES_READY_LIST == 1 )
+		static BaseType_t prvWorkClient( TCPServer_t * pxServer,
+										 TCPClient_t * pxClient );
+		static void prvWorkDueClients( TCPServer_t * pxServer );
+	#else
+		static void prvWorkAllClients( TCPServer_t * pxServer );
+	#endif
+	#if ( tcpserverHAS_BUDGET != 0 )
+		static void prvBudgetGrant( TCPClient_t * pxClient );
+		static void prvBudgetDelay( TCPServer_t * pxServer );
+	#endif
+	#if ( ipconfigTCP_SERVER_MAX_WORKERS > 1 )
+		static TCPServer_t * prvCreateWorker( void );
+		static void prvWorkerTask( void * pvParameters );
+		static TCPServer_t * prvSelectWorker( TCPServer_t * pxServer );
+		static void prvTakeNewClients( TCPServer_t * pxServer );
+	#endif
 	static char * strnew( const char * pcString );
 /* Remove slashes at the end of a path. */
 	static void prvRemoveSlash( char * pcDir );
@@ -158,6 +182,11 @@
 		FTCPWorkFunction fWorkFunc = NULL;
 		FTCPDeleteFunction fDeleteFunc = NULL;
 		const char * pcType = "Unknown";
+		struct freertos_sockaddr xRemoteAddress;
+
+		/* Once the client has been handed over to a worker, the socket may be
+		 * closed at any moment, so look up its address now. */
+		FreeRTOS_GetRemoteAddress( xNexSocket, &xRemoteAddress );
 
 		/*_RB_ Can the work and delete functions be part of the xSERVER_CONFIG structure
 		 * becomes generic, with no pre-processing required? */
@@ -188,24 +217,47 @@
 		/* Malloc enough space for a new HTTP-client */
 		if( xSize )
 		{
-			pxClient = ( TCPClient_t * ) pvPortMallocLarge( xSize );
+			pxClient = ( TCPClient_t * ) pvPortMallocClient( xSize );
 		}
 
 		if( pxClient != NULL )
 		{
 			memset( pxClient, '\0', xSize );
 
-			/* Put the new client in front of the list. */
 			pxClient->eType = pxServer->xServers[ xIndex ].eType;
 			pxClient->pcRootDir = pxServer->xServers[ xIndex ].pcRootDir;
-			pxClient->pxParent = pxServer;
 			pxClient->xSocket = xNexSocket;
-			pxClient->pxNextClient = pxServer->pxClients;
 			pxClient->fWorkFunction = fWorkFunc;
 			pxClient->fDeleteFunction = fDeleteFunc;
-			pxServer->pxClients = pxClient;
+			pxClient->ulRateLimit = ipconfigTCP_SERVER_RATE_LIMIT;
+			pxClient->xTokenTime = xTaskGetTickCount();
+
+			#if ( ipconfigTCP_SERVER_MAX_WORKERS > 1 )
+				{
+					TCPServer_t * pxWorker = prvSelectWorker( pxServer );
+
+					if( pxWorker != pxServer )
+					{
+						/* The worker will add the client to its own list and socket set.
+						 * A child socket starts in the set of its listening socket, take
+						 * it out, or this task would also see its events. */
+						pxClient->pxParent = pxWorker;
+						FreeRTOS_FD_CLR( xNexSocket, pxServer->xSocketSet, eSELECT_ALL );
+
+						if( xQueueSend( pxWorker->xNewClients, &( pxClient ), 0U ) == pdPASS )
+						{
+							( void ) FreeRTOS_SignalSocketSet( pxWorker->xSocketSet );
+							pcType = "handed over";
+							pxClient = NULL;
+						}
+					}
+				}
+			#endif /* ipconfigTCP_SERVER_MAX_WORKERS > 1 */
 
-			FreeRTOS_FD_SET( xNexSocket, pxServer->xSocketSet, eSELECT_READ | eSELECT_EXCEPT );
+			if( pxClient != NULL )
+			{
+				prvAddClient( pxServer, pxClient );
+			}
 		}
 		else
 		{
@@ -213,75 +265,561 @@
 			FreeRTOS_closesocket( xNexSocket );
 		}
 
-		{
-			struct freertos_sockaddr xRemoteAddress;
-			FreeRTOS_GetRemoteAddress( pxClient->xSocket, &xRemoteAddress );
-			FreeRTOS_printf( ( "TPC-server: new %s client %xip\n", pcType, ( unsigned ) FreeRTOS_ntohl( xRemoteAddress.sin_addr ) ) );
-		}
+		FreeRTOS_printf( ( "TPC-server: new %s client %xip\n", pcType, ( unsigned ) FreeRTOS_ntohl( xRemoteAddress.sin_addr ) ) );
 
 		/* Remove compiler warnings in case FreeRTOS_printf() is not used. */
 		( void ) pcType;
+		( void ) xRemoteAddress;
+
+		#if ( ipconfigSELECT_USES_READY_LIST == 1 )
+			{
+				if( pxClient != NULL )
+				{
+					/* A new socket has no events yet, but the client may want to
+					 * greet its peer.  Let it do a first cycle of work now. */
+					( void ) prvWorkClient( pxServer, pxClient );
+				}
+			}
+		#endif
 	}
 /*-----------------------------------------------------------*/
 
-	void FreeRTOS_TCPServerWork( TCPServer_t * pxServer,
-								 TickType_t xBlockingTime )
+	static void prvAddClient( TCPServer_t * pxServer,
+							  TCPClient_t * pxClient )
+	{
+		/* Put the new client in front of the list. */
+		pxClient->pxParent = pxServer;
+		pxClient->pxNextClient = pxServer->pxClients;
+		pxServer->pxClients = pxClient;
+		pxServer->xClientCount++;
+
+		#if ( ipconfigSELECT_USES_READY_LIST == 1 )
+			{
+				/* Let FreeRTOS_select_ready() return the client along with its socket. */
+				FreeRTOS_FD_SetContext( pxClient->xSocket, ( void * ) pxClient );
+			}
+		#endif
+
+		FreeRTOS_FD_SET( pxClient->xSocket, pxServer->xSocketSet, eSELECT_READ | eSELECT_EXCEPT );
+	}
+/*-----------------------------------------------------------*/
+
+	static void prvAcceptClients( TCPServer_t * pxServer )
 	{
-		TCPClient_t ** ppxClient;
 		BaseType_t xIndex;
+
+		for( xIndex = 0; xIndex < pxServer->xServerCount; xIndex++ )
+		{
+			struct freertos_sockaddr xAddress;
+			Socket_t xNexSocket;
+			socklen_t xSocketLength;
+
+			if( pxServer->xServers[ xIndex ].xSocket == FREERTOS_NO_SOCKET )
+			{
+				continue;
+			}
+
+			xSocketLength = sizeof( xAddress );
+			xNexSocket = FreeRTOS_accept( pxServer->xServers[ xIndex ].xSocket, &xAddress, &xSocketLength );
+
+			if( ( xNexSocket != FREERTOS_NO_SOCKET ) && ( xNexSocket != FREERTOS_INVALID_SOCKET ) )
+			{
+				prvReceiveNewClient( pxServer, xIndex, xNexSocket );
+			}
+		}
+	}
+/*-----------------------------------------------------------*/
+
+	#if ( ipconfigSELECT_USES_READY_LIST == 1 )
+
+		/* Let a client do its work.  When it returns a negative value, the client
+		 * is taken from the list and deleted.  Returns pdTRUE if it was deleted. */
+		static BaseType_t prvWorkClient( TCPServer_t * pxServer,
+										 TCPClient_t * pxClient )
+		{
+			TCPClient_t ** ppxClient;
+			BaseType_t xRc;
+			BaseType_t xDeleted = pdFALSE;
+
+			xRc = prvCallClient( pxClient );
+
+			if( xRc < 0 )
+			{
+				for( ppxClient = &pxServer->pxClients; ( *ppxClient ) != NULL; ppxClient = &( ( *ppxClient )->pxNextClient ) )
+				{
+					if( *ppxClient == pxClient )
+					{
+						*ppxClient = pxClient->pxNextClient;
+						break;
+					}
+				}
+
+				pxServer->xClientCount--;
+				/* Close handles, resources */
+				pxClient->fDeleteFunction( pxClient );
+				/* Free the space */
+				vPortFreeClient( pxClient );
+				xDeleted = pdTRUE;
+			}
+
+			return xDeleted;
+		}
+
+	#endif /* ipconfigSELECT_USES_READY_LIST */
+/*-----------------------------------------------------------*/
+
+	/* Call the work function of a client, which may transfer the share of
+	 * bytes that it is given, see uxTCPServerBudget(). */
+	static BaseType_t prvCallClient( TCPClient_t * pxClient )
+	{
 		BaseType_t xRc;
 
-		/* Let the server do one working cycle. */
-		xRc = FreeRTOS_select( pxServer->xSocketSet, xBlockingTime );
+		#if ( tcpserverHAS_BUDGET != 0 )
+			{
+				prvBudgetGrant( pxClient );
+			}
+		#endif
+
+		/* The client sets a new deadline if it still needs one. */
+		pxClient->xHasDeadline = pdFALSE;
+
+		/* Almost C++ */
+		xRc = pxClient->fWorkFunction( pxClient );
+
+		#if ( tcpserverHAS_BUDGET != 0 )
+			{
+				if( pxClient->lDeficit > 0 )
+				{
+					/* A client that had less to do than its share can not save
+					 * the rest for later. */
+					pxClient->lDeficit = 0;
+				}
+			}
+		#endif
 
-		if( xRc != 0 )
+		return xRc;
+	}
+/*-----------------------------------------------------------*/
+
+	#if ( tcpserverHAS_BUDGET != 0 )
+
+		static void prvBudgetGrant( TCPClient_t * pxClient )
 		{
-			for( xIndex = 0; xIndex < pxServer->xServerCount; xIndex++ )
+			#if ( ipconfigTCP_SERVER_QUANTUM > 0 )
+				{
+					pxClient->lDeficit += ipconfigTCP_SERVER_QUANTUM;
+				}
+			#endif
+
+			if( pxClient->ulRateLimit != 0u )
 			{
-				struct freertos_sockaddr xAddress;
-				Socket_t xNexSocket;
-				socklen_t xSocketLength;
+				TickType_t xNow = xTaskGetTickCount();
+				uint64_t ullTokens;
+				int32_t lBurst;
+
+				/* The tokens of 100 ms may be saved up, but at least 4 KB,
+				 * otherwise a slow client might never be able to transfer a
+				 * complete sector. */
+				lBurst = ( int32_t ) ( pxClient->ulRateLimit / 10u );
 
-				if( pxServer->xServers[ xIndex ].xSocket == FREERTOS_NO_SOCKET )
+				if( lBurst < 4096 )
 				{
-					continue;
+					lBurst = 4096;
 				}
 
-				xSocketLength = sizeof( xAddress );
-				xNexSocket = FreeRTOS_accept( pxServer->xServers[ xIndex ].xSocket, &xAddress, &xSocketLength );
+				ullTokens = ( ( uint64_t ) pxClient->ulRateLimit * ( uint64_t ) ( xNow - pxClient->xTokenTime ) ) / configTICK_RATE_HZ;
 
-				if( ( xNexSocket != FREERTOS_NO_SOCKET ) && ( xNexSocket != FREERTOS_INVALID_SOCKET ) )
+				/* At low rates a tick may be worth less than a byte, the time
+				 * is only advanced when tokens are added. */
+				if( ullTokens != 0u )
 				{
-					prvReceiveNewClient( pxServer, xIndex, xNexSocket );
+					pxClient->xTokenTime = xNow;
+
+					if( ullTokens >= ( uint64_t ) ( lBurst - pxClient->lTokens ) )
+					{
+						pxClient->lTokens = lBurst;
+					}
+					else
+					{
+						pxClient->lTokens += ( int32_t ) ullTokens;
+					}
 				}
 			}
 		}
+/*-----------------------------------------------------------*/
+
+		size_t uxTCPServerBudget( TCPClient_t * pxClient )
+		{
+			int32_t lBudget = 0x7fffffff;
+
+			#if ( ipconfigTCP_SERVER_QUANTUM > 0 )
+				{
+					lBudget = pxClient->lDeficit;
+				}
+			#endif
+
+			if( ( pxClient->ulRateLimit != 0u ) && ( pxClient->lTokens < lBudget ) )
+			{
+				lBudget = pxClient->lTokens;
+
+				if( lBudget <= 0 )
+				{
+					/* The client has to wait for new tokens. */
+					pxClient->pxParent->xThrottled = pdTRUE;
+				}
+			}
 
-		ppxClient = &pxServer->pxClients;
+			return ( lBudget > 0 ) ? ( size_t ) lBudget : 0u;
+		}
+/*-----------------------------------------------------------*/
 
-		while( ( *ppxClient ) != NULL )
+		void vTCPServerBudgetUse( TCPClient_t * pxClient,
+								  size_t uxCount )
 		{
-			TCPClient_t * pxThis = *ppxClient;
+			if( uxCount != 0u )
+			{
+				#if ( ipconfigTCP_SERVER_QUANTUM > 0 )
+					{
+						pxClient->lDeficit -= ( int32_t ) uxCount;
+					}
+				#endif
 
-			/* Almost C++ */
-			xRc = pxThis->fWorkFunction( pxThis );
+				if( pxClient->ulRateLimit != 0u )
+				{
+					pxClient->lTokens -= ( int32_t ) uxCount;
+				}
 
-			if( xRc < 0 )
+				pxClient->pxParent->xProgress = pdTRUE;
+			}
+		}
+/*-----------------------------------------------------------*/
+
+		/* A client that is stopped by the rate limit keeps its socket ready, so
+		 * select() would return at once.  When none of the clients could
+		 * transfer anything, give the tokens some time to come in. */
+		static void prvBudgetDelay( TCPServer_t * pxServer )
+		{
+			if( ( pxServer->xThrottled != pdFALSE ) && ( pxServer->xProgress == pdFALSE ) )
 			{
-				*ppxClient = pxThis->pxNextClient;
-				/* Close handles, resources */
-				pxThis->fDeleteFunction( pxThis );
-				/* Free the space */
-				vPortFreeLarge( pxThis );
+				vTaskDelay( 1u );
 			}
-			else
+
+			pxServer->xThrottled = pdFALSE;
+			pxServer->xProgress = pdFALSE;
+		}
+
+	#endif /* tcpserverHAS_BUDGET */
+/*-----------------------------------------------------------*/
+
+	void vTCPServerSetDeadline( TCPClient_t * pxClient,
+								TickType_t xTime )
+	{
+		pxClient->xDeadline = xTime;
+		pxClient->xHasDeadline = pdTRUE;
+	}
+/*-----------------------------------------------------------*/
+
+	/* Block no longer than 'xBlockingTime', nor beyond the nearest deadline of
+	 * the clients.  Without deadlines, the server is only driven by socket
+	 * events. */
+	static TickType_t prvBlockingTime( TCPServer_t * pxServer,
+									   TickType_t xBlockingTime )
+	{
+		TCPClient_t * pxClient;
+		TickType_t xNow = xTaskGetTickCount();
+		TickType_t xRemaining;
+
+		for( pxClient = pxServer->pxClients; pxClient != NULL; pxClient = pxClient->pxNextClient )
+		{
+			if( pxClient->xHasDeadline != pdFALSE )
 			{
-				ppxClient = &( pxThis->pxNextClient );
+				xRemaining = pxClient->xDeadline - xNow;
+
+				if( xRemaining > ( portMAX_DELAY / 2u ) )
+				{
+					/* The deadline has passed already. */
+					xRemaining = 0u;
+				}
+
+				if( xRemaining < xBlockingTime )
+				{
+					xBlockingTime = xRemaining;
+				}
 			}
 		}
+
+		return xBlockingTime;
 	}
 /*-----------------------------------------------------------*/
 
+	#if ( ipconfigSELECT_USES_READY_LIST == 1 )
+
+		/* Call the clients of which the deadline has passed. */
+		static void prvWorkDueClients( TCPServer_t * pxServer )
+		{
+			TCPClient_t * pxClient = pxServer->pxClients;
+			TickType_t xNow = xTaskGetTickCount();
+
+			while( pxClient != NULL )
+			{
+				/* The client may be deleted. */
+				TCPClient_t * pxNext = pxClient->pxNextClient;
+
+				if( ( pxClient->xHasDeadline != pdFALSE ) &&
+					( ( TickType_t ) ( xNow - pxClient->xDeadline ) <= ( portMAX_DELAY / 2u ) ) )
+				{
+					( void ) prvWorkClient( pxServer, pxClient );
+				}
+
+				pxClient = pxNext;
+			}
+		}
+
+	#endif /* ipconfigSELECT_USES_READY_LIST */
+/*-----------------------------------------------------------*/
+
+	#if ( ipconfigSELECT_USES_READY_LIST != 1 )
+
+		static void prvWorkAllClients( TCPServer_t * pxServer )
+		{
+			TCPClient_t ** ppxClient;
+
+			ppxClient = &pxServer->pxClients;
+
+			while( ( *ppxClient ) != NULL )
+			{
+				TCPClient_t * pxThis = *ppxClient;
+				BaseType_t xRc;
+
+				xRc = prvCallClient( pxThis );
+
+				if( xRc < 0 )
+				{
+					*ppxClient = pxThis->pxNextClient;
+					pxServer->xClientCount--;
+					/* Close handles, resources */
+					pxThis->fDeleteFunction( pxThis );
+
+					if( pxThis->pxKept != NULL )
+					{
+						vPortFreeLarge( pxThis->pxKept );
+					}
+
+					/* Free the space */
+					vPortFreeClient( pxThis );
+				}
+				else
+				{
+					ppxClient = &( pxThis->pxNextClient );
+				}
+			}
+		}
+
+	#endif /* ipconfigSELECT_USES_READY_LIST */
+/*-----------------------------------------------------------*/
+
+	#if ( ipconfigSELECT_USES_READY_LIST != 1 )
+
+		BaseType_t xTCPServerPeek( TCPClient_t * pxClient,
+								   char * pcBuffer,
+								   size_t uxSize )
+		{
+			size_t uxKept = 0u;
+			BaseType_t xRc = 0;
+
+			if( pxClient->pxKept != NULL )
+			{
+				uxKept = FreeRTOS_min_uint32( pxClient->pxKept->uxLength, uxSize );
+				memcpy( pcBuffer, pxClient->pxKept->pcData, uxKept );
+			}
+
+			if( uxKept < uxSize )
+			{
+				xRc = FreeRTOS_recv( pxClient->xSocket, ( void * ) ( pcBuffer + uxKept ), uxSize - uxKept, FREERTOS_MSG_PEEK | FREERTOS_MSG_DONTWAIT );
+			}
+
+			if( xRc >= 0 )
+			{
+				xRc += ( BaseType_t ) uxKept;
+			}
+
+			return xRc;
+		}
+/*-----------------------------------------------------------*/
+
+		BaseType_t xTCPServerTake( TCPClient_t * pxClient,
+								   char * pcBuffer,
+								   size_t uxLength )
+		{
+			size_t uxKept = ( pxClient->pxKept != NULL ) ? pxClient->pxKept->uxLength : 0u;
+			BaseType_t xRc = ( BaseType_t ) uxLength;
+
+			if( uxLength >= uxKept )
+			{
+				/* The kept bytes are at the start of pcBuffer already. */
+				if( uxLength > uxKept )
+				{
+					xRc = FreeRTOS_recv( pxClient->xSocket, ( void * ) ( pcBuffer + uxKept ), uxLength - uxKept, 0 );
+
+					if( xRc >= 0 )
+					{
+						xRc += ( BaseType_t ) uxKept;
+					}
+				}
+
+				uxKept = 0u;
+			}
+			else
+			{
+				/* Only a part of the kept bytes is taken. */
+				uxKept -= uxLength;
+				memmove( pxClient->pxKept->pcData, pxClient->pxKept->pcData + uxLength, uxKept );
+			}
+
+			if( pxClient->pxKept != NULL )
+			{
+				pxClient->pxKept->uxLength = uxKept;
+			}
+
+			return xRc;
+		}
+/*-----------------------------------------------------------*/
+
+		void vTCPServerKeep( TCPClient_t * pxClient,
+							 size_t uxLength )
+		{
+			size_t uxKept;
+			BaseType_t xRc;
+
+			if( pxClient->pxKept == NULL )
+			{
+				pxClient->pxKept = ( struct xTCP_LINE_BUFFER * ) pvPortMallocLarge( sizeof( *( pxClient->pxKept ) ) );
+
+				if( pxClient->pxKept == NULL )
+				{
+					/* The bytes stay in the stream, select() will return at
+					 * once until the rest has arrived. */
+					FreeRTOS_printf( ( "vTCPServerKeep: out of memory\n" ) );
+					return;
+				}
+
+				pxClient->pxKept->uxLength = 0u;
+			}
+
+			uxKept = pxClient->pxKept->uxLength;
+
+			if( ( uxLength > uxKept ) && ( uxLength <= sizeof( pxClient->pxKept->pcData ) ) )
+			{
+				/* The first bytes seen by xTCPServerPeek() were kept already. */
+				xRc = FreeRTOS_recv( pxClient->xSocket, ( void * ) ( pxClient->pxKept->pcData + uxKept ), uxLength - uxKept, 0 );
+
+				if( xRc > 0 )
+				{
+					pxClient->pxKept->uxLength = uxKept + ( size_t ) xRc;
+				}
+			}
+		}
+/*-----------------------------------------------------------*/
+
+	#endif /* ipconfigSELECT_USES_READY_LIST != 1 */
+
+	#if ( ipconfigSELECT_USES_READY_LIST == 1 )
+
+		void FreeRTOS_TCPServerWork( TCPServer_t * pxServer,
+									 TickType_t xBlockingTime )
+		{
+			SocketReady_t xReady[ ipconfigTCP_SERVER_READY_COUNT ];
+			TCPClient_t * pxWork[ ipconfigTCP_SERVER_READY_COUNT ];
+			BaseType_t xCount, xIndex, xWorkCount = 0;
+			BaseType_t xAccept = pdFALSE;
+
+			/* Wait for sockets that have an event, those of the other clients
+			 * will not be looked at, unless their deadline passes. */
+			xBlockingTime = prvBlockingTime( pxServer, xBlockingTime );
+			xCount = FreeRTOS_select_ready( pxServer->xSocketSet, xReady, ARRAY_SIZE( xReady ), xBlockingTime );
+
+			#if ( ipconfigTCP_SERVER_MAX_WORKERS > 1 )
+				{
+					prvTakeNewClients( pxServer );
+				}
+			#endif
+
+			for( xIndex = 0; xIndex < xCount; xIndex++ )
+			{
+				TCPClient_t * pxClient = ( TCPClient_t * ) xReady[ xIndex ].pvContext;
+
+				if( pxClient == NULL )
+				{
+					/* One of the listening sockets, or a new socket that has not
+					 * been assigned to a client yet. */
+					xAccept = pdTRUE;
+				}
+				else if( pxClient->xIsReady == pdFALSE )
+				{
+					/* A client may have two ready sockets, call it only once. */
+					pxClient->xIsReady = pdTRUE;
+					pxWork[ xWorkCount++ ] = pxClient;
+				}
+			}
+
+			if( xAccept != pdFALSE )
+			{
+				prvAcceptClients( pxServer );
+			}
+
+			for( xIndex = 0; xIndex < xWorkCount; xIndex++ )
+			{
+				pxWork[ xIndex ]->xIsReady = pdFALSE;
+			}
+
+			for( xIndex = 0; xIndex < xWorkCount; xIndex++ )
+			{
+				( void ) prvWorkClient( pxServer, pxWork[ xIndex ] );
+			}
+
+			prvWorkDueClients( pxServer );
+
+			#if ( tcpserverHAS_BUDGET != 0 )
+				{
+					prvBudgetDelay( pxServer );
+				}
+			#endif
+		}
+
+	#else /* ipconfigSELECT_USES_READY_LIST */
+
+		void FreeRTOS_TCPServerWork( TCPServer_t * pxServer,
+									 TickType_t xBlockingTime )
+		{
+			BaseType_t xRc;
+
+			/* Let the server do one working cycle.  All clients are called,
+			 * so it suffices to wake up at the nearest deadline. */
+			xRc = FreeRTOS_select( pxServer->xSocketSet, prvBlockingTime( pxServer, xBlockingTime ) );
+
+			#if ( ipconfigTCP_SERVER_MAX_WORKERS > 1 )
+				{
+					prvTakeNewClients( pxServer );
+				}
+			#endif
+
+			if( xRc != 0 )
+			{
+				prvAcceptClients( pxServer );
+			}
+
+			prvWorkAllClients( pxServer );
+
+			#if ( tcpserverHAS_BUDGET != 0 )
+				{
+					prvBudgetDelay( pxServer );
+				}
+			#endif
+		}
+
+	#endif /* ipconfigSELECT_USES_READY_LIST */
+/*-----------------------------------------------------------*/
+
 	static char * strnew( const char * pcString )
 	{
 		BaseType_t xLength;
@@ -310,6 +848,249 @@
 	}
 /*-----------------------------------------------------------*/
 
+	/* The FNV-1a hash of a command verb. */
+	uint32_t ulTCPServerCommandKey( const char * pcName,
+									BaseType_t xLength )
+	{
+		uint32_t ulKey = 2166136261ul;
+		BaseType_t xIndex;
+
+		for( xIndex = 0; xIndex < xLength; xIndex++ )
+		{
+			ulKey ^= ( uint8_t ) pcName[ xIndex ];
+			ulKey *= 16777619ul;
+		}
+
+		return ulKey;
+	}
+/*-----------------------------------------------------------*/
+
+	BaseType_t xTCPServerHashBuild( CommandHash_t * pxHash,
+									const uint32_t * pulKeys,
+									BaseType_t xCount )
+	{
+		uint8_t ucSlots[ tcpserverHASH_SIZE ];
+		uint32_t ulMultiplier = 0x9E3779B1ul;
+		BaseType_t xTry, xIndex;
+		BaseType_t xResult = pdFAIL;
+
+		configASSERT( xCount < 255 );
+
+		for( xTry = 0; ( xTry < 2000 ) && ( xResult == pdFAIL ); xTry++ )
+		{
+			memset( ucSlots, '\0', sizeof( ucSlots ) );
+
+			for( xIndex = 0; xIndex < xCount; xIndex++ )
+			{
+				uint32_t ulSlot = ( pulKeys[ xIndex ] * ulMultiplier ) >> ( 32 - tcpserverHASH_BITS );
+
+				if( ucSlots[ ulSlot ] != 0u )
+				{
+					break;
+				}
+
+				ucSlots[ ulSlot ] = ( uint8_t ) ( xIndex + 1 );
+			}
+
+			if( xIndex == xCount )
+			{
+				xResult = pdPASS;
+			}
+			else
+			{
+				/* Collision, try another odd multiplier. */
+				ulMultiplier = ( ulMultiplier * 1664525ul + 1013904223ul ) | 1ul;
+			}
+		}
+
+		if( xResult == pdPASS )
+		{
+			/* Other workers may build or use the same table.  The multiplier
+			 * is set last, it tells that the table is ready. */
+			vTaskSuspendAll();
+			{
+				if( pxHash->ulMultiplier == 0u )
+				{
+					memcpy( pxHash->ucSlots, ucSlots, sizeof( pxHash->ucSlots ) );
+					pxHash->ulMultiplier = ulMultiplier;
+				}
+			}
+			( void ) xTaskResumeAll();
+		}
+
+		configASSERT( xResult == pdPASS );
+
+		return xResult;
+	}
+/*-----------------------------------------------------------*/
+
+	/* Returns the index of the command that might have this key, or -1.  The
+	 * caller must compare the name, an unknown verb may share a slot. */
+	BaseType_t xTCPServerHashFind( const CommandHash_t * pxHash,
+								   uint32_t ulKey )
+	{
+		BaseType_t xResult = -1;
+
+		if( pxHash->ulMultiplier != 0u )
+		{
+			uint32_t ulSlot = ( ulKey * pxHash->ulMultiplier ) >> ( 32 - tcpserverHASH_BITS );
+
+			xResult = ( BaseType_t ) pxHash->ucSlots[ ulSlot ] - 1;
+		}
+
+		return xResult;
+	}
+/*-----------------------------------------------------------*/
+
+	#if ( ipconfigTCP_SERVER_MAX_WORKERS > 1 )
+
+		/* Create a server that has its own clients, but no listening sockets. */
+		static TCPServer_t * prvCreateWorker( void )
+		{
+			TCPServer_t * pxWorker;
+			BaseType_t xSize;
+
+			xSize = sizeof( *pxWorker ) - sizeof( pxWorker->xServers );
+			pxWorker = ( TCPServer_t * ) pvPortMallocLarge( xSize );
+
+			if( pxWorker != NULL )
+			{
+				memset( pxWorker, '\0', xSize );
+				pxWorker->xSocketSet = FreeRTOS_CreateSocketSet();
+				pxWorker->xNewClients = xQueueCreate( ipconfigTCP_SERVER_HANDOVER_COUNT, sizeof( TCPClient_t * ) );
+
+				if( ( pxWorker->xSocketSet == NULL ) || ( pxWorker->xNewClients == NULL ) ||
+					( xTaskCreate( prvWorkerTask, "TcpWorker", ipconfigTCP_SERVER_WORKER_STACK_SIZE, ( void * ) pxWorker,
+								   ipconfigTCP_SERVER_WORKER_PRIORITY, NULL ) != pdPASS ) )
+				{
+					if( pxWorker->xSocketSet != NULL )
+					{
+						FreeRTOS_DeleteSocketSet( pxWorker->xSocketSet );
+					}
+
+					if( pxWorker->xNewClients != NULL )
+					{
+						vQueueDelete( pxWorker->xNewClients );
+					}
+
+					vPortFreeLarge( pxWorker );
+					pxWorker = NULL;
+				}
+			}
+
+			return pxWorker;
+		}
+/*-----------------------------------------------------------*/
+
+		static void prvWorkerTask( void * pvParameters )
+		{
+			TCPServer_t * pxWorker = ( TCPServer_t * ) pvParameters;
+
+			for( ; ; )
+			{
+				/* The worker is woken up by events on its sockets, by a signal
+				 * when a new client is handed over, or by the deadline of one
+				 * of its clients. */
+				FreeRTOS_TCPServerWork( pxWorker, portMAX_DELAY );
+			}
+		}
+/*-----------------------------------------------------------*/
+
+		/* Find the worker with the least clients, starting after the worker
+		 * that got the previous client. */
+		static TCPServer_t * prvSelectWorker( TCPServer_t * pxServer )
+		{
+			TCPServer_t * pxBest = pxServer;
+			BaseType_t xCount;
+
+			for( xCount = 0; xCount < pxServer->xWorkerCount; xCount++ )
+			{
+				TCPServer_t * pxWorker;
+
+				pxServer->xNextWorker++;
+
+				if( pxServer->xNextWorker >= pxServer->xWorkerCount )
+				{
+					pxServer->xNextWorker = 0;
+				}
+
+				pxWorker = pxServer->pxWorkers[ pxServer->xNextWorker ];
+
+				if( ( xCount == 0 ) || ( pxWorker->xClientCount < pxBest->xClientCount ) )
+				{
+					pxBest = pxWorker;
+				}
+			}
+
+			return pxBest;
+		}
+/*-----------------------------------------------------------*/
+
+		/* Add the clients that were handed over by the accepting server. */
+		static void prvTakeNewClients( TCPServer_t * pxServer )
+		{
+			TCPClient_t * pxClient;
+
+			if( pxServer->xNewClients != NULL )
+			{
+				while( xQueueReceive( pxServer->xNewClients, &( pxClient ), 0U ) == pdPASS )
+				{
+					prvAddClient( pxServer, pxClient );
+
+					#if ( ipconfigSELECT_USES_READY_LIST == 1 )
+						{
+							/* Let the client greet its peer, see prvReceiveNewClient(). */
+							( void ) prvWorkClient( pxServer, pxClient );
+						}
+					#endif
+				}
+			}
+		}
+/*-----------------------------------------------------------*/
+
+		/* Same as FreeRTOS_CreateTCPServer(), but the clients will be divided
+		 * among 'xWorkerCount' tasks.  The calling task, which calls
+		 * FreeRTOS_TCPServerWork() for the returned server, is the first worker
+		 * and it also accepts the new clients. */
+		TCPServer_t * FreeRTOS_CreateTCPServerWorkers( const struct xSERVER_CONFIG * pxConfigs,
+													   BaseType_t xCount,
+													   BaseType_t xWorkerCount )
+		{
+			TCPServer_t * pxServer;
+
+			pxServer = FreeRTOS_CreateTCPServer( pxConfigs, xCount );
+
+			if( pxServer != NULL )
+			{
+				if( xWorkerCount > ipconfigTCP_SERVER_MAX_WORKERS )
+				{
+					xWorkerCount = ipconfigTCP_SERVER_MAX_WORKERS;
+				}
+
+				pxServer->pxWorkers[ 0 ] = pxServer;
+				pxServer->xWorkerCount = 1;
+
+				while( pxServer->xWorkerCount < xWorkerCount )
+				{
+					TCPServer_t * pxWorker = prvCreateWorker();
+
+					if( pxWorker == NULL )
+					{
+						FreeRTOS_printf( ( "TCP-server: could only create %d workers\n", ( int ) pxServer->xWorkerCount ) );
+						break;
+					}
+
+					pxServer->pxWorkers[ pxServer->xWorkerCount ] = pxWorker;
+					pxServer->xWorkerCount++;
+				}
+			}
+
+			return pxServer;
+		}
+
+	#endif /* ipconfigTCP_SERVER_MAX_WORKERS > 1 */
+/*-----------------------------------------------------------*/
+
 	#if ( ipconfigSUPPORT_SIGNALS != 0 )
 
 		/* FreeRTOS_TCPServerWork() calls select().
@@ -41,7 +41,9 @@ const FTPCommand_t xFTPCommands[ FTP_CMD_COUNT ] =
 	{ 4, "QUIT", ECMD_QUIT,	   pdTRUE,	pdFALSE },
 	{ 4, "REIN", ECMD_REIN,	   pdTRUE,	pdFALSE },
 	{ 4, "PORT", ECMD_PORT,	   pdTRUE,	pdFALSE },
+	{ 4, "EPRT", ECMD_EPRT,	   pdTRUE,	pdFALSE },
 	{ 4, "PASV", ECMD_PASV,	   pdTRUE,	pdFALSE },
+	{ 4, "EPSV", ECMD_EPSV,	   pdTRUE,	pdFALSE },
 	{ 4, "TYPE", ECMD_TYPE,	   pdTRUE,	pdFALSE },
 	{ 4, "STRU", ECMD_STRU,	   pdTRUE,	pdFALSE },
 	{ 4, "MODE", ECMD_MODE,	   pdTRUE,	pdFALSE },
@@ -62,12 +64,18 @@ const FTPCommand_t xFTPCommands[ FTP_CMD_COUNT ] =
 	{ 3, "PWD",	 ECMD_PWD,	   pdTRUE,	pdFALSE },
 	{ 4, "LIST", ECMD_LIST,	   pdTRUE,	pdFALSE },
 	{ 4, "NLST", ECMD_NLST,	   pdTRUE,	pdFALSE },
+	{ 4, "MLSD", ECMD_MLSD,	   pdTRUE,	pdFALSE },
+	{ 4, "MLST", ECMD_MLST,	   pdTRUE,	pdFALSE },
 	{ 4, "SITE", ECMD_SITE,	   pdTRUE,	pdFALSE },
 	{ 4, "SYST", ECMD_SYST,	   pdFALSE, pdFALSE },
 	{ 4, "FEAT", ECMD_FEAT,	   pdFALSE, pdFALSE },
 	{ 4, "STAT", ECMD_STAT,	   pdTRUE,	pdFALSE },
 	{ 4, "HELP", ECMD_HELP,	   pdFALSE, pdFALSE },
 	{ 4, "NOOP", ECMD_NOOP,	   pdFALSE, pdFALSE },
+	{ 4, "OPTS", ECMD_OPTS,	   pdFALSE, pdFALSE },
+	{ 4, "HASH", ECMD_HASH,	   pdTRUE,	pdTRUE	},
+	{ 4, "XCRC", ECMD_XCRC,	   pdTRUE,	pdTRUE	},
+	{ 4, "XMD5", ECMD_XMD5,	   pdTRUE,	pdTRUE	},
 	{ 4, "EMPT", ECMD_EMPTY,   pdFALSE, pdFALSE },
 	{ 4, "CLOS", ECMD_CLOSE,   pdTRUE,	pdFALSE },
 	{ 4, "UNKN", ECMD_UNKNOWN, pdFALSE, pdFALSE },
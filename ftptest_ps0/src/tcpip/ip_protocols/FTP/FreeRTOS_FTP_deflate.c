@@ -0,0 +1,1249 @@
+/*
+ * FreeRTOS+TCP V2.3.2
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/* Standard includes. */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* FreeRTOS+TCP includes. */
+#include "FreeRTOS_IP.h"
+
+/* FreeRTOS Protocol includes. */
+#include "FreeRTOS_FTP_deflate.h"
+
+/* Remove the whole file if MODE Z is not supported. */
+#if ( ipconfigUSE_FTP == 1 ) && ( ipconfigFTP_HAS_MODE_Z != 0 )
+
+	#if ( ipconfigFTP_DEFLATE_WINDOW_BITS < 9 ) || ( ipconfigFTP_DEFLATE_WINDOW_BITS > 15 )
+		#error ipconfigFTP_DEFLATE_WINDOW_BITS must be between 9 and 15
+	#endif
+
+	#if ( ipconfigFTP_INFLATE_WINDOW_BITS < 8 ) || ( ipconfigFTP_INFLATE_WINDOW_BITS > 15 )
+		#error ipconfigFTP_INFLATE_WINDOW_BITS must be between 8 and 15
+	#endif
+
+	#define zMIN_MATCH			 3u
+	#define zMAX_MATCH			 258u
+	#define zMAX_BITS			 15
+
+/* The compressor keeps this many bytes ahead of the current position, so that
+ * a match can be as long as possible. */
+	#define zMIN_LOOKAHEAD		 ( zMAX_MATCH + zMIN_MATCH + 1u )
+
+	#define zDEFLATE_WSIZE		 ( ( size_t ) 1u << ipconfigFTP_DEFLATE_WINDOW_BITS )
+	#define zDEFLATE_WMASK		 ( zDEFLATE_WSIZE - 1u )
+	#define zDEFLATE_MAX_DIST	 ( zDEFLATE_WSIZE - zMIN_LOOKAHEAD )
+	#define zHASH_BITS			 ( ipconfigFTP_DEFLATE_WINDOW_BITS - 1 )
+	#define zHASH_SIZE			 ( ( size_t ) 1u << zHASH_BITS )
+	#define zDEFLATE_OUT_SIZE	 1024u
+
+/* The most that is written to ucOutput for a single symbol, or for the end
+ * of the stream. */
+	#define zOUT_MARGIN			 8u
+
+	#define zINFLATE_WSIZE		 ( ( size_t ) 1u << ipconfigFTP_INFLATE_WINDOW_BITS )
+	#define zINFLATE_WMASK		 ( zINFLATE_WSIZE - 1u )
+
+/* Must be able to hold the largest header of a dynamic block, which is less
+ * than 300 bytes. */
+	#define zINFLATE_IN_SIZE	 1024u
+
+/* States of the compressor. */
+	#define zDEFLATE_START		 0
+	#define zDEFLATE_COMPRESS	 1
+	#define zDEFLATE_FINISHED	 2
+
+/* States of the decompressor. */
+	#define zINFLATE_HEADER		 0
+	#define zINFLATE_BLOCK		 1
+	#define zINFLATE_STORED		 2
+	#define zINFLATE_CODES		 3
+	#define zINFLATE_TRAILER	 4
+	#define zINFLATE_DONE		 5
+	#define zINFLATE_ERROR		 6
+
+/* Results of a single step of the decompressor. */
+	#define zSTEP_OK			 0
+	#define zSTEP_END			 1
+	#define zSTEP_NEED_INPUT	 ( -1 )
+	#define zSTEP_BAD_DATA		 ( -2 )
+	#define zSTEP_NEED_OUTPUT	 ( -3 )
+
+	struct xFTP_DEFLATE
+	{
+		size_t uxStart;        /* Index in ucWindow of the next byte to compress. */
+		size_t uxEnd;          /* Number of bytes stored in ucWindow. */
+		size_t uxOutHead;      /* Index in ucOutput where the next byte is written. */
+		size_t uxOutTail;      /* Index in ucOutput of the first byte not taken. */
+		uint32_t ulAdler;      /* Adler-32 checksum of all input. */
+		uint32_t ulBitBuffer;  /* Bits that do not make a whole byte yet. */
+		BaseType_t xBitCount;
+		BaseType_t xMaxChain;   /* The maximum number of strings compared. */
+		size_t uxNiceLength;   /* Stop searching once a match is this long. */
+		BaseType_t xState;
+		uint16_t usHead[ zHASH_SIZE ];     /* The last position of each hash value. */
+		uint16_t usPrev[ zDEFLATE_WSIZE ]; /* The previous position with the same hash value. */
+		uint8_t ucWindow[ 2u * zDEFLATE_WSIZE ];
+		uint8_t ucOutput[ zDEFLATE_OUT_SIZE ];
+	};
+
+/* A canonical Huffman code: the number of codes of each length, and the
+ * symbols in the order of their codes. */
+	typedef struct xFTP_HUFFMAN
+	{
+		uint16_t usCount[ zMAX_BITS + 1 ];
+		uint16_t usSymbol[ 288 ];
+	} FTPHuffman_t;
+
+	struct xFTP_INFLATE
+	{
+		BaseType_t xState;
+		BaseType_t xLastBlock;    /* The current block is the last one. */
+		uint32_t ulBitBuffer;     /* Bits read from ucInput but not used yet. */
+		BaseType_t xBitCount;
+		size_t uxInHead;          /* Index in ucInput of the next byte to read. */
+		size_t uxInTail;          /* Number of bytes stored in ucInput. */
+		size_t uxStoredLeft;      /* Bytes left in a stored block. */
+		size_t uxWindowHead;      /* Index in ucWindow where the next byte is written. */
+		size_t uxHave;            /* Number of valid bytes in ucWindow. */
+		size_t uxPending;         /* Number of bytes in ucWindow not taken yet. */
+		uint32_t ulAdler;         /* Adler-32 checksum of the output taken. */
+		uint32_t ulExpected;      /* The checksum found at the end of the stream. */
+		FTPHuffman_t xLengthCode; /* Literals, end-of-block and lengths. */
+		FTPHuffman_t xDistanceCode;
+		uint8_t ucLengths[ 286 + 30 ];
+		uint8_t ucInput[ zINFLATE_IN_SIZE ];
+		uint8_t ucWindow[ zINFLATE_WSIZE ];
+	};
+
+/* The lengths and distances of a match are coded as a symbol plus a number of
+ * extra bits, RFC 1951 section 3.2.5. */
+	static const uint16_t usLengthBase[ 29 ] =
+	{
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+	};
+	static const uint8_t ucLengthExtra[ 29 ] =
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+	};
+	static const uint16_t usDistanceBase[ 30 ] =
+	{
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+	};
+	static const uint8_t ucDistanceExtra[ 30 ] =
+	{
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+	};
+
+/*
+ * Update an Adler-32 checksum with some data.
+ */
+	static uint32_t prvAdler32( uint32_t ulAdler,
+								const uint8_t * pucData,
+								size_t uxLength );
+
+/*
+ * Write the bits of a value, least significant bit first.
+ */
+	static void prvPutBits( FTPDeflate_t * pxDeflate,
+							uint32_t ulValue,
+							BaseType_t xCount );
+
+/*
+ * Write a Huffman code, most significant bit first.
+ */
+	static void prvPutCode( FTPDeflate_t * pxDeflate,
+							uint32_t ulCode,
+							BaseType_t xLength );
+
+/*
+ * Write a literal/length symbol with the fixed Huffman code.
+ */
+	static void prvPutSymbol( FTPDeflate_t * pxDeflate,
+							  uint32_t ulSymbol );
+
+/*
+ * Write a length/distance pair.
+ */
+	static void prvPutMatch( FTPDeflate_t * pxDeflate,
+							 size_t uxLength,
+							 size_t uxDistance );
+
+/*
+ * Add the string at uxPosition to the hash chains.
+ */
+	static void prvInsertString( FTPDeflate_t * pxDeflate,
+								 size_t uxPosition );
+
+/*
+ * Find the longest string in the window that is equal to the string at
+ * uxStart.
+ */
+	static size_t prvLongestMatch( FTPDeflate_t * pxDeflate,
+								   size_t * puxDistance );
+
+/*
+ * Get a number of bits from the input, or -1 when there is not enough input.
+ */
+	static int32_t prvGetBits( FTPInflate_t * pxInflate,
+							   BaseType_t xCount );
+
+/*
+ * Decode a single symbol.
+ */
+	static int32_t prvDecodeSymbol( FTPInflate_t * pxInflate,
+									const FTPHuffman_t * pxCode );
+
+/*
+ * Make a canonical Huffman code from a list of code lengths.
+ */
+	static BaseType_t prvBuildCode( FTPHuffman_t * pxCode,
+									const uint8_t * pucLengths,
+									BaseType_t xCount );
+
+/*
+ * Read the code lengths at the start of a block with dynamic Huffman codes.
+ */
+	static int32_t prvDynamicCodes( FTPInflate_t * pxInflate );
+
+/*
+ * Store a decompressed byte in the window.
+ */
+	static void prvPutByte( FTPInflate_t * pxInflate,
+							uint8_t ucByte );
+
+/*
+ * Decode a single item of the stream.  A step either completes, or it has no
+ * effect apart from reading bits.
+ */
+	static int32_t prvInflateStep( FTPInflate_t * pxInflate );
+
+/*-----------------------------------------------------------*/
+
+	static uint32_t prvAdler32( uint32_t ulAdler,
+								const uint8_t * pucData,
+								size_t uxLength )
+	{
+		uint32_t ulA = ulAdler & 0xFFFFu;
+		uint32_t ulB = ulAdler >> 16;
+
+		while( uxLength > 0u )
+		{
+			/* 5552 bytes can be added before the sums might overflow. */
+			size_t uxCount = FreeRTOS_min_uint32( uxLength, 5552u );
+
+			uxLength -= uxCount;
+
+			while( uxCount > 0u )
+			{
+				ulA += *( pucData++ );
+				ulB += ulA;
+				uxCount--;
+			}
+
+			ulA %= 65521u;
+			ulB %= 65521u;
+		}
+
+		return ( ulB << 16 ) | ulA;
+	}
+/*-----------------------------------------------------------*/
+
+	FTPDeflate_t * pxFTPDeflateCreate( BaseType_t xLevel )
+	{
+		static const uint16_t usMaxChain[ 9 ] = { 4, 8, 16, 32, 64, 128, 256, 1024, 4096 };
+		static const uint16_t usNiceLength[ 9 ] = { 8, 16, 32, 32, 64, 128, 128, 258, 258 };
+		FTPDeflate_t * pxDeflate;
+
+		pxDeflate = ( FTPDeflate_t * ) pvPortMalloc( sizeof( *pxDeflate ) );
+
+		if( pxDeflate != NULL )
+		{
+			memset( pxDeflate, '\0', sizeof( *pxDeflate ) );
+
+			if( xLevel < 1 )
+			{
+				xLevel = 1;
+			}
+			else if( xLevel > 9 )
+			{
+				xLevel = 9;
+			}
+
+			pxDeflate->xMaxChain = ( BaseType_t ) usMaxChain[ xLevel - 1 ];
+			pxDeflate->uxNiceLength = ( size_t ) usNiceLength[ xLevel - 1 ];
+			pxDeflate->ulAdler = 1u;
+			pxDeflate->xState = zDEFLATE_START;
+		}
+
+		return pxDeflate;
+	}
+/*-----------------------------------------------------------*/
+
+	void vFTPDeflateDelete( FTPDeflate_t * pxDeflate )
+	{
+		if( pxDeflate != NULL )
+		{
+			vPortFree( pxDeflate );
+		}
+	}
+/*-----------------------------------------------------------*/
+
+	size_t uxFTPDeflateInput( FTPDeflate_t * pxDeflate,
+							  uint8_t ** ppucBuffer )
+	{
+		if( ( pxDeflate->uxEnd == sizeof( pxDeflate->ucWindow ) ) && ( pxDeflate->uxStart >= zDEFLATE_WSIZE ) )
+		{
+			size_t uxIndex;
+
+			/* The window is full, forget the oldest half. */
+			memcpy( pxDeflate->ucWindow, pxDeflate->ucWindow + zDEFLATE_WSIZE, zDEFLATE_WSIZE );
+			pxDeflate->uxStart -= zDEFLATE_WSIZE;
+			pxDeflate->uxEnd -= zDEFLATE_WSIZE;
+
+			/* Positions that drop out of the window become 0, the end of a chain. */
+			for( uxIndex = 0u; uxIndex < zHASH_SIZE; uxIndex++ )
+			{
+				pxDeflate->usHead[ uxIndex ] = ( pxDeflate->usHead[ uxIndex ] >= zDEFLATE_WSIZE ) ?
+											   ( uint16_t ) ( pxDeflate->usHead[ uxIndex ] - zDEFLATE_WSIZE ) : 0u;
+			}
+
+			for( uxIndex = 0u; uxIndex < zDEFLATE_WSIZE; uxIndex++ )
+			{
+				pxDeflate->usPrev[ uxIndex ] = ( pxDeflate->usPrev[ uxIndex ] >= zDEFLATE_WSIZE ) ?
+											   ( uint16_t ) ( pxDeflate->usPrev[ uxIndex ] - zDEFLATE_WSIZE ) : 0u;
+			}
+		}
+
+		*ppucBuffer = pxDeflate->ucWindow + pxDeflate->uxEnd;
+
+		return sizeof( pxDeflate->ucWindow ) - pxDeflate->uxEnd;
+	}
+/*-----------------------------------------------------------*/
+
+	void vFTPDeflateInputDone( FTPDeflate_t * pxDeflate,
+							   size_t uxCount )
+	{
+		pxDeflate->ulAdler = prvAdler32( pxDeflate->ulAdler, pxDeflate->ucWindow + pxDeflate->uxEnd, uxCount );
+		pxDeflate->uxEnd += uxCount;
+	}
+/*-----------------------------------------------------------*/
+
+	static void prvPutBits( FTPDeflate_t * pxDeflate,
+							uint32_t ulValue,
+							BaseType_t xCount )
+	{
+		pxDeflate->ulBitBuffer |= ulValue << pxDeflate->xBitCount;
+		pxDeflate->xBitCount += xCount;
+
+		while( pxDeflate->xBitCount >= 8 )
+		{
+			pxDeflate->ucOutput[ pxDeflate->uxOutHead++ ] = ( uint8_t ) pxDeflate->ulBitBuffer;
+			pxDeflate->ulBitBuffer >>= 8;
+			pxDeflate->xBitCount -= 8;
+		}
+	}
+/*-----------------------------------------------------------*/
+
+	static void prvPutCode( FTPDeflate_t * pxDeflate,
+							uint32_t ulCode,
+							BaseType_t xLength )
+	{
+		uint32_t ulReversed = 0u;
+		BaseType_t xIndex;
+
+		for( xIndex = 0; xIndex < xLength; xIndex++ )
+		{
+			ulReversed = ( ulReversed << 1 ) | ( ulCode & 1u );
+			ulCode >>= 1;
+		}
+
+		prvPutBits( pxDeflate, ulReversed, xLength );
+	}
+/*-----------------------------------------------------------*/
+
+	static void prvPutSymbol( FTPDeflate_t * pxDeflate,
+							  uint32_t ulSymbol )
+	{
+		/* The fixed Huffman code, RFC 1951 section 3.2.6. */
+		if( ulSymbol < 144u )
+		{
+			prvPutCode( pxDeflate, 0x30u + ulSymbol, 8 );
+		}
+		else if( ulSymbol < 256u )
+		{
+			prvPutCode( pxDeflate, 0x190u + ( ulSymbol - 144u ), 9 );
+		}
+		else if( ulSymbol < 280u )
+		{
+			prvPutCode( pxDeflate, ulSymbol - 256u, 7 );
+		}
+		else
+		{
+			prvPutCode( pxDeflate, 0xC0u + ( ulSymbol - 280u ), 8 );
+		}
+	}
+/*-----------------------------------------------------------*/
+
+	static void prvPutMatch( FTPDeflate_t * pxDeflate,
+							 size_t uxLength,
+							 size_t uxDistance )
+	{
+		BaseType_t xCode;
+
+		for( xCode = 28; usLengthBase[ xCode ] > uxLength; xCode-- )
+		{
+		}
+
+		prvPutSymbol( pxDeflate, 257u + ( uint32_t ) xCode );
+		prvPutBits( pxDeflate, ( uint32_t ) ( uxLength - usLengthBase[ xCode ] ), ( BaseType_t ) ucLengthExtra[ xCode ] );
+
+		for( xCode = 29; usDistanceBase[ xCode ] > uxDistance; xCode-- )
+		{
+		}
+
+		/* All distance codes have 5 bits. */
+		prvPutCode( pxDeflate, ( uint32_t ) xCode, 5 );
+		prvPutBits( pxDeflate, ( uint32_t ) ( uxDistance - usDistanceBase[ xCode ] ), ( BaseType_t ) ucDistanceExtra[ xCode ] );
+	}
+/*-----------------------------------------------------------*/
+
+	static void prvInsertString( FTPDeflate_t * pxDeflate,
+								 size_t uxPosition )
+	{
+		const uint8_t * pucString = pxDeflate->ucWindow + uxPosition;
+		uint32_t ulHash;
+
+		ulHash = ( ( uint32_t ) pucString[ 0 ] << 16 ) | ( ( uint32_t ) pucString[ 1 ] << 8 ) | ( uint32_t ) pucString[ 2 ];
+		ulHash = ( ulHash * 0x9E3779B1u ) >> ( 32 - zHASH_BITS );
+
+		pxDeflate->usPrev[ uxPosition & zDEFLATE_WMASK ] = pxDeflate->usHead[ ulHash ];
+		pxDeflate->usHead[ ulHash ] = ( uint16_t ) uxPosition;
+	}
+/*-----------------------------------------------------------*/
+
+	static size_t prvLongestMatch( FTPDeflate_t * pxDeflate,
+								   size_t * puxDistance )
+	{
+		const uint8_t * pucScan = pxDeflate->ucWindow + pxDeflate->uxStart;
+		size_t uxMaxLength = FreeRTOS_min_uint32( pxDeflate->uxEnd - pxDeflate->uxStart, zMAX_MATCH );
+		size_t uxLimit = ( pxDeflate->uxStart > zDEFLATE_MAX_DIST ) ? ( pxDeflate->uxStart - zDEFLATE_MAX_DIST ) : 0u;
+		size_t uxBest = zMIN_MATCH - 1u;
+		size_t uxMatch;
+		BaseType_t xChain = pxDeflate->xMaxChain;
+
+		/* The string at uxStart has just been inserted, start with the one before. */
+		uxMatch = pxDeflate->usPrev[ pxDeflate->uxStart & zDEFLATE_WMASK ];
+
+		/* Positions in a chain decrease, and 0 marks the end of a chain. */
+		while( ( uxMatch > uxLimit ) && ( xChain > 0 ) )
+		{
+			const uint8_t * pucMatch = pxDeflate->ucWindow + uxMatch;
+
+			/* First check the byte that would make this match the longest. */
+			if( ( pucMatch[ uxBest ] == pucScan[ uxBest ] ) && ( pucMatch[ 0 ] == pucScan[ 0 ] ) )
+			{
+				size_t uxLength = 0u;
+
+				while( ( uxLength < uxMaxLength ) && ( pucMatch[ uxLength ] == pucScan[ uxLength ] ) )
+				{
+					uxLength++;
+				}
+
+				if( uxLength > uxBest )
+				{
+					uxBest = uxLength;
+					*puxDistance = pxDeflate->uxStart - uxMatch;
+
+					if( ( uxBest >= pxDeflate->uxNiceLength ) || ( uxBest == uxMaxLength ) )
+					{
+						break;
+					}
+				}
+			}
+
+			uxMatch = pxDeflate->usPrev[ uxMatch & zDEFLATE_WMASK ];
+			xChain--;
+		}
+
+		return uxBest;
+	}
+/*-----------------------------------------------------------*/
+
+	BaseType_t xFTPDeflateRun( FTPDeflate_t * pxDeflate,
+							   BaseType_t xFinish )
+	{
+		if( pxDeflate->uxOutTail == pxDeflate->uxOutHead )
+		{
+			pxDeflate->uxOutHead = 0u;
+			pxDeflate->uxOutTail = 0u;
+		}
+		else if( ( pxDeflate->uxOutTail > 0u ) && ( ( zDEFLATE_OUT_SIZE - pxDeflate->uxOutHead ) < zOUT_MARGIN ) )
+		{
+			memmove( pxDeflate->ucOutput, pxDeflate->ucOutput + pxDeflate->uxOutTail, pxDeflate->uxOutHead - pxDeflate->uxOutTail );
+			pxDeflate->uxOutHead -= pxDeflate->uxOutTail;
+			pxDeflate->uxOutTail = 0u;
+		}
+
+		if( pxDeflate->xState == zDEFLATE_START )
+		{
+			/* The zlib header: method 8 (deflate) and the window size, plus check
+			 * bits to make the header a multiple of 31. */
+			uint32_t ulHeader = ( ( ( uint32_t ) ( ipconfigFTP_DEFLATE_WINDOW_BITS - 8 ) << 4 ) | 8u ) << 8;
+
+			ulHeader += 31u - ( ulHeader % 31u );
+			pxDeflate->ucOutput[ pxDeflate->uxOutHead++ ] = ( uint8_t ) ( ulHeader >> 8 );
+			pxDeflate->ucOutput[ pxDeflate->uxOutHead++ ] = ( uint8_t ) ulHeader;
+
+			/* All data goes into a single block with the fixed Huffman codes:
+			 * BFINAL = 0, BTYPE = 01. */
+			prvPutBits( pxDeflate, 2u, 3 );
+			pxDeflate->xState = zDEFLATE_COMPRESS;
+		}
+
+		while( ( pxDeflate->xState == zDEFLATE_COMPRESS ) &&
+			   ( ( zDEFLATE_OUT_SIZE - pxDeflate->uxOutHead ) >= zOUT_MARGIN ) )
+		{
+			size_t uxLookahead = pxDeflate->uxEnd - pxDeflate->uxStart;
+			size_t uxLength = 0u;
+			size_t uxDistance = 0u;
+
+			if( uxLookahead == 0u )
+			{
+				if( xFinish != pdFALSE )
+				{
+					/* Close the block, and add an empty last block. */
+					prvPutSymbol( pxDeflate, 256u );
+					prvPutBits( pxDeflate, 3u, 3 );
+					prvPutSymbol( pxDeflate, 256u );
+
+					if( pxDeflate->xBitCount > 0 )
+					{
+						prvPutBits( pxDeflate, 0u, 8 - pxDeflate->xBitCount );
+					}
+
+					pxDeflate->ucOutput[ pxDeflate->uxOutHead++ ] = ( uint8_t ) ( pxDeflate->ulAdler >> 24 );
+					pxDeflate->ucOutput[ pxDeflate->uxOutHead++ ] = ( uint8_t ) ( pxDeflate->ulAdler >> 16 );
+					pxDeflate->ucOutput[ pxDeflate->uxOutHead++ ] = ( uint8_t ) ( pxDeflate->ulAdler >> 8 );
+					pxDeflate->ucOutput[ pxDeflate->uxOutHead++ ] = ( uint8_t ) pxDeflate->ulAdler;
+					pxDeflate->xState = zDEFLATE_FINISHED;
+				}
+
+				break;
+			}
+
+			if( ( xFinish == pdFALSE ) && ( uxLookahead < zMIN_LOOKAHEAD ) )
+			{
+				/* Wait for more input. */
+				break;
+			}
+
+			if( uxLookahead >= zMIN_MATCH )
+			{
+				prvInsertString( pxDeflate, pxDeflate->uxStart );
+				uxLength = prvLongestMatch( pxDeflate, &uxDistance );
+			}
+
+			if( uxLength >= zMIN_MATCH )
+			{
+				size_t uxIndex;
+
+				prvPutMatch( pxDeflate, uxLength, uxDistance );
+
+				/* Also insert the strings that start within the match. */
+				for( uxIndex = 1u; uxIndex < uxLength; uxIndex++ )
+				{
+					if( pxDeflate->uxStart + uxIndex + zMIN_MATCH <= pxDeflate->uxEnd )
+					{
+						prvInsertString( pxDeflate, pxDeflate->uxStart + uxIndex );
+					}
+				}
+
+				pxDeflate->uxStart += uxLength;
+			}
+			else
+			{
+				prvPutSymbol( pxDeflate, ( uint32_t ) pxDeflate->ucWindow[ pxDeflate->uxStart ] );
+				pxDeflate->uxStart++;
+			}
+		}
+
+		return ( pxDeflate->xState == zDEFLATE_FINISHED ) ? ftpZ_DONE : ftpZ_BUSY;
+	}
+/*-----------------------------------------------------------*/
+
+	size_t uxFTPDeflateOutput( FTPDeflate_t * pxDeflate,
+							   const uint8_t ** ppucData )
+	{
+		*ppucData = pxDeflate->ucOutput + pxDeflate->uxOutTail;
+
+		return pxDeflate->uxOutHead - pxDeflate->uxOutTail;
+	}
+/*-----------------------------------------------------------*/
+
+	void vFTPDeflateOutputDone( FTPDeflate_t * pxDeflate,
+								size_t uxCount )
+	{
+		pxDeflate->uxOutTail += uxCount;
+	}
+/*-----------------------------------------------------------*/
+
+	FTPInflate_t * pxFTPInflateCreate( void )
+	{
+		FTPInflate_t * pxInflate;
+
+		pxInflate = ( FTPInflate_t * ) pvPortMalloc( sizeof( *pxInflate ) );
+
+		if( pxInflate != NULL )
+		{
+			/* The window does not need to be cleared. */
+			memset( pxInflate, '\0', offsetof( FTPInflate_t, ucWindow ) );
+			pxInflate->ulAdler = 1u;
+			pxInflate->xState = zINFLATE_HEADER;
+		}
+
+		return pxInflate;
+	}
+/*-----------------------------------------------------------*/
+
+	void vFTPInflateDelete( FTPInflate_t * pxInflate )
+	{
+		if( pxInflate != NULL )
+		{
+			vPortFree( pxInflate );
+		}
+	}
+/*-----------------------------------------------------------*/
+
+	size_t uxFTPInflateWrite( FTPInflate_t * pxInflate,
+							  const uint8_t * pucData,
+							  size_t uxLength )
+	{
+		if( ( pxInflate->xState != zINFLATE_DONE ) && ( pxInflate->xState != zINFLATE_ERROR ) )
+		{
+			if( pxInflate->uxInHead > 0u )
+			{
+				memmove( pxInflate->ucInput, pxInflate->ucInput + pxInflate->uxInHead, pxInflate->uxInTail - pxInflate->uxInHead );
+				pxInflate->uxInTail -= pxInflate->uxInHead;
+				pxInflate->uxInHead = 0u;
+			}
+
+			uxLength = FreeRTOS_min_uint32( uxLength, sizeof( pxInflate->ucInput ) - pxInflate->uxInTail );
+			memcpy( pxInflate->ucInput + pxInflate->uxInTail, pucData, uxLength );
+			pxInflate->uxInTail += uxLength;
+		}
+
+		/* Else: anything after the end of the stream is ignored. */
+
+		return uxLength;
+	}
+/*-----------------------------------------------------------*/
+
+	static int32_t prvGetBits( FTPInflate_t * pxInflate,
+							   BaseType_t xCount )
+	{
+		uint32_t ulValue;
+
+		while( pxInflate->xBitCount < xCount )
+		{
+			if( pxInflate->uxInHead == pxInflate->uxInTail )
+			{
+				return -1;
+			}
+
+			pxInflate->ulBitBuffer |= ( uint32_t ) pxInflate->ucInput[ pxInflate->uxInHead++ ] << pxInflate->xBitCount;
+			pxInflate->xBitCount += 8;
+		}
+
+		ulValue = pxInflate->ulBitBuffer & ( ( 1u << xCount ) - 1u );
+		pxInflate->ulBitBuffer >>= xCount;
+		pxInflate->xBitCount -= xCount;
+
+		return ( int32_t ) ulValue;
+	}
+/*-----------------------------------------------------------*/
+
+	static int32_t prvDecodeSymbol( FTPInflate_t * pxInflate,
+									const FTPHuffman_t * pxCode )
+	{
+		int32_t lCode = 0;
+		int32_t lFirst = 0;
+		int32_t lIndex = 0;
+		BaseType_t xLength;
+
+		/* Read the code bit by bit, until it is a valid code of the current length. */
+		for( xLength = 1; xLength <= zMAX_BITS; xLength++ )
+		{
+			int32_t lBit = prvGetBits( pxInflate, 1 );
+			int32_t lCount;
+
+			if( lBit < 0 )
+			{
+				return zSTEP_NEED_INPUT;
+			}
+
+			lCode |= lBit;
+			lCount = ( int32_t ) pxCode->usCount[ xLength ];
+
+			if( lCode - lCount < lFirst )
+			{
+				return ( int32_t ) pxCode->usSymbol[ lIndex + ( lCode - lFirst ) ];
+			}
+
+			lIndex += lCount;
+			lFirst += lCount;
+			lFirst <<= 1;
+			lCode <<= 1;
+		}
+
+		return zSTEP_BAD_DATA;
+	}
+/*-----------------------------------------------------------*/
+
+	static BaseType_t prvBuildCode( FTPHuffman_t * pxCode,
+									const uint8_t * pucLengths,
+									BaseType_t xCount )
+	{
+		uint16_t usOffsets[ zMAX_BITS + 1 ];
+		BaseType_t xSymbol;
+		BaseType_t xLength;
+		int32_t lLeft = 1;
+
+		memset( pxCode->usCount, '\0', sizeof( pxCode->usCount ) );
+
+		for( xSymbol = 0; xSymbol < xCount; xSymbol++ )
+		{
+			pxCode->usCount[ pucLengths[ xSymbol ] ]++;
+		}
+
+		/* Check that no more codes are used than there are. */
+		for( xLength = 1; xLength <= zMAX_BITS; xLength++ )
+		{
+			lLeft <<= 1;
+			lLeft -= ( int32_t ) pxCode->usCount[ xLength ];
+
+			if( lLeft < 0 )
+			{
+				return pdFALSE;
+			}
+		}
+
+		usOffsets[ 1 ] = 0u;
+
+		for( xLength = 1; xLength < zMAX_BITS; xLength++ )
+		{
+			usOffsets[ xLength + 1 ] = usOffsets[ xLength ] + pxCode->usCount[ xLength ];
+		}
+
+		for( xSymbol = 0; xSymbol < xCount; xSymbol++ )
+		{
+			if( pucLengths[ xSymbol ] != 0u )
+			{
+				pxCode->usSymbol[ usOffsets[ pucLengths[ xSymbol ] ]++ ] = ( uint16_t ) xSymbol;
+			}
+		}
+
+		return pdTRUE;
+	}
+/*-----------------------------------------------------------*/
+
+	static int32_t prvDynamicCodes( FTPInflate_t * pxInflate )
+	{
+		/* The order in which the lengths of the code length code are sent. */
+		static const uint8_t ucOrder[ 19 ] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+		uint8_t * pucLengths = pxInflate->ucLengths;
+		int32_t lLengthCount, lDistanceCount, lCodeCount;
+		int32_t lIndex;
+
+		lLengthCount = prvGetBits( pxInflate, 5 );
+		lDistanceCount = prvGetBits( pxInflate, 5 );
+		lCodeCount = prvGetBits( pxInflate, 4 );
+
+		if( lCodeCount < 0 )
+		{
+			return zSTEP_NEED_INPUT;
+		}
+
+		lLengthCount += 257;
+		lDistanceCount += 1;
+		lCodeCount += 4;
+
+		if( ( lLengthCount > 286 ) || ( lDistanceCount > 30 ) )
+		{
+			return zSTEP_BAD_DATA;
+		}
+
+		for( lIndex = 0; lIndex < 19; lIndex++ )
+		{
+			int32_t lLength = 0;
+
+			if( lIndex < lCodeCount )
+			{
+				lLength = prvGetBits( pxInflate, 3 );
+
+				if( lLength < 0 )
+				{
+					return zSTEP_NEED_INPUT;
+				}
+			}
+
+			pucLengths[ ucOrder[ lIndex ] ] = ( uint8_t ) lLength;
+		}
+
+		/* The distance code is used to hold the code length code for now. */
+		if( prvBuildCode( &( pxInflate->xDistanceCode ), pucLengths, 19 ) == pdFALSE )
+		{
+			return zSTEP_BAD_DATA;
+		}
+
+		lIndex = 0;
+
+		while( lIndex < lLengthCount + lDistanceCount )
+		{
+			int32_t lSymbol = prvDecodeSymbol( pxInflate, &( pxInflate->xDistanceCode ) );
+
+			if( lSymbol < 0 )
+			{
+				return lSymbol;
+			}
+
+			if( lSymbol < 16 )
+			{
+				pucLengths[ lIndex++ ] = ( uint8_t ) lSymbol;
+			}
+			else
+			{
+				/* 16: repeat the previous length 3 to 6 times, 17: 3 to 10 zeros,
+				 * 18: 11 to 138 zeros. */
+				uint8_t ucValue = 0u;
+				int32_t lRepeat;
+
+				if( lSymbol == 16 )
+				{
+					if( lIndex == 0 )
+					{
+						return zSTEP_BAD_DATA;
+					}
+
+					ucValue = pucLengths[ lIndex - 1 ];
+					lRepeat = prvGetBits( pxInflate, 2 );
+
+					if( lRepeat >= 0 )
+					{
+						lRepeat += 3;
+					}
+				}
+				else if( lSymbol == 17 )
+				{
+					lRepeat = prvGetBits( pxInflate, 3 );
+
+					if( lRepeat >= 0 )
+					{
+						lRepeat += 3;
+					}
+				}
+				else
+				{
+					lRepeat = prvGetBits( pxInflate, 7 );
+
+					if( lRepeat >= 0 )
+					{
+						lRepeat += 11;
+					}
+				}
+
+				if( lRepeat < 0 )
+				{
+					return zSTEP_NEED_INPUT;
+				}
+
+				if( lIndex + lRepeat > lLengthCount + lDistanceCount )
+				{
+					return zSTEP_BAD_DATA;
+				}
+
+				while( lRepeat > 0 )
+				{
+					pucLengths[ lIndex++ ] = ucValue;
+					lRepeat--;
+				}
+			}
+		}
+
+		/* There must be a code for the end of the block. */
+		if( pucLengths[ 256 ] == 0u )
+		{
+			return zSTEP_BAD_DATA;
+		}
+
+		if( ( prvBuildCode( &( pxInflate->xLengthCode ), pucLengths, ( BaseType_t ) lLengthCount ) == pdFALSE ) ||
+			( prvBuildCode( &( pxInflate->xDistanceCode ), pucLengths + lLengthCount, ( BaseType_t ) lDistanceCount ) == pdFALSE ) )
+		{
+			return zSTEP_BAD_DATA;
+		}
+
+		return zSTEP_OK;
+	}
+/*-----------------------------------------------------------*/
+
+	static void prvPutByte( FTPInflate_t * pxInflate,
+							uint8_t ucByte )
+	{
+		pxInflate->ucWindow[ pxInflate->uxWindowHead ] = ucByte;
+		pxInflate->uxWindowHead = ( pxInflate->uxWindowHead + 1u ) & zINFLATE_WMASK;
+		pxInflate->uxPending++;
+
+		if( pxInflate->uxHave < zINFLATE_WSIZE )
+		{
+			pxInflate->uxHave++;
+		}
+	}
+/*-----------------------------------------------------------*/
+
+	static int32_t prvInflateStep( FTPInflate_t * pxInflate )
+	{
+		int32_t lResult = zSTEP_OK;
+
+		switch( pxInflate->xState )
+		{
+			case zINFLATE_HEADER:
+			   {
+				   int32_t lMethod = prvGetBits( pxInflate, 8 );
+				   int32_t lFlags = prvGetBits( pxInflate, 8 );
+
+				   if( lFlags < 0 )
+				   {
+					   lResult = zSTEP_NEED_INPUT;
+				   }
+				   else if( ( ( lMethod & 0x0F ) != 8 ) ||
+							( ( ( lMethod >> 4 ) + 8 ) > ipconfigFTP_INFLATE_WINDOW_BITS ) ||
+							( ( ( ( lMethod << 8 ) | lFlags ) % 31 ) != 0 ) ||
+							( ( lFlags & 0x20 ) != 0 ) )
+				   {
+					   /* Not deflate, a window that is too big, or a preset dictionary. */
+					   lResult = zSTEP_BAD_DATA;
+				   }
+				   else
+				   {
+					   pxInflate->xState = zINFLATE_BLOCK;
+				   }
+			   }
+			   break;
+
+			case zINFLATE_BLOCK:
+			   {
+				   int32_t lLast = prvGetBits( pxInflate, 1 );
+				   int32_t lType = prvGetBits( pxInflate, 2 );
+
+				   if( lType < 0 )
+				   {
+					   lResult = zSTEP_NEED_INPUT;
+				   }
+				   else if( lType == 0 )
+				   {
+					   int32_t lLength, lComplement;
+
+					   /* A stored block starts at a byte boundary. */
+					   ( void ) prvGetBits( pxInflate, pxInflate->xBitCount % 8 );
+					   lLength = prvGetBits( pxInflate, 16 );
+					   lComplement = prvGetBits( pxInflate, 16 );
+
+					   if( ( lLength < 0 ) || ( lComplement < 0 ) )
+					   {
+						   lResult = zSTEP_NEED_INPUT;
+					   }
+					   else if( lLength != ( lComplement ^ 0xFFFF ) )
+					   {
+						   lResult = zSTEP_BAD_DATA;
+					   }
+					   else
+					   {
+						   pxInflate->uxStoredLeft = ( size_t ) lLength;
+						   pxInflate->xState = zINFLATE_STORED;
+					   }
+				   }
+				   else if( lType == 1 )
+				   {
+					   uint8_t * pucLengths = pxInflate->ucLengths;
+
+					   /* The fixed Huffman codes, RFC 1951 section 3.2.6. */
+					   memset( pucLengths, 8, 144 );
+					   memset( pucLengths + 144, 9, 256 - 144 );
+					   memset( pucLengths + 256, 7, 280 - 256 );
+					   memset( pucLengths + 280, 8, 288 - 280 );
+					   ( void ) prvBuildCode( &( pxInflate->xLengthCode ), pucLengths, 288 );
+					   memset( pucLengths, 5, 30 );
+					   ( void ) prvBuildCode( &( pxInflate->xDistanceCode ), pucLengths, 30 );
+					   pxInflate->xState = zINFLATE_CODES;
+				   }
+				   else if( lType == 2 )
+				   {
+					   lResult = prvDynamicCodes( pxInflate );
+
+					   if( lResult == zSTEP_OK )
+					   {
+						   pxInflate->xState = zINFLATE_CODES;
+					   }
+				   }
+				   else
+				   {
+					   lResult = zSTEP_BAD_DATA;
+				   }
+
+				   if( lResult == zSTEP_OK )
+				   {
+					   pxInflate->xLastBlock = ( BaseType_t ) lLast;
+				   }
+			   }
+			   break;
+
+			case zINFLATE_STORED:
+
+				if( pxInflate->uxStoredLeft == 0u )
+				{
+					pxInflate->xState = ( pxInflate->xLastBlock != pdFALSE ) ? zINFLATE_TRAILER : zINFLATE_BLOCK;
+				}
+				else if( pxInflate->uxPending >= zINFLATE_WSIZE )
+				{
+					lResult = zSTEP_NEED_OUTPUT;
+				}
+				else
+				{
+					int32_t lByte = prvGetBits( pxInflate, 8 );
+
+					if( lByte < 0 )
+					{
+						lResult = zSTEP_NEED_INPUT;
+					}
+					else
+					{
+						prvPutByte( pxInflate, ( uint8_t ) lByte );
+						pxInflate->uxStoredLeft--;
+					}
+				}
+
+				break;
+
+			case zINFLATE_CODES:
+
+				if( pxInflate->uxPending + zMAX_MATCH > zINFLATE_WSIZE )
+				{
+					/* A match might overwrite data that has not been taken. */
+					lResult = zSTEP_NEED_OUTPUT;
+				}
+				else
+				{
+					int32_t lSymbol = prvDecodeSymbol( pxInflate, &( pxInflate->xLengthCode ) );
+
+					if( lSymbol < 0 )
+					{
+						lResult = lSymbol;
+					}
+					else if( lSymbol < 256 )
+					{
+						prvPutByte( pxInflate, ( uint8_t ) lSymbol );
+					}
+					else if( lSymbol == 256 )
+					{
+						pxInflate->xState = ( pxInflate->xLastBlock != pdFALSE ) ? zINFLATE_TRAILER : zINFLATE_BLOCK;
+					}
+					else if( lSymbol - 257 >= 29 )
+					{
+						lResult = zSTEP_BAD_DATA;
+					}
+					else
+					{
+						int32_t lLength, lDistance, lExtra;
+
+						lSymbol -= 257;
+						lExtra = prvGetBits( pxInflate, ( BaseType_t ) ucLengthExtra[ lSymbol ] );
+						lLength = ( int32_t ) usLengthBase[ lSymbol ] + lExtra;
+						lSymbol = ( lExtra < 0 ) ? zSTEP_NEED_INPUT : prvDecodeSymbol( pxInflate, &( pxInflate->xDistanceCode ) );
+
+						if( lSymbol < 0 )
+						{
+							lResult = lSymbol;
+						}
+						else if( lSymbol >= 30 )
+						{
+							lResult = zSTEP_BAD_DATA;
+						}
+						else
+						{
+							lExtra = prvGetBits( pxInflate, ( BaseType_t ) ucDistanceExtra[ lSymbol ] );
+							lDistance = ( int32_t ) usDistanceBase[ lSymbol ] + lExtra;
+
+							if( lExtra < 0 )
+							{
+								lResult = zSTEP_NEED_INPUT;
+							}
+							else if( ( size_t ) lDistance > pxInflate->uxHave )
+							{
+								/* Refers to data before the start of the stream. */
+								lResult = zSTEP_BAD_DATA;
+							}
+							else
+							{
+								while( lLength > 0 )
+								{
+									prvPutByte( pxInflate, pxInflate->ucWindow[ ( pxInflate->uxWindowHead - ( size_t ) lDistance ) & zINFLATE_WMASK ] );
+									lLength--;
+								}
+							}
+						}
+					}
+				}
+
+				break;
+
+			case zINFLATE_TRAILER:
+			   {
+				   BaseType_t xIndex;
+				   uint32_t ulExpected = 0u;
+
+				   ( void ) prvGetBits( pxInflate, pxInflate->xBitCount % 8 );
+
+				   /* The Adler-32 checksum, most significant byte first. */
+				   for( xIndex = 0; xIndex < 4; xIndex++ )
+				   {
+					   int32_t lByte = prvGetBits( pxInflate, 8 );
+
+					   if( lByte < 0 )
+					   {
+						   lResult = zSTEP_NEED_INPUT;
+						   break;
+					   }
+
+					   ulExpected = ( ulExpected << 8 ) | ( uint32_t ) lByte;
+				   }
+
+				   if( lResult == zSTEP_OK )
+				   {
+					   pxInflate->ulExpected = ulExpected;
+					   pxInflate->xState = zINFLATE_DONE;
+				   }
+			   }
+			   break;
+
+			case zINFLATE_DONE:
+
+				if( pxInflate->uxPending > 0u )
+				{
+					lResult = zSTEP_NEED_OUTPUT;
+				}
+				else if( pxInflate->ulAdler != pxInflate->ulExpected )
+				{
+					lResult = zSTEP_BAD_DATA;
+				}
+				else
+				{
+					lResult = zSTEP_END;
+				}
+
+				break;
+
+			default:
+				lResult = zSTEP_BAD_DATA;
+				break;
+		}
+
+		return lResult;
+	}
+/*-----------------------------------------------------------*/
+
+	BaseType_t xFTPInflateRun( FTPInflate_t * pxInflate )
+	{
+		BaseType_t xResult = ftpZ_BUSY;
+
+		for( ; ; )
+		{
+			/* Remember the position in the input, so that a step that runs out
+			 * of input can be repeated when more data has arrived. */
+			size_t uxInHead = pxInflate->uxInHead;
+			uint32_t ulBitBuffer = pxInflate->ulBitBuffer;
+			BaseType_t xBitCount = pxInflate->xBitCount;
+			int32_t lResult = prvInflateStep( pxInflate );
+
+			if( lResult == zSTEP_OK )
+			{
+				continue;
+			}
+
+			if( lResult == zSTEP_NEED_INPUT )
+			{
+				pxInflate->uxInHead = uxInHead;
+				pxInflate->ulBitBuffer = ulBitBuffer;
+				pxInflate->xBitCount = xBitCount;
+			}
+			else if( lResult == zSTEP_END )
+			{
+				xResult = ftpZ_DONE;
+			}
+			else if( lResult == zSTEP_BAD_DATA )
+			{
+				pxInflate->xState = zINFLATE_ERROR;
+				xResult = ftpZ_ERROR;
+			}
+
+			/* Else zSTEP_NEED_OUTPUT. */
+			break;
+		}
+
+		return xResult;
+	}
+/*-----------------------------------------------------------*/
+
+	size_t uxFTPInflateOutput( FTPInflate_t * pxInflate,
+							   const uint8_t ** ppucData )
+	{
+		size_t uxStart = ( pxInflate->uxWindowHead - pxInflate->uxPending ) & zINFLATE_WMASK;
+
+		*ppucData = pxInflate->ucWindow + uxStart;
+
+		/* The data might wrap around the end of the window. */
+		return FreeRTOS_min_uint32( pxInflate->uxPending, zINFLATE_WSIZE - uxStart );
+	}
+/*-----------------------------------------------------------*/
+
+	void vFTPInflateOutputDone( FTPInflate_t * pxInflate,
+								size_t uxCount )
+	{
+		size_t uxStart = ( pxInflate->uxWindowHead - pxInflate->uxPending ) & zINFLATE_WMASK;
+
+		pxInflate->ulAdler = prvAdler32( pxInflate->ulAdler, pxInflate->ucWindow + uxStart, uxCount );
+		pxInflate->uxPending -= uxCount;
+	}
+/*-----------------------------------------------------------*/
+
+#endif /* ( ipconfigUSE_FTP == 1 ) && ( ipconfigFTP_HAS_MODE_Z != 0 ) */
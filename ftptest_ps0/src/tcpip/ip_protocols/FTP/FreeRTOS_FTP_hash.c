@@ -0,0 +1,500 @@
+/*
+ * FreeRTOS+TCP V2.3.2
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/* Standard includes. */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* FreeRTOS+TCP includes. */
+#include "FreeRTOS_IP.h"
+
+/* FreeRTOS Protocol includes. */
+#include "FreeRTOS_FTP_hash.h"
+
+/* Remove the whole file if neither the hash commands nor the CRC of STOR are
+ * used. */
+#if ( ipconfigUSE_FTP == 1 ) && ( ( ipconfigFTP_HAS_HASH != 0 ) || ( ipconfigFTP_STORE_CRC != 0 ) )
+
+	#define hashROTL( x, n )    ( ( ( x ) << ( n ) ) | ( ( x ) >> ( 32 - ( n ) ) ) )
+	#define hashROTR( x, n )    ( ( ( x ) >> ( n ) ) | ( ( x ) << ( 32 - ( n ) ) ) )
+
+/*
+ * The CRC-32 is calculated 8 bytes at a time ("slice-by-8"): table 0 is the
+ * normal byte-wise table, table N gives the CRC of a byte followed by N zero
+ * bytes.  The 8 KB of tables are filled when the first CRC is calculated.
+ */
+	static uint32_t ulCrcTable[ 8 ][ 256 ];
+	static BaseType_t xCrcTableReady = pdFALSE;
+
+	static const uint32_t ulMD5Sines[ 64 ] =
+	{
+		0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+		0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+		0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+		0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+		0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+		0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+		0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+		0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+	};
+
+	static const uint8_t ucMD5Shifts[ 16 ] =
+	{
+		7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21
+	};
+
+	static const uint32_t ulSHA256Constants[ 64 ] =
+	{
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+	};
+
+	static const char * const pcHashNames[] = { "CRC32", "MD5", "SHA-256" };
+
+/*
+ * Process a single block of 64 bytes.
+ */
+	static void prvMD5Block( uint32_t * pulState,
+							 const uint8_t * pucBlock );
+	static void prvSHA256Block( uint32_t * pulState,
+								const uint8_t * pucBlock );
+
+/*
+ * Fill the tables of the CRC-32.
+ */
+	static void prvCrcTableInit( void );
+/*-----------------------------------------------------------*/
+
+	static void prvCrcTableInit( void )
+	{
+		uint32_t ulIndex, ulCrc;
+		BaseType_t xBit, xSlice;
+
+		for( ulIndex = 0u; ulIndex < 256u; ulIndex++ )
+		{
+			ulCrc = ulIndex;
+
+			for( xBit = 0; xBit < 8; xBit++ )
+			{
+				ulCrc = ( ulCrc >> 1 ) ^ ( ( ulCrc & 1u ) != 0u ? 0xEDB88320u : 0u );
+			}
+
+			ulCrcTable[ 0 ][ ulIndex ] = ulCrc;
+		}
+
+		for( ulIndex = 0u; ulIndex < 256u; ulIndex++ )
+		{
+			ulCrc = ulCrcTable[ 0 ][ ulIndex ];
+
+			for( xSlice = 1; xSlice < 8; xSlice++ )
+			{
+				ulCrc = ( ulCrc >> 8 ) ^ ulCrcTable[ 0 ][ ulCrc & 0xFFu ];
+				ulCrcTable[ xSlice ][ ulIndex ] = ulCrc;
+			}
+		}
+
+		/* Two tasks may fill the tables at the same time, they write the same
+		 * values. */
+		xCrcTableReady = pdTRUE;
+	}
+/*-----------------------------------------------------------*/
+
+	uint32_t ulFTPCrc32( uint32_t ulCrc,
+						 const uint8_t * pucData,
+						 size_t uxLength )
+	{
+		if( xCrcTableReady == pdFALSE )
+		{
+			prvCrcTableInit();
+		}
+
+		ulCrc = ~ulCrc;
+
+		while( uxLength >= 8u )
+		{
+			uint32_t ulLow = ulCrc ^ ( ( uint32_t ) pucData[ 0 ] | ( ( uint32_t ) pucData[ 1 ] << 8 ) |
+									   ( ( uint32_t ) pucData[ 2 ] << 16 ) | ( ( uint32_t ) pucData[ 3 ] << 24 ) );
+
+			ulCrc = ulCrcTable[ 7 ][ ulLow & 0xFFu ] ^
+					ulCrcTable[ 6 ][ ( ulLow >> 8 ) & 0xFFu ] ^
+					ulCrcTable[ 5 ][ ( ulLow >> 16 ) & 0xFFu ] ^
+					ulCrcTable[ 4 ][ ulLow >> 24 ] ^
+					ulCrcTable[ 3 ][ pucData[ 4 ] ] ^
+					ulCrcTable[ 2 ][ pucData[ 5 ] ] ^
+					ulCrcTable[ 1 ][ pucData[ 6 ] ] ^
+					ulCrcTable[ 0 ][ pucData[ 7 ] ];
+			pucData += 8;
+			uxLength -= 8u;
+		}
+
+		while( uxLength-- != 0u )
+		{
+			ulCrc = ( ulCrc >> 8 ) ^ ulCrcTable[ 0 ][ ( ulCrc ^ *( pucData++ ) ) & 0xFFu ];
+		}
+
+		return ~ulCrc;
+	}
+/*-----------------------------------------------------------*/
+
+	static void prvMD5Block( uint32_t * pulState,
+							 const uint8_t * pucBlock )
+	{
+		uint32_t ulWords[ 16 ];
+		uint32_t ulA = pulState[ 0 ], ulB = pulState[ 1 ], ulC = pulState[ 2 ], ulD = pulState[ 3 ];
+		BaseType_t xIndex;
+
+		for( xIndex = 0; xIndex < 16; xIndex++ )
+		{
+			ulWords[ xIndex ] = ( uint32_t ) pucBlock[ 4 * xIndex ] |
+								( ( uint32_t ) pucBlock[ 4 * xIndex + 1 ] << 8 ) |
+								( ( uint32_t ) pucBlock[ 4 * xIndex + 2 ] << 16 ) |
+								( ( uint32_t ) pucBlock[ 4 * xIndex + 3 ] << 24 );
+		}
+
+		for( xIndex = 0; xIndex < 64; xIndex++ )
+		{
+			uint32_t ulF, ulTemp;
+			BaseType_t xWord;
+
+			switch( xIndex >> 4 )
+			{
+				case 0:
+					ulF = ( ulB & ulC ) | ( ~ulB & ulD );
+					xWord = xIndex;
+					break;
+
+				case 1:
+					ulF = ( ulD & ulB ) | ( ~ulD & ulC );
+					xWord = ( 5 * xIndex + 1 ) & 15;
+					break;
+
+				case 2:
+					ulF = ulB ^ ulC ^ ulD;
+					xWord = ( 3 * xIndex + 5 ) & 15;
+					break;
+
+				default:
+					ulF = ulC ^ ( ulB | ~ulD );
+					xWord = ( 7 * xIndex ) & 15;
+					break;
+			}
+
+			ulTemp = ulD;
+			ulD = ulC;
+			ulC = ulB;
+			ulF += ulA + ulMD5Sines[ xIndex ] + ulWords[ xWord ];
+			ulB += hashROTL( ulF, ucMD5Shifts[ ( ( xIndex >> 4 ) << 2 ) | ( xIndex & 3 ) ] );
+			ulA = ulTemp;
+		}
+
+		pulState[ 0 ] += ulA;
+		pulState[ 1 ] += ulB;
+		pulState[ 2 ] += ulC;
+		pulState[ 3 ] += ulD;
+	}
+/*-----------------------------------------------------------*/
+
+	static void prvSHA256Block( uint32_t * pulState,
+								const uint8_t * pucBlock )
+	{
+		/* The message schedule is kept in a ring of 16 words, each new word
+		 * only depends on words that are 2 to 16 positions back. */
+		uint32_t ulW[ 16 ];
+		uint32_t ulA = pulState[ 0 ], ulB = pulState[ 1 ], ulC = pulState[ 2 ], ulD = pulState[ 3 ];
+		uint32_t ulE = pulState[ 4 ], ulF = pulState[ 5 ], ulG = pulState[ 6 ], ulH = pulState[ 7 ];
+		BaseType_t xIndex;
+
+		for( xIndex = 0; xIndex < 16; xIndex++ )
+		{
+			ulW[ xIndex ] = ( ( uint32_t ) pucBlock[ 4 * xIndex ] << 24 ) |
+							( ( uint32_t ) pucBlock[ 4 * xIndex + 1 ] << 16 ) |
+							( ( uint32_t ) pucBlock[ 4 * xIndex + 2 ] << 8 ) |
+							( uint32_t ) pucBlock[ 4 * xIndex + 3 ];
+		}
+
+		for( xIndex = 0; xIndex < 64; xIndex++ )
+		{
+			uint32_t ulT1, ulT2;
+			uint32_t ulWord;
+
+			if( xIndex < 16 )
+			{
+				ulWord = ulW[ xIndex ];
+			}
+			else
+			{
+				uint32_t ulW15 = ulW[ ( xIndex - 15 ) & 15 ];
+				uint32_t ulW2 = ulW[ ( xIndex - 2 ) & 15 ];
+				uint32_t ulS0 = hashROTR( ulW15, 7 ) ^ hashROTR( ulW15, 18 ) ^ ( ulW15 >> 3 );
+				uint32_t ulS1 = hashROTR( ulW2, 17 ) ^ hashROTR( ulW2, 19 ) ^ ( ulW2 >> 10 );
+
+				ulWord = ulW[ xIndex & 15 ] + ulS0 + ulW[ ( xIndex - 7 ) & 15 ] + ulS1;
+				ulW[ xIndex & 15 ] = ulWord;
+			}
+
+			ulT1 = ulH + ( hashROTR( ulE, 6 ) ^ hashROTR( ulE, 11 ) ^ hashROTR( ulE, 25 ) ) +
+				   ( ( ulE & ulF ) ^ ( ~ulE & ulG ) ) + ulSHA256Constants[ xIndex ] + ulWord;
+			ulT2 = ( hashROTR( ulA, 2 ) ^ hashROTR( ulA, 13 ) ^ hashROTR( ulA, 22 ) ) +
+				   ( ( ulA & ulB ) ^ ( ulA & ulC ) ^ ( ulB & ulC ) );
+			ulH = ulG;
+			ulG = ulF;
+			ulF = ulE;
+			ulE = ulD + ulT1;
+			ulD = ulC;
+			ulC = ulB;
+			ulB = ulA;
+			ulA = ulT1 + ulT2;
+		}
+
+		pulState[ 0 ] += ulA;
+		pulState[ 1 ] += ulB;
+		pulState[ 2 ] += ulC;
+		pulState[ 3 ] += ulD;
+		pulState[ 4 ] += ulE;
+		pulState[ 5 ] += ulF;
+		pulState[ 6 ] += ulG;
+		pulState[ 7 ] += ulH;
+	}
+/*-----------------------------------------------------------*/
+
+	void vFTPHashInit( FTPHash_t * pxHash,
+					   BaseType_t xType )
+	{
+		static const uint32_t ulMD5Init[ 4 ] =
+		{
+			0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476
+		};
+		static const uint32_t ulSHA256Init[ 8 ] =
+		{
+			0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+		};
+
+		memset( pxHash, '\0', sizeof( *pxHash ) );
+		pxHash->xType = xType;
+
+		if( xType == ftpHASH_MD5 )
+		{
+			memcpy( pxHash->ulState, ulMD5Init, sizeof( ulMD5Init ) );
+		}
+		else if( xType == ftpHASH_SHA256 )
+		{
+			memcpy( pxHash->ulState, ulSHA256Init, sizeof( ulSHA256Init ) );
+		}
+		else
+		{
+			/* CRC-32 starts at zero. */
+		}
+	}
+/*-----------------------------------------------------------*/
+
+	void vFTPHashUpdate( FTPHash_t * pxHash,
+						 const void * pvData,
+						 size_t uxLength )
+	{
+		const uint8_t * pucData = ( const uint8_t * ) pvData;
+
+		if( pxHash->xType == ftpHASH_CRC32 )
+		{
+			pxHash->ulState[ 0 ] = ulFTPCrc32( pxHash->ulState[ 0 ], pucData, uxLength );
+			pxHash->ullLength += uxLength;
+		}
+		else
+		{
+			size_t uxUsed = ( size_t ) ( pxHash->ullLength & 63u );
+
+			pxHash->ullLength += uxLength;
+
+			while( uxLength > 0u )
+			{
+				if( ( uxUsed == 0u ) && ( uxLength >= 64u ) )
+				{
+					/* Whole blocks are hashed in place. */
+					if( pxHash->xType == ftpHASH_MD5 )
+					{
+						prvMD5Block( pxHash->ulState, pucData );
+					}
+					else
+					{
+						prvSHA256Block( pxHash->ulState, pucData );
+					}
+
+					pucData += 64;
+					uxLength -= 64u;
+				}
+				else
+				{
+					size_t uxCount = 64u - uxUsed;
+
+					if( uxCount > uxLength )
+					{
+						uxCount = uxLength;
+					}
+
+					memcpy( pxHash->ucBlock + uxUsed, pucData, uxCount );
+					uxUsed += uxCount;
+					pucData += uxCount;
+					uxLength -= uxCount;
+
+					if( uxUsed == 64u )
+					{
+						if( pxHash->xType == ftpHASH_MD5 )
+						{
+							prvMD5Block( pxHash->ulState, pxHash->ucBlock );
+						}
+						else
+						{
+							prvSHA256Block( pxHash->ulState, pxHash->ucBlock );
+						}
+
+						uxUsed = 0u;
+					}
+				}
+			}
+		}
+	}
+/*-----------------------------------------------------------*/
+
+	void vFTPHashFinal( FTPHash_t * pxHash,
+						char * pcHex )
+	{
+		if( pxHash->xType == ftpHASH_CRC32 )
+		{
+			snprintf( pcHex, ftpHASH_MAX_HEX_LENGTH, "%08lX", ( unsigned long ) pxHash->ulState[ 0 ] );
+		}
+		else
+		{
+			uint64_t ullBits = pxHash->ullLength * 8u;
+			size_t uxUsed = ( size_t ) ( pxHash->ullLength & 63u );
+			BaseType_t xWords = ( pxHash->xType == ftpHASH_MD5 ) ? 4 : 8;
+			BaseType_t xIndex;
+
+			/* Append a one bit, zeros, and the length in bits. */
+			pxHash->ucBlock[ uxUsed++ ] = 0x80u;
+
+			if( uxUsed > 56u )
+			{
+				memset( pxHash->ucBlock + uxUsed, '\0', 64u - uxUsed );
+
+				if( pxHash->xType == ftpHASH_MD5 )
+				{
+					prvMD5Block( pxHash->ulState, pxHash->ucBlock );
+				}
+				else
+				{
+					prvSHA256Block( pxHash->ulState, pxHash->ucBlock );
+				}
+
+				uxUsed = 0u;
+			}
+
+			memset( pxHash->ucBlock + uxUsed, '\0', 56u - uxUsed );
+
+			for( xIndex = 0; xIndex < 8; xIndex++ )
+			{
+				/* MD5 stores the length little-endian, SHA-256 big-endian. */
+				uint8_t ucByte = ( uint8_t ) ( ullBits >> ( 8 * xIndex ) );
+
+				if( pxHash->xType == ftpHASH_MD5 )
+				{
+					pxHash->ucBlock[ 56 + xIndex ] = ucByte;
+				}
+				else
+				{
+					pxHash->ucBlock[ 63 - xIndex ] = ucByte;
+				}
+			}
+
+			if( pxHash->xType == ftpHASH_MD5 )
+			{
+				prvMD5Block( pxHash->ulState, pxHash->ucBlock );
+			}
+			else
+			{
+				prvSHA256Block( pxHash->ulState, pxHash->ucBlock );
+			}
+
+			for( xIndex = 0; xIndex < xWords; xIndex++ )
+			{
+				uint32_t ulWord = pxHash->ulState[ xIndex ];
+
+				if( pxHash->xType == ftpHASH_MD5 )
+				{
+					/* The MD5 digest is little-endian. */
+					ulWord = ( ulWord >> 24 ) | ( ( ulWord >> 8 ) & 0xFF00u ) |
+							 ( ( ulWord << 8 ) & 0xFF0000u ) | ( ulWord << 24 );
+				}
+
+				snprintf( pcHex + 8 * xIndex, 9, "%08lx", ( unsigned long ) ulWord );
+			}
+		}
+	}
+/*-----------------------------------------------------------*/
+
+	const char * pcFTPHashName( BaseType_t xType )
+	{
+		const char * pcName = "";
+
+		if( ( xType >= 0 ) && ( xType < ( BaseType_t ) ( sizeof( pcHashNames ) / sizeof( pcHashNames[ 0 ] ) ) ) )
+		{
+			pcName = pcHashNames[ xType ];
+		}
+
+		return pcName;
+	}
+/*-----------------------------------------------------------*/
+
+	BaseType_t xFTPHashType( const char * pcName )
+	{
+		BaseType_t xType;
+
+		for( xType = 0; xType < ( BaseType_t ) ( sizeof( pcHashNames ) / sizeof( pcHashNames[ 0 ] ) ); xType++ )
+		{
+			if( strcasecmp( pcName, pcHashNames[ xType ] ) == 0 )
+			{
+				break;
+			}
+		}
+
+		if( xType == ( BaseType_t ) ( sizeof( pcHashNames ) / sizeof( pcHashNames[ 0 ] ) ) )
+		{
+			xType = -1;
+		}
+
+		return xType;
+	}
+/*-----------------------------------------------------------*/
+
+#endif /* ( ipconfigUSE_FTP == 1 ) && ( ( ipconfigFTP_HAS_HASH != 0 ) || ( ipconfigFTP_STORE_CRC != 0 ) ) */
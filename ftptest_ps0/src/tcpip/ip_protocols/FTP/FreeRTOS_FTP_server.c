@@ -27,11 +27,13 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <ctype.h>
 #include <time.h>
 
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
 #include "task.h"
+#include "semphr.h"
 #include "portmacro.h"
 
 /* FreeRTOS+TCP includes. */
@@ -42,6 +44,8 @@
 
 /* FreeRTOS Protocol includes. */
 #include "FreeRTOS_FTP_commands.h"
+#include "FreeRTOS_FTP_deflate.h"
+#include "FreeRTOS_FTP_hash.h"
 #include "FreeRTOS_TCP_server.h"
 #include "FreeRTOS_server_private.h"
 
@@ -88,12 +92,185 @@
 		#define ipconfigFTP_ZERO_COPY_ALIGNED_WRITES    0
 	#endif
 
+/*
+ * ipconfigFTP_TX_ZERO_COPY : when non-zero, RETR reads the file directly into
+ * the TX stream of the data socket.  As much as possible, whole clusters are
+ * read ahead, and the reads are kept aligned to sectors.
+ */
+	#ifndef ipconfigFTP_TX_ZERO_COPY
+		#define ipconfigFTP_TX_ZERO_COPY    0
+	#endif
+
+/*
+ * ipconfigFTP_STOR_ALLOCATE_SIZE : when a client does not announce the file
+ * size with ALLO, STOR will reserve clusters ahead of the data in steps of
+ * this many bytes.  Clusters that are not used are freed when the file is
+ * closed.  Zero means: only reserve space when ALLO was received.
+ */
+	#ifndef ipconfigFTP_STOR_ALLOCATE_SIZE
+		#define ipconfigFTP_STOR_ALLOCATE_SIZE    0
+	#endif
+
+
+/*
+ * ipconfigFTP_LIST_CACHE_COUNT : when non-zero, the output of LIST and MLSD is
+ * stored in one of this many cache entries of ipconfigFTP_LIST_CACHE_SIZE
+ * bytes.  When the same directory is listed again, and no directory on the
+ * disk has been changed in the mean time, the listing is sent from the cache
+ * without reading the directory.  Listings that do not fit are not stored.
+ */
+	#ifndef ipconfigFTP_LIST_CACHE_COUNT
+		#define ipconfigFTP_LIST_CACHE_COUNT    0
+	#endif
+
+	#ifndef ipconfigFTP_LIST_CACHE_SIZE
+		#define ipconfigFTP_LIST_CACHE_SIZE    ( 8 * 1024 )
+	#endif
+
+	#if ( ipconfigFTP_LIST_CACHE_COUNT > 0 )
+		struct xFTP_LIST_CACHE
+		{
+			char pcDirectory[ ffconfigMAX_FILENAME ]; /* Absolute path of the directory. */
+			uint32_t ulDirChanges;                    /* The value of ff_dirchanges() when the listing was started. */
+			TickType_t xLastUsed;                     /* To find the least recently used entry. */
+			BaseType_t xMachineList;                  /* pdTRUE for MLSD, pdFALSE for LIST. */
+			BaseType_t xReadOnly;                     /* pdTRUE when the MLSD permissions were made for a read-only client. */
+			BaseType_t xEntryCount;                   /* The number of directory entries listed. */
+			BaseType_t xUsers;                        /* The number of clients that are filling or sending this listing. */
+			BaseType_t xComplete;                     /* pdTRUE when the whole listing has been stored. */
+			size_t uxLength;                          /* The number of bytes stored in pcData. */
+			char pcData[ ipconfigFTP_LIST_CACHE_SIZE ];
+		};
+		typedef struct xFTP_LIST_CACHE FTPListCache_t;
+
+/* The cache is shared by all tasks that run an FTP server. */
+		static FTPListCache_t xListCache[ ipconfigFTP_LIST_CACHE_COUNT ];
+	#endif /* ipconfigFTP_LIST_CACHE_COUNT > 0 */
+
+/*
+ * ipconfigFTP_PASV_POOL_SIZE : when non-zero, up to this number of data sockets
+ * are created, bound and put in the listening state in advance.  A PASV or
+ * EPSV command takes a socket from this pool, so the reply can be sent
+ * immediately.  The pool is refilled after the reply has been sent.  A socket
+ * that was never connected to is returned to the pool.
+ */
+	#ifndef ipconfigFTP_PASV_POOL_SIZE
+		#define ipconfigFTP_PASV_POOL_SIZE    0
+	#endif
+
+/*
+ * ipconfigFTP_PIPELINE_COUNT : the maximum number of commands that are taken
+ * from the command socket in one call to xFTPClientWork().  Clients may send
+ * several commands without waiting for the replies.
+ */
+	#ifndef ipconfigFTP_PIPELINE_COUNT
+		#define ipconfigFTP_PIPELINE_COUNT    8
+	#endif
+
+/* A perfect hash of the verbs in xFTPCommands[], see xTCPServerHashBuild(). */
+	static CommandHash_t xFTPCommandHash;
+
+/* The data received with STOR are checksummed while they are written. */
+	#define ftpSTORE_CHECKSUM    ( ( ipconfigFTP_STORE_CRC != 0 ) || ( ( ipconfigFTP_HAS_HASH != 0 ) && ( ipconfigFTP_HASH_ON_STORE != 0 ) ) )
+
+	#if ( ipconfigFTP_HAS_HASH != 0 )
+
+/* The number of bytes of a file that are hashed in one call to
+ * xFTPClientWork(), so that other clients get a turn. */
+		#define ftpHASH_BYTES_PER_CALL    ( 64u * 1024u )
+
+/* The states of a FTPFileDigest_t. */
+		#define ftpDIGEST_NONE            0 /* No valid digest. */
+		#define ftpDIGEST_READING         1 /* A file is read to answer a hash command. */
+		#define ftpDIGEST_STORING         2 /* A file is being received with STOR. */
+		#define ftpDIGEST_STORED          3 /* STOR is ready, but the file is not closed yet. */
+		#define ftpDIGEST_VALID           4 /* pcDigest belongs to pcFileName. */
+
+		struct xFTP_FILE_DIGEST
+		{
+			FTPHash_t xHash;
+			FF_FILE * pxHandle;                   /* The file being read for a hash command. */
+			BaseType_t xCommand;                  /* ECMD_HASH, ECMD_XCRC or ECMD_XMD5. */
+			BaseType_t xSelected;                 /* The algorithm of HASH, set with OPTS HASH. */
+			BaseType_t xStoreType;                /* The algorithm used while storing a file. */
+			BaseType_t xState;                    /* One of the ftpDIGEST_xxx values. */
+			uint32_t ulSize;                      /* The size, cluster and time of the file */
+			uint32_t ulCluster;                   /* when the digest was calculated, to */
+			uint32_t ulModified;                  /* see if it was changed since. */
+			uint32_t ulStart;                     /* The digest covers ulLength bytes, */
+			uint32_t ulLength;                    /* starting at offset ulStart. */
+			char pcDigest[ ftpHASH_MAX_HEX_LENGTH ];
+			char pcFileName[ ffconfigMAX_FILENAME ]; /* Absolute path of the file. */
+		};
+		typedef struct xFTP_FILE_DIGEST FTPFileDigest_t;
+	#endif /* ipconfigFTP_HAS_HASH != 0 */
+
+	#if ( ipconfigFTP_MEMORY_SINK_COUNT > 0 )
+		struct xFTP_SINK_SLOT
+		{
+			FTPMemorySink_t xSink; /* xSink.pcName is NULL for a free slot. */
+			BaseType_t xBusy;      /* pdTRUE while a client is storing to it. */
+		};
+		typedef struct xFTP_SINK_SLOT FTPSinkSlot_t;
+
+/* The sinks are shared by all tasks that run an FTP server. */
+		static FTPSinkSlot_t xSinkSlots[ ipconfigFTP_MEMORY_SINK_COUNT ];
+
+/* A client is receiving a file, either to the disk or to a memory sink. */
+		#define ftpIS_STORING( pxClient )    ( ( ( pxClient )->pxWriteHandle != NULL ) || ( ( pxClient )->pxSink != NULL ) )
+	#else
+		#define ftpIS_STORING( pxClient )    ( ( pxClient )->pxWriteHandle != NULL )
+	#endif
+
+	#if ( ipconfigFTP_MEMORY_SOURCE_COUNT > 0 )
+		struct xFTP_SOURCE_SLOT
+		{
+			FTPMemorySource_t xSource; /* xSource.pcName is NULL for a free slot. */
+			uint32_t ulModified;       /* The time of the last change, for MDTM. */
+			BaseType_t xReaders;       /* The number of clients that are sending it. */
+		};
+		typedef struct xFTP_SOURCE_SLOT FTPSourceSlot_t;
+
+/* The sources are shared by all tasks that run an FTP server. */
+		static FTPSourceSlot_t xSourceSlots[ ipconfigFTP_MEMORY_SOURCE_COUNT ];
+
+/* A client is sending a file, either from the disk or from a memory source. */
+		#define ftpIS_RETRIEVING( pxClient )    ( ( ( pxClient )->pxReadHandle != NULL ) || ( ( pxClient )->pxSource != NULL ) )
+	#else
+		#define ftpIS_RETRIEVING( pxClient )    ( ( pxClient )->pxReadHandle != NULL )
+	#endif
+
+	#if ( ipconfigFTP_PASV_POOL_SIZE > 0 )
+/* The pool is shared by all tasks that run an FTP server. */
+		static Socket_t xPassivePool[ ipconfigFTP_PASV_POOL_SIZE ];
+		static BaseType_t xPassivePoolCount = 0;
+	#endif
+
 /*
  * This module only has 2 public functions:
  */
 	BaseType_t xFTPClientWork( TCPClient_t * pxClient );
 	void vFTPClientDelete( TCPClient_t * pxClient );
 
+/*
+ * Receive a single line from the command socket.  Returns 0 as long as the
+ * line is not complete.
+ */
+	static BaseType_t prvReceiveCommand( FTPClient_t * pxClient );
+
+/*
+ * Do not let select() report the command socket as readable before it has
+ * at least uxLowWater bytes, or any number of bytes when uxLowWater is 0.
+ */
+	static void prvSetRxLowWater( FTPClient_t * pxClient,
+								  size_t uxLowWater );
+
+/*
+ * Look up the verb of a command, returns ECMD_UNKNOWN if it is not known.
+ */
+	static BaseType_t prvFindCommand( char * pcCommand,
+									  char ** ppcRestCommand );
+
 /*
  * Process a single command.
  */
@@ -107,11 +284,36 @@
 	static BaseType_t prvTransferConnect( FTPClient_t * pxClient,
 										  BaseType_t xDoListen );
 
+/*
+ * Create a data socket, bind it to any port and set its options.
+ */
+	static Socket_t prvTransferSocketCreate( BaseType_t xDoListen );
+
 /*
  * Either call listen() or connect() to start the transfer connection.
  */
 	static BaseType_t prvTransferStart( FTPClient_t * pxClient );
 
+/*
+ * PASV and EPSV: start listening and get the local port number.
+ */
+	static UBaseType_t prvTransferPassive( FTPClient_t * pxClient,
+										   uint32_t * pulIPAddress );
+
+	#if ( ipconfigFTP_PASV_POOL_SIZE > 0 )
+
+/*
+ * Take a listening socket from the pool, or return one that was not used.
+ */
+		static Socket_t prvPassivePoolTake( void );
+		static BaseType_t prvPassivePoolGive( Socket_t xSocket );
+
+/*
+ * Create listening sockets until the pool is full.
+ */
+		static void prvPassivePoolFill( void );
+	#endif /* ipconfigFTP_PASV_POOL_SIZE > 0 */
+
 /*
  * See if the socket has got connected or disconnected. Close the socket if
  * necessary.
@@ -166,6 +368,12 @@
 	static UBaseType_t prvParsePortData( const char * pcCommand,
 										 uint32_t * pulIPAddress );
 
+/*
+ * Parse the arguments of EPRT, e.g. "|1|192.168.1.2|1043|".
+ */
+	static UBaseType_t prvParseExtendedPortData( const char * pcCommand,
+												 uint32_t * pulIPAddress );
+
 /*
  * CWD: Change current working directory.
  */
@@ -223,10 +431,43 @@
 
 /*
  * LIST: Send a directory listing in Unix style.
+ * MLSD: Send a directory listing in the machine readable format of RFC 3659.
  */
-	static BaseType_t prvListSendPrep( FTPClient_t * pxClient );
+	static BaseType_t prvListSendPrep( FTPClient_t * pxClient,
+									   const char * pcDirectory );
 	static BaseType_t prvListSendWork( FTPClient_t * pxClient );
 
+/*
+ * Prepare the reply that will be sent when a listing is complete.
+ */
+	static void prvListSendAck( FTPClient_t * pxClient );
+
+	#if ( ipconfigFTP_LIST_CACHE_COUNT > 0 )
+
+/*
+ * Find a cached listing of pcNEW_DIR, or an entry to store a new listing.
+ */
+		static void prvListCacheTake( FTPClient_t * pxClient );
+
+/*
+ * Stop using the cache entry, and mark it as complete if the listing has been
+ * stored completely.
+ */
+		static void prvListCacheGive( FTPClient_t * pxClient,
+									  BaseType_t xComplete );
+
+/*
+ * Send as much as possible of a cached listing.
+ */
+		static void prvListCacheSend( FTPClient_t * pxClient );
+	#endif /* ipconfigFTP_LIST_CACHE_COUNT > 0 */
+
+/*
+ * MLST: Send the facts of a single file or directory on the command socket.
+ */
+	static BaseType_t prvListSingleFile( FTPClient_t * pxClient,
+										 const char * pcFileName );
+
 /*
  * RETR: Send a file to the FTP client.
  */
@@ -234,6 +475,35 @@
 										   char * pcFileName );
 	static BaseType_t prvRetrieveFileWork( FTPClient_t * pxClient );
 
+/*
+ * RETR: send the 150 reply and connect the data socket.
+ */
+	static void prvRetrieveFileConnect( FTPClient_t * pxClient,
+										size_t uxFileSize );
+
+	#if ( ipconfigFTP_MEMORY_SOURCE_COUNT > 0 )
+
+/*
+ * Find a memory source by the path that the client used, and count the
+ * client as a reader when xTake is true.  Returns NULL when the path is not
+ * one of the memory sources.
+ */
+		static FTPSourceSlot_t * prvMemorySourceFind( FTPClient_t * pxClient,
+													  const char * pcPath,
+													  BaseType_t xTake );
+
+/*
+ * RETR from a memory source.  prvRetrieveMemoryRead() copies the next part
+ * of a source, it is also used by MODE Z.
+ */
+		static BaseType_t prvRetrieveMemoryPrep( FTPClient_t * pxClient );
+		static BaseType_t prvRetrieveMemoryWork( FTPClient_t * pxClient );
+		static size_t prvRetrieveMemoryRead( FTPClient_t * pxClient,
+											 uint8_t * pucBuffer,
+											 size_t uxCount );
+	#endif
+
+
 /*
  * STOR: Receive a file from the FTP client and store it.
  */
@@ -241,6 +511,168 @@
 										char * pcFileName );
 	static BaseType_t prvStoreFileWork( FTPClient_t * pxClient );
 
+/*
+ * STOR: send the 150 reply and connect the data socket.
+ */
+	static void prvStoreFileConnect( FTPClient_t * pxClient );
+
+	#if ( ipconfigFTP_MEMORY_SINK_COUNT > 0 )
+
+/*
+ * STOR to a memory sink: the data are not written to a file.  The sink is
+ * released with success or failure in prvStoreMemoryDone().
+ */
+		static BaseType_t prvStoreMemoryPrep( FTPClient_t * pxClient );
+		static BaseType_t prvStoreMemoryWork( FTPClient_t * pxClient );
+		static BaseType_t prvStoreMemoryWrite( FTPClient_t * pxClient,
+											   const uint8_t * pucData,
+											   size_t uxLength );
+		static void prvStoreMemoryDone( FTPClient_t * pxClient,
+										BaseType_t xSuccess );
+	#endif
+
+	#if ( ipconfigFTP_HAS_MODE_Z != 0 )
+
+/*
+ * RETR and STOR in MODE Z: the data are sent as a zlib stream.
+ */
+		static BaseType_t prvRetrieveFileCompressed( FTPClient_t * pxClient );
+		static BaseType_t prvStoreFileCompressed( FTPClient_t * pxClient );
+	#endif
+
+	#if ( ipconfigFTP_HAS_HASH != 0 )
+
+/*
+ * HASH, XCRC and XMD5: reply with the digest of a file.  When the digest is
+ * not known yet, the file will be read by prvHashFileWork().
+ */
+		static void prvHashCommand( FTPClient_t * pxClient,
+									BaseType_t xCommand,
+									const char * pcFileName );
+
+/*
+ * XCRC and XMD5: split an argument like '"name" start end' or 'name start'
+ * into the name and the positions.  Returns the number of positions, or -1
+ * in case of a syntax error.
+ */
+		static BaseType_t prvHashRange( char * pcArgument,
+										uint32_t * pulStart,
+										uint32_t * pulEnd );
+
+/*
+ * Read and hash the next part of a file, and reply when it is done.
+ */
+		static void prvHashFileWork( FTPClient_t * pxClient );
+
+/*
+ * OPTS HASH: show or select the algorithm used by HASH.
+ */
+		static const char * prvHashOptions( FTPClient_t * pxClient,
+											const char * pcOption );
+
+		#if ( ipconfigFTP_HASH_ON_STORE != 0 )
+
+/*
+ * STOR: calculate the digest of a file while it is received.
+ */
+			static void prvHashStoreStart( FTPClient_t * pxClient );
+			static void prvHashStoreData( FTPClient_t * pxClient,
+										  const void * pvData,
+										  size_t uxLength );
+			static void prvHashStoreEnd( FTPClient_t * pxClient );
+			static void prvHashStoreClosed( FTPClient_t * pxClient );
+		#endif
+	#endif /* ipconfigFTP_HAS_HASH != 0 */
+
+	#if ( ftpSTORE_CHECKSUM != 0 )
+
+/*
+ * STOR: update the CRC and the digest with data that have been written.
+ */
+		static void prvStoreFileChecksum( FTPClient_t * pxClient,
+										  const void * pvData,
+										  size_t uxLength );
+	#endif
+
+	#if ( ipconfigFTP_STORE_CRC != 0 )
+
+/*
+ * STOR: reset the CRC when an upload starts, compare it with the one announced
+ * by 'SITE CRCCHECK' when the transfer ends, and remove a damaged file, or add
+ * it to the CRC index, once it has been closed.
+ */
+		static void prvStoreCrcStart( FTPClient_t * pxClient,
+									  BaseType_t xFromStart );
+		static void prvStoreCrcCheck( FTPClient_t * pxClient );
+		static void prvStoreCrcClosed( FTPClient_t * pxClient );
+
+/*
+ * Rewrite the CRC index next to pxClient->pcFileName: drop the line of that
+ * file and the lines of files that are gone or have been changed, and add a
+ * new line for the file when xAddFile is true.  The tasks that share the
+ * index take turns with the mutex of prvCrcIndexLock().
+ */
+		static void prvCrcIndexUpdate( FTPClient_t * pxClient,
+									   BaseType_t xAddFile );
+		static void prvCrcIndexLock( void );
+		static void prvCrcIndexUnlock( void );
+
+/*
+ * Returns pdTRUE if pcName refers to the CRC index, which clients may not
+ * store, delete or rename.
+ */
+		static BaseType_t prvIsCrcIndex( const char * pcName );
+
+/*
+ * 'SITE CRC': reply with the CRC of the last upload, or with the CRC of a
+ * file as found in the index of its directory.
+ */
+		static void prvSiteCrc( FTPClient_t * pxClient,
+								const char * pcFileName );
+	#endif
+
+/*
+ * STAT without arguments: the status of the session and of a transfer.
+ */
+	static void prvSendStatus( FTPClient_t * pxClient );
+
+/*
+ * Read from or write to the file of a transfer, the time spent is counted
+ * when ipconfigFTP_HAS_STATS is defined.
+ */
+	static size_t prvFileRead( FTPClient_t * pxClient,
+							   void * pvBuffer,
+							   size_t uxCount );
+	static size_t prvFileWrite( FTPClient_t * pxClient,
+								const void * pvBuffer,
+								size_t uxCount );
+
+	#if ( ipconfigFTP_HAS_STATS != 0 )
+
+/*
+ * Statistics: a transfer starts and ends, the running transfer is copied to
+ * xStats, and the time the transfer waits for the network is measured.
+ */
+		static void prvStatsTransferStart( FTPClient_t * pxClient,
+										   BaseType_t xSending );
+		static void prvStatsTransferEnd( FTPClient_t * pxClient );
+		static void prvStatsUpdate( FTPClient_t * pxClient );
+		static void prvStatsWaitEnd( FTPClient_t * pxClient );
+		static void prvStatsWaitCheck( FTPClient_t * pxClient );
+		static uint32_t prvStatsClockToMs( uint64_t ullClocks );
+
+/*
+ * 'SITE STATS': reply with the statistics of the session.
+ */
+		static void prvSiteStats( FTPClient_t * pxClient );
+	#endif /* ipconfigFTP_HAS_STATS != 0 */
+
+/*
+ * STOR: reserve the clusters for a file of ulSize bytes.
+ */
+	static void prvStoreFileReserve( FTPClient_t * pxClient,
+									 uint32_t ulSize );
+
 /*
  * Print/format a single directory entry in Unix style.
  */
@@ -248,6 +680,17 @@
 										  char * pcLine,
 										  BaseType_t xMaxLength );
 
+/*
+ * Print/format the facts of a single directory entry for MLSD and MLST.
+ */
+	static BaseType_t prvGetFileFacts( char * pcLine,
+									   BaseType_t xMaxLength,
+									   BaseType_t xIsDir,
+									   BaseType_t xReadOnly,
+									   uint32_t ulSize,
+									   const FF_SystemTime_t * pxTime,
+									   const char * pcFileName );
+
 /*
  * Send a reply to a socket, either the command- or the data-socket.
  */
@@ -284,7 +727,8 @@
 	BaseType_t xFTPClientWork( TCPClient_t * pxTCPClient )
 	{
 		FTPClient_t * pxClient = ( FTPClient_t * ) pxTCPClient;
-		BaseType_t xRc;
+		BaseType_t xRc, xCount, xIndex;
+		char * pcRestCommand;
 
 		if( pxClient->bits.bHelloSent == pdFALSE_UNSIGNED )
 		{
@@ -295,21 +739,45 @@
 			xLength = snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ),
 								"220 Welcome to the FreeRTOS+TCP FTP server\r\n" );
 			prvSendReply( pxClient->xSocket, pcCOMMAND_BUFFER, xLength );
+
+			#if ( ipconfigFTP_HAS_STATS != 0 )
+				{
+					struct freertos_sockaddr xRemoteAddress;
+
+					FreeRTOS_GetRemoteAddress( pxClient->xSocket, &xRemoteAddress );
+					pxClient->xStats.ulClientIP = xRemoteAddress.sin_addr;
+					pxClient->xStats.usClientPort = FreeRTOS_ntohs( xRemoteAddress.sin_port );
+					pxClient->xStats.xConnectTime = xTaskGetTickCount();
+				}
+			#endif
 		}
 
-		/* Call recv() in a non-blocking way, to see if there is an FTP command
-		 * sent to this server. */
-		xRc = FreeRTOS_recv( pxClient->xSocket, ( void * ) pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), 0 );
+		#if ( ipconfigFTP_HAS_HASH != 0 )
+			if( ( pxClient->pxDigest != NULL ) && ( pxClient->pxDigest->pxHandle != NULL ) )
+			{
+				/* A file is being read to answer a hash command. */
+				prvHashFileWork( pxClient );
+			}
+		#endif
 
-		if( xRc > 0 )
+		/* Call recv() in a non-blocking way, to see if there are FTP commands
+		 * sent to this server. */
+		for( xCount = 0; xCount < ipconfigFTP_PIPELINE_COUNT; xCount++ )
 		{
-			BaseType_t xIndex;
-			const FTPCommand_t * pxCommand;
-			char * pcRestCommand;
+			#if ( ipconfigFTP_HAS_HASH != 0 )
+				if( ( pxClient->pxDigest != NULL ) && ( pxClient->pxDigest->pxHandle != NULL ) )
+				{
+					/* The reply to a hash command must come first. */
+					xRc = 0;
+					break;
+				}
+			#endif
 
-			if( xRc < ( BaseType_t ) sizeof( pcCOMMAND_BUFFER ) )
+			xRc = prvReceiveCommand( pxClient );
+
+			if( xRc <= 0 )
 			{
-				pcCOMMAND_BUFFER[ xRc ] = '\0';
+				break;
 			}
 
 			while( xRc && ( ( pcCOMMAND_BUFFER[ xRc - 1 ] == ftpASCII_CR ) || ( pcCOMMAND_BUFFER[ xRc - 1 ] == ftpASCII_LF ) ) )
@@ -317,38 +785,29 @@
 				pcCOMMAND_BUFFER[ --xRc ] = '\0';
 			}
 
-			/* Now iterate through a list of FTP commands, and look for a match. */
-			pxCommand = xFTPCommands;
-			pcRestCommand = pcCOMMAND_BUFFER;
-
-			for( xIndex = 0; xIndex < FTP_CMD_COUNT - 1; xIndex++, pxCommand++ )
-			{
-				BaseType_t xLength;
-
-				/* The length of each command is stored as well, just to be a bit
-				 * quicker here. */
-				xLength = pxCommand->xCommandLength;
+			/* If the command received was not recognised, xIndex will point to a
+			 * fake entry called 'ECMD_UNKNOWN'. */
+			xIndex = prvFindCommand( pcCOMMAND_BUFFER, &pcRestCommand );
+			prvProcessCommand( pxClient, xIndex, pcRestCommand );
 
-				if( ( xRc >= xLength ) && ( memcmp( ( const void * ) pxCommand->pcCommandName, ( const void * ) pcCOMMAND_BUFFER, xLength ) == 0 ) )
+			#if ( ipconfigFTP_PASV_POOL_SIZE > 0 )
 				{
-					/* A match with an existing command is found.  Skip any
-					 * whitespace to get the first parameter. */
-					pcRestCommand += xLength;
-
-					while( ( *pcRestCommand == ' ' ) || ( *pcRestCommand == '\t' ) )
-					{
-						pcRestCommand++;
-					}
-
-					break;
+					/* The reply has been sent, now there is time to replace a socket
+					 * that was taken from the pool. */
+					prvPassivePoolFill();
 				}
-			}
+			#endif
 
-			/* If the command received was not recognised, xIndex will point to a
-			 * fake entry called 'ECMD_UNKNOWN'. */
-			prvProcessCommand( pxClient, xIndex, pcRestCommand );
+			if( ftpIS_RETRIEVING( pxClient ) || ftpIS_STORING( pxClient ) ||
+				( pxClient->bits1.bDirHasEntry != pdFALSE_UNSIGNED ) )
+			{
+				/* A transfer has been started, let it run before looking at the
+				 * next command. */
+				break;
+			}
 		}
-		else if( xRc < 0 )
+
+		if( xRc < 0 )
 		{
 			/* The connection will be closed and the client will be deleted. */
 			FreeRTOS_printf( ( "xFTPClientWork: xRc = %ld\n", xRc ) );
@@ -367,17 +826,24 @@
 			{
 				BaseType_t xClientRc = 0;
 
+				#if ( ipconfigFTP_HAS_STATS != 0 )
+					{
+						/* Either the socket has an event, or select() timed out. */
+						prvStatsWaitEnd( pxClient );
+					}
+				#endif
+
 				if( pxClient->bits1.bDirHasEntry )
 				{
 					/* Still listing a directory. */
 					xClientRc = prvListSendWork( pxClient );
 				}
-				else if( pxClient->pxReadHandle != NULL )
+				else if( ftpIS_RETRIEVING( pxClient ) )
 				{
 					/* Sending a file. */
 					xClientRc = prvRetrieveFileWork( pxClient );
 				}
-				else if( pxClient->pxWriteHandle != NULL )
+				else if( ftpIS_STORING( pxClient ) )
 				{
 					/* Receiving a file. */
 					xClientRc = prvStoreFileWork( pxClient );
@@ -388,6 +854,13 @@
 					prvTransferCloseSocket( pxClient );
 					prvTransferCloseFile( pxClient );
 				}
+
+				#if ( ipconfigFTP_HAS_STATS != 0 )
+					else
+					{
+						prvStatsWaitCheck( pxClient );
+					}
+				#endif
 			}
 		}
 
@@ -397,8 +870,17 @@
 
 	static void prvTransferCloseDir( FTPClient_t * pxClient )
 	{
-		/* Nothing to close for +FAT. */
-		( void ) pxClient;
+		/* There is no directory handle to close for +FAT, but a listing may
+		 * still be using the cache. */
+		#if ( ipconfigFTP_LIST_CACHE_COUNT > 0 )
+			{
+				prvListCacheGive( pxClient, pdFALSE );
+			}
+		#else
+			{
+				( void ) pxClient;
+			}
+		#endif
 	}
 /*-----------------------------------------------------------*/
 
@@ -413,6 +895,19 @@
 		/* Close any open file handle. */
 		prvTransferCloseFile( pxClient );
 
+		#if ( ipconfigFTP_HAS_HASH != 0 )
+			if( pxClient->pxDigest != NULL )
+			{
+				if( pxClient->pxDigest->pxHandle != NULL )
+				{
+					ff_fclose( pxClient->pxDigest->pxHandle );
+				}
+
+				vPortFree( pxClient->pxDigest );
+				pxClient->pxDigest = NULL;
+			}
+		#endif
+
 		/* Close the FTP command socket */
 		if( pxClient->xSocket != FREERTOS_NO_SOCKET )
 		{
@@ -423,39 +918,179 @@
 	}
 /*-----------------------------------------------------------*/
 
-	static BaseType_t prvProcessCommand( FTPClient_t * pxClient,
-										 BaseType_t xIndex,
-										 char * pcRestCommand )
+	static BaseType_t prvReceiveCommand( FTPClient_t * pxClient )
 	{
-		const FTPCommand_t * pxFTPCommand = &( xFTPCommands[ xIndex ] );
-		const char * pcMyReply = NULL;
-		BaseType_t xResult = 0;
+		BaseType_t xRc;
+		BaseType_t xIndex;
 
-		if( ( pxFTPCommand->ucCommandType != ECMD_PASS ) && ( pxFTPCommand->ucCommandType != ECMD_PORT ) )
-		{
-			FreeRTOS_printf( ( "       %s %s\n", pxFTPCommand->pcCommandName, pcRestCommand ) );
-		}
+		/* Look at the data without taking them: there may be more than one
+		 * command. */
+		xRc = xTCPServerPeek( ( TCPClient_t * ) pxClient, pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ) - 1u );
 
-		if( ( pxFTPCommand->checkLogin != pdFALSE ) && ( pxClient->bits.bLoggedIn == pdFALSE_UNSIGNED ) )
-		{
-			pcMyReply = REPL_530; /* Please first log in. */
-		}
-		else if( ( pxFTPCommand->checkNullArg != pdFALSE ) && ( ( pcRestCommand == NULL ) || ( pcRestCommand[ 0 ] == '\0' ) ) )
+		if( xRc > 0 )
 		{
-			pcMyReply = REPL_501; /* Command needs a parameter. */
-		}
+			for( xIndex = 0; xIndex < xRc; xIndex++ )
+			{
+				if( pcCOMMAND_BUFFER[ xIndex ] == ftpASCII_LF )
+				{
+					break;
+				}
+			}
 
-		if( pcMyReply == NULL )
-		{
-			switch( pxFTPCommand->ucCommandType )
+			if( ( xIndex < xRc ) || ( xRc >= ( BaseType_t ) sizeof( pcCOMMAND_BUFFER ) - 1 ) )
 			{
-				case ECMD_USER: /* User. */
-					/* User name has been entered, expect password. */
-					pxClient->bits.bStatusUser = pdTRUE_UNSIGNED;
+				/* Take the first line only, or as much as fits in the buffer
+				 * when the line is too long. */
+				xRc = ( xIndex < xRc ) ? ( xIndex + 1 ) : xRc;
+				prvSetRxLowWater( pxClient, 0u );
+				xRc = xTCPServerTake( ( TCPClient_t * ) pxClient, pcCOMMAND_BUFFER, ( size_t ) xRc );
 
-					#if ( ipconfigFTP_HAS_USER_PASSWORD_HOOK != 0 ) /*_RB_ Needs defaulting and adding to the web documentation. */
-						{
-							/* Save the user name in 'pcFileName'. */
+				if( xRc > 0 )
+				{
+					pcCOMMAND_BUFFER[ xRc ] = '\0';
+				}
+			}
+			else if( FreeRTOS_connstatus( pxClient->xSocket ) != ( BaseType_t ) eESTABLISHED )
+			{
+				/* The peer has closed its side, the line will never be
+				 * completed. */
+				xRc = -1;
+			}
+			else
+			{
+				/* Wait for the rest of the line, without being woken up for
+				 * the bytes seen already. */
+				#if ( ipconfigSELECT_USES_READY_LIST == 1 )
+					{
+						prvSetRxLowWater( pxClient, ( size_t ) xRc + 1u );
+					}
+				#else
+					{
+						vTCPServerKeep( ( TCPClient_t * ) pxClient, ( size_t ) xRc );
+					}
+				#endif
+				xRc = 0;
+			}
+		}
+
+		return xRc;
+	}
+/*-----------------------------------------------------------*/
+
+	static void prvSetRxLowWater( FTPClient_t * pxClient,
+								  size_t uxLowWater )
+	{
+		#if ( ipconfigSELECT_USES_READY_LIST == 1 )
+			{
+				if( uxLowWater != pxClient->uxRxLowWater )
+				{
+					pxClient->uxRxLowWater = uxLowWater;
+					( void ) FreeRTOS_setsockopt( pxClient->xSocket, 0, FREERTOS_SO_SELECT_RCVLOWAT, ( void * ) &uxLowWater, sizeof( uxLowWater ) );
+				}
+			}
+		#else
+			{
+				/* FreeRTOS_select() has no low-water marks. */
+				( void ) pxClient;
+				( void ) uxLowWater;
+			}
+		#endif
+	}
+/*-----------------------------------------------------------*/
+
+	static BaseType_t prvFindCommand( char * pcCommand,
+									  char ** ppcRestCommand )
+	{
+		BaseType_t xIndex = -1;
+		BaseType_t xLength = 0;
+		char * pcRestCommand = pcCommand;
+
+		if( xFTPCommandHash.ulMultiplier == 0u )
+		{
+			uint32_t ulKeys[ FTP_CMD_COUNT - 1 ];
+
+			/* The fake entry ECMD_UNKNOWN is not part of the table. */
+			for( xIndex = 0; xIndex < FTP_CMD_COUNT - 1; xIndex++ )
+			{
+				ulKeys[ xIndex ] = ulTCPServerCommandKey( xFTPCommands[ xIndex ].pcCommandName, xFTPCommands[ xIndex ].xCommandLength );
+			}
+
+			( void ) xTCPServerHashBuild( &xFTPCommandHash, ulKeys, FTP_CMD_COUNT - 1 );
+		}
+
+		while( ( pcCommand[ xLength ] != '\0' ) && ( pcCommand[ xLength ] != ' ' ) && ( pcCommand[ xLength ] != '\t' ) )
+		{
+			xLength++;
+		}
+
+		xIndex = xTCPServerHashFind( &xFTPCommandHash, ulTCPServerCommandKey( pcCommand, xLength ) );
+
+		if( ( xIndex >= 0 ) &&
+			( xFTPCommands[ xIndex ].xCommandLength == xLength ) &&
+			( memcmp( ( const void * ) xFTPCommands[ xIndex ].pcCommandName, ( const void * ) pcCommand, xLength ) == 0 ) )
+		{
+			/* A match with an existing command is found.  Skip any
+			 * whitespace to get the first parameter. */
+			pcRestCommand += xLength;
+
+			while( ( *pcRestCommand == ' ' ) || ( *pcRestCommand == '\t' ) )
+			{
+				pcRestCommand++;
+			}
+		}
+		else
+		{
+			xIndex = ECMD_UNKNOWN;
+		}
+
+		*ppcRestCommand = pcRestCommand;
+
+		return xIndex;
+	}
+/*-----------------------------------------------------------*/
+
+	static BaseType_t prvProcessCommand( FTPClient_t * pxClient,
+										 BaseType_t xIndex,
+										 char * pcRestCommand )
+	{
+		const FTPCommand_t * pxFTPCommand = &( xFTPCommands[ xIndex ] );
+		const char * pcMyReply = NULL;
+		BaseType_t xResult = 0;
+
+		if( ( pxFTPCommand->ucCommandType != ECMD_PASS ) && ( pxFTPCommand->ucCommandType != ECMD_PORT ) )
+		{
+			FreeRTOS_printf( ( "       %s %s\n", pxFTPCommand->pcCommandName, pcRestCommand ) );
+		}
+
+		if( ( pxFTPCommand->checkLogin != pdFALSE ) && ( pxClient->bits.bLoggedIn == pdFALSE_UNSIGNED ) )
+		{
+			pcMyReply = REPL_530; /* Please first log in. */
+		}
+		else if( ( pxFTPCommand->checkNullArg != pdFALSE ) && ( ( pcRestCommand == NULL ) || ( pcRestCommand[ 0 ] == '\0' ) ) )
+		{
+			pcMyReply = REPL_501; /* Command needs a parameter. */
+		}
+		else if( ( pxClient->bits.bEpsvAll != pdFALSE_UNSIGNED ) &&
+				 ( ( pxFTPCommand->ucCommandType == ECMD_PORT ) ||
+				   ( pxFTPCommand->ucCommandType == ECMD_EPRT ) ||
+				   ( pxFTPCommand->ucCommandType == ECMD_PASV ) ) )
+		{
+			/* RFC 2428: after 'EPSV ALL', other ways to set up a data
+			 * connection must be refused, so that a NAT device can rely on it. */
+			pcMyReply = REPL_503_EPSV_ALL;
+		}
+
+		if( pcMyReply == NULL )
+		{
+			switch( pxFTPCommand->ucCommandType )
+			{
+				case ECMD_USER: /* User. */
+					/* User name has been entered, expect password. */
+					pxClient->bits.bStatusUser = pdTRUE_UNSIGNED;
+
+					#if ( ipconfigFTP_HAS_USER_PASSWORD_HOOK != 0 ) /*_RB_ Needs defaulting and adding to the web documentation. */
+						{
+							/* Save the user name in 'pcFileName'. */
 							snprintf( pxClient->pcFileName, sizeof( pxClient->pcFileName ), "%s", pcRestCommand );
 
 							/* The USER name is presented to the application.  The function
@@ -572,6 +1207,72 @@
 
 					break;
 
+				case ECMD_ALLO: /* The client announces the size of the next STOR. */
+
+					if( pxClient->bits.bReadOnly != pdFALSE_UNSIGNED )
+					{
+						pcMyReply = REPL_553_READ_ONLY;
+					}
+					else
+					{
+						const char * pcPtr = pcRestCommand;
+						char * pcEnd = NULL;
+						unsigned long ulSize = 0ul;
+
+						while( *pcPtr == ' ' )
+						{
+							pcPtr++;
+						}
+
+						if( ( *pcPtr >= '0' ) && ( *pcPtr <= '9' ) )
+						{
+							ulSize = strtoul( pcPtr, &pcEnd, 10 );
+						}
+
+						if( ( pcEnd == NULL ) || ( ( *pcEnd != '\0' ) && ( *pcEnd != ' ' ) ) )
+						{
+							pcMyReply = REPL_501; /* 501 Syntax error in parameters or arguments. */
+						}
+						else if( ( ( uint64_t ) ulSize > 0xFFFFFFFFull ) ||
+								 ( ( uint64_t ) ulSize > ( uint64_t ) ff_diskfree( pxClient->pcCurrentDir, NULL ) * 512u ) )
+						{
+							/* Larger than a FAT file can be, or than the free space. */
+							pxClient->ulAllocSize = 0ul;
+							pcMyReply = REPL_552;
+						}
+						else
+						{
+							pxClient->ulAllocSize = ( uint32_t ) ulSize;
+							snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ),
+									  "200 Will reserve %lu bytes\r\n", ( unsigned long ) pxClient->ulAllocSize );
+							pcMyReply = pcCOMMAND_BUFFER;
+						}
+					}
+
+					break;
+
+				case ECMD_ABOR:
+
+					/* Abort a transfer, e.g. when a client that downloads a file in
+					 * segments has received the part that it asked for. */
+					if( pxClient->xTransferSocket != FREERTOS_NO_SOCKET )
+					{
+						if( ftpIS_RETRIEVING( pxClient ) || ftpIS_STORING( pxClient ) )
+						{
+							/* prvTransferCloseSocket() will reply with 426, RFC 959
+							 * section 4.1.3. */
+							pxClient->bits1.bHadError = pdTRUE_UNSIGNED;
+							pxClient->bits1.bAborted = pdTRUE_UNSIGNED;
+						}
+
+						prvTransferCloseSocket( pxClient );
+						prvTransferCloseFile( pxClient );
+						prvTransferCloseDir( pxClient );
+					}
+
+					pcMyReply = "226 ABOR command successful.\r\n";
+					break;
+
 				case ECMD_NOOP: /* NOP operation */
 
 					if( pxClient->xTransferSocket != FREERTOS_NO_SOCKET )
@@ -585,6 +1286,34 @@
 
 					break;
 
+				case ECMD_OPTS: /* Options of a command. */
+					#if ( ipconfigFTP_HAS_HASH != 0 )
+						if( ( strncasecmp( pcRestCommand, "HASH", 4 ) == 0 ) &&
+							( ( pcRestCommand[ 4 ] == '\0' ) || ( pcRestCommand[ 4 ] == ' ' ) ) )
+						{
+							pcMyReply = prvHashOptions( pxClient, pcRestCommand + 4 );
+						}
+						else
+					#endif
+					{
+						pcMyReply = REPL_501;
+					}
+					break;
+
+				case ECMD_HASH: /* Get the digest of a file. */
+				case ECMD_XCRC:
+				case ECMD_XMD5:
+					#if ( ipconfigFTP_HAS_HASH != 0 )
+						{
+							prvHashCommand( pxClient, pxFTPCommand->ucCommandType, pcRestCommand );
+						}
+					#else
+						{
+							pcMyReply = REPL_502;
+						}
+					#endif
+					break;
+
 				case ECMD_TYPE: /* Ask or set transfer type. */
 				   {
 					   /* e.g. "TYPE I" for Images (binary). */
@@ -603,44 +1332,117 @@
 				   }
 				   break;
 
-				case ECMD_PASV: /* Enter passive mode. */
+				case ECMD_MODE: /* Set the transfer mode. */
 
-					/* Connect passive: Server will listen() and wait for a connection.
-					 * Start up a new data connection with 'xDoListen' set to true. */
-					if( prvTransferConnect( pxClient, pdTRUE ) == pdFALSE )
+					/* "MODE S" for a stream, "MODE Z" for a compressed stream. */
+					if( ( pcRestCommand[ 0 ] == 'S' ) || ( pcRestCommand[ 0 ] == 's' ) )
 					{
-						pcMyReply = REPL_502;
+						pxClient->bits.bModeZ = pdFALSE_UNSIGNED;
+						pcMyReply = REPL_200;
 					}
+
+					#if ( ipconfigFTP_HAS_MODE_Z != 0 )
+						else if( ( pcRestCommand[ 0 ] == 'Z' ) || ( pcRestCommand[ 0 ] == 'z' ) )
+						{
+							pxClient->bits.bModeZ = pdTRUE_UNSIGNED;
+							pcMyReply = REPL_200;
+						}
+					#endif
 					else
 					{
-						uint32_t ulIP;
-						uint16_t ulPort;
-						struct freertos_sockaddr xLocalAddress;
-						struct freertos_sockaddr xRemoteAddress;
+						pcMyReply = REPL_504;
+					}
+
+					break;
+
+				case ECMD_PASV: /* Enter passive mode. */
+
+					/* Connect passive: Server will listen() and wait for a connection. */
+				   {
+					   uint32_t ulIP;
+					   UBaseType_t uxPort;
+
+					   uxPort = prvTransferPassive( pxClient, &ulIP );
 
-						FreeRTOS_GetLocalAddress( pxClient->xTransferSocket, &xLocalAddress );
-						FreeRTOS_GetRemoteAddress( pxClient->xSocket, &xRemoteAddress );
+					   if( uxPort == 0u )
+					   {
+						   pcMyReply = REPL_502;
+					   }
+					   else
+					   {
+						   /* REPL_227_D "227 Entering Passive Mode (%d,%d,%d,%d,%d,%d). */
+						   snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), REPL_227_D,
+									 ( unsigned ) ulIP >> 24,
+									 ( unsigned ) ( ulIP >> 16 ) & 0xFF,
+									 ( unsigned ) ( ulIP >> 8 ) & 0xFF,
+									 ( unsigned ) ulIP & 0xFF,
+									 ( unsigned ) uxPort >> 8,
+									 ( unsigned ) uxPort & 0xFF );
+
+						   pcMyReply = pcCOMMAND_BUFFER;
+					   }
+				   }
+				   break;
 
-						ulIP = FreeRTOS_ntohl( xLocalAddress.sin_addr );
-						pxClient->ulClientIP = FreeRTOS_ntohl( xRemoteAddress.sin_addr );
-						ulPort = FreeRTOS_ntohs( xLocalAddress.sin_port );
+				case ECMD_EPSV: /* Enter extended passive mode (RFC 2428). */
 
-						pxClient->usClientPort = FreeRTOS_ntohs( xRemoteAddress.sin_port );
+					if( strcasecmp( pcRestCommand, "ALL" ) == 0 )
+					{
+						/* The client will only use EPSV from now on. */
+						pxClient->bits.bEpsvAll = pdTRUE_UNSIGNED;
+						pcMyReply = "200 EPSV ALL command successful.\r\n";
+					}
+					else if( ( pcRestCommand[ 0 ] != '\0' ) && ( strcmp( pcRestCommand, "1" ) != 0 ) )
+					{
+						/* Only IPv4 is supported. */
+						pcMyReply = REPL_522;
+					}
+					else
+					{
+						uint32_t ulIP;
+						UBaseType_t uxPort;
 
-						/* REPL_227_D "227 Entering Passive Mode (%d,%d,%d,%d,%d,%d). */
-						snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), REPL_227_D,
-								  ( unsigned ) ulIP >> 24,
-								  ( unsigned ) ( ulIP >> 16 ) & 0xFF,
-								  ( unsigned ) ( ulIP >> 8 ) & 0xFF,
-								  ( unsigned ) ulIP & 0xFF,
-								  ( unsigned ) ulPort >> 8,
-								  ( unsigned ) ulPort & 0xFF );
+						uxPort = prvTransferPassive( pxClient, &ulIP );
 
-						pcMyReply = pcCOMMAND_BUFFER;
+						if( uxPort == 0u )
+						{
+							pcMyReply = REPL_502;
+						}
+						else
+						{
+							/* The client uses the address of the command connection. */
+							snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), REPL_229_D, ( unsigned ) uxPort );
+							pcMyReply = pcCOMMAND_BUFFER;
+						}
 					}
 
 					break;
 
+				case ECMD_EPRT: /* Extended active connection to the client (RFC 2428). */
+				   {
+					   uint32_t ulIPAddress = 0;
+					   UBaseType_t uxPort;
+
+					   uxPort = prvParseExtendedPortData( pcRestCommand, &ulIPAddress );
+
+					   if( uxPort == 0u )
+					   {
+						   /* A syntax error, or not IPv4. */
+						   pcMyReply = REPL_501;
+					   }
+					   else if( prvTransferConnect( pxClient, pdFALSE ) == pdFALSE )
+					   {
+						   pcMyReply = REPL_501;
+					   }
+					   else
+					   {
+						   pxClient->usClientPort = ( uint16_t ) uxPort;
+						   pxClient->ulClientIP = ulIPAddress;
+						   pcMyReply = REPL_200;
+					   }
+				   }
+				   break;
+
 				case ECMD_PORT: /* Active connection to the client. */
 
 					/* The client uses this command to tell the server to what
@@ -683,6 +1485,13 @@
 					{
 						pcMyReply = REPL_553_READ_ONLY;
 					}
+
+					#if ( ipconfigFTP_STORE_CRC != 0 )
+						else if( prvIsCrcIndex( pcRestCommand ) != pdFALSE )
+						{
+							pcMyReply = REPL_553;
+						}
+					#endif
 					else
 					{
 						prvRenameFrom( pxClient, pcRestCommand );
@@ -696,6 +1505,14 @@
 					{
 						pcMyReply = REPL_503; /* "503 Bad sequence of commands. */
 					}
+
+					#if ( ipconfigFTP_STORE_CRC != 0 )
+						else if( prvIsCrcIndex( pcRestCommand ) != pdFALSE )
+						{
+							/* The index is maintained by the server only. */
+							pcMyReply = REPL_553;
+						}
+					#endif
 					else
 					{
 						prvRenameTo( pxClient, pcRestCommand );
@@ -705,11 +1522,15 @@
 
 				case ECMD_SITE: /* Set file permissions */
 
-					if( pxClient->bits.bReadOnly != pdFALSE_UNSIGNED )
+					if( prvSiteCmd( pxClient, pcRestCommand ) != pdFALSE )
+					{
+						/* The command has been handled and answered. */
+					}
+					else if( pxClient->bits.bReadOnly != pdFALSE_UNSIGNED )
 					{
 						pcMyReply = REPL_553_READ_ONLY;
 					}
-					else if( prvSiteCmd( pxClient, pcRestCommand ) == pdFALSE )
+					else
 					{
 						pcMyReply = REPL_202;
 					}
@@ -722,6 +1543,13 @@
 					{
 						pcMyReply = REPL_553_READ_ONLY;
 					}
+
+					#if ( ipconfigFTP_STORE_CRC != 0 )
+						else if( prvIsCrcIndex( pcRestCommand ) != pdFALSE )
+						{
+							pcMyReply = REPL_553;
+						}
+					#endif
 					else
 					{
 						prvDeleteFile( pxClient, pcRestCommand );
@@ -733,6 +1561,10 @@
 					prvSizeDateFile( pxClient, pcRestCommand, pdTRUE );
 					break;
 
+				case ECMD_MLST:
+					prvListSingleFile( pxClient, pcRestCommand );
+					break;
+
 				case ECMD_SIZE:
 
 					if( pxClient->pxWriteHandle != NULL )
@@ -796,6 +1628,7 @@
 					break;
 
 				case ECMD_LIST:
+				case ECMD_MLSD:
 				case ECMD_RETR:
 				case ECMD_STOR:
 
@@ -825,7 +1658,13 @@
 						switch( pxFTPCommand->ucCommandType )
 						{
 							case ECMD_LIST:
-								prvListSendPrep( pxClient );
+								pxClient->bits1.bMachineList = pdFALSE_UNSIGNED;
+								prvListSendPrep( pxClient, NULL );
+								break;
+
+							case ECMD_MLSD:
+								pxClient->bits1.bMachineList = pdTRUE_UNSIGNED;
+								prvListSendPrep( pxClient, pcRestCommand );
 								break;
 
 							case ECMD_RETR:
@@ -838,6 +1677,13 @@
 								{
 									pcMyReply = REPL_553_READ_ONLY;
 								}
+
+								#if ( ipconfigFTP_STORE_CRC != 0 )
+									else if( prvIsCrcIndex( pcRestCommand ) != pdFALSE )
+									{
+										pcMyReply = REPL_553;
+									}
+								#endif
 								else
 								{
 									prvStoreFilePrep( pxClient, pcRestCommand );
@@ -857,6 +1703,29 @@
 						}
 					}
 
+					#if ( ipconfigFTP_STORE_CRC != 0 )
+						if( ( pxFTPCommand->ucCommandType == ECMD_STOR ) && !ftpIS_STORING( pxClient ) )
+						{
+							/* This STOR consumed the announced CRC, even when it
+							 * failed, or when it was checked already. */
+							pxClient->bits.bExpectCrc = pdFALSE_UNSIGNED;
+						}
+					#endif
+
+					break;
+
+				case ECMD_STAT:
+
+					if( pcRestCommand[ 0 ] != '\0' )
+					{
+						/* STAT with a path is not supported. */
+						pcMyReply = REPL_504;
+					}
+					else
+					{
+						prvSendStatus( pxClient );
+					}
+
 					break;
 
 				case ECMD_FEAT:
@@ -869,6 +1738,19 @@
 						   #if ( ffconfigTIME_SUPPORT != 0 )
 							   " MDTM\x0a"
 						   #endif
+						   #if ( ffconfigTIME_SUPPORT != 0 )
+							   " MLST type*;size*;modify*;perm*;\x0a"
+						   #else
+							   " MLST type*;size*;perm*;\x0a"
+						   #endif
+						   " EPRT\x0a"
+						   " EPSV\x0a"
+						   #if ( ipconfigFTP_HAS_HASH != 0 )
+							   " HASH CRC32;MD5;SHA-256*\x0a"
+						   #endif
+						   #if ( ipconfigFTP_HAS_MODE_Z != 0 )
+							   " MODE Z\x0a"
+						   #endif
 						   " REST STREAM\x0a"
 						   " SIZE\x0d\x0a"
 						   "211 End\x0d\x0a";
@@ -900,8 +1782,9 @@
 	static BaseType_t prvTransferConnect( FTPClient_t * pxClient,
 										  BaseType_t xDoListen )
 	{
-		Socket_t xSocket;
+		Socket_t xSocket = FREERTOS_NO_SOCKET;
 		BaseType_t xResult;
+		BaseType_t xIsListening = pdFALSE;
 
 		/* Open a socket for a data connection with the FTP client.
 		 * Happens after a PORT or a PASV command. */
@@ -911,18 +1794,86 @@
 
 		pxClient->bits1.bEmptyFile = pdFALSE_UNSIGNED;
 
-		xSocket = FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP );
+		#if ( ipconfigFTP_PASV_POOL_SIZE > 0 )
+			{
+				if( xDoListen != pdFALSE )
+				{
+					xSocket = prvPassivePoolTake();
+					xIsListening = ( xSocket != FREERTOS_NO_SOCKET );
+				}
+			}
+		#endif
 
-		if( ( xSocket != FREERTOS_NO_SOCKET ) && ( xSocket != FREERTOS_INVALID_SOCKET ) )
+		if( xSocket == FREERTOS_NO_SOCKET )
 		{
-			BaseType_t xSmallTimeout = pdMS_TO_TICKS( 100 );
-			struct freertos_sockaddr xAddress;
-
-			#if ( ipconfigFTP_TX_BUFSIZE > 0 )
-				WinProperties_t xWinProps;
-			#endif
-			xAddress.sin_addr = FreeRTOS_GetIPAddress(); /* Single NIC, currently not used */
-			xAddress.sin_port = FreeRTOS_htons( 0 );     /* Bind to any available port number */
+			xSocket = prvTransferSocketCreate( xDoListen );
+		}
+
+		if( xSocket != FREERTOS_NO_SOCKET )
+		{
+			pxClient->bits1.bIsListen = xDoListen;
+			pxClient->xTransferSocket = xSocket;
+
+			#if ( ipconfigSELECT_USES_READY_LIST == 1 )
+				{
+					/* Events on the data socket will also lead to this client. */
+					FreeRTOS_FD_SetContext( xSocket, ( void * ) pxClient );
+				}
+			#endif
+
+			if( xDoListen != pdFALSE )
+			{
+				FreeRTOS_FD_SET( xSocket, pxClient->pxParent->xSocketSet, eSELECT_EXCEPT | eSELECT_READ );
+
+				if( xIsListening != pdFALSE )
+				{
+					/* A socket from the pool is listening already. */
+					xResult = pdTRUE;
+				}
+				else
+				{
+					/* Calling FreeRTOS_listen( ) */
+					xResult = prvTransferStart( pxClient );
+
+					if( xResult >= 0 )
+					{
+						xResult = pdTRUE;
+					}
+				}
+			}
+			else
+			{
+				FreeRTOS_FD_SET( xSocket, pxClient->pxParent->xSocketSet, eSELECT_EXCEPT | eSELECT_READ | eSELECT_WRITE );
+				xResult = pdTRUE;
+			}
+		}
+		else
+		{
+			FreeRTOS_printf( ( "FreeRTOS_socket() failed\n" ) );
+			xResult = -pdFREERTOS_ERRNO_ENOMEM;
+		}
+
+		/* An active socket (PORT) should connect() later. */
+		return xResult;
+	}
+/*-----------------------------------------------------------*/
+
+	static Socket_t prvTransferSocketCreate( BaseType_t xDoListen )
+	{
+		Socket_t xSocket;
+
+		xSocket = FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP );
+
+		if( ( xSocket != FREERTOS_NO_SOCKET ) && ( xSocket != FREERTOS_INVALID_SOCKET ) )
+		{
+			BaseType_t xSmallTimeout = pdMS_TO_TICKS( 100 );
+			struct freertos_sockaddr xAddress;
+
+			#if ( ipconfigFTP_TX_BUFSIZE > 0 )
+				WinProperties_t xWinProps;
+			#endif
+			xAddress.sin_addr = FreeRTOS_GetIPAddress(); /* Single NIC, currently not used */
+			xAddress.sin_port = FreeRTOS_htons( 0 );     /* Bind to any available port number */
 
 			FreeRTOS_bind( xSocket, &xAddress, sizeof( xAddress ) );
 
@@ -950,38 +1901,126 @@
 				BaseType_t xTrueValue = pdTRUE;
 				FreeRTOS_setsockopt( xSocket, 0, FREERTOS_SO_REUSE_LISTEN_SOCKET, ( void * ) &xTrueValue, sizeof( xTrueValue ) );
 			}
+		}
+		else
+		{
+			xSocket = FREERTOS_NO_SOCKET;
+		}
 
-			pxClient->bits1.bIsListen = xDoListen;
-			pxClient->xTransferSocket = xSocket;
+		return xSocket;
+	}
+/*-----------------------------------------------------------*/
 
-			if( xDoListen != pdFALSE )
+	static UBaseType_t prvTransferPassive( FTPClient_t * pxClient,
+										   uint32_t * pulIPAddress )
+	{
+		UBaseType_t uxPort = 0u;
+
+		/* Start up a new data connection with 'xDoListen' set to true. */
+		if( prvTransferConnect( pxClient, pdTRUE ) != pdFALSE )
+		{
+			struct freertos_sockaddr xLocalAddress;
+			struct freertos_sockaddr xRemoteAddress;
+
+			FreeRTOS_GetLocalAddress( pxClient->xTransferSocket, &xLocalAddress );
+			FreeRTOS_GetRemoteAddress( pxClient->xSocket, &xRemoteAddress );
+
+			*pulIPAddress = FreeRTOS_ntohl( xLocalAddress.sin_addr );
+			pxClient->ulClientIP = FreeRTOS_ntohl( xRemoteAddress.sin_addr );
+			uxPort = FreeRTOS_ntohs( xLocalAddress.sin_port );
+
+			pxClient->usClientPort = FreeRTOS_ntohs( xRemoteAddress.sin_port );
+		}
+
+		return uxPort;
+	}
+/*-----------------------------------------------------------*/
+
+	#if ( ipconfigFTP_PASV_POOL_SIZE > 0 )
+
+		static Socket_t prvPassivePoolTake( void )
+		{
+			Socket_t xSocket;
+
+			for( ; ; )
 			{
-				FreeRTOS_FD_SET( xSocket, pxClient->pxParent->xSocketSet, eSELECT_EXCEPT | eSELECT_READ );
-				/* Calling FreeRTOS_listen( ) */
-				xResult = prvTransferStart( pxClient );
+				xSocket = FREERTOS_NO_SOCKET;
 
-				if( xResult >= 0 )
+				vTaskSuspendAll();
 				{
-					xResult = pdTRUE;
+					if( xPassivePoolCount > 0 )
+					{
+						xPassivePoolCount--;
+						xSocket = xPassivePool[ xPassivePoolCount ];
+					}
+				}
+				( void ) xTaskResumeAll();
+
+				if( xSocket == FREERTOS_NO_SOCKET )
+				{
+					break;
 				}
+
+				if( FreeRTOS_connstatus( xSocket ) == ( BaseType_t ) eTCP_LISTEN )
+				{
+					break;
+				}
+
+				/* Somebody has connected to the socket while it was in the pool. */
+				FreeRTOS_closesocket( xSocket );
 			}
-			else
+
+			return xSocket;
+		}
+/*-----------------------------------------------------------*/
+
+		static BaseType_t prvPassivePoolGive( Socket_t xSocket )
+		{
+			BaseType_t xResult = pdFALSE;
+
+			if( FreeRTOS_connstatus( xSocket ) == ( BaseType_t ) eTCP_LISTEN )
 			{
-				FreeRTOS_FD_SET( xSocket, pxClient->pxParent->xSocketSet, eSELECT_EXCEPT | eSELECT_READ | eSELECT_WRITE );
-				xResult = pdTRUE;
+				vTaskSuspendAll();
+				{
+					if( xPassivePoolCount < ipconfigFTP_PASV_POOL_SIZE )
+					{
+						xPassivePool[ xPassivePoolCount ] = xSocket;
+						xPassivePoolCount++;
+						xResult = pdTRUE;
+					}
+				}
+				( void ) xTaskResumeAll();
 			}
+
+			return xResult;
 		}
-		else
+/*-----------------------------------------------------------*/
+
+		static void prvPassivePoolFill( void )
 		{
-			FreeRTOS_printf( ( "FreeRTOS_socket() failed\n" ) );
-			xResult = -pdFREERTOS_ERRNO_ENOMEM;
-		}
+			Socket_t xSocket;
 
-		/* An active socket (PORT) should connect() later. */
-		return xResult;
-	}
+			while( xPassivePoolCount < ipconfigFTP_PASV_POOL_SIZE )
+			{
+				xSocket = prvTransferSocketCreate( pdTRUE );
+
+				if( xSocket == FREERTOS_NO_SOCKET )
+				{
+					break;
+				}
+
+				if( ( FreeRTOS_listen( xSocket, 1 ) != 0 ) || ( prvPassivePoolGive( xSocket ) == pdFALSE ) )
+				{
+					/* Another task has filled the pool in the mean time. */
+					FreeRTOS_closesocket( xSocket );
+					break;
+				}
+			}
+		}
 /*-----------------------------------------------------------*/
 
+	#endif /* ipconfigFTP_PASV_POOL_SIZE > 0 */
+
 	static BaseType_t prvTransferStart( FTPClient_t * pxClient )
 	{
 		BaseType_t xResult;
@@ -1097,7 +2136,8 @@
 			/* DEBUGGING ONLY */
 			BaseType_t xRxSize = FreeRTOS_rx_size( pxClient->xTransferSocket );
 
-			if( xRxSize > 0 )
+			/* After ABOR, the data that are still in the RX stream are dropped. */
+			if( ( xRxSize > 0 ) && ( pxClient->bits1.bAborted == pdFALSE_UNSIGNED ) )
 			{
 				BaseType_t xRxSize2;
 				BaseType_t xStatus;
@@ -1119,16 +2159,52 @@
 			}
 		}
 
-		if( ( pxClient->pxWriteHandle != NULL ) || ( pxClient->pxReadHandle != NULL ) )
+		if( ftpIS_STORING( pxClient ) || ftpIS_RETRIEVING( pxClient ) )
 		{
 			BaseType_t xLength;
-			char pcStrBuf[ 32 ];
+
+			#if ( ipconfigFTP_HAS_MODE_Z != 0 )
+				if( ( pxClient->pxInflate != NULL ) && ( xFTPInflateRun( pxClient->pxInflate ) != ftpZ_DONE ) )
+				{
+					/* The connection was closed before the end of the compressed stream. */
+					pxClient->bits1.bHadError = pdTRUE_UNSIGNED;
+				}
+			#endif
+
+			#if ( ipconfigFTP_STORE_CRC != 0 )
+				if( ftpIS_STORING( pxClient ) )
+				{
+					/* Files as well as memory sinks: a mismatch makes it fail. */
+					prvStoreCrcCheck( pxClient );
+				}
+			#endif
+
+			#if ( ipconfigFTP_HAS_HASH != 0 ) && ( ipconfigFTP_HASH_ON_STORE != 0 )
+				if( pxClient->pxWriteHandle != NULL )
+				{
+					prvHashStoreEnd( pxClient );
+				}
+			#endif
 
 			if( pxClient->bits1.bHadError == pdFALSE_UNSIGNED )
 			{
 				xLength = snprintf( pxClient->pcClientAck, sizeof( pxClient->pcClientAck ),
 									"226 Closing connection %d bytes transmitted\r\n", ( int ) pxClient->ulRecvBytes );
 			}
+			else if( pxClient->bits1.bAborted != pdFALSE_UNSIGNED )
+			{
+				xLength = snprintf( pxClient->pcClientAck, sizeof( pxClient->pcClientAck ),
+									"426 Transfer aborted after %d bytes\r\n", ( int ) pxClient->ulRecvBytes );
+			}
+
+			#if ( ipconfigFTP_STORE_CRC != 0 )
+				else if( pxClient->bits1.bCrcMismatch != pdFALSE_UNSIGNED )
+				{
+					xLength = snprintf( pxClient->pcClientAck, sizeof( pxClient->pcClientAck ),
+										"451 CRC32 %08lX does not match %08lX, file removed\r\n",
+										( unsigned long ) pxClient->ulStoreCrc, ( unsigned long ) pxClient->ulExpectCrc );
+				}
+			#endif
 			else
 			{
 				xLength = snprintf( pxClient->pcClientAck, sizeof( pxClient->pcClientAck ),
@@ -1138,26 +2214,53 @@
 			/* Tell on the command socket the data connection is now closed. */
 			prvSendReply( pxClient->xSocket, pxClient->pcClientAck, xLength );
 
-			#if ( ipconfigHAS_PRINTF != 0 )
+			#if ( ipconfigFTP_MEMORY_SINK_COUNT > 0 )
+				if( pxClient->pxSink != NULL )
+				{
+					prvStoreMemoryDone( pxClient, ( pxClient->bits1.bHadError == pdFALSE_UNSIGNED ) ? pdTRUE : pdFALSE );
+				}
+			#endif
+
+			#if ( ipconfigFTP_HAS_STATS != 0 )
+				{
+					/* Also logs a summary of the transfer. */
+					prvStatsTransferEnd( pxClient );
+				}
+			#elif ( ipconfigHAS_PRINTF != 0 )
 				{
 					TickType_t xDelta;
 					uint32_t ulAverage;
+					char pcStrBuf[ 32 ];
+
 					xDelta = xTaskGetTickCount() - pxClient->xStartTime;
 					ulAverage = ulGetAverage( pxClient->ulRecvBytes, xDelta );
 
 					FreeRTOS_printf( ( "FTP: %s: '%s' %lu Bytes (%s/sec)\n",
-									   pxClient->pxReadHandle ? "sent" : "recv",
+									   ftpIS_RETRIEVING( pxClient ) ? "sent" : "recv",
 									   pxClient->pcFileName,
 									   pxClient->ulRecvBytes,
 									   pcMkSize( ulAverage, pcStrBuf, sizeof( pcStrBuf ) ) ) );
 				}
-			#endif /* if ( ipconfigHAS_PRINTF != 0 ) */
+			#endif /* if ( ipconfigFTP_HAS_STATS != 0 ) */
 		}
 
 		if( pxClient->xTransferSocket != FREERTOS_NO_SOCKET )
 		{
 			FreeRTOS_FD_CLR( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_ALL );
-			FreeRTOS_closesocket( pxClient->xTransferSocket );
+
+			#if ( ipconfigFTP_PASV_POOL_SIZE > 0 )
+				if( ( pxClient->bits1.bIsListen != pdFALSE_UNSIGNED ) &&
+					( pxClient->bits1.bClientConnected == pdFALSE_UNSIGNED ) &&
+					( prvPassivePoolGive( pxClient->xTransferSocket ) != pdFALSE ) )
+				{
+					/* The client never connected, the socket can be used again. */
+				}
+				else
+			#endif
+			{
+				FreeRTOS_closesocket( pxClient->xTransferSocket );
+			}
+
 			pxClient->xTransferSocket = FREERTOS_NO_SOCKET;
 
 			if( pxClient->ulRecvBytes == 0ul )
@@ -1171,24 +2274,54 @@
 			}
 		}
 
+		if( pxClient->bits1.bDirHasEntry != pdFALSE_UNSIGNED )
+		{
+			/* A listing got interrupted. */
+			prvTransferCloseDir( pxClient );
+		}
+
 		pxClient->bits1.bIsListen = pdFALSE_UNSIGNED;
 		pxClient->bits1.bDirHasEntry = pdFALSE_UNSIGNED;
 		pxClient->bits1.bClientConnected = pdFALSE_UNSIGNED;
 		pxClient->bits1.bHadError = pdFALSE_UNSIGNED;
+		pxClient->bits1.bAborted = pdFALSE_UNSIGNED;
 	}
 /*-----------------------------------------------------------*/
 
 	static void prvTransferCloseFile( FTPClient_t * pxClient )
 	{
+		#if ( ipconfigFTP_HAS_STATS != 0 )
+			{
+				/* In case the data connection was not closed normally. */
+				prvStatsTransferEnd( pxClient );
+			}
+		#endif
+
 		if( pxClient->pxWriteHandle != NULL )
 		{
 			ff_fclose( pxClient->pxWriteHandle );
 			pxClient->pxWriteHandle = NULL;
+			#if ( ipconfigFTP_HAS_HASH != 0 ) && ( ipconfigFTP_HASH_ON_STORE != 0 )
+				{
+					prvHashStoreClosed( pxClient );
+				}
+			#endif
+			#if ( ipconfigFTP_STORE_CRC != 0 )
+				{
+					prvStoreCrcClosed( pxClient );
+				}
+			#endif
 			#if ( ipconfigFTP_HAS_RECEIVED_HOOK != 0 )
 				{
 					vApplicationFTPReceivedHook( pxClient->pcFileName, pxClient->ulRecvBytes, pxClient );
 				}
 			#endif
+			#if ( ipconfigUSE_HTTP != 0 ) && ( ipconfigHTTP_CACHE_COUNT > 0 )
+				{
+					/* The HTTP server may have a copy of the old contents. */
+					FreeRTOS_HTTPCacheChanged();
+				}
+			#endif
 		}
 
 		if( pxClient->pxReadHandle != NULL )
@@ -1197,6 +2330,35 @@
 			pxClient->pxReadHandle = NULL;
 		}
 
+		#if ( ipconfigFTP_MEMORY_SOURCE_COUNT > 0 )
+			if( pxClient->pxSource != NULL )
+			{
+				vTaskSuspendAll();
+				{
+					pxClient->pxSource->xReaders--;
+				}
+				( void ) xTaskResumeAll();
+				pxClient->pxSource = NULL;
+			}
+		#endif
+
+		#if ( ipconfigFTP_MEMORY_SINK_COUNT > 0 )
+			if( pxClient->pxSink != NULL )
+			{
+				/* The upload did not end normally. */
+				prvStoreMemoryDone( pxClient, pdFALSE );
+			}
+		#endif
+
+		#if ( ipconfigFTP_HAS_MODE_Z != 0 )
+			{
+				vFTPDeflateDelete( pxClient->pxDeflate );
+				pxClient->pxDeflate = NULL;
+				vFTPInflateDelete( pxClient->pxInflate );
+				pxClient->pxInflate = NULL;
+			}
+		#endif
+
 		/* These two field are only used for logging / file-statistics */
 		pxClient->ulRecvBytes = 0ul;
 		pxClient->xStartTime = 0ul;
@@ -1366,6 +2528,33 @@
 	}
 /*-----------------------------------------------------------*/
 
+	static UBaseType_t prvParseExtendedPortData( const char * pcCommand,
+												 uint32_t * pulIPAddress )
+	{
+		unsigned uxProtocol, h1, h2, h3, h4, uxPort;
+		char d1, d2, d3, d4;
+		UBaseType_t uxResult = 0u;
+
+		/* Expect EPRT |1|h1.h2.h3.h4|port| where '|' may be any delimiter. */
+		if( ( sscanf( pcCommand, "%c%u%c%u.%u.%u.%u%c%u%c",
+					  &d1, &uxProtocol, &d2, &h1, &h2, &h3, &h4, &d3, &uxPort, &d4 ) == 10 ) &&
+			( d1 == d2 ) && ( d1 == d3 ) && ( d1 == d4 ) &&
+			( uxProtocol == 1u ) &&
+			( ( h1 | h2 | h3 | h4 ) <= 0xFFu ) &&
+			( uxPort <= 0xFFFFu ) )
+		{
+			*pulIPAddress =
+				( ( uint32_t ) h1 << 24 ) |
+				( ( uint32_t ) h2 << 16 ) |
+				( ( uint32_t ) h3 << 8 ) |
+				( ( uint32_t ) h4 );
+			uxResult = ( UBaseType_t ) uxPort;
+		}
+
+		return uxResult;
+	}
+/*-----------------------------------------------------------*/
+
 /*
  *
  ####                                  #######   #   ###
@@ -1393,6 +2582,18 @@
 
 		xMakeAbsolute( pxClient, pxClient->pcFileName, sizeof( pxClient->pcFileName ), pcFileName );
 
+		#if ( ipconfigFTP_MEMORY_SINK_COUNT > 0 )
+			{
+				xResult = prvStoreMemoryPrep( pxClient );
+
+				if( xResult >= 0 )
+				{
+					/* The file is one of the memory sinks. */
+					return xResult;
+				}
+			}
+		#endif
+
 		pxNewHandle = NULL;
 
 		if( pxClient->ulRestartOffset != 0 )
@@ -1441,6 +2642,21 @@
 			pxNewHandle = ff_fopen( pxClient->pcFileName, "wb" );
 		}
 
+		#if ( ipconfigFTP_HAS_MODE_Z != 0 )
+			if( ( pxNewHandle != NULL ) && ( pxClient->bits.bModeZ != pdFALSE_UNSIGNED ) )
+			{
+				/* MODE Z: the data will be decompressed before they are written. */
+				pxClient->pxInflate = pxFTPInflateCreate();
+
+				if( pxClient->pxInflate == NULL )
+				{
+					ff_fclose( pxNewHandle );
+					pxNewHandle = NULL;
+					stdioSET_ERRNO( pdFREERTOS_ERRNO_ENOMEM );
+				}
+			}
+		#endif
+
 		if( pxNewHandle == NULL )
 		{
 			iErrorNo = stdioGET_ERRNO();
@@ -1463,24 +2679,33 @@
 		}
 		else
 		{
-			if( pxClient->bits1.bIsListen )
-			{
-				/* True if PASV is used. */
-				snprintf( pxClient->pcConnectionAck, sizeof( pxClient->pcConnectionAck ),
-						  "150 Accepted data connection from %%xip:%%u\r\n" );
-				prvTransferCheck( pxClient );
-			}
-			else
-			{
-				BaseType_t xLength;
+			prvStoreFileConnect( pxClient );
 
-				xLength = snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), "150 Opening BIN connection to store file\r\n" );
-				prvSendReply( pxClient->xSocket, pcCOMMAND_BUFFER, xLength );
-				pxClient->pcConnectionAck[ 0 ] = '\0';
-				prvTransferStart( pxClient ); /* Now active connect. */
+			pxClient->pxWriteHandle = pxNewHandle;
+
+			#if ( ipconfigFTP_HAS_HASH != 0 ) && ( ipconfigFTP_HASH_ON_STORE != 0 )
+				{
+					prvHashStoreStart( pxClient );
+				}
+			#endif
+
+			#if ( ipconfigFTP_STORE_CRC != 0 )
+				{
+					prvStoreCrcStart( pxClient, ( pxNewHandle->ulFilePointer == 0ul ) ? pdTRUE : pdFALSE );
+				}
+			#endif
+
+			/* The clusters up to the current size of the file already exist. */
+			pxClient->ulAllocated = pxNewHandle->ulFilePointer;
+
+			if( ( pxClient->ulAllocSize != 0ul ) && ( pxClient->ulAllocSize <= 0xFFFFFFFFul - pxNewHandle->ulFilePointer ) )
+			{
+				/* The size was announced with ALLO: reserve all clusters at once.
+				 * After REST, it is counted from the restart position. */
+				prvStoreFileReserve( pxClient, pxNewHandle->ulFilePointer + pxClient->ulAllocSize );
 			}
 
-			pxClient->pxWriteHandle = pxNewHandle;
+			pxClient->ulAllocSize = 0ul;
 
 			/* To get some statistics about the performance. */
 			pxClient->xStartTime = xTaskGetTickCount();
@@ -1492,17 +2717,63 @@
 	}
 /*-----------------------------------------------------------*/
 
-	#if ( ipconfigFTP_ZERO_COPY_ALIGNED_WRITES == 0 )
-
-		static BaseType_t prvStoreFileWork( FTPClient_t * pxClient )
-		{
-			BaseType_t xRc, xWritten;
-
-			/* Read from the data socket until all has been read or until a negative value
-			 * is returned. */
-			for( ; ; )
+	static void prvStoreFileConnect( FTPClient_t * pxClient )
+	{
+		#if ( ipconfigFTP_HAS_STATS != 0 )
 			{
-				char * pcBuffer;
+				prvStatsTransferStart( pxClient, pdFALSE );
+			}
+		#endif
+
+		if( pxClient->bits1.bIsListen )
+		{
+			/* True if PASV is used. */
+			snprintf( pxClient->pcConnectionAck, sizeof( pxClient->pcConnectionAck ),
+					  "150 Accepted data connection from %%xip:%%u\r\n" );
+			prvTransferCheck( pxClient );
+		}
+		else
+		{
+			BaseType_t xLength;
+
+			xLength = snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), "150 Opening BIN connection to store file\r\n" );
+			prvSendReply( pxClient->xSocket, pcCOMMAND_BUFFER, xLength );
+			pxClient->pcConnectionAck[ 0 ] = '\0';
+			prvTransferStart( pxClient ); /* Now active connect. */
+		}
+	}
+/*-----------------------------------------------------------*/
+
+	#if ( ipconfigFTP_ZERO_COPY_ALIGNED_WRITES == 0 )
+
+		static BaseType_t prvStoreFileWork( FTPClient_t * pxClient )
+		{
+			BaseType_t xRc, xWritten;
+
+			#if ( ipconfigFTP_HAS_MODE_Z != 0 )
+				{
+					/* Also when storing to a memory sink. */
+					if( pxClient->pxInflate != NULL )
+					{
+						return prvStoreFileCompressed( pxClient );
+					}
+				}
+			#endif
+
+			#if ( ipconfigFTP_MEMORY_SINK_COUNT > 0 )
+				{
+					if( pxClient->pxSink != NULL )
+					{
+						return prvStoreMemoryWork( pxClient );
+					}
+				}
+			#endif
+
+			/* Read from the data socket until all has been read or until a negative value
+			 * is returned. */
+			for( ; ; )
+			{
+				char * pcBuffer;
 
 				/* The "zero-copy" method: */
 				xRc = FreeRTOS_recv( pxClient->xTransferSocket, ( void * ) &pcBuffer,
@@ -1513,9 +2784,37 @@
 					break;
 				}
 
+				/* Data beyond the share of this client stay in the RX stream,
+				 * they will be read in a next cycle. */
+				xRc = ( BaseType_t ) FreeRTOS_min_uint32( ( uint32_t ) xRc, uxTCPServerBudget( ( TCPClient_t * ) pxClient ) );
+
+				if( xRc == 0 )
+				{
+					break;
+				}
+
 				pxClient->ulRecvBytes += xRc;
-				xWritten = ff_fwrite( pcBuffer, 1, xRc, pxClient->pxWriteHandle );
+
+				#if ( ipconfigFTP_STOR_ALLOCATE_SIZE > 0 )
+					{
+						if( pxClient->pxWriteHandle->ulFilePointer + ( uint32_t ) xRc > pxClient->ulAllocated )
+						{
+							/* Reserve a chunk ahead of the data. */
+							prvStoreFileReserve( pxClient, pxClient->pxWriteHandle->ulFilePointer + ( uint32_t ) xRc + ipconfigFTP_STOR_ALLOCATE_SIZE );
+						}
+					}
+				#endif
+
+				xWritten = ( BaseType_t ) prvFileWrite( pxClient, pcBuffer, ( size_t ) xRc );
+
+				#if ( ftpSTORE_CHECKSUM != 0 )
+					if( xWritten == xRc )
+					{
+						prvStoreFileChecksum( pxClient, pcBuffer, ( size_t ) xRc );
+					}
+				#endif
 				FreeRTOS_recv( pxClient->xTransferSocket, ( void * ) NULL, xRc, 0 );
+				vTCPServerBudgetUse( ( TCPClient_t * ) pxClient, ( size_t ) xRc );
 
 				if( xWritten != xRc )
 				{
@@ -1542,12 +2841,40 @@
 		{
 			BaseType_t xRc, xWritten;
 
+			#if ( ipconfigFTP_HAS_MODE_Z != 0 )
+				{
+					/* Also when storing to a memory sink. */
+					if( pxClient->pxInflate != NULL )
+					{
+						return prvStoreFileCompressed( pxClient );
+					}
+				}
+			#endif
+
+			#if ( ipconfigFTP_MEMORY_SINK_COUNT > 0 )
+				{
+					if( pxClient->pxSink != NULL )
+					{
+						return prvStoreMemoryWork( pxClient );
+					}
+				}
+			#endif
+
 			/* Read from the data socket until all has been read or until a negative
 			 * value is returned. */
 			for( ; ; )
 			{
 				char * pcBuffer;
 				UBaseType_t xStatus;
+				size_t uxBudget = uxTCPServerBudget( ( TCPClient_t * ) pxClient );
+
+				if( uxBudget == 0u )
+				{
+					/* This client has used its share, the data will be read in a
+					 * next cycle. */
+					xRc = 0;
+					break;
+				}
 
 				/* The "zero-copy" method: */
 				xRc = FreeRTOS_recv( pxClient->xTransferSocket, ( void * ) &pcBuffer,
@@ -1570,6 +2897,12 @@
 				{
 					if( xRc >= ipconfigFTP_PREFERRED_WRITE_SIZE )
 					{
+						if( ( ( size_t ) xRc > uxBudget ) && ( uxBudget >= ipconfigFTP_PREFERRED_WRITE_SIZE ) )
+						{
+							/* Write no more than the share of this client. */
+							xRc = ( BaseType_t ) uxBudget;
+						}
+
 						/* More than a sector to write, round down to a multiple of
 						 * PREFERRED_WRITE_SIZE bytes. */
 						xRc = ( xRc / ipconfigFTP_PREFERRED_WRITE_SIZE ) * ipconfigFTP_PREFERRED_WRITE_SIZE;
@@ -1610,13 +2943,32 @@
 
 				pxClient->ulRecvBytes += xRc;
 
-				xWritten = ff_fwrite( pcBuffer, 1, xRc, pxClient->pxWriteHandle );
+				#if ( ipconfigFTP_STOR_ALLOCATE_SIZE > 0 )
+					{
+						if( pxClient->pxWriteHandle->ulFilePointer + ( uint32_t ) xRc > pxClient->ulAllocated )
+						{
+							/* Reserve a chunk ahead of the data. */
+							prvStoreFileReserve( pxClient, pxClient->pxWriteHandle->ulFilePointer + ( uint32_t ) xRc + ipconfigFTP_STOR_ALLOCATE_SIZE );
+						}
+					}
+				#endif
+
+				xWritten = ( BaseType_t ) prvFileWrite( pxClient, pcBuffer, ( size_t ) xRc );
+
+				#if ( ftpSTORE_CHECKSUM != 0 )
+					if( xWritten == xRc )
+					{
+						prvStoreFileChecksum( pxClient, pcBuffer, ( size_t ) xRc );
+					}
+				#endif
 
 				if( pcBuffer != pcFILE_BUFFER )
 				{
 					FreeRTOS_recv( pxClient->xTransferSocket, ( void * ) NULL, xRc, 0 );
 				}
 
+				vTCPServerBudgetUse( ( TCPClient_t * ) pxClient, ( size_t ) xRc );
+
 				if( xWritten != xRc )
 				{
 					xRc = -1;
@@ -1632,300 +2984,2371 @@
 	#endif /* ipconfigFTP_ZERO_COPY_ALIGNED_WRITES */
 /*-----------------------------------------------------------*/
 
-/*
- ######                          #                           #######   #   ###
- #    #          #              #                            #   ##   #     #
- #    #          #                                           #    #         #
- #    #  ####  ###### ### ##  ###    ####  #    #  ####      #   #  ###     #    ####
- ###### #    #   #     # #  #   #   #    # #    # #    #     #####    #     #   #    #
- #  ##  ######   #     ##   #   #   ###### #    # ######     #   #    #     #   ######
- #   #  #        #     #        #   #      #    # #          #        #     #   #
- #    # #   ##   # ##  #        #   #   ##  #  #  #   ##     #        #     #   #   ##
- ###  ##  ####     ##  ####    #####  ####    ##    ####     ####    ##### #####  ####
- */
-	static BaseType_t prvRetrieveFilePrep( FTPClient_t * pxClient,
-										   char * pcFileName )
-	{
-		BaseType_t xResult = pdTRUE;
-		size_t uxFileSize;
+	#if ( ipconfigFTP_MEMORY_SINK_COUNT > 0 )
 
-		/* Close previous handle (if any) and reset file transfer parameters */
-		prvTransferCloseFile( pxClient );
+		BaseType_t FreeRTOS_FTPAddMemorySink( const FTPMemorySink_t * pxSink )
+		{
+			BaseType_t xIndex, xFree = -1;
+			BaseType_t xResult = pdFALSE;
 
-		xMakeAbsolute( pxClient, pxClient->pcFileName, sizeof( pxClient->pcFileName ), pcFileName );
+			if( ( pxSink->pcName != NULL ) && ( ( pxSink->pucBuffer != NULL ) || ( pxSink->fWrite != NULL ) ) )
+			{
+				vTaskSuspendAll();
+				{
+					for( xIndex = 0; xIndex < ipconfigFTP_MEMORY_SINK_COUNT; xIndex++ )
+					{
+						if( xSinkSlots[ xIndex ].xSink.pcName == NULL )
+						{
+							if( xFree < 0 )
+							{
+								xFree = xIndex;
+							}
+						}
+						else if( strcasecmp( xSinkSlots[ xIndex ].xSink.pcName, pxSink->pcName ) == 0 )
+						{
+							/* The name is in use already. */
+							xFree = -1;
+							break;
+						}
+					}
 
-		pxClient->pxReadHandle = ff_fopen( pxClient->pcFileName, "rb" );
+					if( xFree >= 0 )
+					{
+						memcpy( &( xSinkSlots[ xFree ].xSink ), pxSink, sizeof( xSinkSlots[ xFree ].xSink ) );
+						xSinkSlots[ xFree ].xBusy = pdFALSE;
+						xResult = pdTRUE;
+					}
+				}
+				( void ) xTaskResumeAll();
+			}
 
-		if( pxClient->pxReadHandle == NULL )
+			return xResult;
+		}
+/*-----------------------------------------------------------*/
+
+		BaseType_t FreeRTOS_FTPRemoveMemorySink( const char * pcName )
 		{
-			int iErrno = stdioGET_ERRNO();
-			/* "Requested file action not taken". */
-			prvSendReply( pxClient->xSocket, REPL_450, 0 );
-			FreeRTOS_printf( ( "prvRetrieveFilePrep: open '%s': errno %d: %s\n",
-							   pxClient->pcFileName, iErrno, ( const char * ) strerror( iErrno ) ) );
-			uxFileSize = 0ul;
-			xResult = pdFALSE;
+			BaseType_t xIndex;
+			BaseType_t xResult = pdFALSE;
+
+			vTaskSuspendAll();
+			{
+				for( xIndex = 0; xIndex < ipconfigFTP_MEMORY_SINK_COUNT; xIndex++ )
+				{
+					if( ( xSinkSlots[ xIndex ].xSink.pcName != NULL ) &&
+						( xSinkSlots[ xIndex ].xBusy == pdFALSE ) &&
+						( strcasecmp( xSinkSlots[ xIndex ].xSink.pcName, pcName ) == 0 ) )
+					{
+						xSinkSlots[ xIndex ].xSink.pcName = NULL;
+						xResult = pdTRUE;
+						break;
+					}
+				}
+			}
+			( void ) xTaskResumeAll();
+
+			return xResult;
 		}
-		else
+/*-----------------------------------------------------------*/
+
+		static BaseType_t prvStoreMemoryPrep( FTPClient_t * pxClient )
 		{
-			uxFileSize = pxClient->pxReadHandle->ulFileSize;
-			pxClient->uxBytesLeft = uxFileSize;
+			FTPSinkSlot_t * pxSlot = NULL;
+			const char * pcName;
+			BaseType_t xIndex, xLength;
+			BaseType_t xResult = -1;
 
-			if( pxClient->ulRestartOffset != 0ul )
+			/* The path as the client sees it, e.g. "/mem/firmware.bin". */
+			xMakeRelative( pxClient, pcNEW_DIR, sizeof( pcNEW_DIR ), pxClient->pcFileName );
+			xLength = ( BaseType_t ) strlen( ipconfigFTP_MEMORY_DIRECTORY );
+
+			if( ( strncasecmp( pcNEW_DIR, ipconfigFTP_MEMORY_DIRECTORY, xLength ) == 0 ) &&
+				( pcNEW_DIR[ xLength ] == '/' ) )
 			{
-				size_t uxOffset = pxClient->ulRestartOffset;
-				int32_t iRc;
+				pcName = pcNEW_DIR + xLength + 1;
+				xResult = pdFALSE;
 
-				/* Only use 1 time. */
-				pxClient->ulRestartOffset = 0;
+				vTaskSuspendAll();
+				{
+					for( xIndex = 0; xIndex < ipconfigFTP_MEMORY_SINK_COUNT; xIndex++ )
+					{
+						if( ( xSinkSlots[ xIndex ].xSink.pcName != NULL ) &&
+							( strcasecmp( xSinkSlots[ xIndex ].xSink.pcName, pcName ) == 0 ) )
+						{
+							if( xSinkSlots[ xIndex ].xBusy == pdFALSE )
+							{
+								xSinkSlots[ xIndex ].xBusy = pdTRUE;
+								pxSlot = &( xSinkSlots[ xIndex ] );
+							}
 
-				if( uxOffset < uxFileSize )
+							break;
+						}
+					}
+				}
+				( void ) xTaskResumeAll();
+
+				if( pxSlot == NULL )
 				{
-					iRc = ff_fseek( pxClient->pxReadHandle, uxOffset, FF_SEEK_SET );
+					/* There is no such sink, or another client is storing to it. */
+					prvSendReply( pxClient->xSocket, REPL_450, 0 );
+				}
+				else if( pxClient->ulRestartOffset > pxSlot->xSink.uxSize )
+				{
+					prvSendReply( pxClient->xSocket, REPL_552, 0 );
+					pxSlot->xBusy = pdFALSE;
 				}
+				#if ( ipconfigFTP_HAS_MODE_Z != 0 )
+					else if( ( pxClient->bits.bModeZ != pdFALSE_UNSIGNED ) &&
+							 ( ( pxClient->pxInflate = pxFTPInflateCreate() ) == NULL ) )
+					{
+						/* MODE Z: the data will be decompressed into the sink. */
+						prvSendReply( pxClient->xSocket, REPL_450, 0 );
+						pxSlot->xBusy = pdFALSE;
+					}
+				#endif
 				else
 				{
-					iRc = -pdFREERTOS_ERRNO_EINVAL;
+					prvStoreFileConnect( pxClient );
+
+					pxClient->pxSink = pxSlot;
+					pxClient->ulMemoryOffset = pxClient->ulRestartOffset;
+					pxClient->xStartTime = xTaskGetTickCount();
+
+					#if ( ipconfigFTP_STORE_CRC != 0 )
+						{
+							prvStoreCrcStart( pxClient, ( pxClient->ulMemoryOffset == 0ul ) ? pdTRUE : pdFALSE );
+						}
+					#endif
+					xResult = pdTRUE;
 				}
 
-				if( iRc != 0 )
-				{
-					BaseType_t xLength;
+				pxClient->ulRestartOffset = 0ul; /* Only use 1 time. */
+			}
 
-					xLength = snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ),
-										"450 Seek invalid %u length %u\r\n", ( unsigned ) uxOffset, ( unsigned ) uxFileSize );
+			return xResult;
+		}
+/*-----------------------------------------------------------*/
 
-					/* "Requested file action not taken". */
-					prvSendReply( pxClient->xSocket, pcCOMMAND_BUFFER, xLength );
+		static BaseType_t prvStoreMemoryWork( FTPClient_t * pxClient )
+		{
+			BaseType_t xRc, xSuccess;
+			uint8_t * pucData;
 
-					FreeRTOS_printf( ( "prvRetrieveFilePrep: create %s: Seek %u length %u\n",
-									   pxClient->pcFileName, ( unsigned ) uxOffset, ( unsigned ) uxFileSize ) );
+			for( ; ; )
+			{
+				/* The data are copied only once: from the TCP buffer to their
+				 * final place. */
+				xRc = FreeRTOS_recv( pxClient->xTransferSocket, ( void * ) &pucData,
+									 0x20000u, FREERTOS_ZERO_COPY | FREERTOS_MSG_DONTWAIT );
 
-					ff_fclose( pxClient->pxReadHandle );
-					pxClient->pxReadHandle = NULL;
-					xResult = pdFALSE;
+				if( xRc <= 0 )
+				{
+					break;
 				}
-				else
+
+				xRc = ( BaseType_t ) FreeRTOS_min_uint32( ( uint32_t ) xRc, uxTCPServerBudget( ( TCPClient_t * ) pxClient ) );
+
+				if( xRc == 0 )
+				{
+					break;
+				}
+
+				xSuccess = prvStoreMemoryWrite( pxClient, pucData, ( size_t ) xRc );
+
+				FreeRTOS_recv( pxClient->xTransferSocket, ( void * ) NULL, xRc, 0 );
+				vTCPServerBudgetUse( ( TCPClient_t * ) pxClient, ( size_t ) xRc );
+
+				if( xSuccess == pdFALSE )
 				{
-					pxClient->uxBytesLeft = uxFileSize - pxClient->ulRestartOffset;
+					xRc = -1;
+					/* bHadError: a transfer got aborted because of an error. */
+					pxClient->bits1.bHadError = pdTRUE_UNSIGNED;
+					break;
 				}
+
+				pxClient->ulRecvBytes += ( uint32_t ) xRc;
 			}
+
+			return xRc;
 		}
+/*-----------------------------------------------------------*/
 
-		if( xResult != pdFALSE )
+		static BaseType_t prvStoreMemoryWrite( FTPClient_t * pxClient,
+											   const uint8_t * pucData,
+											   size_t uxLength )
 		{
-			if( pxClient->bits1.bIsListen != pdFALSE_UNSIGNED )
+			const FTPMemorySink_t * pxSink = &( pxClient->pxSink->xSink );
+			BaseType_t xSuccess;
+
+			if( uxLength > pxSink->uxSize - pxClient->ulMemoryOffset )
+			{
+				FreeRTOS_printf( ( "ftp::storeMemory: %s: more than %lu bytes\n",
+								   pxSink->pcName, ( unsigned long ) pxSink->uxSize ) );
+				xSuccess = pdFALSE;
+			}
+			else if( pxSink->pucBuffer != NULL )
 			{
-				/* True if PASV is used. */
-				snprintf( pxClient->pcConnectionAck, sizeof( pxClient->pcConnectionAck ),
-						  "150%cAccepted data connection from %%xip:%%u\r\n%s",
-						  pxClient->xTransType == TMODE_ASCII ? '-' : ' ',
-						  pxClient->xTransType == TMODE_ASCII ? "150 NOTE: ASCII mode requested, but binary mode used\r\n" : "" );
+				memcpy( pxSink->pucBuffer + pxClient->ulMemoryOffset, pucData, uxLength );
+				xSuccess = pdTRUE;
 			}
 			else
 			{
-				BaseType_t xLength;
-
-				xLength = snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), "150%cOpening data connection to %lxip:%u\r\n%s",
-									pxClient->xTransType == TMODE_ASCII ? '-' : ' ',
-									pxClient->ulClientIP,
-									pxClient->usClientPort,
-									pxClient->xTransType == TMODE_ASCII ? "150 NOTE: ASCII mode requested, but binary mode used\r\n" : "" );
-				prvSendReply( pxClient->xSocket, pcCOMMAND_BUFFER, xLength );
-				pxClient->pcConnectionAck[ 0 ] = '\0';
-				prvTransferStart( pxClient );
+				xSuccess = pxSink->fWrite( pxSink->pvContext, pxClient->ulMemoryOffset, pucData, uxLength );
 			}
 
-			/* Prepare the ACK which will be sent when all data has been sent. */
-			snprintf( pxClient->pcClientAck, sizeof( pxClient->pcClientAck ), "%s", REPL_226 );
-
-			/* To get some statistics about the performance. */
-			pxClient->xStartTime = xTaskGetTickCount();
-
-			if( uxFileSize == 0ul )
+			if( xSuccess != pdFALSE )
 			{
-				FreeRTOS_shutdown( pxClient->xTransferSocket, FREERTOS_SHUT_RDWR );
+				#if ( ftpSTORE_CHECKSUM != 0 )
+					{
+						prvStoreFileChecksum( pxClient, pucData, uxLength );
+					}
+				#endif
+				pxClient->ulMemoryOffset += ( uint32_t ) uxLength;
 			}
-		}
 
-		return xResult;
-	}
+			return xSuccess;
+		}
 /*-----------------------------------------------------------*/
 
-	static BaseType_t prvRetrieveFileWork( FTPClient_t * pxClient )
-	{
-		size_t uxSpace;
-		size_t uxCount, uxItemsRead;
-		BaseType_t xRc = 0;
-		BaseType_t xSetEvent = pdFALSE;
-
-		do
+		static void prvStoreMemoryDone( FTPClient_t * pxClient,
+										BaseType_t xSuccess )
 		{
-			#if ( ipconfigFTP_TX_ZERO_COPY != 0 )
-				char * pcBuffer;
-				BaseType_t xBufferLength;
-			#endif /* ipconfigFTP_TX_ZERO_COPY */
+			FTPSinkSlot_t * pxSlot = pxClient->pxSink;
 
-			/* Take the lesser of the two: tx_space (number of bytes that can be
-			 * queued for transmission) and uxBytesLeft (the number of bytes left to
-			 * read from the file) */
-			uxSpace = FreeRTOS_tx_space( pxClient->xTransferSocket );
+			pxClient->pxSink = NULL;
 
-			if( uxSpace == 0 )
+			if( pxSlot->xSink.fDone != NULL )
 			{
-				FreeRTOS_FD_SET( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE | eSELECT_EXCEPT );
-				xRc = FreeRTOS_select( pxClient->pxParent->xSocketSet, 200 );
-				uxSpace = FreeRTOS_tx_space( pxClient->xTransferSocket );
+				pxSlot->xSink.fDone( pxSlot->xSink.pvContext, pxClient->ulMemoryOffset, xSuccess );
 			}
 
-			uxCount = FreeRTOS_min_uint32( pxClient->uxBytesLeft, uxSpace );
-
-			if( uxCount == 0 )
-			{
-				break;
-			}
+			pxSlot->xBusy = pdFALSE;
 
-			#if ( ipconfigFTP_TX_ZERO_COPY == 0 )
+			#if ( ipconfigFTP_STORE_CRC != 0 )
+				{
+					/* A sink has no CRC index, the reply has been sent. */
+					pxClient->bits1.bCrcValid = pdFALSE_UNSIGNED;
+					pxClient->bits1.bCrcMismatch = pdFALSE_UNSIGNED;
+				}
+			#endif
+		}
+
+	#endif /* ipconfigFTP_MEMORY_SINK_COUNT > 0 */
+/*-----------------------------------------------------------*/
+
+	#if ( ipconfigFTP_HAS_MODE_Z != 0 )
+
+		static BaseType_t prvStoreFileCompressed( FTPClient_t * pxClient )
+		{
+			BaseType_t xRc;
+
+			/* Decompress as long as data are received, or as long as the
+			 * decompressor makes progress. */
+			for( ; ; )
+			{
+				char * pcBuffer;
+				const uint8_t * pucData;
+				size_t uxAccepted = 0u;
+				size_t uxLength;
+				BaseType_t xStatus;
+				BaseType_t xProgress = pdFALSE;
+
+				if( uxTCPServerBudget( ( TCPClient_t * ) pxClient ) == 0u )
+				{
+					/* This client has used its share, the data will be read in a
+					 * next cycle. */
+					xRc = 0;
+					break;
+				}
+
+				xRc = FreeRTOS_recv( pxClient->xTransferSocket, ( void * ) &pcBuffer,
+									 0x20000u, FREERTOS_ZERO_COPY | FREERTOS_MSG_DONTWAIT );
+
+				if( xRc > 0 )
+				{
+					/* The decompressor may accept less than what is available. */
+					uxAccepted = uxFTPInflateWrite( pxClient->pxInflate, ( const uint8_t * ) pcBuffer, ( size_t ) xRc );
+					FreeRTOS_recv( pxClient->xTransferSocket, ( void * ) NULL, uxAccepted, 0 );
+				}
+
+				xStatus = xFTPInflateRun( pxClient->pxInflate );
+
+				/* Write the decompressed data, which may wrap around the end of
+				 * the window of the decompressor. */
+				while( xStatus != ftpZ_ERROR )
+				{
+					BaseType_t xWritten;
+
+					uxLength = uxFTPInflateOutput( pxClient->pxInflate, &pucData );
+
+					if( uxLength == 0u )
+					{
+						break;
+					}
+
+					#if ( ipconfigFTP_MEMORY_SINK_COUNT > 0 )
+						if( pxClient->pxSink != NULL )
+						{
+							/* Checks the size of the sink and updates the checksum. */
+							xWritten = prvStoreMemoryWrite( pxClient, pucData, uxLength );
+						}
+						else
+					#endif
+					{
+						#if ( ipconfigFTP_STOR_ALLOCATE_SIZE > 0 )
+							{
+								if( pxClient->pxWriteHandle->ulFilePointer + ( uint32_t ) uxLength > pxClient->ulAllocated )
+								{
+									/* Reserve a chunk ahead of the data. */
+									prvStoreFileReserve( pxClient, pxClient->pxWriteHandle->ulFilePointer + ( uint32_t ) uxLength + ipconfigFTP_STOR_ALLOCATE_SIZE );
+								}
+							}
+						#endif
+
+						xWritten = ( prvFileWrite( pxClient, pucData, uxLength ) == uxLength ) ? pdTRUE : pdFALSE;
+
+						#if ( ftpSTORE_CHECKSUM != 0 )
+							if( xWritten != pdFALSE )
+							{
+								prvStoreFileChecksum( pxClient, pucData, uxLength );
+							}
+						#endif
+					}
+
+					if( xWritten == pdFALSE )
+					{
+						xStatus = ftpZ_ERROR;
+					}
+					else
+					{
+						vFTPInflateOutputDone( pxClient->pxInflate, uxLength );
+						pxClient->ulRecvBytes += uxLength;
+						vTCPServerBudgetUse( ( TCPClient_t * ) pxClient, uxLength );
+						xProgress = pdTRUE;
+					}
+				}
+
+				if( xStatus == ftpZ_ERROR )
+				{
+					FreeRTOS_printf( ( "prvStoreFileCompressed: '%s': bad data or disk full after %lu bytes\n",
+									   pxClient->pcFileName, pxClient->ulRecvBytes ) );
+					xRc = -1;
+					/* bHadError: a transfer got aborted because of an error. */
+					pxClient->bits1.bHadError = pdTRUE_UNSIGNED;
+					break;
+				}
+
+				if( ( uxAccepted == 0u ) && ( xProgress == pdFALSE ) )
+				{
+					break;
+				}
+			}
+
+			return xRc;
+		}
+
+	#endif /* ipconfigFTP_HAS_MODE_Z != 0 */
+/*-----------------------------------------------------------*/
+
+	static size_t prvFileRead( FTPClient_t * pxClient,
+							   void * pvBuffer,
+							   size_t uxCount )
+	{
+		size_t uxResult;
+
+		#if ( ipconfigFTP_HAS_STATS != 0 )
+			uint32_t ulStart = ipconfigFTP_STATS_CLOCK();
+		#endif
+
+		uxResult = ff_fread( pvBuffer, 1, uxCount, pxClient->pxReadHandle );
+
+		#if ( ipconfigFTP_HAS_STATS != 0 )
+			{
+				pxClient->ullDiskClocks += ( uint32_t ) ( ipconfigFTP_STATS_CLOCK() - ulStart );
+			}
+		#endif
+
+		return uxResult;
+	}
+/*-----------------------------------------------------------*/
+
+	static size_t prvFileWrite( FTPClient_t * pxClient,
+								const void * pvBuffer,
+								size_t uxCount )
+	{
+		size_t uxResult;
+
+		#if ( ipconfigFTP_HAS_STATS != 0 )
+			uint32_t ulStart = ipconfigFTP_STATS_CLOCK();
+		#endif
+
+		uxResult = ff_fwrite( pvBuffer, 1, uxCount, pxClient->pxWriteHandle );
+
+		#if ( ipconfigFTP_HAS_STATS != 0 )
+			{
+				pxClient->ullDiskClocks += ( uint32_t ) ( ipconfigFTP_STATS_CLOCK() - ulStart );
+			}
+		#endif
+
+		return uxResult;
+	}
+/*-----------------------------------------------------------*/
+
+	static void prvStoreFileReserve( FTPClient_t * pxClient,
+									 uint32_t ulSize )
+	{
+		BaseType_t xResult;
+
+		#if ( ipconfigFTP_HAS_STATS != 0 )
+			uint32_t ulStart = ipconfigFTP_STATS_CLOCK();
+		#endif
+
+		/* Extending the cluster chain in a single step makes it more likely
+		 * that the clusters are contiguous, and the FAT is updated only once. */
+		xResult = ( BaseType_t ) ff_fallocate( pxClient->pxWriteHandle, ( size_t ) ulSize );
+
+		#if ( ipconfigFTP_HAS_STATS != 0 )
+			{
+				pxClient->ullDiskClocks += ( uint32_t ) ( ipconfigFTP_STATS_CLOCK() - ulStart );
+			}
+		#endif
+
+		if( xResult == 0 )
+		{
+			pxClient->ulAllocated = ulSize;
+		}
+		else
+		{
+			/* Not fatal: ff_fwrite() will try to extend the file itself.
+			 * Do not try to reserve space again for this file. */
+			FreeRTOS_printf( ( "ftp::storeFile: reserve %lu bytes: %s\n",
+							   ulSize, ( const char * ) strerror( stdioGET_ERRNO() ) ) );
+			pxClient->ulAllocated = ~0ul;
+		}
+	}
+/*-----------------------------------------------------------*/
+
+/*
+ ######                          #                           #######   #   ###
+ #    #          #              #                            #   ##   #     #
+ #    #          #                                           #    #         #
+ #    #  ####  ###### ### ##  ###    ####  #    #  ####      #   #  ###     #    ####
+ ###### #    #   #     # #  #   #   #    # #    # #    #     #####    #     #   #    #
+ #  ##  ######   #     ##   #   #   ###### #    # ######     #   #    #     #   ######
+ #   #  #        #     #        #   #      #    # #          #        #     #   #
+ #    # #   ##   # ##  #        #   #   ##  #  #  #   ##     #        #     #   #   ##
+ ###  ##  ####     ##  ####    #####  ####    ##    ####     ####    ##### #####  ####
+ */
+	static BaseType_t prvRetrieveFilePrep( FTPClient_t * pxClient,
+										   char * pcFileName )
+	{
+		BaseType_t xResult = pdTRUE;
+		size_t uxFileSize;
+
+		/* Close previous handle (if any) and reset file transfer parameters */
+		prvTransferCloseFile( pxClient );
+
+		xMakeAbsolute( pxClient, pxClient->pcFileName, sizeof( pxClient->pcFileName ), pcFileName );
+
+		#if ( ipconfigFTP_MEMORY_SOURCE_COUNT > 0 )
+			{
+				xResult = prvRetrieveMemoryPrep( pxClient );
+
+				if( xResult >= 0 )
+				{
+					/* The file is one of the memory sources. */
+					return xResult;
+				}
+
+				xResult = pdTRUE;
+			}
+		#endif
+
+		pxClient->pxReadHandle = ff_fopen( pxClient->pcFileName, "rb" );
+
+		#if ( ipconfigFTP_HAS_MODE_Z != 0 )
+			if( ( pxClient->pxReadHandle != NULL ) && ( pxClient->bits.bModeZ != pdFALSE_UNSIGNED ) )
+			{
+				/* MODE Z: the file will be compressed while it is sent. */
+				pxClient->pxDeflate = pxFTPDeflateCreate( ipconfigFTP_DEFLATE_LEVEL );
+
+				if( pxClient->pxDeflate == NULL )
+				{
+					ff_fclose( pxClient->pxReadHandle );
+					pxClient->pxReadHandle = NULL;
+					stdioSET_ERRNO( pdFREERTOS_ERRNO_ENOMEM );
+				}
+			}
+		#endif
+
+		if( pxClient->pxReadHandle == NULL )
+		{
+			int iErrno = stdioGET_ERRNO();
+			/* "Requested file action not taken". */
+			prvSendReply( pxClient->xSocket, REPL_450, 0 );
+			FreeRTOS_printf( ( "prvRetrieveFilePrep: open '%s': errno %d: %s\n",
+							   pxClient->pcFileName, iErrno, ( const char * ) strerror( iErrno ) ) );
+			uxFileSize = 0ul;
+			xResult = pdFALSE;
+		}
+		else
+		{
+			uxFileSize = pxClient->pxReadHandle->ulFileSize;
+			pxClient->uxBytesLeft = uxFileSize;
+
+			if( pxClient->ulRestartOffset != 0ul )
+			{
+				size_t uxOffset = pxClient->ulRestartOffset;
+				int32_t iRc;
+
+				/* Only use 1 time. */
+				pxClient->ulRestartOffset = 0;
+
+				if( uxOffset < uxFileSize )
+				{
+					iRc = ff_fseek( pxClient->pxReadHandle, uxOffset, FF_SEEK_SET );
+				}
+				else
+				{
+					iRc = -pdFREERTOS_ERRNO_EINVAL;
+				}
+
+				if( iRc != 0 )
+				{
+					BaseType_t xLength;
+
+					xLength = snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ),
+										"450 Seek invalid %u length %u\r\n", ( unsigned ) uxOffset, ( unsigned ) uxFileSize );
+
+					/* "Requested file action not taken". */
+					prvSendReply( pxClient->xSocket, pcCOMMAND_BUFFER, xLength );
+
+					FreeRTOS_printf( ( "prvRetrieveFilePrep: create %s: Seek %u length %u\n",
+									   pxClient->pcFileName, ( unsigned ) uxOffset, ( unsigned ) uxFileSize ) );
+
+					ff_fclose( pxClient->pxReadHandle );
+					pxClient->pxReadHandle = NULL;
+					xResult = pdFALSE;
+				}
+				else
+				{
+					pxClient->uxBytesLeft = uxFileSize - uxOffset;
+				}
+			}
+		}
+
+		if( xResult != pdFALSE )
+		{
+			prvRetrieveFileConnect( pxClient, uxFileSize );
+		}
+
+		return xResult;
+	}
+/*-----------------------------------------------------------*/
+
+	static void prvRetrieveFileConnect( FTPClient_t * pxClient,
+										size_t uxFileSize )
+	{
+		if( pxClient->bits1.bIsListen != pdFALSE_UNSIGNED )
+		{
+			/* True if PASV is used. */
+			snprintf( pxClient->pcConnectionAck, sizeof( pxClient->pcConnectionAck ),
+					  "150%cAccepted data connection from %%xip:%%u\r\n%s",
+					  pxClient->xTransType == TMODE_ASCII ? '-' : ' ',
+					  pxClient->xTransType == TMODE_ASCII ? "150 NOTE: ASCII mode requested, but binary mode used\r\n" : "" );
+		}
+		else
+		{
+			BaseType_t xLength;
+
+			xLength = snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), "150%cOpening data connection to %lxip:%u\r\n%s",
+								pxClient->xTransType == TMODE_ASCII ? '-' : ' ',
+								pxClient->ulClientIP,
+								pxClient->usClientPort,
+								pxClient->xTransType == TMODE_ASCII ? "150 NOTE: ASCII mode requested, but binary mode used\r\n" : "" );
+			prvSendReply( pxClient->xSocket, pcCOMMAND_BUFFER, xLength );
+			pxClient->pcConnectionAck[ 0 ] = '\0';
+			prvTransferStart( pxClient );
+		}
+
+		/* Prepare the ACK which will be sent when all data has been sent. */
+		snprintf( pxClient->pcClientAck, sizeof( pxClient->pcClientAck ), "%s", REPL_226 );
+
+		/* To get some statistics about the performance. */
+		pxClient->xStartTime = xTaskGetTickCount();
+
+		#if ( ipconfigFTP_HAS_STATS != 0 )
+			{
+				prvStatsTransferStart( pxClient, pdTRUE );
+			}
+		#endif
+
+		/* In MODE Z, even an empty file results in a zlib stream. */
+		if( ( uxFileSize == 0ul ) && ( pxClient->pxDeflate == NULL ) )
+		{
+			FreeRTOS_shutdown( pxClient->xTransferSocket, FREERTOS_SHUT_RDWR );
+		}
+	}
+/*-----------------------------------------------------------*/
+
+	static BaseType_t prvRetrieveFileWork( FTPClient_t * pxClient )
+	{
+		size_t uxSpace;
+		size_t uxCount, uxItemsRead;
+		BaseType_t xRc = 0;
+		BaseType_t xSetEvent = pdFALSE;
+
+		#if ( ipconfigFTP_HAS_MODE_Z != 0 )
+			{
+				if( pxClient->pxDeflate != NULL )
+				{
+					return prvRetrieveFileCompressed( pxClient );
+				}
+			}
+		#endif
+
+		#if ( ipconfigFTP_MEMORY_SOURCE_COUNT > 0 )
+			{
+				if( pxClient->pxSource != NULL )
+				{
+					return prvRetrieveMemoryWork( pxClient );
+				}
+			}
+		#endif
+
+		do
+		{
+			#if ( ipconfigFTP_TX_ZERO_COPY != 0 )
+				char * pcBuffer;
+				BaseType_t xBufferLength;
+			#endif /* ipconfigFTP_TX_ZERO_COPY */
+
+			/* Take the lesser of the two: tx_space (number of bytes that can be
+			 * queued for transmission) and uxBytesLeft (the number of bytes left to
+			 * read from the file) */
+			uxSpace = FreeRTOS_tx_space( pxClient->xTransferSocket );
+
+			/* When the TX stream is full, or when this client has used its
+			 * share, the loop ends and eSELECT_WRITE is set below: the server
+			 * will call here again as soon as space is freed. */
+			uxCount = FreeRTOS_min_uint32( pxClient->uxBytesLeft, uxSpace );
+			uxCount = FreeRTOS_min_uint32( uxCount, uxTCPServerBudget( ( TCPClient_t * ) pxClient ) );
+
+			if( uxCount == 0 )
+			{
+				break;
+			}
+
+			#if ( ipconfigFTP_TX_ZERO_COPY == 0 )
 				{
 					if( uxCount > sizeof( pcFILE_BUFFER ) )
 					{
-						uxCount = sizeof( pcFILE_BUFFER );
+						uxCount = sizeof( pcFILE_BUFFER );
+					}
+
+					uxItemsRead = prvFileRead( pxClient, pcFILE_BUFFER, uxCount );
+
+					if( uxItemsRead != uxCount )
+					{
+						FreeRTOS_printf( ( "prvRetrieveFileWork: Got %u Expected %u\n", ( unsigned ) uxItemsRead, ( unsigned ) uxCount ) );
+						xRc = FreeRTOS_shutdown( pxClient->xTransferSocket, FREERTOS_SHUT_RDWR );
+						pxClient->uxBytesLeft = 0u;
+						break;
+					}
+
+					pxClient->uxBytesLeft -= uxCount;
+
+					if( pxClient->uxBytesLeft == 0u )
+					{
+						BaseType_t xTrueValue = 1;
+
+						FreeRTOS_setsockopt( pxClient->xTransferSocket, 0, FREERTOS_SO_CLOSE_AFTER_SEND, ( void * ) &xTrueValue, sizeof( xTrueValue ) );
+					}
+
+					xRc = FreeRTOS_send( pxClient->xTransferSocket, pcFILE_BUFFER, uxCount, 0 );
+				}
+			#else /* ipconfigFTP_TX_ZERO_COPY != 0 */
+				{
+					FF_IOManager_t * pxIOManager = pxClient->pxReadHandle->pxIOManager;
+					size_t uxSectorSize = ( size_t ) pxIOManager->usSectorSize;
+					size_t uxClusterSize = uxSectorSize * ( size_t ) pxIOManager->xPartition.ulSectorsPerCluster;
+					size_t uxMisalignment = ( size_t ) pxClient->pxReadHandle->ulFilePointer % uxSectorSize;
+					size_t uxShort;
+
+					if( uxMisalignment != 0u )
+					{
+						/* After a REST, first read up to a sector boundary, so that
+						 * all following reads can be done without a sector copy. */
+						uxCount = FreeRTOS_min_uint32( uxCount, uxSectorSize - uxMisalignment );
+					}
+
+					/* Use zero-copy transmission:
+					 * FreeRTOS_get_tx_head() returns a direct pointer to the TX stream and
+					 * sets xBufferLength to the space up to the end of the circular buffer. */
+					pcBuffer = ( char * ) FreeRTOS_get_tx_head( pxClient->xTransferSocket, &xBufferLength );
+
+					if( ( pcBuffer != NULL ) && ( ( size_t ) xBufferLength >= FreeRTOS_min_uint32( uxCount, uxSectorSize ) ) )
+					{
+						/* Will read disk data directly to the TX stream of the socket. */
+						uxCount = FreeRTOS_min_uint32( uxCount, ( uint32_t ) xBufferLength );
+						uxShort = uxCount;
+
+						if( uxCount > ( size_t ) 0x40000u )
+						{
+							uxCount = ( size_t ) 0x40000u;
+						}
+
+						if( uxCount >= uxClusterSize )
+						{
+							/* Read ahead as many whole clusters as fit. */
+							uxCount -= uxCount % uxClusterSize;
+						}
+						else if( ( uxMisalignment == 0u ) && ( uxCount < pxClient->uxBytesLeft ) )
+						{
+							/* Short of space, or close to the end of the circular buffer:
+							 * read whole sectors.  The rest will be read after the
+							 * head of the stream has wrapped around. */
+							uxCount -= uxCount % uxSectorSize;
+						}
+					}
+					else
+					{
+						/* The TX stream has not been created yet, or less than a sector
+						 * fits before the end of the circular buffer.  Use the normal file
+						 * i/o buffer, FreeRTOS_send() will wrap around. */
+						pcBuffer = pcFILE_BUFFER;
+
+						if( uxCount > sizeof( pcFILE_BUFFER ) )
+						{
+							uxCount = sizeof( pcFILE_BUFFER );
+						}
+
+						uxShort = uxCount;
+
+						if( ( uxMisalignment == 0u ) && ( uxCount < pxClient->uxBytesLeft ) )
+						{
+							uxCount -= uxCount % uxSectorSize;
+						}
+					}
+
+					if( uxCount == 0u )
+					{
+						/* Less than a sector fits in the TX stream.  The space is
+						 * still reported as eSELECT_WRITE, this must not make the
+						 * server call here over and over. */
+						#if ( ipconfigSELECT_USES_READY_LIST == 1 )
+							{
+								/* Wait until there is space for at least one sector. */
+								size_t uxLowWater = uxSectorSize;
+
+								( void ) FreeRTOS_setsockopt( pxClient->xTransferSocket, 0, FREERTOS_SO_SELECT_SNDLOWAT, ( void * ) &uxLowWater, sizeof( uxLowWater ) );
+								( void ) uxShort;
+								break;
+							}
+						#else
+							{
+								/* Send the short part with a copy, the read after it
+								 * will be aligned again. */
+								pcBuffer = pcFILE_BUFFER;
+								uxCount = uxShort;
+							}
+						#endif
+					}
+
+					uxItemsRead = prvFileRead( pxClient, pcBuffer, uxCount );
+
+					if( uxCount != uxItemsRead )
+					{
+						FreeRTOS_printf( ( "prvRetrieveFileWork: Got %u Expected %u\n", ( unsigned ) uxItemsRead, ( unsigned ) uxCount ) );
+						xRc = FreeRTOS_shutdown( pxClient->xTransferSocket, FREERTOS_SHUT_RDWR );
+						pxClient->uxBytesLeft = 0u;
+						break;
+					}
+
+					pxClient->uxBytesLeft -= uxCount;
+
+					if( pxClient->uxBytesLeft == 0u )
+					{
+						BaseType_t xTrueValue = 1;
+
+						FreeRTOS_setsockopt( pxClient->xTransferSocket, 0, FREERTOS_SO_CLOSE_AFTER_SEND, ( void * ) &xTrueValue, sizeof( xTrueValue ) );
+					}
+
+					if( pcBuffer != pcFILE_BUFFER )
+					{
+						pcBuffer = NULL;
+					}
+
+					xRc = FreeRTOS_send( pxClient->xTransferSocket, pcBuffer, uxCount, 0 );
+				}
+			#endif /* ipconfigFTP_TX_ZERO_COPY */
+
+			if( xRc < 0 )
+			{
+				break;
+			}
+
+			pxClient->ulRecvBytes += xRc;
+			vTCPServerBudgetUse( ( TCPClient_t * ) pxClient, ( size_t ) xRc );
+
+			if( pxClient->uxBytesLeft == 0u )
+			{
+				break;
+			}
+		} while( uxCount > 0u );
+
+		if( xRc < 0 )
+		{
+			FreeRTOS_printf( ( "prvRetrieveFileWork: already disconnected\n" ) );
+		}
+		else if( pxClient->uxBytesLeft <= 0u )
+		{
+			BaseType_t x;
+
+			for( x = 0; x < 5; x++ )
+			{
+				xRc = FreeRTOS_recv( pxClient->xTransferSocket, pcFILE_BUFFER, sizeof( pcFILE_BUFFER ), 0 );
+
+				if( xRc < 0 )
+				{
+					break;
+				}
+			}
+
+/*		FreeRTOS_printf( ( "prvRetrieveFileWork: %s all sent: xRc %ld\n", pxClient->pcFileName, xRc ) ); */
+		}
+		else
+		{
+			FreeRTOS_FD_SET( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+			xSetEvent = pdTRUE;
+		}
+
+		if( xSetEvent == pdFALSE )
+		{
+			FreeRTOS_FD_CLR( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+		}
+
+		return xRc;
+	}
+/*-----------------------------------------------------------*/
+
+	#if ( ipconfigFTP_HAS_MODE_Z != 0 )
+
+		static BaseType_t prvRetrieveFileCompressed( FTPClient_t * pxClient )
+		{
+			BaseType_t xRc = 0;
+			BaseType_t xFinished = pdFALSE;
+			size_t uxSpace;
+			const uint8_t * pucData;
+
+			for( ; ; )
+			{
+				uint8_t * pucBuffer;
+				size_t uxCount, uxLength;
+
+				/* Read the next part of the file directly into the window of the
+				 * compressor. */
+				uxCount = uxFTPDeflateInput( pxClient->pxDeflate, &pucBuffer );
+				uxCount = FreeRTOS_min_uint32( uxCount, pxClient->uxBytesLeft );
+				uxCount = FreeRTOS_min_uint32( uxCount, uxTCPServerBudget( ( TCPClient_t * ) pxClient ) );
+
+				if( uxCount > 0u )
+				{
+					size_t uxItemsRead;
+
+					#if ( ipconfigFTP_MEMORY_SOURCE_COUNT > 0 )
+						if( pxClient->pxSource != NULL )
+						{
+							uxItemsRead = prvRetrieveMemoryRead( pxClient, pucBuffer, uxCount );
+						}
+						else
+					#endif
+					{
+						uxItemsRead = prvFileRead( pxClient, pucBuffer, uxCount );
+					}
+
+					if( uxItemsRead != uxCount )
+					{
+						FreeRTOS_printf( ( "prvRetrieveFileWork: Got %u Expected %u\n", ( unsigned ) uxItemsRead, ( unsigned ) uxCount ) );
+						xRc = FreeRTOS_shutdown( pxClient->xTransferSocket, FREERTOS_SHUT_RDWR );
+						pxClient->uxBytesLeft = 0u;
+						break;
+					}
+
+					vFTPDeflateInputDone( pxClient->pxDeflate, uxCount );
+					pxClient->uxBytesLeft -= uxCount;
+					pxClient->ulRecvBytes += uxCount;
+					vTCPServerBudgetUse( ( TCPClient_t * ) pxClient, uxCount );
+				}
+
+				if( xFTPDeflateRun( pxClient->pxDeflate, ( pxClient->uxBytesLeft == 0u ) ? pdTRUE : pdFALSE ) == ftpZ_DONE )
+				{
+					/* The end of the stream has been produced, it may still have
+					 * to be sent. */
+					xFinished = pdTRUE;
+				}
+
+				uxLength = uxFTPDeflateOutput( pxClient->pxDeflate, &pucData );
+
+				if( ( uxLength == 0u ) && ( ( uxCount == 0u ) || ( xFinished != pdFALSE ) ) )
+				{
+					break;
+				}
+
+				uxSpace = FreeRTOS_tx_space( pxClient->xTransferSocket );
+
+				if( uxLength > uxSpace )
+				{
+					uxLength = uxSpace;
+				}
+				else if( xFinished != pdFALSE )
+				{
+					BaseType_t xTrueValue = 1;
+
+					/* These are the last bytes of the stream. */
+					FreeRTOS_setsockopt( pxClient->xTransferSocket, 0, FREERTOS_SO_CLOSE_AFTER_SEND, ( void * ) &xTrueValue, sizeof( xTrueValue ) );
+				}
+
+				if( uxLength > 0u )
+				{
+					xRc = FreeRTOS_send( pxClient->xTransferSocket, pucData, uxLength, 0 );
+
+					if( xRc < 0 )
+					{
+						break;
+					}
+
+					vFTPDeflateOutputDone( pxClient->pxDeflate, ( size_t ) xRc );
+				}
+
+				if( uxLength >= uxSpace )
+				{
+					/* The TX stream is full. */
+					break;
+				}
+			}
+
+			if( xRc < 0 )
+			{
+				FreeRTOS_printf( ( "prvRetrieveFileCompressed: already disconnected\n" ) );
+			}
+			else if( ( xFinished != pdFALSE ) && ( uxFTPDeflateOutput( pxClient->pxDeflate, &pucData ) == 0u ) )
+			{
+				/* All sent, the socket will be closed. */
+				FreeRTOS_FD_CLR( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+			}
+			else
+			{
+				/* Wait for space in the TX stream. */
+				FreeRTOS_FD_SET( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+			}
+
+			return xRc;
+		}
+
+	#endif /* ipconfigFTP_HAS_MODE_Z != 0 */
+/*-----------------------------------------------------------*/
+
+	#if ( ipconfigFTP_HAS_HASH != 0 )
+
+		static FTPFileDigest_t * prvDigestGet( FTPClient_t * pxClient )
+		{
+			if( pxClient->pxDigest == NULL )
+			{
+				pxClient->pxDigest = ( FTPFileDigest_t * ) pvPortMalloc( sizeof( *( pxClient->pxDigest ) ) );
+
+				if( pxClient->pxDigest != NULL )
+				{
+					memset( pxClient->pxDigest, '\0', sizeof( *( pxClient->pxDigest ) ) );
+					pxClient->pxDigest->xSelected = ftpHASH_SHA256;
+					pxClient->pxDigest->xStoreType = ftpHASH_CRC32;
+					pxClient->pxDigest->xState = ftpDIGEST_NONE;
+				}
+			}
+
+			return pxClient->pxDigest;
+		}
+/*-----------------------------------------------------------*/
+
+		static void prvDigestSetFile( FTPFileDigest_t * pxDigest,
+									  const FF_Stat_t * pxStat )
+		{
+			pxDigest->ulSize = pxStat->st_size;
+			pxDigest->ulCluster = pxStat->st_ino;
+			pxDigest->ulStart = 0ul;
+			pxDigest->ulLength = pxStat->st_size;
+			#if ( ffconfigTIME_SUPPORT != 0 )
+				{
+					pxDigest->ulModified = pxStat->st_mtime;
+				}
+			#else
+				{
+					pxDigest->ulModified = 0ul;
+				}
+			#endif
+		}
+/*-----------------------------------------------------------*/
+
+		static void prvHashReply( FTPClient_t * pxClient )
+		{
+			FTPFileDigest_t * pxDigest = pxClient->pxDigest;
+			BaseType_t xLength;
+
+			if( pxDigest->xCommand == ECMD_HASH )
+			{
+				/* e.g. "213 SHA-256 0-49 169cd2228... /docs/readme.txt" */
+				xMakeRelative( pxClient, pcNEW_DIR, sizeof( pcNEW_DIR ), pxDigest->pcFileName );
+				xLength = snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), "213 %s 0-%lu %s %s\r\n",
+									pcFTPHashName( pxDigest->xHash.xType ),
+									( unsigned long ) ( ( pxDigest->ulSize != 0ul ) ? ( pxDigest->ulSize - 1ul ) : 0ul ),
+									pxDigest->pcDigest, pcNEW_DIR );
+			}
+			else
+			{
+				xLength = snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), "250 %s\r\n", pxDigest->pcDigest );
+			}
+
+			prvSendReply( pxClient->xSocket, pcCOMMAND_BUFFER, xLength );
+		}
+/*-----------------------------------------------------------*/
+
+		static void prvHashCommand( FTPClient_t * pxClient,
+									BaseType_t xCommand,
+									const char * pcFileName )
+		{
+			FTPFileDigest_t * pxDigest = prvDigestGet( pxClient );
+			const char * pcMyReply = NULL;
+			FF_Stat_t xStatBuf;
+			BaseType_t xType;
+			BaseType_t xRange = 0;
+			uint32_t ulStart = 0ul;
+			uint32_t ulEnd = 0ul;
+
+			if( pxDigest == NULL )
+			{
+				pcMyReply = REPL_451;
+			}
+			else if( ( pxDigest->xState == ftpDIGEST_READING ) || ( pxDigest->xState == ftpDIGEST_STORING ) )
+			{
+				/* Another digest is being calculated. */
+				pcMyReply = REPL_450;
+			}
+			else
+			{
+				if( xCommand == ECMD_XCRC )
+				{
+					xType = ftpHASH_CRC32;
+				}
+				else if( xCommand == ECMD_XMD5 )
+				{
+					xType = ftpHASH_MD5;
+				}
+				else
+				{
+					xType = pxDigest->xSelected;
+				}
+
+				/* A client that checks an upload will most likely ask the same
+				 * digest of the next file it stores. */
+				pxDigest->xStoreType = xType;
+				pxDigest->xCommand = xCommand;
+
+				/* The argument may be modified by prvHashRange(). */
+				snprintf( pcFILE_BUFFER, sizeof( pcFILE_BUFFER ), "%s", pcFileName );
+				xMakeAbsolute( pxClient, pcNEW_DIR, sizeof( pcNEW_DIR ), pcFILE_BUFFER );
+
+				if( ( xCommand != ECMD_HASH ) && ( ff_stat( pcNEW_DIR, &xStatBuf ) != 0 ) )
+				{
+					/* Not the name of a file: it may be followed by a range. */
+					xRange = prvHashRange( pcFILE_BUFFER, &ulStart, &ulEnd );
+					xMakeAbsolute( pxClient, pcNEW_DIR, sizeof( pcNEW_DIR ), pcFILE_BUFFER );
+				}
+
+				if( xRange < 0 )
+				{
+					pcMyReply = REPL_501;
+				}
+				else if( ( ff_stat( pcNEW_DIR, &xStatBuf ) != 0 ) || ( ( xStatBuf.st_mode & FF_IFDIR ) != 0 ) )
+				{
+					pcMyReply = REPL_550;
+				}
+				else if( ( xRange == 2 ) && ( ulStart > ulEnd ) )
+				{
+					pcMyReply = REPL_501;
+				}
+				else if( ( ulStart > ( uint32_t ) xStatBuf.st_size ) ||
+						 ( ( xRange == 2 ) && ( ulEnd > ( uint32_t ) xStatBuf.st_size ) ) )
+				{
+					/* The range does not lie within the file. */
+					pcMyReply = REPL_501;
+				}
+				else if( ( pxDigest->xState == ftpDIGEST_VALID ) &&
+						 ( pxDigest->xHash.xType == xType ) &&
+						 ( strcmp( pxDigest->pcFileName, pcNEW_DIR ) == 0 ) &&
+						 ( pxDigest->ulSize == xStatBuf.st_size ) &&
+						 ( pxDigest->ulCluster == xStatBuf.st_ino ) &&
+						 ( pxDigest->ulStart == ulStart ) &&
+						 ( pxDigest->ulLength == ( ( xRange == 2 ) ? ulEnd : ( uint32_t ) xStatBuf.st_size ) - ulStart )
+						 #if ( ffconfigTIME_SUPPORT != 0 )
+							 && ( pxDigest->ulModified == ( uint32_t ) xStatBuf.st_mtime )
+						 #endif
+						 )
+				{
+					/* The file has not changed since its digest was calculated. */
+					prvHashReply( pxClient );
+				}
+				else
+				{
+					pxDigest->xState = ftpDIGEST_NONE;
+					pxDigest->pxHandle = ff_fopen( pcNEW_DIR, "rb" );
+
+					if( ( pxDigest->pxHandle != NULL ) && ( ulStart != 0ul ) &&
+						( ff_fseek( pxDigest->pxHandle, ( long ) ulStart, FF_SEEK_SET ) != 0 ) )
+					{
+						ff_fclose( pxDigest->pxHandle );
+						pxDigest->pxHandle = NULL;
+					}
+
+					if( pxDigest->pxHandle == NULL )
+					{
+						pcMyReply = REPL_550;
+					}
+					else
+					{
+						snprintf( pxDigest->pcFileName, sizeof( pxDigest->pcFileName ), "%s", pcNEW_DIR );
+						prvDigestSetFile( pxDigest, &xStatBuf );
+
+						if( xRange == 2 )
+						{
+							/* The end position is not included. */
+							pxDigest->ulLength = ulEnd - ulStart;
+						}
+						else
+						{
+							pxDigest->ulLength -= ulStart;
+						}
+
+						pxDigest->ulStart = ulStart;
+						vFTPHashInit( &( pxDigest->xHash ), xType );
+						pxDigest->xState = ftpDIGEST_READING;
+
+						/* The command socket is almost always writable: this makes sure
+						 * that xFTPClientWork() is called again while the file is read. */
+						FreeRTOS_FD_SET( pxClient->xSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+						prvHashFileWork( pxClient );
+					}
+				}
+			}
+
+			if( pcMyReply != NULL )
+			{
+				prvSendReply( pxClient->xSocket, pcMyReply, 0 );
+			}
+		}
+/*-----------------------------------------------------------*/
+
+		static BaseType_t prvHashRange( char * pcArgument,
+										uint32_t * pulStart,
+										uint32_t * pulEnd )
+		{
+			char * pcRest;
+			char * pcEnd;
+			unsigned long ulValue;
+			BaseType_t xCount = 0;
+
+			if( pcArgument[ 0 ] == '"' )
+			{
+				/* A quoted name may contain spaces and digits. */
+				pcRest = strchr( pcArgument + 1, '"' );
+
+				if( pcRest == NULL )
+				{
+					return -1;
+				}
+
+				*( pcRest++ ) = '\0';
+				memmove( pcArgument, pcArgument + 1, strlen( pcArgument + 1 ) + 1u );
+			}
+			else
+			{
+				/* Otherwise the positions are the last one or two words. */
+				pcRest = pcArgument + strlen( pcArgument );
+
+				for( xCount = 0; xCount < 2; xCount++ )
+				{
+					pcEnd = pcRest;
+
+					while( ( pcEnd > pcArgument ) && ( isdigit( ( unsigned char ) pcEnd[ -1 ] ) != 0 ) )
+					{
+						pcEnd--;
+					}
+
+					if( ( pcEnd == pcRest ) || ( pcEnd == pcArgument ) || ( pcEnd[ -1 ] != ' ' ) )
+					{
+						break;
+					}
+
+					pcRest = pcEnd - 1;
+
+					while( ( pcRest > pcArgument ) && ( pcRest[ -1 ] == ' ' ) )
+					{
+						pcRest--;
+					}
+				}
+
+				if( *pcRest != '\0' )
+				{
+					*( pcRest++ ) = '\0';
+				}
+
+				xCount = 0;
+			}
+
+			for( ; ; )
+			{
+				while( *pcRest == ' ' )
+				{
+					pcRest++;
+				}
+
+				if( *pcRest == '\0' )
+				{
+					break;
+				}
+
+				if( ( xCount == 2 ) || ( isdigit( ( unsigned char ) *pcRest ) == 0 ) )
+				{
+					return -1;
+				}
+
+				ulValue = strtoul( pcRest, &pcEnd, 10 );
+
+				if( ( ( uint64_t ) ulValue > 0xFFFFFFFFull ) || ( ( *pcEnd != ' ' ) && ( *pcEnd != '\0' ) ) )
+				{
+					return -1;
+				}
+
+				if( xCount == 0 )
+				{
+					*pulStart = ( uint32_t ) ulValue;
+				}
+				else
+				{
+					*pulEnd = ( uint32_t ) ulValue;
+				}
+
+				xCount++;
+				pcRest = pcEnd;
+			}
+
+			return xCount;
+		}
+/*-----------------------------------------------------------*/
+
+		static void prvHashFileWork( FTPClient_t * pxClient )
+		{
+			FTPFileDigest_t * pxDigest = pxClient->pxDigest;
+			size_t uxLimit = uxTCPServerBudget( ( TCPClient_t * ) pxClient );
+			size_t uxCount, uxRead;
+			BaseType_t xDone = pdFALSE;
+
+			if( uxLimit > ftpHASH_BYTES_PER_CALL )
+			{
+				uxLimit = ftpHASH_BYTES_PER_CALL;
+			}
+
+			for( ; ; )
+			{
+				/* Only the requested part of the file is hashed. */
+				uxCount = ( size_t ) ( ( uint64_t ) pxDigest->ulLength - pxDigest->xHash.ullLength );
+
+				if( uxCount == 0u )
+				{
+					xDone = pdTRUE;
+					break;
+				}
+
+				if( uxLimit == 0u )
+				{
+					break;
+				}
+
+				uxCount = FreeRTOS_min_uint32( uxCount, FreeRTOS_min_uint32( uxLimit, sizeof( pcFILE_BUFFER ) ) );
+				uxRead = ff_fread( pcFILE_BUFFER, 1, uxCount, pxDigest->pxHandle );
+
+				if( uxRead > 0u )
+				{
+					vFTPHashUpdate( &( pxDigest->xHash ), pcFILE_BUFFER, uxRead );
+					vTCPServerBudgetUse( ( TCPClient_t * ) pxClient, uxRead );
+				}
+
+				if( uxRead < uxCount )
+				{
+					/* End of file, or a read error. */
+					xDone = pdTRUE;
+					break;
+				}
+
+				uxLimit -= uxRead;
+			}
+
+			if( xDone != pdFALSE )
+			{
+				ff_fclose( pxDigest->pxHandle );
+				pxDigest->pxHandle = NULL;
+				FreeRTOS_FD_CLR( pxClient->xSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+
+				if( pxDigest->xHash.ullLength == ( uint64_t ) pxDigest->ulLength )
+				{
+					vFTPHashFinal( &( pxDigest->xHash ), pxDigest->pcDigest );
+					pxDigest->xState = ftpDIGEST_VALID;
+					prvHashReply( pxClient );
+				}
+				else
+				{
+					FreeRTOS_printf( ( "ftp::hash: %s: read %lu of %lu bytes\n", pxDigest->pcFileName,
+									   ( unsigned long ) pxDigest->xHash.ullLength, pxDigest->ulLength ) );
+					pxDigest->xState = ftpDIGEST_NONE;
+					prvSendReply( pxClient->xSocket, REPL_451, 0 );
+				}
+			}
+		}
+/*-----------------------------------------------------------*/
+
+		static const char * prvHashOptions( FTPClient_t * pxClient,
+											const char * pcOption )
+		{
+			FTPFileDigest_t * pxDigest = prvDigestGet( pxClient );
+			const char * pcMyReply = pcCOMMAND_BUFFER;
+			BaseType_t xType;
+
+			while( *pcOption == ' ' )
+			{
+				pcOption++;
+			}
+
+			if( pxDigest == NULL )
+			{
+				pcMyReply = REPL_451;
+			}
+			else if( *pcOption == '\0' )
+			{
+				/* "OPTS HASH" shows the selected algorithm. */
+				snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), "200 %s\r\n", pcFTPHashName( pxDigest->xSelected ) );
+			}
+			else
+			{
+				xType = xFTPHashType( pcOption );
+
+				if( xType < 0 )
+				{
+					pcMyReply = REPL_504;
+				}
+				else
+				{
+					/* pcOption points into pcCOMMAND_BUFFER, which is overwritten here. */
+					pxDigest->xSelected = xType;
+					snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), "200 %s\r\n", pcFTPHashName( xType ) );
+				}
+			}
+
+			return pcMyReply;
+		}
+/*-----------------------------------------------------------*/
+
+		#if ( ipconfigFTP_HASH_ON_STORE != 0 )
+
+			static void prvHashStoreStart( FTPClient_t * pxClient )
+			{
+				FTPFileDigest_t * pxDigest = prvDigestGet( pxClient );
+
+				if( ( pxDigest != NULL ) && ( pxDigest->pxHandle == NULL ) )
+				{
+					pxDigest->xState = ftpDIGEST_NONE;
+
+					/* After REST, only a part of the file will be received. */
+					if( pxClient->pxWriteHandle->ulFilePointer == 0ul )
+					{
+						vFTPHashInit( &( pxDigest->xHash ), pxDigest->xStoreType );
+						snprintf( pxDigest->pcFileName, sizeof( pxDigest->pcFileName ), "%s", pxClient->pcFileName );
+						pxDigest->xState = ftpDIGEST_STORING;
+					}
+				}
+			}
+/*-----------------------------------------------------------*/
+
+			static void prvHashStoreData( FTPClient_t * pxClient,
+										  const void * pvData,
+										  size_t uxLength )
+			{
+				FTPFileDigest_t * pxDigest = pxClient->pxDigest;
+
+				if( ( pxDigest != NULL ) && ( pxDigest->xState == ftpDIGEST_STORING ) )
+				{
+					vFTPHashUpdate( &( pxDigest->xHash ), pvData, uxLength );
+				}
+			}
+/*-----------------------------------------------------------*/
+
+			static void prvHashStoreEnd( FTPClient_t * pxClient )
+			{
+				FTPFileDigest_t * pxDigest = pxClient->pxDigest;
+
+				if( ( pxDigest != NULL ) && ( pxDigest->xState == ftpDIGEST_STORING ) )
+				{
+					if( pxClient->bits1.bHadError == pdFALSE_UNSIGNED )
+					{
+						vFTPHashFinal( &( pxDigest->xHash ), pxDigest->pcDigest );
+						pxDigest->xState = ftpDIGEST_STORED;
+					}
+					else
+					{
+						pxDigest->xState = ftpDIGEST_NONE;
+					}
+				}
+			}
+/*-----------------------------------------------------------*/
+
+			static void prvHashStoreClosed( FTPClient_t * pxClient )
+			{
+				FTPFileDigest_t * pxDigest = pxClient->pxDigest;
+				FF_Stat_t xStatBuf;
+
+				if( pxDigest != NULL )
+				{
+					/* The cluster and time of the file are only known after
+					 * it has been closed. */
+					if( ( pxDigest->xState == ftpDIGEST_STORED ) &&
+						( ff_stat( pxDigest->pcFileName, &xStatBuf ) == 0 ) &&
+						( ( uint64_t ) xStatBuf.st_size == pxDigest->xHash.ullLength ) )
+					{
+						prvDigestSetFile( pxDigest, &xStatBuf );
+						pxDigest->xState = ftpDIGEST_VALID;
+					}
+					else if( pxDigest->xState != ftpDIGEST_VALID )
+					{
+						pxDigest->xState = ftpDIGEST_NONE;
+					}
+				}
+			}
+		#endif /* ipconfigFTP_HASH_ON_STORE != 0 */
+
+	#endif /* ipconfigFTP_HAS_HASH != 0 */
+/*-----------------------------------------------------------*/
+
+	#if ( ipconfigFTP_MEMORY_SOURCE_COUNT > 0 )
+
+		static uint32_t prvMemorySourceTime( void )
+		{
+			#if ( ffconfigTIME_SUPPORT != 0 )
+				{
+					return ( uint32_t ) FreeRTOS_time( NULL );
+				}
+			#else
+				{
+					return 0ul;
+				}
+			#endif
+		}
+/*-----------------------------------------------------------*/
+
+		BaseType_t FreeRTOS_FTPAddMemorySource( const FTPMemorySource_t * pxSource )
+		{
+			BaseType_t xIndex, xFree = -1;
+			BaseType_t xResult = pdFALSE;
+			uint32_t ulNow = prvMemorySourceTime();
+
+			if( ( pxSource->pcName != NULL ) && ( ( pxSource->pucData != NULL ) || ( pxSource->fRead != NULL ) ) )
+			{
+				vTaskSuspendAll();
+				{
+					for( xIndex = 0; xIndex < ipconfigFTP_MEMORY_SOURCE_COUNT; xIndex++ )
+					{
+						if( xSourceSlots[ xIndex ].xSource.pcName == NULL )
+						{
+							if( xFree < 0 )
+							{
+								xFree = xIndex;
+							}
+						}
+						else if( strcasecmp( xSourceSlots[ xIndex ].xSource.pcName, pxSource->pcName ) == 0 )
+						{
+							/* The name is in use already. */
+							xFree = -1;
+							break;
+						}
+					}
+
+					if( xFree >= 0 )
+					{
+						memcpy( &( xSourceSlots[ xFree ].xSource ), pxSource, sizeof( xSourceSlots[ xFree ].xSource ) );
+						xSourceSlots[ xFree ].ulModified = ulNow;
+						xSourceSlots[ xFree ].xReaders = 0;
+						xResult = pdTRUE;
+					}
+				}
+				( void ) xTaskResumeAll();
+			}
+
+			return xResult;
+		}
+/*-----------------------------------------------------------*/
+
+		BaseType_t FreeRTOS_FTPTouchMemorySource( const char * pcName,
+												  size_t uxSize )
+		{
+			BaseType_t xIndex;
+			BaseType_t xResult = pdFALSE;
+			uint32_t ulNow = prvMemorySourceTime();
+
+			vTaskSuspendAll();
+			{
+				for( xIndex = 0; xIndex < ipconfigFTP_MEMORY_SOURCE_COUNT; xIndex++ )
+				{
+					if( ( xSourceSlots[ xIndex ].xSource.pcName != NULL ) &&
+						( strcasecmp( xSourceSlots[ xIndex ].xSource.pcName, pcName ) == 0 ) )
+					{
+						/* A transfer that is busy keeps the size it started with. */
+						xSourceSlots[ xIndex ].xSource.uxSize = uxSize;
+						xSourceSlots[ xIndex ].ulModified = ulNow;
+						xResult = pdTRUE;
+						break;
+					}
+				}
+			}
+			( void ) xTaskResumeAll();
+
+			return xResult;
+		}
+/*-----------------------------------------------------------*/
+
+		BaseType_t FreeRTOS_FTPRemoveMemorySource( const char * pcName )
+		{
+			BaseType_t xIndex;
+			BaseType_t xResult = pdFALSE;
+
+			vTaskSuspendAll();
+			{
+				for( xIndex = 0; xIndex < ipconfigFTP_MEMORY_SOURCE_COUNT; xIndex++ )
+				{
+					if( ( xSourceSlots[ xIndex ].xSource.pcName != NULL ) &&
+						( xSourceSlots[ xIndex ].xReaders == 0 ) &&
+						( strcasecmp( xSourceSlots[ xIndex ].xSource.pcName, pcName ) == 0 ) )
+					{
+						xSourceSlots[ xIndex ].xSource.pcName = NULL;
+						xResult = pdTRUE;
+						break;
+					}
+				}
+			}
+			( void ) xTaskResumeAll();
+
+			return xResult;
+		}
+/*-----------------------------------------------------------*/
+
+		static FTPSourceSlot_t * prvMemorySourceFind( FTPClient_t * pxClient,
+													  const char * pcPath,
+													  BaseType_t xTake )
+		{
+			FTPSourceSlot_t * pxSlot = NULL;
+			const char * pcName;
+			BaseType_t xIndex, xLength;
+
+			/* The path as the client sees it, e.g. "/mem/adc_capture.bin". */
+			xMakeRelative( pxClient, pcNEW_DIR, sizeof( pcNEW_DIR ), pcPath );
+			xLength = ( BaseType_t ) strlen( ipconfigFTP_MEMORY_DIRECTORY );
+
+			if( ( strncasecmp( pcNEW_DIR, ipconfigFTP_MEMORY_DIRECTORY, xLength ) == 0 ) &&
+				( pcNEW_DIR[ xLength ] == '/' ) )
+			{
+				pcName = pcNEW_DIR + xLength + 1;
+
+				vTaskSuspendAll();
+				{
+					for( xIndex = 0; xIndex < ipconfigFTP_MEMORY_SOURCE_COUNT; xIndex++ )
+					{
+						if( ( xSourceSlots[ xIndex ].xSource.pcName != NULL ) &&
+							( strcasecmp( xSourceSlots[ xIndex ].xSource.pcName, pcName ) == 0 ) )
+						{
+							pxSlot = &( xSourceSlots[ xIndex ] );
+
+							if( xTake != pdFALSE )
+							{
+								pxSlot->xReaders++;
+							}
+
+							break;
+						}
+					}
+				}
+				( void ) xTaskResumeAll();
+			}
+
+			return pxSlot;
+		}
+/*-----------------------------------------------------------*/
+
+		static BaseType_t prvRetrieveMemoryPrep( FTPClient_t * pxClient )
+		{
+			FTPSourceSlot_t * pxSlot = prvMemorySourceFind( pxClient, pxClient->pcFileName, pdTRUE );
+			uint32_t ulOffset = pxClient->ulRestartOffset;
+			size_t uxFileSize;
+
+			if( pxSlot == NULL )
+			{
+				/* Not a memory source, RETR will open a file. */
+				return -1;
+			}
+
+			pxClient->ulRestartOffset = 0ul; /* Only use 1 time. */
+			pxClient->pxSource = pxSlot;
+			uxFileSize = pxSlot->xSource.uxSize;
+
+			if( ( ulOffset != 0ul ) && ( ulOffset >= uxFileSize ) )
+			{
+				BaseType_t xLength;
+
+				xLength = snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ),
+									"450 Seek invalid %u length %u\r\n", ( unsigned ) ulOffset, ( unsigned ) uxFileSize );
+				prvSendReply( pxClient->xSocket, pcCOMMAND_BUFFER, xLength );
+				prvTransferCloseFile( pxClient );
+
+				return pdFALSE;
+			}
+
+			#if ( ipconfigFTP_HAS_MODE_Z != 0 )
+				if( pxClient->bits.bModeZ != pdFALSE_UNSIGNED )
+				{
+					/* MODE Z: the data will be compressed while they are sent. */
+					pxClient->pxDeflate = pxFTPDeflateCreate( ipconfigFTP_DEFLATE_LEVEL );
+
+					if( pxClient->pxDeflate == NULL )
+					{
+						prvSendReply( pxClient->xSocket, REPL_450, 0 );
+						prvTransferCloseFile( pxClient );
+
+						return pdFALSE;
+					}
+				}
+			#endif
+
+			pxClient->ulMemoryOffset = ulOffset;
+			pxClient->uxBytesLeft = uxFileSize - ulOffset;
+			prvRetrieveFileConnect( pxClient, uxFileSize );
+
+			return pdTRUE;
+		}
+/*-----------------------------------------------------------*/
+
+		static size_t prvRetrieveMemoryRead( FTPClient_t * pxClient,
+											 uint8_t * pucBuffer,
+											 size_t uxCount )
+		{
+			const FTPMemorySource_t * pxSource = &( pxClient->pxSource->xSource );
+			size_t uxResult;
+
+			if( pxSource->pucData != NULL )
+			{
+				memcpy( pucBuffer, pxSource->pucData + pxClient->ulMemoryOffset, uxCount );
+				uxResult = uxCount;
+			}
+			else
+			{
+				uxResult = pxSource->fRead( pxSource->pvContext, pxClient->ulMemoryOffset, pucBuffer, uxCount );
+			}
+
+			pxClient->ulMemoryOffset += ( uint32_t ) uxResult;
+
+			return uxResult;
+		}
+/*-----------------------------------------------------------*/
+
+		static BaseType_t prvRetrieveMemoryWork( FTPClient_t * pxClient )
+		{
+			const FTPMemorySource_t * pxSource = &( pxClient->pxSource->xSource );
+			const uint8_t * pucData;
+			uint8_t * pucBuffer;
+			BaseType_t xBufferLength;
+			size_t uxCount;
+			BaseType_t xRc = 0;
+
+			while( pxClient->uxBytesLeft > 0u )
+			{
+				uxCount = FreeRTOS_min_uint32( pxClient->uxBytesLeft, FreeRTOS_tx_space( pxClient->xTransferSocket ) );
+				uxCount = FreeRTOS_min_uint32( uxCount, uxTCPServerBudget( ( TCPClient_t * ) pxClient ) );
+
+				if( uxCount == 0u )
+				{
+					break;
+				}
+
+				if( pxSource->pucData != NULL )
+				{
+					/* The region is copied directly into the TX stream. */
+					pucData = pxSource->pucData + pxClient->ulMemoryOffset;
+					pxClient->ulMemoryOffset += ( uint32_t ) uxCount;
+				}
+				else
+				{
+					/* Let the producer write into the TX stream, as far as the space
+					 * reaches before the end of the circular buffer. */
+					pucBuffer = FreeRTOS_get_tx_head( pxClient->xTransferSocket, &xBufferLength );
+
+					if( ( pucBuffer != NULL ) && ( xBufferLength > 0 ) )
+					{
+						uxCount = FreeRTOS_min_uint32( uxCount, ( uint32_t ) xBufferLength );
+					}
+					else
+					{
+						pucBuffer = ( uint8_t * ) pcFILE_BUFFER;
+						uxCount = FreeRTOS_min_uint32( uxCount, sizeof( pcFILE_BUFFER ) );
+					}
+
+					if( prvRetrieveMemoryRead( pxClient, pucBuffer, uxCount ) != uxCount )
+					{
+						FreeRTOS_printf( ( "prvRetrieveMemoryWork: %s: short read at %lu\n",
+										   pxSource->pcName, ( unsigned long ) pxClient->ulMemoryOffset ) );
+						xRc = FreeRTOS_shutdown( pxClient->xTransferSocket, FREERTOS_SHUT_RDWR );
+						pxClient->uxBytesLeft = 0u;
+						break;
 					}
 
-					uxItemsRead = ff_fread( pcFILE_BUFFER, 1, uxCount, pxClient->pxReadHandle );
+					/* NULL: the data are in the TX stream already. */
+					pucData = ( pucBuffer == ( uint8_t * ) pcFILE_BUFFER ) ? pucBuffer : NULL;
+				}
+
+				pxClient->uxBytesLeft -= uxCount;
+
+				if( pxClient->uxBytesLeft == 0u )
+				{
+					BaseType_t xTrueValue = 1;
+
+					FreeRTOS_setsockopt( pxClient->xTransferSocket, 0, FREERTOS_SO_CLOSE_AFTER_SEND, ( void * ) &xTrueValue, sizeof( xTrueValue ) );
+				}
+
+				xRc = FreeRTOS_send( pxClient->xTransferSocket, pucData, uxCount, 0 );
+
+				if( xRc < 0 )
+				{
+					break;
+				}
+
+				pxClient->ulRecvBytes += xRc;
+				vTCPServerBudgetUse( ( TCPClient_t * ) pxClient, ( size_t ) xRc );
+			}
+
+			if( ( xRc >= 0 ) && ( pxClient->uxBytesLeft > 0u ) )
+			{
+				/* Wait for space in the TX stream. */
+				FreeRTOS_FD_SET( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+			}
+			else
+			{
+				FreeRTOS_FD_CLR( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+			}
+
+			return xRc;
+		}
+
+	#endif /* ipconfigFTP_MEMORY_SOURCE_COUNT > 0 */
+/*-----------------------------------------------------------*/
+
+	#if ( ftpSTORE_CHECKSUM != 0 )
+
+		static void prvStoreFileChecksum( FTPClient_t * pxClient,
+										  const void * pvData,
+										  size_t uxLength )
+		{
+			#if ( ipconfigFTP_STORE_CRC != 0 )
+				{
+					pxClient->ulStoreCrc = ulFTPCrc32( pxClient->ulStoreCrc, ( const uint8_t * ) pvData, uxLength );
+					pxClient->ulStoreLength += ( uint32_t ) uxLength;
+				}
+			#endif
+			#if ( ipconfigFTP_HAS_HASH != 0 ) && ( ipconfigFTP_HASH_ON_STORE != 0 )
+				{
+					prvHashStoreData( pxClient, pvData, uxLength );
+				}
+			#endif
+		}
+
+	#endif /* ftpSTORE_CHECKSUM != 0 */
+/*-----------------------------------------------------------*/
+
+	#if ( ipconfigFTP_STORE_CRC != 0 )
+
+		static void prvStoreCrcStart( FTPClient_t * pxClient,
+									  BaseType_t xFromStart )
+		{
+			pxClient->ulStoreCrc = 0ul;
+			pxClient->ulStoreLength = 0ul;
+			/* After REST, the CRC only covers the part received now. */
+			pxClient->bits1.bCrcFromStart = ( xFromStart != pdFALSE ) ? pdTRUE_UNSIGNED : pdFALSE_UNSIGNED;
+			pxClient->bits1.bCrcValid = pdFALSE_UNSIGNED;
+			pxClient->bits1.bCrcMismatch = pdFALSE_UNSIGNED;
+		}
+/*-----------------------------------------------------------*/
+
+		static void prvStoreCrcCheck( FTPClient_t * pxClient )
+		{
+			if( pxClient->bits1.bHadError == pdFALSE_UNSIGNED )
+			{
+				if( ( pxClient->bits.bExpectCrc != pdFALSE_UNSIGNED ) &&
+					( pxClient->bits1.bCrcFromStart != pdFALSE_UNSIGNED ) &&
+					( pxClient->ulStoreCrc != pxClient->ulExpectCrc ) )
+				{
+					/* prvTransferCloseSocket() will reply with 451. */
+					pxClient->bits1.bHadError = pdTRUE_UNSIGNED;
+					pxClient->bits1.bCrcMismatch = pdTRUE_UNSIGNED;
+				}
+				else
+				{
+					pxClient->bits1.bCrcValid = pxClient->bits1.bCrcFromStart;
+				}
+			}
+
+			/* The announced CRC only applies to one upload. */
+			pxClient->bits.bExpectCrc = pdFALSE_UNSIGNED;
+		}
+/*-----------------------------------------------------------*/
+
+		static void prvStoreCrcClosed( FTPClient_t * pxClient )
+		{
+			if( pxClient->bits1.bCrcMismatch != pdFALSE_UNSIGNED )
+			{
+				/* Don't leave a damaged file for the application to use. */
+				FreeRTOS_printf( ( "ftp::storeFile: %s: CRC32 %08lX expected %08lX\n", pxClient->pcFileName,
+								   ( unsigned long ) pxClient->ulStoreCrc, ( unsigned long ) pxClient->ulExpectCrc ) );
+				ff_remove( pxClient->pcFileName );
 
-					if( uxItemsRead != uxCount )
+				/* An earlier line of the file must go as well. */
+				prvCrcIndexUpdate( pxClient, pdFALSE );
+			}
+			else if( pxClient->bits1.bCrcValid != pdFALSE_UNSIGNED )
+			{
+				prvCrcIndexUpdate( pxClient, pdTRUE );
+			}
+
+			pxClient->bits1.bCrcValid = pdFALSE_UNSIGNED;
+			pxClient->bits1.bCrcMismatch = pdFALSE_UNSIGNED;
+		}
+/*-----------------------------------------------------------*/
+
+		static SemaphoreHandle_t xCrcIndexMutex = NULL;
+
+		static void prvCrcIndexLock( void )
+		{
+			if( xCrcIndexMutex == NULL )
+			{
+				/* Created once, by the first task that needs it. */
+				vTaskSuspendAll();
+				{
+					if( xCrcIndexMutex == NULL )
 					{
-						FreeRTOS_printf( ( "prvRetrieveFileWork: Got %u Expected %u\n", ( unsigned ) uxItemsRead, ( unsigned ) uxCount ) );
-						xRc = FreeRTOS_shutdown( pxClient->xTransferSocket, FREERTOS_SHUT_RDWR );
-						pxClient->uxBytesLeft = 0u;
-						break;
+						xCrcIndexMutex = xSemaphoreCreateMutex();
 					}
+				}
+				( void ) xTaskResumeAll();
+			}
 
-					pxClient->uxBytesLeft -= uxCount;
+			if( xCrcIndexMutex != NULL )
+			{
+				( void ) xSemaphoreTake( xCrcIndexMutex, portMAX_DELAY );
+			}
+		}
+/*-----------------------------------------------------------*/
 
-					if( pxClient->uxBytesLeft == 0u )
-					{
-						BaseType_t xTrueValue = 1;
+		static void prvCrcIndexUnlock( void )
+		{
+			if( xCrcIndexMutex != NULL )
+			{
+				( void ) xSemaphoreGive( xCrcIndexMutex );
+			}
+		}
+/*-----------------------------------------------------------*/
 
-						FreeRTOS_setsockopt( pxClient->xTransferSocket, 0, FREERTOS_SO_CLOSE_AFTER_SEND, ( void * ) &xTrueValue, sizeof( xTrueValue ) );
-					}
+		static BaseType_t prvIsCrcIndex( const char * pcName )
+		{
+			const char * pcBaseName = strrchr( pcName, '/' );
 
-					xRc = FreeRTOS_send( pxClient->xTransferSocket, pcFILE_BUFFER, uxCount, 0 );
-				}
-			#else /* ipconfigFTP_TX_ZERO_COPY != 0 */
-				{
-					/* Use zero-copy transmission:
-					 * FreeRTOS_get_tx_head() returns a direct pointer to the TX stream and
-					 * set xBufferLength to know how much space there is left. */
-					pcBuffer = ( char * ) FreeRTOS_get_tx_head( pxClient->xTransferSocket, &xBufferLength );
+			pcBaseName = ( pcBaseName != NULL ) ? ( pcBaseName + 1 ) : pcName;
+
+			return ( strcasecmp( pcBaseName, ipconfigFTP_CRC_INDEX_NAME ) == 0 ) ? pdTRUE : pdFALSE;
+		}
+/*-----------------------------------------------------------*/
+
+		static void prvCrcIndexUpdate( FTPClient_t * pxClient,
+									   BaseType_t xAddFile )
+		{
+			const char * pcBaseName = strrchr( pxClient->pcFileName, '/' );
+			int iDirLength;
+			char pcTempName[ ffconfigMAX_FILENAME ];
+			/* The first half of the file buffer holds a line, the second half
+			 * the path of the file that it describes. */
+			char * pcLine = pcFILE_BUFFER;
+			char * pcPath = pcFILE_BUFFER + ( sizeof( pcFILE_BUFFER ) / 2u );
+			size_t uxHalf = sizeof( pcFILE_BUFFER ) / 2u;
+			FF_FILE * pxOldIndex, * pxNewIndex;
+			FF_Stat_t xStatBuf;
+			unsigned long ulLineCrc, ulLineSize, ulLineCluster, ulLineModified;
+			unsigned long ulModified;
+			int iOffset;
+			size_t uxNameLength;
+			BaseType_t xLength, xLineCount = 0;
+
+			if( ( pcBaseName == NULL ) || ( prvIsCrcIndex( pxClient->pcFileName ) != pdFALSE ) )
+			{
+				return;
+			}
+
+			/* The index lives in the same directory as the file. */
+			iDirLength = ( int ) ( pcBaseName - pxClient->pcFileName );
+			snprintf( pcNEW_DIR, sizeof( pcNEW_DIR ), "%.*s/%s", iDirLength, pxClient->pcFileName, ipconfigFTP_CRC_INDEX_NAME );
+			snprintf( pcTempName, sizeof( pcTempName ), "%s.new", pcNEW_DIR );
+
+			prvCrcIndexLock();
+
+			pxNewIndex = ff_fopen( pcTempName, "wb" );
 
-					if( ( pcBuffer != NULL ) && ( xBufferLength >= 512 ) )
+			if( pxNewIndex != NULL )
+			{
+				pxOldIndex = ff_fopen( pcNEW_DIR, "rb" );
+
+				if( pxOldIndex != NULL )
+				{
+					while( ff_fgets( pcLine, uxHalf, pxOldIndex ) != NULL )
 					{
-						/* Will read disk data directly to the TX stream of the socket. */
-						uxCount = FreeRTOS_min_uint32( uxCount, ( uint32_t ) xBufferLength );
+						/* "CRC size cluster modified name": lines in another
+						 * format are dropped. */
+						if( sscanf( pcLine, "%lx %lu %lu %lu %n", &ulLineCrc, &ulLineSize, &ulLineCluster, &ulLineModified, &iOffset ) != 4 )
+						{
+							continue;
+						}
 
-						if( uxCount > ( size_t ) 0x40000u )
+						uxNameLength = strcspn( pcLine + iOffset, "\r\n" );
+
+						if( ( strlen( pcBaseName + 1 ) == uxNameLength ) &&
+							( strncasecmp( pcLine + iOffset, pcBaseName + 1, uxNameLength ) == 0 ) )
 						{
-							uxCount = ( size_t ) 0x40000u;
+							/* The line of this file is replaced. */
+							continue;
 						}
-					}
-					else
-					{
-						/* Use the normal file i/o buffer. */
-						pcBuffer = pcFILE_BUFFER;
 
-						if( uxCount > sizeof( pcFILE_BUFFER ) )
+						if( ( size_t ) iDirLength + 1u + uxNameLength >= uxHalf )
 						{
-							uxCount = sizeof( pcFILE_BUFFER );
+							continue;
 						}
-					}
 
-					if( pxClient->uxBytesLeft >= 1024u )
-					{
-						uxCount &= ~( ( size_t ) 512u - 1u );
-					}
+						/* The directory and its slash, followed by the name. */
+						memcpy( pcPath, pxClient->pcFileName, ( size_t ) iDirLength + 1u );
+						memcpy( pcPath + iDirLength + 1, pcLine + iOffset, uxNameLength );
+						pcPath[ ( size_t ) iDirLength + 1u + uxNameLength ] = '\0';
 
-					if( uxCount <= 0u )
-					{
-						/* Nothing to send after rounding down to a multiple of a sector size. */
-						break;
+						if( ff_stat( pcPath, &xStatBuf ) != 0 )
+						{
+							continue;
+						}
+
+						#if ( ffconfigTIME_SUPPORT != 0 )
+							{
+								ulModified = ( unsigned long ) xStatBuf.st_mtime;
+							}
+						#else
+							{
+								ulModified = 0ul;
+							}
+						#endif
+
+						if( ( ulLineSize == ( unsigned long ) xStatBuf.st_size ) &&
+							( ulLineCluster == ( unsigned long ) xStatBuf.st_ino ) &&
+							( ulLineModified == ulModified ) )
+						{
+							ff_fwrite( pcLine, 1, strlen( pcLine ), pxNewIndex );
+							xLineCount++;
+						}
 					}
 
-					uxItemsRead = ff_fread( pcBuffer, 1, uxCount, pxClient->pxReadHandle );
+					ff_fclose( pxOldIndex );
+				}
 
-					if( uxCount != uxItemsRead )
+				if( ( xAddFile != pdFALSE ) && ( ff_stat( pxClient->pcFileName, &xStatBuf ) == 0 ) )
+				{
+					#if ( ffconfigTIME_SUPPORT != 0 )
+						{
+							ulModified = ( unsigned long ) xStatBuf.st_mtime;
+						}
+					#else
+						{
+							ulModified = 0ul;
+						}
+					#endif
+					xLength = snprintf( pcLine, uxHalf, "%08lX %lu %lu %lu %s\n",
+										( unsigned long ) pxClient->ulStoreCrc, ( unsigned long ) xStatBuf.st_size,
+										( unsigned long ) xStatBuf.st_ino, ulModified, pcBaseName + 1 );
+					ff_fwrite( pcLine, 1, xLength, pxNewIndex );
+					xLineCount++;
+				}
+
+				ff_fclose( pxNewIndex );
+
+				if( xLineCount != 0 )
+				{
+					ff_rename( pcTempName, pcNEW_DIR, pdTRUE );
+				}
+				else
+				{
+					/* Nothing left to describe. */
+					ff_remove( pcTempName );
+					ff_remove( pcNEW_DIR );
+				}
+			}
+
+			prvCrcIndexUnlock();
+		}
+/*-----------------------------------------------------------*/
+
+		static void prvSiteCrc( FTPClient_t * pxClient,
+								const char * pcFileName )
+		{
+			char * pcBaseName;
+			const char * pcMyReply = REPL_550;
+			FF_FILE * pxIndex;
+			FF_Stat_t xStatBuf;
+			BaseType_t xLength, xNameLength;
+			unsigned long ulCrc = 0ul, ulSize = 0ul, ulCluster = 0ul, ulModified = 0ul;
+			unsigned long ulFileModified;
+			BaseType_t xFound = pdFALSE;
+
+			if( *pcFileName == '\0' )
+			{
+				/* The upload that is running now, or the last one. */
+				xLength = snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), "200 CRC32 %08lX %lu%s\r\n",
+									( unsigned long ) pxClient->ulStoreCrc, ( unsigned long ) pxClient->ulStoreLength,
+									( pxClient->pxWriteHandle != NULL ) ? " receiving" : "" );
+				prvSendReply( pxClient->xSocket, pcCOMMAND_BUFFER, xLength );
+
+				return;
+			}
+
+			xMakeAbsolute( pxClient, pcNEW_DIR, sizeof( pcNEW_DIR ), pcFileName );
+			pcBaseName = strrchr( pcNEW_DIR, '/' );
+
+			if( ( pcBaseName != NULL ) && ( ff_stat( pcNEW_DIR, &xStatBuf ) == 0 ) )
+			{
+				/* Keep the name of the file, and open the index next to it. */
+				xNameLength = snprintf( pcFILE_BUFFER, sizeof( pcFILE_BUFFER ), "%s", pcBaseName + 1 );
+				snprintf( pcBaseName + 1, sizeof( pcNEW_DIR ) - ( size_t ) ( pcBaseName + 1 - pcNEW_DIR ), "%s", ipconfigFTP_CRC_INDEX_NAME );
+
+				/* Don't read the index while another task rewrites it. */
+				prvCrcIndexLock();
+				pxIndex = ff_fopen( pcNEW_DIR, "rb" );
+
+				if( pxIndex != NULL )
+				{
+					char * pcLine = pcFILE_BUFFER + xNameLength + 1;
+					size_t uxLineSize = sizeof( pcFILE_BUFFER ) - ( size_t ) xNameLength - 1u;
+					int iOffset;
+
+					/* The index has at most one line per name. */
+					while( ( xFound == pdFALSE ) && ( ff_fgets( pcLine, uxLineSize, pxIndex ) != NULL ) )
 					{
-						FreeRTOS_printf( ( "prvRetrieveFileWork: Got %u Expected %u\n", ( unsigned ) uxItemsRead, ( unsigned ) uxCount ) );
-						xRc = FreeRTOS_shutdown( pxClient->xTransferSocket, FREERTOS_SHUT_RDWR );
-						pxClient->uxBytesLeft = 0u;
-						break;
+						if( ( sscanf( pcLine, "%lx %lu %lu %lu %n", &ulCrc, &ulSize, &ulCluster, &ulModified, &iOffset ) == 4 ) &&
+							( strncasecmp( pcLine + iOffset, pcFILE_BUFFER, xNameLength ) == 0 ) &&
+							( ( pcLine[ iOffset + xNameLength ] == '\n' ) || ( pcLine[ iOffset + xNameLength ] == '\0' ) ) )
+						{
+							xFound = pdTRUE;
+						}
 					}
 
-					pxClient->uxBytesLeft -= uxCount;
+					ff_fclose( pxIndex );
+				}
 
-					if( pxClient->uxBytesLeft == 0u )
-					{
-						BaseType_t xTrueValue = 1;
+				prvCrcIndexUnlock();
 
-						FreeRTOS_setsockopt( pxClient->xTransferSocket, 0, FREERTOS_SO_CLOSE_AFTER_SEND, ( void * ) &xTrueValue, sizeof( xTrueValue ) );
+				#if ( ffconfigTIME_SUPPORT != 0 )
+					{
+						ulFileModified = ( unsigned long ) xStatBuf.st_mtime;
 					}
-
-					if( pcBuffer != pcFILE_BUFFER )
+				#else
 					{
-						pcBuffer = NULL;
+						ulFileModified = 0ul;
 					}
-
-					xRc = FreeRTOS_send( pxClient->xTransferSocket, pcBuffer, uxCount, 0 );
+				#endif
+
+				/* Like the HASH cache, the size, the first cluster and the
+				 * time of the last change must all be the same. */
+				if( ( xFound != pdFALSE ) &&
+					( ulSize == ( unsigned long ) xStatBuf.st_size ) &&
+					( ulCluster == ( unsigned long ) xStatBuf.st_ino ) &&
+					( ulModified == ulFileModified ) )
+				{
+					xLength = snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), "200 CRC32 %08lX %lu %s\r\n",
+										ulCrc, ulSize, pcFILE_BUFFER );
+					prvSendReply( pxClient->xSocket, pcCOMMAND_BUFFER, xLength );
+					pcMyReply = NULL;
 				}
-			#endif /* ipconfigFTP_TX_ZERO_COPY */
+			}
 
-			if( xRc < 0 )
+			if( pcMyReply != NULL )
 			{
-				break;
+				/* Not found, or the file has been changed since it was stored. */
+				prvSendReply( pxClient->xSocket, pcMyReply, 0 );
 			}
+		}
 
-			pxClient->ulRecvBytes += xRc;
+	#endif /* ipconfigFTP_STORE_CRC != 0 */
+/*-----------------------------------------------------------*/
 
-			if( pxClient->uxBytesLeft == 0u )
+	static void prvSendStatus( FTPClient_t * pxClient )
+	{
+		BaseType_t xLength;
+
+		xLength = snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ),
+							"211-FreeRTOS+TCP FTP server status:\r\n"
+							" Directory %s, TYPE %s, MODE %s\r\n",
+							pxClient->pcCurrentDir,
+							( pxClient->xTransType == TMODE_ASCII ) ? "A" : "I",
+							( pxClient->bits.bModeZ != pdFALSE_UNSIGNED ) ? "Z" : "S" );
+
+		if( ftpIS_STORING( pxClient ) || ftpIS_RETRIEVING( pxClient ) )
+		{
+			xLength += snprintf( pcCOMMAND_BUFFER + xLength, sizeof( pcCOMMAND_BUFFER ) - xLength,
+								 " %s %s: %lu bytes\r\n",
+								 ftpIS_STORING( pxClient ) ? "Receiving" : "Sending",
+								 pxClient->pcFileName, ( unsigned long ) pxClient->ulRecvBytes );
+		}
+
+		#if ( ipconfigFTP_STORE_CRC != 0 )
 			{
-				break;
+				xLength += snprintf( pcCOMMAND_BUFFER + xLength, sizeof( pcCOMMAND_BUFFER ) - xLength,
+									 " %s STOR: CRC32 %08lX of %lu bytes\r\n",
+									 ( pxClient->pxWriteHandle != NULL ) ? "Running" : "Last",
+									 ( unsigned long ) pxClient->ulStoreCrc, ( unsigned long ) pxClient->ulStoreLength );
 			}
-		} while( uxCount > 0u );
+		#endif
 
-		if( xRc < 0 )
+		xLength += snprintf( pcCOMMAND_BUFFER + xLength, sizeof( pcCOMMAND_BUFFER ) - xLength, "211 End of status\r\n" );
+		prvSendReply( pxClient->xSocket, pcCOMMAND_BUFFER, xLength );
+	}
+/*-----------------------------------------------------------*/
+
+	#if ( ipconfigFTP_HAS_STATS != 0 )
+
+		static uint32_t prvStatsClockToMs( uint64_t ullClocks )
 		{
-			FreeRTOS_printf( ( "prvRetrieveFileWork: already disconnected\n" ) );
+			return ( uint32_t ) ( ( ullClocks * 1000ull ) / ipconfigFTP_STATS_CLOCK_HZ );
 		}
-		else if( pxClient->uxBytesLeft <= 0u )
+/*-----------------------------------------------------------*/
+
+		static void prvStatsTransferStart( FTPClient_t * pxClient,
+										   BaseType_t xSending )
 		{
-			BaseType_t x;
+			FTPTransferStats_t * pxTransfer = &( pxClient->xStats.xTransfer );
 
-			for( x = 0; x < 5; x++ )
+			pxClient->xTransferStart = xTaskGetTickCount();
+			pxClient->ullDiskClocks = 0ull;
+			pxClient->ullWaitClocks = 0ull;
+			pxClient->ulWaitStart = 0ul;
+
+			vTaskSuspendAll();
 			{
-				xRc = FreeRTOS_recv( pxClient->xTransferSocket, pcFILE_BUFFER, sizeof( pcFILE_BUFFER ), 0 );
+				memset( pxTransfer, 0, sizeof( *pxTransfer ) );
+				pxTransfer->xSending = xSending;
+				pxClient->xStats.xBusy = pdTRUE;
+			}
+			( void ) xTaskResumeAll();
+		}
+/*-----------------------------------------------------------*/
 
-				if( xRc < 0 )
+		static void prvStatsUpdate( FTPClient_t * pxClient )
+		{
+			FTPTransferStats_t * pxTransfer = &( pxClient->xStats.xTransfer );
+			TickType_t xDuration;
+
+			/* Called from the server task, or from another task while the
+			 * scheduler is suspended. */
+			if( pxClient->xStats.xBusy != pdFALSE )
+			{
+				xDuration = xTaskGetTickCount() - pxClient->xTransferStart;
+				pxTransfer->ulBytes = pxClient->ulRecvBytes;
+				pxTransfer->ulDuration = ( uint32_t ) ( ( ( uint64_t ) xDuration * 1000ull ) / configTICK_RATE_HZ );
+				pxTransfer->ulDiskTime = prvStatsClockToMs( pxClient->ullDiskClocks );
+				pxTransfer->ulWaitTime = prvStatsClockToMs( pxClient->ullWaitClocks );
+			}
+		}
+/*-----------------------------------------------------------*/
+
+		static void prvStatsTransferEnd( FTPClient_t * pxClient )
+		{
+			FTPSessionStats_t * pxStats = &( pxClient->xStats );
+			FTPTransferStats_t * pxTransfer = &( pxStats->xTransfer );
+
+			if( pxStats->xBusy != pdFALSE )
+			{
+				prvStatsWaitEnd( pxClient );
+
+				vTaskSuspendAll();
 				{
-					break;
+					prvStatsUpdate( pxClient );
+					pxTransfer->xSuccess = ( pxClient->bits1.bHadError == pdFALSE_UNSIGNED ) ? pdTRUE : pdFALSE;
+
+					if( pxTransfer->xSending != pdFALSE )
+					{
+						pxStats->ulFilesSent++;
+						pxStats->ullBytesSent += pxTransfer->ulBytes;
+					}
+					else
+					{
+						pxStats->ulFilesReceived++;
+						pxStats->ullBytesReceived += pxTransfer->ulBytes;
+					}
+
+					pxStats->xBusy = pdFALSE;
 				}
+				( void ) xTaskResumeAll();
+
+				#if ( ipconfigHAS_PRINTF != 0 )
+					{
+						char pcStrBuf[ 32 ];
+						uint32_t ulAverage;
+
+						ulAverage = ulGetAverage( pxTransfer->ulBytes, ( TickType_t ) pxTransfer->ulDuration );
+						FreeRTOS_printf( ( "FTP: %s: '%s' %lu Bytes (%s/sec) %lu ms, disk %lu ms, network %lu ms%s\n",
+										   ( pxTransfer->xSending != pdFALSE ) ? "sent" : "recv",
+										   pxClient->pcFileName,
+										   pxTransfer->ulBytes,
+										   pcMkSize( ulAverage, pcStrBuf, sizeof( pcStrBuf ) ),
+										   pxTransfer->ulDuration,
+										   pxTransfer->ulDiskTime,
+										   pxTransfer->ulWaitTime,
+										   ( pxTransfer->xSuccess != pdFALSE ) ? "" : " (aborted)" ) );
+					}
+				#endif /* ipconfigHAS_PRINTF != 0 */
 			}
+		}
+/*-----------------------------------------------------------*/
 
-/*		FreeRTOS_printf( ( "prvRetrieveFileWork: %s all sent: xRc %ld\n", pxClient->pcFileName, xRc ) ); */
+		static void prvStatsWaitEnd( FTPClient_t * pxClient )
+		{
+			if( pxClient->ulWaitStart != 0ul )
+			{
+				pxClient->ullWaitClocks += ( uint32_t ) ( ipconfigFTP_STATS_CLOCK() - pxClient->ulWaitStart );
+				pxClient->ulWaitStart = 0ul;
+			}
 		}
-		else
+/*-----------------------------------------------------------*/
+
+		static void prvStatsWaitCheck( FTPClient_t * pxClient )
 		{
-			FreeRTOS_FD_SET( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
-			xSetEvent = pdTRUE;
+			BaseType_t xWaiting = pdFALSE;
+
+			if( ( pxClient->xStats.xBusy != pdFALSE ) && ( pxClient->xTransferSocket != FREERTOS_NO_SOCKET ) )
+			{
+				if( pxClient->xStats.xTransfer.xSending != pdFALSE )
+				{
+					/* The TX stream is full, the peer must acknowledge data first. */
+					xWaiting = ( FreeRTOS_tx_space( pxClient->xTransferSocket ) <= 0 ) ? pdTRUE : pdFALSE;
+				}
+				else
+				{
+					/* All data have been stored, no more have arrived. */
+					xWaiting = ( FreeRTOS_rx_size( pxClient->xTransferSocket ) <= 0 ) ? pdTRUE : pdFALSE;
+				}
+			}
+
+			if( xWaiting != pdFALSE )
+			{
+				/* Bit 0 is set so that a start time is never zero. */
+				pxClient->ulWaitStart = ipconfigFTP_STATS_CLOCK() | 1ul;
+			}
+		}
+/*-----------------------------------------------------------*/
+
+		static void prvSiteStats( FTPClient_t * pxClient )
+		{
+			const FTPSessionStats_t * pxStats = &( pxClient->xStats );
+			const FTPTransferStats_t * pxTransfer = &( pxStats->xTransfer );
+			char pcAddress[ 16 ];
+			BaseType_t xLength;
+
+			prvStatsUpdate( pxClient );
+			FreeRTOS_inet_ntoa( pxStats->ulClientIP, pcAddress );
+
+			xLength = snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ),
+								"200-Session %s:%u, connected %lu sec\r\n"
+								"200-Sent %lu files, %lu KB, received %lu files, %lu KB\r\n",
+								pcAddress, ( unsigned ) pxStats->usClientPort,
+								( unsigned long ) ( ( xTaskGetTickCount() - pxStats->xConnectTime ) / configTICK_RATE_HZ ),
+								( unsigned long ) pxStats->ulFilesSent, ( unsigned long ) ( pxStats->ullBytesSent / 1024ull ),
+								( unsigned long ) pxStats->ulFilesReceived, ( unsigned long ) ( pxStats->ullBytesReceived / 1024ull ) );
+
+			if( ( pxStats->xBusy != pdFALSE ) || ( pxStats->ulFilesSent + pxStats->ulFilesReceived != 0ul ) )
+			{
+				xLength += snprintf( pcCOMMAND_BUFFER + xLength, sizeof( pcCOMMAND_BUFFER ) - xLength,
+									 "200-%s %s '%s': %lu bytes in %lu ms, disk %lu ms, network %lu ms\r\n",
+									 ( pxStats->xBusy != pdFALSE ) ? "Running" : "Last",
+									 ( pxTransfer->xSending != pdFALSE ) ? "RETR" : "STOR",
+									 pxClient->pcFileName,
+									 ( unsigned long ) pxTransfer->ulBytes,
+									 ( unsigned long ) pxTransfer->ulDuration,
+									 ( unsigned long ) pxTransfer->ulDiskTime,
+									 ( unsigned long ) pxTransfer->ulWaitTime );
+			}
+
+			xLength += snprintf( pcCOMMAND_BUFFER + xLength, sizeof( pcCOMMAND_BUFFER ) - xLength, "200 End of statistics\r\n" );
+			prvSendReply( pxClient->xSocket, pcCOMMAND_BUFFER, xLength );
 		}
+/*-----------------------------------------------------------*/
 
-		if( xSetEvent == pdFALSE )
+		BaseType_t FreeRTOS_FTPGetStats( TCPServer_t * pxServer,
+										 FTPSessionStats_t * pxStats,
+										 BaseType_t xMaxCount )
 		{
-			FreeRTOS_FD_CLR( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+			TCPServer_t * pxWorker = pxServer;
+			TCPClient_t * pxTCPClient;
+			BaseType_t xCount = 0;
+
+			#if ( ipconfigTCP_SERVER_MAX_WORKERS > 1 )
+				BaseType_t xWorker = 0;
+			#endif
+
+			/* Clients are added and removed by the server tasks, which can not
+			 * run while the scheduler is suspended. */
+			vTaskSuspendAll();
+			{
+				while( pxWorker != NULL )
+				{
+					for( pxTCPClient = pxWorker->pxClients; pxTCPClient != NULL; pxTCPClient = pxTCPClient->pxNextClient )
+					{
+						if( ( pxTCPClient->eType == eSERVER_FTP ) && ( xCount < xMaxCount ) )
+						{
+							FTPClient_t * pxClient = ( FTPClient_t * ) pxTCPClient;
+
+							prvStatsUpdate( pxClient );
+							pxStats[ xCount++ ] = pxClient->xStats;
+						}
+					}
+
+					/* pxWorkers[ 0 ] is the server itself. */
+					#if ( ipconfigTCP_SERVER_MAX_WORKERS > 1 )
+						{
+							xWorker++;
+							pxWorker = ( xWorker < pxServer->xWorkerCount ) ? pxServer->pxWorkers[ xWorker ] : NULL;
+						}
+					#else
+						{
+							pxWorker = NULL;
+						}
+					#endif
+				}
+			}
+			( void ) xTaskResumeAll();
+
+			return xCount;
 		}
 
-		return xRc;
-	}
+	#endif /* ipconfigFTP_HAS_STATS != 0 */
 /*-----------------------------------------------------------*/
 
 /*
@@ -1939,8 +5362,9 @@
  #    #   #   #    #   #
  ####### #####  ####   ####
  */
-/* Prepare sending a directory LIST */
-	static BaseType_t prvListSendPrep( FTPClient_t * pxClient )
+/* Prepare sending a directory LIST or MLSD */
+	static BaseType_t prvListSendPrep( FTPClient_t * pxClient,
+									   const char * pcDirectory )
 	{
 		BaseType_t xFindResult;
 		int iErrorNo;
@@ -1966,7 +5390,31 @@
 		}
 
 		pxClient->xDirCount = 0;
-		xMakeAbsolute( pxClient, pcNEW_DIR, sizeof( pcNEW_DIR ), pxClient->pcCurrentDir );
+
+		if( ( pcDirectory != NULL ) && ( pcDirectory[ 0 ] != '\0' ) )
+		{
+			/* MLSD may name the directory to be listed. */
+			xMakeAbsolute( pxClient, pcNEW_DIR, sizeof( pcNEW_DIR ), pcDirectory );
+		}
+		else
+		{
+			xMakeAbsolute( pxClient, pcNEW_DIR, sizeof( pcNEW_DIR ), pxClient->pcCurrentDir );
+		}
+
+		#if ( ipconfigFTP_LIST_CACHE_COUNT > 0 )
+			{
+				prvListCacheTake( pxClient );
+
+				if( pxClient->bits1.bListFromCache != pdFALSE_UNSIGNED )
+				{
+					/* The listing will be sent from the cache. */
+					pxClient->bits1.bDirHasEntry = pdTRUE_UNSIGNED;
+					pxClient->pcClientAck[ 0 ] = '\0';
+
+					return pxClient->xDirCount;
+				}
+			}
+		#endif
 
 		xFindResult = ff_findfirst( pcNEW_DIR, &pxClient->xFindData );
 
@@ -1977,7 +5425,12 @@
 		if( ( xFindResult < 0 ) && ( iErrorNo == pdFREERTOS_ERRNO_ENMFILE ) )
 		{
 			FreeRTOS_printf( ( "prvListSendPrep: Empty directory? (%s)\n", pxClient->pcCurrentDir ) );
-			prvSendReply( pxClient->xTransferSocket, "total 0\r\n", 0 );
+
+			if( pxClient->bits1.bMachineList == pdFALSE_UNSIGNED )
+			{
+				prvSendReply( pxClient->xTransferSocket, "total 0\r\n", 0 );
+			}
+
 			pxClient->xDirCount++;
 		}
 		else if( xFindResult < 0 )
@@ -1986,18 +5439,38 @@
 			prvSendReply( pxClient->xSocket, REPL_451, 0 );
 		}
 
+		#if ( ipconfigFTP_LIST_CACHE_COUNT > 0 )
+			{
+				if( xFindResult < 0 )
+				{
+					/* Nothing worth caching. */
+					prvListCacheGive( pxClient, pdFALSE );
+				}
+			}
+		#endif
+
 		pxClient->pcClientAck[ 0 ] = '\0';
 
 		return pxClient->xDirCount;
 	}
 /*-----------------------------------------------------------*/
 
-	#define MAX_DIR_LIST_ENTRY_SIZE    256
+/* The facts of MLSD, or the columns of LIST, take less than 80 bytes, and the
+ * name up to ffconfigMAX_FILENAME bytes. */
+	#define MAX_DIR_LIST_ENTRY_SIZE    ( ffconfigMAX_FILENAME + 80 )
 
 	static BaseType_t prvListSendWork( FTPClient_t * pxClient )
 	{
 		BaseType_t xTxSpace;
 
+		#if ( ipconfigFTP_LIST_CACHE_COUNT > 0 )
+			if( pxClient->bits1.bListFromCache != pdFALSE_UNSIGNED )
+			{
+				prvListCacheSend( pxClient );
+			}
+			else
+		#endif
+
 		while( pxClient->bits1.bClientConnected != pdFALSE_UNSIGNED )
 		{
 			char * pcWritePtr = pcCOMMAND_BUFFER;
@@ -2016,7 +5489,55 @@
 				int32_t iRc;
 				int iErrorNo;
 
-				xLength = prvGetFileInfoStat( &( pxClient->xFindData.xDirectoryEntry ), pcWritePtr, xTxSpace );
+				if( pxClient->bits1.bMachineList != pdFALSE_UNSIGNED )
+				{
+					FF_DirEnt_t * pxEntry = &( pxClient->xFindData.xDirectoryEntry );
+
+					#if ( ffconfigTIME_SUPPORT != 0 )
+						const FF_SystemTime_t * pxTime = &( pxEntry->xModifiedTime );
+					#else
+						const FF_SystemTime_t * pxTime = NULL;
+					#endif
+
+					/* A client that may not write, sees no 'w', 'd' or 'f' either. */
+					xLength = prvGetFileFacts( pcWritePtr, xTxSpace,
+											   ( pxEntry->ucAttrib & FF_FAT_ATTR_DIR ) != 0,
+											   ( ( pxEntry->ucAttrib & FF_FAT_ATTR_READONLY ) != 0 ) ||
+											   ( pxClient->bits.bReadOnly != pdFALSE_UNSIGNED ),
+											   pxEntry->ulFileSize,
+											   pxTime,
+											   pxEntry->pcFileName );
+				}
+				else
+				{
+					xLength = prvGetFileInfoStat( &( pxClient->xFindData.xDirectoryEntry ), pcWritePtr, xTxSpace );
+				}
+
+				if( xLength >= xTxSpace )
+				{
+					/* snprintf() returns the length that it would have written. */
+					xLength = xTxSpace - 1;
+				}
+
+				#if ( ipconfigFTP_LIST_CACHE_COUNT > 0 )
+					{
+						FTPListCache_t * pxCache = pxClient->pxListCache;
+
+						if( pxCache != NULL )
+						{
+							if( pxCache->uxLength + ( size_t ) xLength <= sizeof( pxCache->pcData ) )
+							{
+								memcpy( pxCache->pcData + pxCache->uxLength, pcWritePtr, ( size_t ) xLength );
+								pxCache->uxLength += ( size_t ) xLength;
+							}
+							else
+							{
+								/* The listing is too big to be cached. */
+								prvListCacheGive( pxClient, pdFALSE );
+							}
+						}
+					}
+				#endif
 
 				pxClient->xDirCount++;
 				pcWritePtr += xLength;
@@ -2035,6 +5556,16 @@
 									   ( const char * ) strerror( iErrorNo ),
 									   ( unsigned ) iRc ) );
 				}
+
+				#if ( ipconfigFTP_LIST_CACHE_COUNT > 0 )
+					{
+						if( pxClient->bits1.bDirHasEntry == pdFALSE_UNSIGNED )
+						{
+							/* Only a complete listing can be used again. */
+							prvListCacheGive( pxClient, xEndOfDir );
+						}
+					}
+				#endif
 			}
 
 			xWriteLength = ( BaseType_t ) ( pcWritePtr - pcCOMMAND_BUFFER );
@@ -2046,20 +5577,7 @@
 
 			if( pxClient->bits1.bDirHasEntry == pdFALSE_UNSIGNED )
 			{
-				uint32_t ulTotalCount;
-				uint32_t ulFreeCount;
-				uint32_t ulPercentage;
-
-				ulTotalCount = 1;
-				ulFreeCount = ff_diskfree( pxClient->pcCurrentDir, &ulTotalCount );
-				ulPercentage = ( uint32_t ) ( ( 100ULL * ulFreeCount + ulTotalCount / 2 ) / ulTotalCount );
-
-				/* Prepare the ACK which will be sent when all data has been sent. */
-				snprintf( pxClient->pcClientAck, sizeof( pxClient->pcClientAck ),
-						  "226-Options: -l\r\n"
-						  "226-%ld matches total\r\n"
-						  "226 Total %lu KB (%lu %% free)\r\n",
-						  pxClient->xDirCount, ulTotalCount / 1024, ulPercentage );
+				prvListSendAck( pxClient );
 			}
 
 			if( xWriteLength )
@@ -2081,10 +5599,216 @@
 			}
 		} /* while( pxClient->bits1.bClientConnected )  */
 
+		if( ( pxClient->bits1.bClientConnected != pdFALSE_UNSIGNED ) &&
+			( pxClient->bits1.bDirHasEntry != pdFALSE_UNSIGNED ) )
+		{
+			/* Not enough TX space for the remaining entries, wait for space. */
+			FreeRTOS_FD_SET( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+		}
+		else
+		{
+			FreeRTOS_FD_CLR( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+		}
+
 		return 0;
 	}
 /*-----------------------------------------------------------*/
 
+	static void prvListSendAck( FTPClient_t * pxClient )
+	{
+		if( pxClient->bits1.bMachineList != pdFALSE_UNSIGNED )
+		{
+			snprintf( pxClient->pcClientAck, sizeof( pxClient->pcClientAck ),
+					  "226 %ld matches total\r\n", pxClient->xDirCount );
+		}
+		else
+		{
+			uint32_t ulTotalCount;
+			uint32_t ulFreeCount;
+			uint32_t ulPercentage;
+
+			ulTotalCount = 1;
+			ulFreeCount = ff_diskfree( pxClient->pcCurrentDir, &ulTotalCount );
+			ulPercentage = ( uint32_t ) ( ( 100ULL * ulFreeCount + ulTotalCount / 2 ) / ulTotalCount );
+
+			/* Prepare the ACK which will be sent when all data has been sent. */
+			snprintf( pxClient->pcClientAck, sizeof( pxClient->pcClientAck ),
+					  "226-Options: -l\r\n"
+					  "226-%ld matches total\r\n"
+					  "226 Total %lu KB (%lu %% free)\r\n",
+					  pxClient->xDirCount, ulTotalCount / 1024, ulPercentage );
+		}
+	}
+/*-----------------------------------------------------------*/
+
+	#if ( ipconfigFTP_LIST_CACHE_COUNT > 0 )
+
+		static void prvListCacheTake( FTPClient_t * pxClient )
+		{
+			FTPListCache_t * pxCache;
+			FTPListCache_t * pxFound = NULL;
+			FTPListCache_t * pxVictim = NULL;
+			BaseType_t xVictimStale = pdFALSE;
+			BaseType_t xIndex;
+			uint32_t ulDirChanges;
+			TickType_t xNow = xTaskGetTickCount();
+			/* Only the permissions in MLSD depend on the client. */
+			BaseType_t xReadOnly = ( ( pxClient->bits1.bMachineList != pdFALSE_UNSIGNED ) &&
+									 ( pxClient->bits.bReadOnly != pdFALSE_UNSIGNED ) ) ? pdTRUE : pdFALSE;
+
+			pxClient->pxListCache = NULL;
+			pxClient->uxListOffset = 0u;
+			pxClient->bits1.bListFromCache = pdFALSE_UNSIGNED;
+
+			if( ff_dirchanges( pcNEW_DIR, &ulDirChanges ) != 0 )
+			{
+				/* Not on a disk that is known to +FAT. */
+				return;
+			}
+
+			vTaskSuspendAll();
+			{
+				for( xIndex = 0; xIndex < ipconfigFTP_LIST_CACHE_COUNT; xIndex++ )
+				{
+					pxCache = &( xListCache[ xIndex ] );
+
+					if( ( pxCache->xComplete != pdFALSE ) &&
+						( pxCache->ulDirChanges == ulDirChanges ) &&
+						( pxCache->xMachineList == ( BaseType_t ) pxClient->bits1.bMachineList ) &&
+						( pxCache->xReadOnly == xReadOnly ) &&
+						( strcmp( pxCache->pcDirectory, pcNEW_DIR ) == 0 ) )
+					{
+						pxFound = pxCache;
+						break;
+					}
+
+					/* Entries that are in use can not be replaced.  Otherwise prefer
+					 * incomplete or outdated entries, and then the least recently used. */
+					if( pxCache->xUsers == 0 )
+					{
+						BaseType_t xStale = ( pxCache->xComplete == pdFALSE ) || ( pxCache->ulDirChanges != ulDirChanges );
+
+						if( ( pxVictim == NULL ) ||
+							( xStale > xVictimStale ) ||
+							( ( xStale == xVictimStale ) && ( ( xNow - pxCache->xLastUsed ) > ( xNow - pxVictim->xLastUsed ) ) ) )
+						{
+							pxVictim = pxCache;
+							xVictimStale = xStale;
+						}
+					}
+				}
+
+				if( pxFound != NULL )
+				{
+					pxFound->xUsers++;
+					pxFound->xLastUsed = xNow;
+				}
+				else if( pxVictim != NULL )
+				{
+					/* Claim the entry to store the new listing. */
+					pxVictim->xUsers = 1;
+					pxVictim->xComplete = pdFALSE;
+				}
+			}
+			( void ) xTaskResumeAll();
+
+			if( pxFound != NULL )
+			{
+				pxClient->pxListCache = pxFound;
+				pxClient->xDirCount = pxFound->xEntryCount;
+				pxClient->bits1.bListFromCache = pdTRUE_UNSIGNED;
+			}
+			else if( pxVictim != NULL )
+			{
+				/* The entry is not visible to other clients until it is complete. */
+				snprintf( pxVictim->pcDirectory, sizeof( pxVictim->pcDirectory ), "%s", pcNEW_DIR );
+				pxVictim->ulDirChanges = ulDirChanges;
+				pxVictim->xLastUsed = xNow;
+				pxVictim->xMachineList = ( BaseType_t ) pxClient->bits1.bMachineList;
+				pxVictim->xReadOnly = xReadOnly;
+				pxVictim->xEntryCount = 0;
+				pxVictim->uxLength = 0u;
+				pxClient->pxListCache = pxVictim;
+			}
+		}
+/*-----------------------------------------------------------*/
+
+		static void prvListCacheGive( FTPClient_t * pxClient,
+									  BaseType_t xComplete )
+		{
+			FTPListCache_t * pxCache = pxClient->pxListCache;
+
+			if( pxCache != NULL )
+			{
+				vTaskSuspendAll();
+				{
+					if( pxClient->bits1.bListFromCache == pdFALSE_UNSIGNED )
+					{
+						/* This client was filling the entry. */
+						pxCache->xEntryCount = pxClient->xDirCount;
+						pxCache->xComplete = xComplete;
+					}
+
+					pxCache->xUsers--;
+				}
+				( void ) xTaskResumeAll();
+
+				pxClient->pxListCache = NULL;
+			}
+
+			pxClient->bits1.bListFromCache = pdFALSE_UNSIGNED;
+		}
+/*-----------------------------------------------------------*/
+
+		static void prvListCacheSend( FTPClient_t * pxClient )
+		{
+			FTPListCache_t * pxCache = pxClient->pxListCache;
+			BaseType_t xTxSpace;
+			size_t uxCount;
+
+			if( pxClient->bits1.bClientConnected == pdFALSE_UNSIGNED )
+			{
+				return;
+			}
+
+			xTxSpace = FreeRTOS_tx_space( pxClient->xTransferSocket );
+			uxCount = pxCache->uxLength - pxClient->uxListOffset;
+
+			if( ( xTxSpace > 0 ) && ( uxCount > ( size_t ) xTxSpace ) )
+			{
+				uxCount = ( size_t ) xTxSpace;
+			}
+			else if( xTxSpace > 0 )
+			{
+				BaseType_t xTrueValue = 1;
+
+				/* This is the last part of the listing. */
+				pxClient->bits1.bDirHasEntry = pdFALSE_UNSIGNED;
+				FreeRTOS_setsockopt( pxClient->xTransferSocket, 0, FREERTOS_SO_CLOSE_AFTER_SEND, ( void * ) &xTrueValue, sizeof( xTrueValue ) );
+			}
+			else
+			{
+				uxCount = 0u;
+			}
+
+			if( uxCount > 0u )
+			{
+				/* The entry can not change while it has users. */
+				prvSendReply( pxClient->xTransferSocket, pxCache->pcData + pxClient->uxListOffset, ( BaseType_t ) uxCount );
+				pxClient->uxListOffset += uxCount;
+			}
+
+			if( pxClient->bits1.bDirHasEntry == pdFALSE_UNSIGNED )
+			{
+				prvListCacheGive( pxClient, pdTRUE );
+				prvListSendAck( pxClient );
+				prvSendReply( pxClient->xSocket, pxClient->pcClientAck, 0 );
+			}
+		}
+/*-----------------------------------------------------------*/
+
+	#endif /* ipconfigFTP_LIST_CACHE_COUNT > 0 */
+
 	static const char * pcMonthAbbrev( BaseType_t xMonth )
 	{
 		static const char pcMonthList[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
@@ -2175,6 +5899,122 @@
 	}
 /*-----------------------------------------------------------*/
 
+	static BaseType_t prvGetFileFacts( char * pcLine,
+									   BaseType_t xMaxLength,
+									   BaseType_t xIsDir,
+									   BaseType_t xReadOnly,
+									   uint32_t ulSize,
+									   const FF_SystemTime_t * pxTime,
+									   const char * pcFileName )
+	{
+		const char * pcType;
+		const char * pcPerm;
+		char pcModify[ 32 ] = "";
+
+/*
+ *	Creates a listing as defined in RFC 3659, e.g.:
+ *
+ * type=file;size=10564588;modify=20150901001700;perm=rwdf; Star (Instrumental).mp3
+ */
+		if( xIsDir != pdFALSE )
+		{
+			if( strcmp( pcFileName, "." ) == 0 )
+			{
+				pcType = "cdir";
+			}
+			else if( strcmp( pcFileName, ".." ) == 0 )
+			{
+				pcType = "pdir";
+			}
+			else
+			{
+				pcType = "dir";
+			}
+
+			/* Enter, list, create files, make directories, purge. */
+			pcPerm = ( xReadOnly != pdFALSE ) ? "el" : "elcmp";
+		}
+		else
+		{
+			pcType = "file";
+			/* Retrieve, write, delete, rename. */
+			pcPerm = ( xReadOnly != pdFALSE ) ? "r" : "rwdf";
+		}
+
+		if( ( pxTime != NULL ) && ( pxTime->Month != 0 ) && ( pxTime->Day != 0 ) )
+		{
+			snprintf( pcModify, sizeof( pcModify ), "modify=%04u%02u%02u%02u%02u%02u;",
+					  pxTime->Year,
+					  pxTime->Month,
+					  pxTime->Day,
+					  pxTime->Hour,
+					  pxTime->Minute,
+					  pxTime->Second );
+		}
+
+		return snprintf( pcLine, xMaxLength, "type=%s;size=%lu;%sperm=%s; %s\r\n",
+						 pcType, ulSize, pcModify, pcPerm, pcFileName );
+	}
+/*-----------------------------------------------------------*/
+
+	static BaseType_t prvListSingleFile( FTPClient_t * pxClient,
+										 const char * pcFileName )
+	{
+		FF_Stat_t xStatBuf;
+		BaseType_t xLength;
+		const FF_SystemTime_t * pxTime = NULL;
+
+		#if ( ffconfigTIME_SUPPORT != 0 )
+			FF_SystemTime_t xTime;
+		#endif
+
+		/* MLST without an argument is about the working directory. */
+		if( pcFileName[ 0 ] == '\0' )
+		{
+			pcFileName = pxClient->pcCurrentDir;
+		}
+
+		xMakeAbsolute( pxClient, pcNEW_DIR, sizeof( pcNEW_DIR ), pcFileName );
+
+		if( ff_stat( pcNEW_DIR, &xStatBuf ) != 0 )
+		{
+			FreeRTOS_printf( ( "ftp::listSingleFile: %s: %s\n", pcNEW_DIR,
+							   ( const char * ) strerror( stdioGET_ERRNO() ) ) );
+			prvSendReply( pxClient->xSocket, REPL_550, 0 );
+			return pdFALSE;
+		}
+
+		#if ( ffconfigTIME_SUPPORT != 0 )
+			{
+				FF_TimeStruct_t tmStruct;
+				time_t secs = xStatBuf.st_mtime;
+
+				FreeRTOS_gmtime_r( &secs, &tmStruct );
+				xTime.Year = ( uint16_t ) ( tmStruct.tm_year + 1900 );
+				xTime.Month = ( uint16_t ) ( tmStruct.tm_mon + 1 );
+				xTime.Day = ( uint16_t ) tmStruct.tm_mday;
+				xTime.Hour = ( uint16_t ) tmStruct.tm_hour;
+				xTime.Minute = ( uint16_t ) tmStruct.tm_min;
+				xTime.Second = ( uint16_t ) tmStruct.tm_sec;
+				pxTime = &xTime;
+			}
+		#endif
+
+		xLength = snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), "250-Listing %s\r\n ", pcFileName );
+		xLength += prvGetFileFacts( pcCOMMAND_BUFFER + xLength, sizeof( pcCOMMAND_BUFFER ) - xLength,
+									( xStatBuf.st_mode & FF_IFDIR ) != 0,
+									pxClient->bits.bReadOnly != pdFALSE_UNSIGNED,
+									xStatBuf.st_size,
+									pxTime,
+									pcNEW_DIR );
+		xLength += snprintf( pcCOMMAND_BUFFER + xLength, sizeof( pcCOMMAND_BUFFER ) - xLength, "250 End\r\n" );
+
+		prvSendReply( pxClient->xSocket, pcCOMMAND_BUFFER, xLength );
+
+		return pdTRUE;
+	}
+/*-----------------------------------------------------------*/
+
 /*
  ####  #     # #####
  #    # #     #  #   #
@@ -2372,6 +6212,11 @@
 		{
 			case 0:
 				FreeRTOS_printf( ( "ftp::renameTo[%s,%s]: Ok\n", pxClient->pcFileName, pcNEW_DIR ) );
+				#if ( ipconfigUSE_HTTP != 0 ) && ( ipconfigHTTP_CACHE_COUNT > 0 )
+					{
+						FreeRTOS_HTTPCacheChanged();
+					}
+				#endif
 				snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ),
 						  "250 Rename successful to '%s'\r\n", pcNEW_DIR );
 				myReply = pcCOMMAND_BUFFER;
@@ -2432,10 +6277,74 @@
 	static BaseType_t prvSiteCmd( FTPClient_t * pxClient,
 								  char * pcRestCommand )
 	{
-		( void ) pxClient;
-		( void ) pcRestCommand;
+		BaseType_t xResult = pdFALSE;
 
-		return 0;
+		#if ( ipconfigFTP_STORE_CRC != 0 )
+			{
+				BaseType_t xLength;
+
+				if( strncasecmp( pcRestCommand, "CRCCHECK ", 9 ) == 0 )
+				{
+					const char * pcHex = pcRestCommand + 9;
+					char * pcEnd;
+					unsigned long ulCrc;
+
+					/* "SITE CRCCHECK 1A2B3C4D": the CRC of the next upload. */
+					while( *pcHex == ' ' )
+					{
+						pcHex++;
+					}
+
+					ulCrc = strtoul( pcHex, &pcEnd, 16 );
+
+					/* Exactly one hexadecimal number of at most 8 digits, no sign. */
+					if( ( isxdigit( ( unsigned char ) *pcHex ) == 0 ) || ( ( pcEnd - pcHex ) > 8 ) ||
+						( ( *pcEnd != '\0' ) && ( *pcEnd != ' ' ) && ( *pcEnd != '\r' ) && ( *pcEnd != '\n' ) ) )
+					{
+						pxClient->bits.bExpectCrc = pdFALSE_UNSIGNED;
+						prvSendReply( pxClient->xSocket, REPL_501, 0 );
+					}
+					else
+					{
+						pxClient->ulExpectCrc = ( uint32_t ) ulCrc;
+						pxClient->bits.bExpectCrc = pdTRUE_UNSIGNED;
+						xLength = snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ),
+											"200 Next STOR must have CRC32 %08lX\r\n", ( unsigned long ) pxClient->ulExpectCrc );
+						prvSendReply( pxClient->xSocket, pcCOMMAND_BUFFER, xLength );
+					}
+
+					xResult = pdTRUE;
+				}
+				else if( ( strncasecmp( pcRestCommand, "CRC", 3 ) == 0 ) &&
+						 ( ( pcRestCommand[ 3 ] == '\0' ) || ( pcRestCommand[ 3 ] == ' ' ) ) )
+				{
+					pcRestCommand += 3;
+
+					while( *pcRestCommand == ' ' )
+					{
+						pcRestCommand++;
+					}
+
+					prvSiteCrc( pxClient, pcRestCommand );
+					xResult = pdTRUE;
+				}
+			}
+		#else /* if ( ipconfigFTP_STORE_CRC != 0 ) */
+			{
+				( void ) pxClient;
+				( void ) pcRestCommand;
+			}
+		#endif /* if ( ipconfigFTP_STORE_CRC != 0 ) */
+
+		#if ( ipconfigFTP_HAS_STATS != 0 )
+			if( ( xResult == pdFALSE ) && ( strcasecmp( pcRestCommand, "STATS" ) == 0 ) )
+			{
+				prvSiteStats( pxClient );
+				xResult = pdTRUE;
+			}
+		#endif
+
+		return xResult;
 	}
 /*-----------------------------------------------------------*/
 
@@ -2467,6 +6376,11 @@
 			xLength = snprintf( pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ),
 								"250 File \"%s\" removed\r\n", pxClient->pcFileName );
 			xResult = pdTRUE;
+			#if ( ipconfigUSE_HTTP != 0 ) && ( ipconfigHTTP_CACHE_COUNT > 0 )
+				{
+					FreeRTOS_HTTPCacheChanged();
+				}
+			#endif
 		}
 		else
 		{
@@ -2541,7 +6455,28 @@
 		if( ( pcPtr != NULL ) && ( pcPtr[ 1 ] != '\0' ) )
 		{
 			FF_Stat_t xStatBuf;
-			int32_t iRc = ff_stat( pxClient->pcFileName, &xStatBuf );
+			int32_t iRc;
+
+			#if ( ipconfigFTP_MEMORY_SOURCE_COUNT > 0 )
+				FTPSourceSlot_t * pxSlot = prvMemorySourceFind( pxClient, pxClient->pcFileName, pdFALSE );
+
+				if( pxSlot != NULL )
+				{
+					/* A memory source, fill in the fields that are used below. */
+					memset( &xStatBuf, '\0', sizeof( xStatBuf ) );
+					xStatBuf.st_size = ( uint32_t ) pxSlot->xSource.uxSize;
+					#if ( ffconfigTIME_SUPPORT != 0 )
+						{
+							xStatBuf.st_mtime = pxSlot->ulModified;
+						}
+					#endif
+					iRc = 0;
+				}
+				else
+			#endif
+			{
+				iRc = ff_stat( pxClient->pcFileName, &xStatBuf );
+			}
 
 			if( iRc < 0 )
 			{
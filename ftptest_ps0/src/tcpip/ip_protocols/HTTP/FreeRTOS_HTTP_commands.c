@@ -53,26 +53,50 @@ const char * webCodename( int aCode )
 		case WEB_REPLY_OK: /*  = 200, */
 			return "OK";
 
+		case WEB_CREATED: /* 201 */
+			return "Created";
+
 		case WEB_NO_CONTENT: /* 204 */
 			return "No content";
 
+		case WEB_PARTIAL_CONTENT: /* 206 */
+			return "Partial Content";
+
+		case WEB_NOT_MODIFIED: /* 304 */
+			return "Not Modified";
+
 		case WEB_BAD_REQUEST: /*  = 400, */
 			return "Bad request";
 
 		case WEB_UNAUTHORIZED: /*  = 401, */
 			return "Authorization Required";
 
+		case WEB_FORBIDDEN: /* 403 */
+			return "Forbidden";
+
 		case WEB_NOT_FOUND: /*  = 404, */
 			return "Not Found";
 
 		case WEB_GONE: /*  = 410, */
 			return "Done";
 
+		case WEB_LENGTH_REQUIRED: /* 411 */
+			return "Length Required";
+
 		case WEB_PRECONDITION_FAILED: /*  = 412, */
 			return "Precondition Failed";
 
+		case WEB_PAYLOAD_TOO_LARGE: /* 413 */
+			return "Payload Too Large";
+
+		case WEB_RANGE_NOT_SATISFIABLE: /*  = 416, */
+			return "Range Not Satisfiable";
+
 		case WEB_INTERNAL_SERVER_ERROR: /*  = 500, */
 			return "Internal Server Error";
+
+		case WEB_NOT_IMPLEMENTED: /*  = 501, */
+			return "Not Implemented";
 	}
 
 	return "Unknown";
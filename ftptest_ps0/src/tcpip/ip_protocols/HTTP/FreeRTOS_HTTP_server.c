@@ -34,6 +34,7 @@
 /* FreeRTOS+TCP includes. */
 #include "FreeRTOS_IP.h"
 #include "FreeRTOS_Sockets.h"
+#include "FreeRTOS_TCP_IP.h"
 
 /* FreeRTOS Protocol includes. */
 #include "FreeRTOS_HTTP_commands.h"
@@ -67,41 +68,369 @@
 		#define ipconfigHTTP_REQUEST_CHARACTER	  '?'
 	#endif
 
+/*
+ * ipconfigHTTP_PIPELINE_COUNT : the maximum number of requests that are
+ * answered in one call to xHTTPClientWork().  Browsers may send several
+ * requests on a connection without waiting for the replies.
+ */
+	#ifndef ipconfigHTTP_PIPELINE_COUNT
+		#define ipconfigHTTP_PIPELINE_COUNT    8
+	#endif
+
+/*
+ * ipconfigHTTP_KEEP_ALIVE_MAX : the number of requests after which a
+ * persistent connection is closed, so that one browser can not hold on to
+ * a client forever.
+ */
+	#ifndef ipconfigHTTP_KEEP_ALIVE_MAX
+		#define ipconfigHTTP_KEEP_ALIVE_MAX    100
+	#endif
+
+/* A request is only taken when the TX stream has space for the header of its
+ * reply, which is never longer than this. */
+	#define httpREPLY_HEADER_SIZE    ( 384 )
+
+/* Separates the parts of a multipart/byteranges reply. */
+	#define httpRANGE_BOUNDARY       "FreeRTOS_HTTP_byteranges"
+
+/* Space for the header of one part of a multipart/byteranges reply. */
+	#define httpRANGE_PART_SIZE      ( 192 )
+
+/* True while a multipart/byteranges reply has part headers or the final
+ * boundary to send. */
+	#define httpRANGE_PARTS_LEFT( pxClient ) \
+	( ( ( pxClient )->xRangeCount > 1 ) && ( ( pxClient )->xRangeIndex <= ( pxClient )->xRangeCount ) )
+
+/* The size of an ETag: three hexadecimal numbers in quotes. */
+	#define httpETAG_SIZE            32
+
+/* The size of the header lines written by prvFileHeaders(). */
+	#define httpFILE_HEADERS_SIZE    160
+
+/* True while a reply is being sent from a file or from the cache, or while
+ * the body of a request is being stored. */
+	#if ( ipconfigHTTP_CACHE_COUNT > 0 )
+		#define httpCACHE_BUSY( pxClient )    ( ( pxClient )->pxCacheEntry != NULL )
+	#else
+		#define httpCACHE_BUSY( pxClient )    pdFALSE
+	#endif
+
+	#if ( ipconfigHTTP_HAS_UPLOAD != 0 )
+		#define httpUPLOAD_BUSY( pxClient )    ( ( pxClient )->pxWriteHandle != NULL )
+	#else
+		#define httpUPLOAD_BUSY( pxClient )    pdFALSE
+	#endif
+
+	#define httpREPLY_BUSY( pxClient ) \
+	( ( ( pxClient )->pxFileHandle != NULL ) || httpCACHE_BUSY( pxClient ) || httpUPLOAD_BUSY( pxClient ) )
+
+/* The states of a chunked request body, see prvUploadWork(). */
+	#define httpCHUNK_SIZE         0    /* A line with the size of the next chunk. */
+	#define httpCHUNK_DATA_END     1    /* The empty line after the data of a chunk. */
+	#define httpCHUNK_TRAILER      2    /* Header lines after the last chunk, up to an empty line. */
+
+/* The longest line with the size of a chunk, including extensions. */
+	#define httpCHUNK_LINE_SIZE    80
+
+/* Passed to prvUploadDone() when the connection was lost during an upload. */
+	#define httpUPLOAD_LOST        ( -1 )
+
+/* Remember that a request came in, or that a transfer made progress, see
+ * ipconfigHTTP_IDLE_TIMEOUT_MS. */
+	#if ( ipconfigHTTP_IDLE_TIMEOUT_MS > 0 )
+		#define httpACTIVITY( pxClient )    ( ( pxClient )->xLastActivity = xTaskGetTickCount() )
+	#else
+		#define httpACTIVITY( pxClient )    ( ( void ) ( pxClient ) )
+	#endif
+
+	#if ( ipconfigHTTP_CACHE_COUNT > 0 )
+
+/* A small file, together with the header of a '200 OK' reply. */
+		typedef struct xHTTP_CACHE_ENTRY
+		{
+			char pcFileName[ ffconfigMAX_FILENAME ];
+			uint8_t * pucData;     /* The header, followed by the contents of the file. */
+			size_t uxHeaderLength; /* The length of the header. */
+			size_t uxLength;       /* The length of the header and the file. */
+			uint32_t ulSize;       /* The size, cluster and time of the file, to */
+			uint32_t ulCluster;    /* see if it has changed. */
+			uint32_t ulModified;
+			uint32_t ulGeneration; /* The value of prvCacheGeneration() when it was last checked. */
+			TickType_t xLastUsed;
+			BaseType_t xUsers;     /* The number of clients sending from pucData. */
+			BaseType_t xValid;     /* pdFALSE once the file has changed, pucData is freed by the last user. */
+		} HTTPCacheEntry_t;
+
+		static HTTPCacheEntry_t xHTTPCache[ ipconfigHTTP_CACHE_COUNT ];
+
+/* Incremented by FreeRTOS_HTTPCacheChanged(). */
+		static volatile uint32_t ulCacheGeneration = 1u;
+	#endif /* ipconfigHTTP_CACHE_COUNT > 0 */
+
 /*_RB_ Need comment block, although fairly self evident. */
 	static void prvFileClose( HTTPClient_t * pxClient );
+	static BaseType_t prvFindCommand( const char * pcCommand,
+									  BaseType_t xLength );
 	static BaseType_t prvProcessCmd( HTTPClient_t * pxClient,
 									 BaseType_t xIndex );
-	static const char * pcGetContentsType( const char * apFname );
+
+/*
+ * The Content-Type of the file being sent, also when it is the '.gz'
+ * version of the requested file.
+ */
+	static const char * prvContentsType( HTTPClient_t * pxClient );
+
+/*
+ * The header lines that are specific to the file that is sent: validators
+ * and encoding.
+ */
+	static void prvFileHeaders( HTTPClient_t * pxClient,
+								char * pcBuffer,
+								size_t uxBufferSize );
+
 	static BaseType_t prvOpenURL( HTTPClient_t * pxClient );
+
+/*
+ * Make pcCurrentFilename from the root directory and the URL.  Returns pdFALSE
+ * when the URL contains "..", which might lead outside the root directory.
+ */
+	static BaseType_t prvMakeFilename( HTTPClient_t * pxClient );
 	static BaseType_t prvSendFile( HTTPClient_t * pxClient );
 	static BaseType_t prvSendReply( HTTPClient_t * pxClient,
 									BaseType_t xCode );
 
+/*
+ * Take one complete request, up to and including the empty line after the
+ * header, from the socket.  Returns 0 when the request is not complete yet.
+ */
+	static BaseType_t prvReceiveRequest( HTTPClient_t * pxClient );
+
+/*
+ * Split a request in method, URL and header lines, and process it.
+ */
+	static BaseType_t prvHandleRequest( HTTPClient_t * pxClient,
+										char * pcBuffer,
+										BaseType_t xRc );
+
+/*
+ * Find a header line of the current request, returns a pointer to the value,
+ * which ends at a CR or LF, or NULL when it is not present.
+ */
+	static const char * prvFindHeader( HTTPClient_t * pxClient,
+									   const char * pcName );
+
+/*
+ * The reply to a request has been queued entirely: close the connection
+ * unless it is persistent.
+ */
+	static void prvRequestDone( HTTPClient_t * pxClient );
+
+/*
+ * Select the events that let the client make progress.  The events are
+ * level-triggered: a condition that the client can not act upon, like a
+ * pipelined request while a reply is being sent, must not be selected.
+ */
+	static void prvSelectUpdate( HTTPClient_t * pxClient );
+
+/*
+ * Do not report eSELECT_READ before this number of bytes can be read, e.g.
+ * one more than the incomplete header that is waiting in the RX stream.
+ */
+	static void prvSetRxLowWater( HTTPClient_t * pxClient,
+								  size_t uxLowWater );
+
+	#if ( ipconfigHTTP_MAX_RANGES > 0 )
+
+/*
+ * Parse the 'Range' header of a GET request.  Returns the number of
+ * satisfiable ranges, 0 when the whole file must be sent, or -1 when none of
+ * the ranges lies within the file.
+ */
+		static BaseType_t prvRangeParse( HTTPClient_t * pxClient,
+										 uint32_t ulFileSize );
+
+/*
+ * Prepare the header and the first range of a reply to a GET request, and
+ * return the status code: 200, 206 or 416.
+ */
+		static BaseType_t prvRangeStart( HTTPClient_t * pxClient );
+
+/*
+ * Format the boundary and header of part xIndex of a multipart/byteranges
+ * reply, or the final boundary when xIndex equals xRangeCount.
+ */
+		static BaseType_t prvRangePart( HTTPClient_t * pxClient,
+										BaseType_t xIndex,
+										char * pcBuffer,
+										size_t uxBufferSize );
+
+/*
+ * Send the next part header of a multipart/byteranges reply and seek to
+ * its data.  Returns 0 when the TX stream has no space for it yet.
+ */
+		static BaseType_t prvRangeNext( HTTPClient_t * pxClient );
+	#endif /* ipconfigHTTP_MAX_RANGES > 0 */
+
+	#if ( ipconfigHTTP_CACHE_COUNT > 0 )
+
+/*
+ * The cache can only be used for complete files on persistent connections.
+ */
+		static BaseType_t prvCacheUsable( HTTPClient_t * pxClient );
+
+/*
+ * Look up pcCurrentFilename in the cache.  When files have been changed, the
+ * entry is compared with the file on disk first.
+ */
+		static BaseType_t prvCacheFind( HTTPClient_t * pxClient );
+
+/*
+ * A number that changes whenever a file on the disk of pcCurrentFilename may
+ * have changed, see ulGeneration.
+ */
+		static uint32_t prvCacheGeneration( HTTPClient_t * pxClient );
+
+/*
+ * A small file has just been opened: read it into a new cache entry, and
+ * close it.  Returns pdFALSE when the file is to be sent normally.
+ */
+		static BaseType_t prvCacheFill( HTTPClient_t * pxClient );
+
+/*
+ * Send a reply from the cache entry of the client.
+ */
+		static BaseType_t prvCacheSend( HTTPClient_t * pxClient );
+
+/*
+ * A client has finished sending from an entry.  With xInvalidate, the entry
+ * will be freed as soon as no client uses it.
+ */
+		static void prvCacheRelease( HTTPCacheEntry_t * pxEntry,
+									 BaseType_t xInvalidate );
+	#endif /* ipconfigHTTP_CACHE_COUNT > 0 */
+
+	#if ( ipconfigHTTP_HAS_VALIDATORS != 0 )
+
+/*
+ * Format the ETag of a file, including the quotes.
+ */
+		static BaseType_t prvETagFormat( const FF_Stat_t * pxStatBuf,
+										 char * pcBuffer,
+										 size_t uxBufferSize );
+
+/*
+ * Store the ETag and Last-Modified header lines of a file in pcValidators.
+ */
+		static void prvValidatorsMake( HTTPClient_t * pxClient,
+									   const FF_Stat_t * pxStatBuf );
+
+		#if ( ffconfigTIME_SUPPORT != 0 )
+
+/*
+ * Convert the date of an If-Modified-Since header to seconds after 1-1-1970.
+ */
+			static BaseType_t prvDateParse( const char * pcDate,
+											uint32_t * pulSeconds );
+		#endif
+
+/*
+ * Check If-None-Match and If-Modified-Since against the directory entry of
+ * the requested file.  Returns pdTRUE when a '304 Not Modified' is to be sent.
+ */
+		static BaseType_t prvNotModified( HTTPClient_t * pxClient );
+	#endif /* ipconfigHTTP_HAS_VALIDATORS */
+
+	#if ( ipconfigHTTP_HAS_GZIP != 0 )
+
+/*
+ * True when the Accept-Encoding header of the request lists gzip.
+ */
+		static BaseType_t prvGzipAccepted( HTTPClient_t * pxClient );
+
+/*
+ * Append '.gz' to pcCurrentFilename if the client accepts gzip, the type of
+ * file is worth compressing and the compressed version exists.
+ */
+		static void prvGzipSelect( HTTPClient_t * pxClient );
+	#endif /* ipconfigHTTP_HAS_GZIP */
+
+	#if ( ipconfigHTTP_HAS_UPLOAD != 0 )
+
+/*
+ * PUT or POST: open the file and start storing the body of the request.
+ */
+		static BaseType_t prvUploadStart( HTTPClient_t * pxClient );
+
+/*
+ * The body is stored in a temporary file in the directory of the target,
+ * which replaces the target once it is complete.  Returns pdFALSE when the
+ * name does not fit.
+ */
+		static BaseType_t prvUploadTempName( HTTPClient_t * pxClient,
+											 char * pcBuffer,
+											 size_t uxBufferSize );
+
+/*
+ * Store the available part of the body.  The reply is sent once the whole
+ * body has been received.
+ */
+		static void prvUploadWork( HTTPClient_t * pxClient );
+
+/*
+ * Take a single line of a chunked body from the socket, without the line
+ * ending.  Returns 0 when the line is not complete yet, and -1 when it is
+ * too long or the connection is lost.
+ */
+		static BaseType_t prvUploadLine( HTTPClient_t * pxClient,
+										 char * pcLine,
+										 size_t uxSize );
+
+/*
+ * Close the file of an upload and send the reply with the status xCode.  A
+ * complete upload replaces the target, a failed upload is removed.
+ */
+		static BaseType_t prvUploadDone( HTTPClient_t * pxClient,
+										 BaseType_t xCode );
+	#endif /* ipconfigHTTP_HAS_UPLOAD */
+
 	static const char pcEmptyString[ 1 ] = { '\0' };
 
+/* A perfect hash of the verbs in xWebCommands[], see xTCPServerHashBuild(). */
+	static CommandHash_t xWebCommandHash;
+
 	typedef struct xTYPE_COUPLE
 	{
 		const char * pcExtension;
 		const char * pcType;
+		BaseType_t xCompress; /* Look for a '.gz' version, see prvGzipSelect(). */
 	} TypeCouple_t;
 
 	static TypeCouple_t pxTypeCouples[] =
 	{
-		{ "html", "text/html"			   },
-		{ "css",  "text/css"			   },
-		{ "js",	  "text/javascript"		   },
-		{ "png",  "image/png"			   },
-		{ "jpg",  "image/jpeg"			   },
-		{ "gif",  "image/gif"			   },
-		{ "txt",  "text/plain"			   },
-		{ "mp3",  "audio/mpeg3"			   },
-		{ "wav",  "audio/wav"			   },
-		{ "flac", "audio/ogg"			   },
-		{ "pdf",  "application/pdf"		   },
-		{ "ttf",  "application/x-font-ttf" },
-		{ "ttc",  "application/x-font-ttf" }
+		{ "html", "text/html",			    pdTRUE  },
+		{ "css",  "text/css",			    pdTRUE  },
+		{ "js",	  "text/javascript",	    pdTRUE  },
+		{ "json", "application/json",	    pdTRUE  },
+		{ "svg",  "image/svg+xml",		    pdTRUE  },
+		{ "png",  "image/png",			    pdFALSE },
+		{ "jpg",  "image/jpeg",			    pdFALSE },
+		{ "gif",  "image/gif",			    pdFALSE },
+		{ "txt",  "text/plain",			    pdTRUE  },
+		{ "mp3",  "audio/mpeg3",		    pdFALSE },
+		{ "wav",  "audio/wav",			    pdFALSE },
+		{ "flac", "audio/ogg",			    pdFALSE },
+		{ "pdf",  "application/pdf",	    pdFALSE },
+		{ "ttf",  "application/x-font-ttf", pdTRUE  },
+		{ "ttc",  "application/x-font-ttf", pdTRUE  }
 	};
 
+/*
+ * Look up the extension of the first uxLength characters of a file name in
+ * pxTypeCouples[], returns NULL when it is not known.
+ */
+	static const TypeCouple_t * pxFindTypeCouple( const char * pcName,
+												  size_t uxLength );
+
 	void vHTTPClientDelete( TCPClient_t * pxTCPClient )
 	{
 		HTTPClient_t * pxClient = ( HTTPClient_t * ) pxTCPClient;
@@ -115,6 +444,22 @@
 		}
 
 		prvFileClose( pxClient );
+
+		#if ( ipconfigHTTP_CACHE_COUNT > 0 )
+			if( pxClient->pxCacheEntry != NULL )
+			{
+				prvCacheRelease( pxClient->pxCacheEntry, pdFALSE );
+				pxClient->pxCacheEntry = NULL;
+			}
+		#endif
+
+		#if ( ipconfigHTTP_HAS_UPLOAD != 0 )
+			if( pxClient->pxWriteHandle != NULL )
+			{
+				/* The socket is closed already, no reply is sent. */
+				prvUploadDone( pxClient, httpUPLOAD_LOST );
+			}
+		#endif
 	}
 /*-----------------------------------------------------------*/
 
@@ -133,26 +478,37 @@
 									BaseType_t xCode )
 	{
 		struct xTCP_SERVER * pxParent = pxClient->pxParent;
+		char pcFileHeaders[ httpFILE_HEADERS_SIZE ];
 		BaseType_t xRc;
 
 		/* A normal command reply on the main socket (port 21). */
 		char * pcBuffer = pxParent->pcFileBuffer;
 
+		prvFileHeaders( pxClient, pcFileHeaders, sizeof( pcFileHeaders ) );
+
 		xRc = snprintf( pcBuffer, sizeof( pxParent->pcFileBuffer ),
 						"HTTP/1.1 %d %s\r\n"
 						#if USE_HTML_CHUNKS
 							"Transfer-Encoding: chunked\r\n"
 						#endif
 						"Content-Type: %s\r\n"
-						"Connection: keep-alive\r\n"
+						"Connection: %s\r\n"
+						"%s"
 						"%s\r\n",
 						( int ) xCode,
 						webCodename( xCode ),
 						pxParent->pcContentsType[ 0 ] ? pxParent->pcContentsType : "text/html",
+						( pxClient->bits.bKeepAlive != pdFALSE_UNSIGNED ) ? "keep-alive" : "close",
+						pcFileHeaders,
 						pxParent->pcExtraContents );
 
 		pxParent->pcContentsType[ 0 ] = '\0';
 		pxParent->pcExtraContents[ 0 ] = '\0';
+		#if ( ipconfigHTTP_HAS_VALIDATORS != 0 )
+			{
+				pxClient->pcValidators[ 0 ] = '\0';
+			}
+		#endif
 
 		xRc = FreeRTOS_send( pxClient->xSocket, ( const void * ) pcBuffer, xRc, 0 );
 		pxClient->bits.bReplySent = pdTRUE_UNSIGNED;
@@ -169,20 +525,68 @@
 
 		if( pxClient->bits.bReplySent == pdFALSE_UNSIGNED )
 		{
+			BaseType_t xCode = WEB_REPLY_OK;
+
 			pxClient->bits.bReplySent = pdTRUE_UNSIGNED;
 
-			strcpy( pxClient->pxParent->pcContentsType, pcGetContentsType( pxClient->pcCurrentFilename ) );
-			snprintf( pxClient->pxParent->pcExtraContents, sizeof( pxClient->pxParent->pcExtraContents ),
-					  "Content-Length: %d\r\n", ( int ) pxClient->uxBytesLeft );
+			strcpy( pxClient->pxParent->pcContentsType, prvContentsType( pxClient ) );
+
+			#if ( ipconfigHTTP_HAS_VALIDATORS != 0 )
+				{
+					FF_Stat_t xStatBuf;
+
+					/* Unless a conditional request has looked them up already. */
+					if( ( pxClient->pcValidators[ 0 ] == '\0' ) &&
+						( ff_stat( pxClient->pcCurrentFilename, &xStatBuf ) == 0 ) )
+					{
+						prvValidatorsMake( pxClient, &xStatBuf );
+					}
+				}
+			#endif
+
+			#if ( ipconfigHTTP_MAX_RANGES > 0 )
+				{
+					xCode = prvRangeStart( pxClient );
+				}
+			#else
+				{
+					snprintf( pxClient->pxParent->pcExtraContents, sizeof( pxClient->pxParent->pcExtraContents ),
+							  "Content-Length: %d\r\n", ( int ) pxClient->uxBytesLeft );
+				}
+			#endif
 
 			/* "Requested file action OK". */
-			xRc = prvSendReply( pxClient, WEB_REPLY_OK );
+			xRc = prvSendReply( pxClient, xCode );
+
+			if( ( pxClient->bits.bHeadOnly != pdFALSE_UNSIGNED ) || ( xCode == WEB_RANGE_NOT_SATISFIABLE ) )
+			{
+				/* HEAD: the length is announced, but the file is not sent. */
+				pxClient->uxBytesLeft = 0u;
+				#if ( ipconfigHTTP_MAX_RANGES > 0 )
+					{
+						pxClient->xRangeCount = 0;
+					}
+				#endif
+			}
 		}
 
 		if( xRc >= 0 )
 		{
 			do
 			{
+				#if ( ipconfigHTTP_MAX_RANGES > 0 )
+					if( ( pxClient->uxBytesLeft == 0u ) && httpRANGE_PARTS_LEFT( pxClient ) )
+					{
+						/* The next part of a multipart/byteranges reply. */
+						xRc = prvRangeNext( pxClient );
+
+						if( xRc <= 0 )
+						{
+							break;
+						}
+					}
+				#endif
+
 				uxSpace = FreeRTOS_tx_space( pxClient->xSocket );
 
 				if( pxClient->uxBytesLeft < uxSpace )
@@ -194,6 +598,10 @@
 					uxCount = uxSpace;
 				}
 
+				/* Stop when this client has used its share, eSELECT_WRITE will
+				 * bring it back. */
+				uxCount = FreeRTOS_min_uint32( uxCount, uxTCPServerBudget( ( TCPClient_t * ) pxClient ) );
+
 				if( uxCount > 0u )
 				{
 					if( uxCount > sizeof( pxClient->pxParent->pcFileBuffer ) )
@@ -210,101 +618,1449 @@
 					{
 						break;
 					}
+
+					vTCPServerBudgetUse( ( TCPClient_t * ) pxClient, uxCount );
+					httpACTIVITY( pxClient );
 				}
-			} while( uxCount > 0u );
+			#if ( ipconfigHTTP_MAX_RANGES > 0 )
+				} while( ( uxCount > 0u ) || ( ( pxClient->uxBytesLeft == 0u ) && httpRANGE_PARTS_LEFT( pxClient ) ) );
+			#else
+				} while( uxCount > 0u );
+			#endif
 		}
 
+		/* While the file is open, prvSelectUpdate() waits for eSELECT_WRITE:
+		 * for more space in the TX stream. */
+		#if ( ipconfigHTTP_MAX_RANGES > 0 )
+			if( httpRANGE_PARTS_LEFT( pxClient ) )
+			{
+				/* More parts to send. */
+			}
+			else
+		#endif
 		if( pxClient->uxBytesLeft == 0u )
 		{
-			/* Writing is ready, no need for further 'eSELECT_WRITE' events. */
-			FreeRTOS_FD_CLR( pxClient->xSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
 			prvFileClose( pxClient );
 		}
-		else
-		{
-			/* Wake up the TCP task as soon as this socket may be written to. */
-			FreeRTOS_FD_SET( pxClient->xSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
-		}
 
 		return xRc;
 	}
 /*-----------------------------------------------------------*/
 
-	static BaseType_t prvOpenURL( HTTPClient_t * pxClient )
-	{
-		BaseType_t xRc;
-		char pcSlash[ 2 ];
+	#if ( ipconfigHTTP_MAX_RANGES > 0 )
 
-		pxClient->bits.ulFlags = 0;
+		static BaseType_t prvRangeParse( HTTPClient_t * pxClient,
+										 uint32_t ulFileSize )
+		{
+			const char * pcValue = prvFindHeader( pxClient, "Range" );
+			char * pcEnd;
+			uint32_t ulFirst, ulLast;
+			BaseType_t xCount = 0;
+			BaseType_t xValid = pdTRUE;
 
-		#if ( ipconfigHTTP_HAS_HANDLE_REQUEST_HOOK != 0 )
+			if( ( pcValue == NULL ) || ( strncasecmp( pcValue, "bytes=", 6 ) != 0 ) )
 			{
-				if( strchr( pxClient->pcUrlData, ipconfigHTTP_REQUEST_CHARACTER ) != NULL )
+				/* No range, or a unit other than bytes: send the whole file. */
+				xValid = pdFALSE;
+			}
+			else
+			{
+				pcValue += 6;
+			}
+
+			while( xValid != pdFALSE )
+			{
+				BaseType_t xSatisfiable = pdFALSE;
+
+				while( ( *pcValue == ' ' ) || ( *pcValue == '\t' ) )
 				{
-					size_t xResult;
+					pcValue++;
+				}
 
-					xResult = uxApplicationHTTPHandleRequestHook( pxClient->pcUrlData, pxClient->pcCurrentFilename, sizeof( pxClient->pcCurrentFilename ) );
+				if( *pcValue == '-' )
+				{
+					/* "-500": the last 500 bytes of the file. */
+					ulLast = ( uint32_t ) strtoul( pcValue + 1, &pcEnd, 10 );
 
-					if( xResult > 0 )
+					if( pcEnd == pcValue + 1 )
 					{
-						strcpy( pxClient->pxParent->pcContentsType, "text/html" );
-						snprintf( pxClient->pxParent->pcExtraContents, sizeof( pxClient->pxParent->pcExtraContents ),
-								  "Content-Length: %d\r\n", ( int ) xResult );
-						xRc = prvSendReply( pxClient, WEB_REPLY_OK ); /* "Requested file action OK" */
+						xValid = pdFALSE;
+						break;
+					}
 
-						if( xRc > 0 )
+					if( ( ulLast != 0u ) && ( ulFileSize != 0u ) )
+					{
+						ulFirst = ulFileSize - FreeRTOS_min_uint32( ulLast, ulFileSize );
+						ulLast = ulFileSize - 1u;
+						xSatisfiable = pdTRUE;
+					}
+				}
+				else if( ( *pcValue >= '0' ) && ( *pcValue <= '9' ) )
+				{
+					/* "500-999", or "500-" until the end of the file. */
+					ulFirst = ( uint32_t ) strtoul( pcValue, &pcEnd, 10 );
+
+					if( *pcEnd != '-' )
+					{
+						xValid = pdFALSE;
+						break;
+					}
+
+					pcValue = pcEnd + 1;
+
+					if( ( *pcValue >= '0' ) && ( *pcValue <= '9' ) )
+					{
+						ulLast = ( uint32_t ) strtoul( pcValue, &pcEnd, 10 );
+
+						if( ulLast < ulFirst )
 						{
-							xRc = FreeRTOS_send( pxClient->xSocket, pxClient->pcCurrentFilename, xResult, 0 );
+							xValid = pdFALSE;
+							break;
 						}
+					}
+					else
+					{
+						ulLast = ~0ul;
+						pcEnd = ( char * ) pcValue;
+					}
 
-						/* Although against the coding standard of FreeRTOS, a return is
-						 * done here  to simplify this conditional code. */
-						return xRc;
+					if( ulFirst < ulFileSize )
+					{
+						ulLast = FreeRTOS_min_uint32( ulLast, ulFileSize - 1u );
+						xSatisfiable = pdTRUE;
 					}
 				}
-			}
-		#endif /* ipconfigHTTP_HAS_HANDLE_REQUEST_HOOK */
+				else
+				{
+					xValid = pdFALSE;
+					break;
+				}
 
-		if( pxClient->pcUrlData[ 0 ] != '/' )
-		{
-			/* Insert a slash before the file name. */
-			pcSlash[ 0 ] = '/';
-			pcSlash[ 1 ] = '\0';
-		}
-		else
-		{
-			/* The browser provided a starting '/' already. */
-			pcSlash[ 0 ] = '\0';
-		}
+				if( xSatisfiable != pdFALSE )
+				{
+					if( xCount >= ipconfigHTTP_MAX_RANGES )
+					{
+						/* Too many ranges, the whole file will be sent. */
+						xValid = pdFALSE;
+						break;
+					}
 
-		snprintf( pxClient->pcCurrentFilename, sizeof( pxClient->pcCurrentFilename ), "%s%s%s",
-				  pxClient->pcRootDir,
-				  pcSlash,
-				  pxClient->pcUrlData );
+					pxClient->xRanges[ xCount ].ulFirst = ulFirst;
+					pxClient->xRanges[ xCount ].ulLast = ulLast;
+					xCount++;
+				}
 
-		pxClient->pxFileHandle = ff_fopen( pxClient->pcCurrentFilename, "rb" );
+				pcValue = pcEnd;
 
-		FreeRTOS_printf( ( "Open file '%s': %s\n", pxClient->pcCurrentFilename,
-						   pxClient->pxFileHandle != NULL ? "Ok" : strerror( stdioGET_ERRNO() ) ) );
+				while( ( *pcValue == ' ' ) || ( *pcValue == '\t' ) )
+				{
+					pcValue++;
+				}
 
-		if( pxClient->pxFileHandle == NULL )
-		{
-			strcpy( pxClient->pxParent->pcExtraContents, "Content-Length: 0\r\n" );
-			/* "404 File not found". */
-			xRc = prvSendReply( pxClient, WEB_NOT_FOUND );
-		}
-		else
-		{
-			pxClient->uxBytesLeft = ( size_t ) pxClient->pxFileHandle->ulFileSize;
-			xRc = prvSendFile( pxClient );
-		}
+				if( *pcValue != ',' )
+				{
+					break;
+				}
 
-		return xRc;
-	}
-/*-----------------------------------------------------------*/
+				pcValue++;
+			}
 
-	static BaseType_t prvProcessCmd( HTTPClient_t * pxClient,
-									 BaseType_t xIndex )
+			if( ( xValid != pdFALSE ) && ( *pcValue != '\0' ) && ( *pcValue != '\r' ) && ( *pcValue != '\n' ) )
+			{
+				/* Garbage after the last range. */
+				xValid = pdFALSE;
+			}
+
+			if( xValid == pdFALSE )
+			{
+				/* A header that can not be parsed is ignored. */
+				xCount = 0;
+			}
+			else if( xCount == 0 )
+			{
+				/* None of the ranges overlaps with the file. */
+				xCount = -1;
+			}
+
+			return xCount;
+		}
+/*-----------------------------------------------------------*/
+
+		static BaseType_t prvRangeStart( HTTPClient_t * pxClient )
+		{
+			struct xTCP_SERVER * pxParent = pxClient->pxParent;
+			uint32_t ulFileSize = pxClient->pxFileHandle->ulFileSize;
+			BaseType_t xCode = WEB_PARTIAL_CONTENT;
+			BaseType_t xCount, xIndex;
+
+			pxClient->xRangeCount = 0;
+			pxClient->xRangeIndex = 0;
+			xCount = prvRangeParse( pxClient, ulFileSize );
+
+			if( xCount < 0 )
+			{
+				xCode = WEB_RANGE_NOT_SATISFIABLE;
+				snprintf( pxParent->pcExtraContents, sizeof( pxParent->pcExtraContents ),
+						  "Content-Range: bytes */%lu\r\n"
+						  "Content-Length: 0\r\n",
+						  ( unsigned long ) ulFileSize );
+			}
+			else if( xCount == 1 )
+			{
+				/* A single range is sent as the body, no parts are needed. */
+				ff_fseek( pxClient->pxFileHandle, ( long ) pxClient->xRanges[ 0 ].ulFirst, FF_SEEK_SET );
+				pxClient->uxBytesLeft = ( size_t ) ( pxClient->xRanges[ 0 ].ulLast - pxClient->xRanges[ 0 ].ulFirst + 1u );
+				snprintf( pxParent->pcExtraContents, sizeof( pxParent->pcExtraContents ),
+						  "Accept-Ranges: bytes\r\n"
+						  "Content-Range: bytes %lu-%lu/%lu\r\n"
+						  "Content-Length: %lu\r\n",
+						  ( unsigned long ) pxClient->xRanges[ 0 ].ulFirst,
+						  ( unsigned long ) pxClient->xRanges[ 0 ].ulLast,
+						  ( unsigned long ) ulFileSize,
+						  ( unsigned long ) pxClient->uxBytesLeft );
+			}
+			else if( xCount > 1 )
+			{
+				char pcPart[ httpRANGE_PART_SIZE ];
+				size_t uxLength = 0u;
+
+				/* The length of the body is calculated in advance, so that the
+				 * connection can stay open. */
+				pxClient->xRangeCount = xCount;
+
+				for( xIndex = 0; xIndex <= xCount; xIndex++ )
+				{
+					uxLength += ( size_t ) prvRangePart( pxClient, xIndex, pcPart, sizeof( pcPart ) );
+
+					if( xIndex < xCount )
+					{
+						uxLength += ( size_t ) ( pxClient->xRanges[ xIndex ].ulLast - pxClient->xRanges[ xIndex ].ulFirst + 1u );
+					}
+				}
+
+				/* The data follow the header of each part. */
+				pxClient->uxBytesLeft = 0u;
+				snprintf( pxParent->pcContentsType, sizeof( pxParent->pcContentsType ),
+						  "multipart/byteranges; boundary=%s", httpRANGE_BOUNDARY );
+				snprintf( pxParent->pcExtraContents, sizeof( pxParent->pcExtraContents ),
+						  "Accept-Ranges: bytes\r\n"
+						  "Content-Length: %lu\r\n",
+						  ( unsigned long ) uxLength );
+			}
+			else
+			{
+				xCode = WEB_REPLY_OK;
+				snprintf( pxParent->pcExtraContents, sizeof( pxParent->pcExtraContents ),
+						  "Accept-Ranges: bytes\r\n"
+						  "Content-Length: %lu\r\n",
+						  ( unsigned long ) ulFileSize );
+			}
+
+			return xCode;
+		}
+/*-----------------------------------------------------------*/
+
+		static BaseType_t prvRangePart( HTTPClient_t * pxClient,
+										BaseType_t xIndex,
+										char * pcBuffer,
+										size_t uxBufferSize )
+		{
+			BaseType_t xLength;
+
+			if( xIndex < pxClient->xRangeCount )
+			{
+				xLength = snprintf( pcBuffer, uxBufferSize,
+									"\r\n--%s\r\n"
+									"Content-Type: %s\r\n"
+									"Content-Range: bytes %lu-%lu/%lu\r\n\r\n",
+									httpRANGE_BOUNDARY,
+									prvContentsType( pxClient ),
+									( unsigned long ) pxClient->xRanges[ xIndex ].ulFirst,
+									( unsigned long ) pxClient->xRanges[ xIndex ].ulLast,
+									( unsigned long ) pxClient->pxFileHandle->ulFileSize );
+			}
+			else
+			{
+				xLength = snprintf( pcBuffer, uxBufferSize, "\r\n--%s--\r\n", httpRANGE_BOUNDARY );
+			}
+
+			return xLength;
+		}
+/*-----------------------------------------------------------*/
+
+		static BaseType_t prvRangeNext( HTTPClient_t * pxClient )
+		{
+			char pcPart[ httpRANGE_PART_SIZE ];
+			BaseType_t xIndex = pxClient->xRangeIndex;
+			BaseType_t xLength;
+			BaseType_t xRc = 0;
+
+			xLength = prvRangePart( pxClient, xIndex, pcPart, sizeof( pcPart ) );
+
+			if( FreeRTOS_tx_space( pxClient->xSocket ) >= xLength )
+			{
+				xRc = FreeRTOS_send( pxClient->xSocket, pcPart, xLength, 0 );
+
+				if( xRc > 0 )
+				{
+					if( xIndex < pxClient->xRangeCount )
+					{
+						ff_fseek( pxClient->pxFileHandle, ( long ) pxClient->xRanges[ xIndex ].ulFirst, FF_SEEK_SET );
+						pxClient->uxBytesLeft = ( size_t ) ( pxClient->xRanges[ xIndex ].ulLast - pxClient->xRanges[ xIndex ].ulFirst + 1u );
+					}
+
+					pxClient->xRangeIndex++;
+				}
+			}
+
+			return xRc;
+		}
+/*-----------------------------------------------------------*/
+
+	#endif /* ipconfigHTTP_MAX_RANGES > 0 */
+
+	#if ( ipconfigHTTP_CACHE_COUNT > 0 )
+
+		static BaseType_t prvCacheUsable( HTTPClient_t * pxClient )
+		{
+			/* The cached header says "keep-alive", and holds the whole file. */
+			BaseType_t xResult = ( pxClient->bits.bKeepAlive != pdFALSE_UNSIGNED ) ? pdTRUE : pdFALSE;
+
+			#if ( ipconfigHTTP_MAX_RANGES > 0 )
+				if( prvFindHeader( pxClient, "Range" ) != NULL )
+				{
+					xResult = pdFALSE;
+				}
+			#endif
+
+			return xResult;
+		}
+/*-----------------------------------------------------------*/
+
+		static BaseType_t prvCacheFind( HTTPClient_t * pxClient )
+		{
+			HTTPCacheEntry_t * pxEntry = NULL;
+			uint32_t ulGeneration = prvCacheGeneration( pxClient );
+			FF_Stat_t xStatBuf;
+			BaseType_t xIndex;
+
+			if( prvCacheUsable( pxClient ) != pdFALSE )
+			{
+				/* The cache is shared by the workers of the server. */
+				vTaskSuspendAll();
+				{
+					for( xIndex = 0; xIndex < ipconfigHTTP_CACHE_COUNT; xIndex++ )
+					{
+						if( ( xHTTPCache[ xIndex ].pucData != NULL ) &&
+							( xHTTPCache[ xIndex ].xValid != pdFALSE ) &&
+							( strcmp( xHTTPCache[ xIndex ].pcFileName, pxClient->pcCurrentFilename ) == 0 ) )
+						{
+							pxEntry = &( xHTTPCache[ xIndex ] );
+							pxEntry->xUsers++;
+							pxEntry->xLastUsed = xTaskGetTickCount();
+							break;
+						}
+					}
+				}
+				( void ) xTaskResumeAll();
+			}
+
+			if( ( pxEntry != NULL ) && ( pxEntry->ulGeneration != ulGeneration ) )
+			{
+				/* Files have been changed since the entry was checked, see if
+				 * this one is still the same. */
+				if( ( ff_stat( pxClient->pcCurrentFilename, &xStatBuf ) == 0 ) &&
+					( xStatBuf.st_size == pxEntry->ulSize ) &&
+					( xStatBuf.st_ino == pxEntry->ulCluster )
+					#if ( ffconfigTIME_SUPPORT != 0 )
+						&& ( ( uint32_t ) xStatBuf.st_mtime == pxEntry->ulModified )
+					#endif
+					)
+				{
+					pxEntry->ulGeneration = ulGeneration;
+				}
+				else
+				{
+					prvCacheRelease( pxEntry, pdTRUE );
+					pxEntry = NULL;
+				}
+			}
+
+			if( pxEntry != NULL )
+			{
+				pxClient->pxCacheEntry = pxEntry;
+				pxClient->uxCacheOffset = 0u;
+			}
+
+			return ( pxEntry != NULL ) ? pdTRUE : pdFALSE;
+		}
+/*-----------------------------------------------------------*/
+
+		static BaseType_t prvCacheFill( HTTPClient_t * pxClient )
+		{
+			HTTPCacheEntry_t * pxEntry = NULL;
+			uint8_t * pucData = NULL;
+			uint8_t * pucFree = NULL;
+			char pcHeader[ httpREPLY_HEADER_SIZE ];
+			uint32_t ulSize = pxClient->pxFileHandle->ulFileSize;
+			uint32_t ulGeneration = prvCacheGeneration( pxClient );
+			FF_Stat_t xStatBuf;
+			BaseType_t xHeaderLength = 0;
+			BaseType_t xIndex;
+
+			if( ( prvCacheUsable( pxClient ) != pdFALSE ) &&
+				( ulSize <= ipconfigHTTP_CACHE_MAX_FILE ) &&
+				( ff_stat( pxClient->pcCurrentFilename, &xStatBuf ) == 0 ) )
+			{
+				char pcFileHeaders[ httpFILE_HEADERS_SIZE ];
+
+				#if ( ipconfigHTTP_HAS_VALIDATORS != 0 )
+					{
+						prvValidatorsMake( pxClient, &xStatBuf );
+					}
+				#endif
+
+				prvFileHeaders( pxClient, pcFileHeaders, sizeof( pcFileHeaders ) );
+
+				/* The same header as prvSendFile() would send. */
+				xHeaderLength = snprintf( pcHeader, sizeof( pcHeader ),
+										  "HTTP/1.1 %d %s\r\n"
+										  "Content-Type: %s\r\n"
+										  "Connection: keep-alive\r\n"
+										  "%s"
+										  #if ( ipconfigHTTP_MAX_RANGES > 0 )
+											  "Accept-Ranges: bytes\r\n"
+										  #endif
+										  "Content-Length: %lu\r\n\r\n",
+										  ( int ) WEB_REPLY_OK,
+										  webCodename( WEB_REPLY_OK ),
+										  prvContentsType( pxClient ),
+										  pcFileHeaders,
+										  ( unsigned long ) ulSize );
+
+				if( xHeaderLength < ( BaseType_t ) sizeof( pcHeader ) )
+				{
+					pucData = ( uint8_t * ) pvPortMallocLarge( ( size_t ) xHeaderLength + ulSize );
+				}
+			}
+
+			if( pucData != NULL )
+			{
+				memcpy( pucData, pcHeader, ( size_t ) xHeaderLength );
+
+				if( ff_fread( pucData + xHeaderLength, 1, ulSize, pxClient->pxFileHandle ) == ulSize )
+				{
+					TickType_t xNow = xTaskGetTickCount();
+
+					vTaskSuspendAll();
+					{
+						/* Take an empty slot, or else the least recently used one
+						 * that is not being sent. */
+						for( xIndex = 0; xIndex < ipconfigHTTP_CACHE_COUNT; xIndex++ )
+						{
+							HTTPCacheEntry_t * pxCandidate = &( xHTTPCache[ xIndex ] );
+
+							if( pxCandidate->xUsers == 0 )
+							{
+								if( pxCandidate->pucData == NULL )
+								{
+									pxEntry = pxCandidate;
+									break;
+								}
+
+								if( ( pxEntry == NULL ) || ( ( xNow - pxCandidate->xLastUsed ) > ( xNow - pxEntry->xLastUsed ) ) )
+								{
+									pxEntry = pxCandidate;
+								}
+							}
+						}
+
+						if( pxEntry != NULL )
+						{
+							pucFree = pxEntry->pucData;
+							snprintf( pxEntry->pcFileName, sizeof( pxEntry->pcFileName ), "%s", pxClient->pcCurrentFilename );
+							pxEntry->pucData = pucData;
+							pxEntry->uxHeaderLength = ( size_t ) xHeaderLength;
+							pxEntry->uxLength = ( size_t ) xHeaderLength + ulSize;
+							pxEntry->ulSize = ulSize;
+							pxEntry->ulCluster = xStatBuf.st_ino;
+							#if ( ffconfigTIME_SUPPORT != 0 )
+								pxEntry->ulModified = ( uint32_t ) xStatBuf.st_mtime;
+							#endif
+							pxEntry->ulGeneration = ulGeneration;
+							pxEntry->xLastUsed = xNow;
+							pxEntry->xUsers = 1;
+							pxEntry->xValid = pdTRUE;
+						}
+						else
+						{
+							/* All entries are being sent. */
+							pucFree = pucData;
+						}
+					}
+					( void ) xTaskResumeAll();
+				}
+				else
+				{
+					pucFree = pucData;
+				}
+
+				if( pxEntry == NULL )
+				{
+					/* Send the file in the normal way. */
+					ff_fseek( pxClient->pxFileHandle, 0, FF_SEEK_SET );
+				}
+			}
+
+			if( pucFree != NULL )
+			{
+				vPortFreeLarge( pucFree );
+			}
+
+			if( pxEntry != NULL )
+			{
+				/* The reply will be sent from the cache. */
+				prvFileClose( pxClient );
+				pxClient->pxCacheEntry = pxEntry;
+				pxClient->uxCacheOffset = 0u;
+			}
+
+			return ( pxEntry != NULL ) ? pdTRUE : pdFALSE;
+		}
+/*-----------------------------------------------------------*/
+
+		static BaseType_t prvCacheSend( HTTPClient_t * pxClient )
+		{
+			HTTPCacheEntry_t * pxEntry = pxClient->pxCacheEntry;
+			BaseType_t xSpace;
+			size_t uxLength, uxCount;
+			BaseType_t xRc = 0;
+
+			/* HEAD: only the header of the reply is sent. */
+			uxLength = ( pxClient->bits.bHeadOnly != pdFALSE_UNSIGNED ) ? pxEntry->uxHeaderLength : pxEntry->uxLength;
+			xSpace = FreeRTOS_tx_space( pxClient->xSocket );
+
+			if( xSpace > 0 )
+			{
+				uxCount = FreeRTOS_min_uint32( uxLength - pxClient->uxCacheOffset, ( uint32_t ) xSpace );
+				uxCount = FreeRTOS_min_uint32( uxCount, uxTCPServerBudget( ( TCPClient_t * ) pxClient ) );
+
+				if( uxCount > 0u )
+				{
+					/* Usually the header and the file go out in a single call. */
+					xRc = FreeRTOS_send( pxClient->xSocket, pxEntry->pucData + pxClient->uxCacheOffset, uxCount, 0 );
+
+					if( xRc > 0 )
+					{
+						pxClient->uxCacheOffset += ( size_t ) xRc;
+						vTCPServerBudgetUse( ( TCPClient_t * ) pxClient, ( size_t ) xRc );
+						httpACTIVITY( pxClient );
+					}
+				}
+			}
+
+			if( pxClient->uxCacheOffset >= uxLength )
+			{
+				prvCacheRelease( pxEntry, pdFALSE );
+				pxClient->pxCacheEntry = NULL;
+			}
+
+			return xRc;
+		}
+/*-----------------------------------------------------------*/
+
+		static void prvCacheRelease( HTTPCacheEntry_t * pxEntry,
+									 BaseType_t xInvalidate )
+		{
+			uint8_t * pucFree = NULL;
+
+			vTaskSuspendAll();
+			{
+				if( xInvalidate != pdFALSE )
+				{
+					pxEntry->xValid = pdFALSE;
+				}
+
+				pxEntry->xUsers--;
+
+				if( ( pxEntry->xUsers == 0 ) && ( pxEntry->xValid == pdFALSE ) )
+				{
+					/* The last client that was sending it has finished. */
+					pucFree = pxEntry->pucData;
+					pxEntry->pucData = NULL;
+				}
+			}
+			( void ) xTaskResumeAll();
+
+			if( pucFree != NULL )
+			{
+				vPortFreeLarge( pucFree );
+			}
+		}
+/*-----------------------------------------------------------*/
+
+		static uint32_t prvCacheGeneration( HTTPClient_t * pxClient )
+		{
+			uint32_t ulChanges = 0u;
+
+			/* The disk counts the changes of directory entries, which are made
+			 * whenever a file is written, renamed or deleted, by any task. */
+			( void ) ff_dirchanges( pxClient->pcCurrentFilename, &ulChanges );
+
+			return ulCacheGeneration + ulChanges;
+		}
+/*-----------------------------------------------------------*/
+
+		void FreeRTOS_HTTPCacheChanged( void )
+		{
+			/* Entries with an older generation are checked before being used. */
+			ulCacheGeneration++;
+		}
+/*-----------------------------------------------------------*/
+
+	#endif /* ipconfigHTTP_CACHE_COUNT > 0 */
+
+	#if ( ipconfigHTTP_HAS_VALIDATORS != 0 )
+
+		static BaseType_t prvETagFormat( const FF_Stat_t * pxStatBuf,
+										 char * pcBuffer,
+										 size_t uxBufferSize )
+		{
+			/* A new file gets a new first cluster, a rewritten file a new size
+			 * or time. */
+			#if ( ffconfigTIME_SUPPORT != 0 )
+				return snprintf( pcBuffer, uxBufferSize, "\"%lx-%lx-%lx\"",
+								 ( unsigned long ) pxStatBuf->st_ino,
+								 ( unsigned long ) pxStatBuf->st_size,
+								 ( unsigned long ) pxStatBuf->st_mtime );
+			#else
+				return snprintf( pcBuffer, uxBufferSize, "\"%lx-%lx\"",
+								 ( unsigned long ) pxStatBuf->st_ino,
+								 ( unsigned long ) pxStatBuf->st_size );
+			#endif
+		}
+/*-----------------------------------------------------------*/
+
+		static void prvValidatorsMake( HTTPClient_t * pxClient,
+									   const FF_Stat_t * pxStatBuf )
+		{
+			char pcETag[ httpETAG_SIZE ];
+
+			prvETagFormat( pxStatBuf, pcETag, sizeof( pcETag ) );
+
+			#if ( ffconfigTIME_SUPPORT != 0 )
+				{
+					static const char pcDayList[] = "SunMonTueWedThuFriSat";
+					static const char pcMonthList[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+					FF_TimeStruct_t xTimeStruct;
+					time_t xSeconds = ( time_t ) pxStatBuf->st_mtime;
+
+					FreeRTOS_gmtime_r( &xSeconds, &xTimeStruct );
+					/* "Last-Modified: Sun, 06 Nov 1994 08:49:37 GMT". */
+					snprintf( pxClient->pcValidators, sizeof( pxClient->pcValidators ),
+							  "ETag: %s\r\n"
+							  "Last-Modified: %.3s, %02d %.3s %04d %02d:%02d:%02d GMT\r\n",
+							  pcETag,
+							  pcDayList + 3 * ( xTimeStruct.tm_wday % 7 ),
+							  xTimeStruct.tm_mday,
+							  pcMonthList + 3 * ( xTimeStruct.tm_mon % 12 ),
+							  xTimeStruct.tm_year + 1900,
+							  xTimeStruct.tm_hour,
+							  xTimeStruct.tm_min,
+							  xTimeStruct.tm_sec );
+				}
+			#else
+				{
+					snprintf( pxClient->pcValidators, sizeof( pxClient->pcValidators ),
+							  "ETag: %s\r\n", pcETag );
+				}
+			#endif
+		}
+/*-----------------------------------------------------------*/
+
+		#if ( ffconfigTIME_SUPPORT != 0 )
+			static BaseType_t prvDateParse( const char * pcDate,
+											uint32_t * pulSeconds )
+			{
+				static const char pcMonthList[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+				FF_TimeStruct_t xTimeStruct;
+				char pcMonth[ 4 ];
+				const char * pcFound;
+				BaseType_t xResult = pdFALSE;
+
+				memset( &xTimeStruct, 0, sizeof( xTimeStruct ) );
+
+				/* Only the IMF-fixdate format of RFC 7231 is recognised:
+				 * "Sun, 06 Nov 1994 08:49:37 GMT". */
+				pcDate = strchr( pcDate, ',' );
+
+				if( ( pcDate != NULL ) &&
+					( sscanf( pcDate + 1, "%d %3s %d %d:%d:%d",
+							  &xTimeStruct.tm_mday, pcMonth, &xTimeStruct.tm_year,
+							  &xTimeStruct.tm_hour, &xTimeStruct.tm_min, &xTimeStruct.tm_sec ) == 6 ) )
+				{
+					pcFound = strstr( pcMonthList, pcMonth );
+
+					if( ( pcFound != NULL ) && ( strlen( pcMonth ) == 3u ) && ( ( ( pcFound - pcMonthList ) % 3 ) == 0 ) )
+					{
+						xTimeStruct.tm_mon = ( int ) ( ( pcFound - pcMonthList ) / 3 );
+						xTimeStruct.tm_year -= 1900;
+						*pulSeconds = ( uint32_t ) FreeRTOS_mktime( &xTimeStruct );
+						xResult = pdTRUE;
+					}
+				}
+
+				return xResult;
+			}
+		#endif /* ffconfigTIME_SUPPORT */
+/*-----------------------------------------------------------*/
+
+		static BaseType_t prvNotModified( HTTPClient_t * pxClient )
+		{
+			const char * pcNoneMatch = prvFindHeader( pxClient, "If-None-Match" );
+			const char * pcSince = prvFindHeader( pxClient, "If-Modified-Since" );
+			const char * pcEnd;
+			const char * pcFound;
+			char pcETag[ httpETAG_SIZE ];
+			FF_Stat_t xStatBuf;
+			BaseType_t xResult = pdFALSE;
+
+			/* Only the directory entry is looked up, the file is not opened. */
+			if( ( ( pcNoneMatch != NULL ) || ( pcSince != NULL ) ) &&
+				( ff_stat( pxClient->pcCurrentFilename, &xStatBuf ) == 0 ) &&
+				( ( xStatBuf.st_mode & FF_IFDIR ) == 0 ) )
+			{
+				/* The validators are also sent when the file has changed. */
+				prvValidatorsMake( pxClient, &xStatBuf );
+
+				if( pcNoneMatch != NULL )
+				{
+					/* A list of tags, possibly weak ( W/"..." ), or "*".  When
+					 * present, If-Modified-Since is ignored. */
+					pcEnd = strchr( pcNoneMatch, '\r' );
+
+					if( pcEnd == NULL )
+					{
+						pcEnd = pcNoneMatch + strlen( pcNoneMatch );
+					}
+
+					prvETagFormat( &xStatBuf, pcETag, sizeof( pcETag ) );
+					pcFound = strstr( pcNoneMatch, pcETag );
+
+					if( ( *pcNoneMatch == '*' ) || ( ( pcFound != NULL ) && ( pcFound < pcEnd ) ) )
+					{
+						xResult = pdTRUE;
+					}
+				}
+
+				#if ( ffconfigTIME_SUPPORT != 0 )
+					else
+					{
+						uint32_t ulSince;
+
+						if( ( prvDateParse( pcSince, &ulSince ) != pdFALSE ) &&
+							( ( uint32_t ) xStatBuf.st_mtime <= ulSince ) )
+						{
+							xResult = pdTRUE;
+						}
+					}
+				#endif
+			}
+
+			return xResult;
+		}
+/*-----------------------------------------------------------*/
+
+	#endif /* ipconfigHTTP_HAS_VALIDATORS */
+
+	#if ( ipconfigHTTP_HAS_GZIP != 0 )
+
+		static BaseType_t prvGzipAccepted( HTTPClient_t * pxClient )
+		{
+			const char * pcValue = prvFindHeader( pxClient, "Accept-Encoding" );
+			const char * pcEnd;
+			const char * pcFound = NULL;
+			BaseType_t xResult = pdFALSE;
+
+			if( pcValue != NULL )
+			{
+				pcEnd = strchr( pcValue, '\r' );
+
+				if( pcEnd == NULL )
+				{
+					pcEnd = pcValue + strlen( pcValue );
+				}
+
+				pcFound = strstr( pcValue, "gzip" );
+			}
+
+			if( ( pcFound != NULL ) && ( pcFound < pcEnd ) )
+			{
+				/* "gzip;q=0" means that gzip is not acceptable. */
+				pcFound += 4;
+
+				while( *pcFound == ' ' )
+				{
+					pcFound++;
+				}
+
+				xResult = pdTRUE;
+
+				if( ( pcFound[ 0 ] == ';' ) && ( strncmp( pcFound + 1, "q=0", 3 ) == 0 ) )
+				{
+					pcFound += 4;
+
+					if( *pcFound == '.' )
+					{
+						do
+						{
+							pcFound++;
+						} while( *pcFound == '0' );
+					}
+
+					if( ( *pcFound < '1' ) || ( *pcFound > '9' ) )
+					{
+						xResult = pdFALSE;
+					}
+				}
+			}
+
+			return xResult;
+		}
+/*-----------------------------------------------------------*/
+
+		static void prvGzipSelect( HTTPClient_t * pxClient )
+		{
+			const TypeCouple_t * pxCouple;
+			FF_Stat_t xStatBuf;
+			size_t uxLength = strlen( pxClient->pcCurrentFilename );
+			BaseType_t xFound = pdFALSE;
+
+			pxClient->bits.bGzip = pdFALSE_UNSIGNED;
+			pxCouple = pxFindTypeCouple( pxClient->pcCurrentFilename, uxLength );
+
+			if( ( pxCouple != NULL ) && ( pxCouple->xCompress != pdFALSE ) &&
+				( uxLength + 4u <= sizeof( pxClient->pcCurrentFilename ) ) &&
+				( prvGzipAccepted( pxClient ) != pdFALSE ) )
+			{
+				strcpy( pxClient->pcCurrentFilename + uxLength, ".gz" );
+
+				#if ( ipconfigHTTP_CACHE_COUNT > 0 )
+					{
+						uint32_t ulGeneration = prvCacheGeneration( pxClient );
+						BaseType_t xIndex;
+
+						/* A cached copy saves the directory lookup, as long as
+						 * no files have been changed since it was checked. */
+						vTaskSuspendAll();
+						{
+							for( xIndex = 0; xIndex < ipconfigHTTP_CACHE_COUNT; xIndex++ )
+							{
+								if( ( xHTTPCache[ xIndex ].pucData != NULL ) &&
+									( xHTTPCache[ xIndex ].xValid != pdFALSE ) &&
+									( xHTTPCache[ xIndex ].ulGeneration == ulGeneration ) &&
+									( strcmp( xHTTPCache[ xIndex ].pcFileName, pxClient->pcCurrentFilename ) == 0 ) )
+								{
+									xFound = pdTRUE;
+									break;
+								}
+							}
+						}
+						( void ) xTaskResumeAll();
+					}
+				#endif
+
+				if( ( xFound == pdFALSE ) &&
+					( ff_stat( pxClient->pcCurrentFilename, &xStatBuf ) == 0 ) &&
+					( ( xStatBuf.st_mode & FF_IFDIR ) == 0 ) )
+				{
+					xFound = pdTRUE;
+				}
+
+				if( xFound != pdFALSE )
+				{
+					pxClient->bits.bGzip = pdTRUE_UNSIGNED;
+				}
+				else
+				{
+					/* There is no compressed version, send the file itself. */
+					pxClient->pcCurrentFilename[ uxLength ] = '\0';
+				}
+			}
+		}
+/*-----------------------------------------------------------*/
+
+	#endif /* ipconfigHTTP_HAS_GZIP */
+
+	static BaseType_t prvMakeFilename( HTTPClient_t * pxClient )
+	{
+		char pcSlash[ 2 ];
+		BaseType_t xResult = pdTRUE;
+
+		if( pxClient->pcUrlData[ 0 ] != '/' )
+		{
+			/* Insert a slash before the file name. */
+			pcSlash[ 0 ] = '/';
+			pcSlash[ 1 ] = '\0';
+		}
+		else
+		{
+			/* The browser provided a starting '/' already. */
+			pcSlash[ 0 ] = '\0';
+		}
+
+		snprintf( pxClient->pcCurrentFilename, sizeof( pxClient->pcCurrentFilename ), "%s%s%s",
+				  pxClient->pcRootDir,
+				  pcSlash,
+				  pxClient->pcUrlData );
+
+		if( strstr( pxClient->pcUrlData, ".." ) != NULL )
+		{
+			/* No method may access a file outside the root directory. */
+			pxClient->pcCurrentFilename[ 0 ] = '\0';
+			xResult = pdFALSE;
+		}
+
+		return xResult;
+	}
+/*-----------------------------------------------------------*/
+
+	#if ( ipconfigHTTP_HAS_UPLOAD != 0 )
+
+		static BaseType_t prvUploadStart( HTTPClient_t * pxClient )
+		{
+			const char * pcValue;
+			char pcTempName[ ffconfigMAX_FILENAME ];
+			FF_Stat_t xStatBuf;
+			BaseType_t xCode = 0;
+			BaseType_t xRc = 0;
+			uint32_t ulLength = 0u;
+			BaseType_t xInsideRoot = prvMakeFilename( pxClient );
+
+			pxClient->bits.bChunked = pdFALSE_UNSIGNED;
+			pxClient->xChunkState = httpCHUNK_SIZE;
+
+			/* Find out how the end of the body will be recognised. */
+			pcValue = prvFindHeader( pxClient, "Transfer-Encoding" );
+
+			if( pcValue != NULL )
+			{
+				if( strncasecmp( pcValue, "chunked", 7 ) == 0 )
+				{
+					pxClient->bits.bChunked = pdTRUE_UNSIGNED;
+				}
+				else
+				{
+					xCode = WEB_NOT_IMPLEMENTED;
+				}
+			}
+			else
+			{
+				pcValue = prvFindHeader( pxClient, "Content-Length" );
+
+				if( pcValue != NULL )
+				{
+					char * pcEnd;
+					unsigned long ulValue = strtoul( pcValue, &pcEnd, 10 );
+
+					if( ( *pcValue < '0' ) || ( *pcValue > '9' ) ||
+						( ( *pcEnd != '\r' ) && ( *pcEnd != '\n' ) && ( *pcEnd != ' ' ) && ( *pcEnd != '\t' ) && ( *pcEnd != '\0' ) ) )
+					{
+						/* Not a plain decimal number. */
+						xCode = WEB_BAD_REQUEST;
+					}
+					else if( ( uint64_t ) ulValue > ( uint64_t ) ff_diskfree( pxClient->pcRootDir, NULL ) * 512u )
+					{
+						/* Refuse the upload before any of it is stored.  A
+						 * number that is too big for strtoul() ends up here
+						 * as well. */
+						xCode = WEB_PAYLOAD_TOO_LARGE;
+					}
+					else
+					{
+						ulLength = ( uint32_t ) ulValue;
+					}
+				}
+				else
+				{
+					xCode = WEB_LENGTH_REQUIRED;
+				}
+			}
+
+			if( ( xCode == 0 ) && ( xInsideRoot == pdFALSE ) )
+			{
+				/* Do not write outside the root directory. */
+				xCode = WEB_FORBIDDEN;
+			}
+
+			if( xCode == 0 )
+			{
+				if( ff_stat( pxClient->pcCurrentFilename, &xStatBuf ) != 0 )
+				{
+					pxClient->bits.bCreated = pdTRUE_UNSIGNED;
+				}
+				else if( ( xStatBuf.st_mode & FF_IFDIR ) == 0 )
+				{
+					pxClient->bits.bCreated = pdFALSE_UNSIGNED;
+				}
+				else
+				{
+					xCode = WEB_FORBIDDEN;
+				}
+			}
+
+			if( xCode == 0 )
+			{
+				/* The current version of the file stays available, and intact
+				 * when the upload fails. */
+				if( prvUploadTempName( pxClient, pcTempName, sizeof( pcTempName ) ) != pdFALSE )
+				{
+					pxClient->pxWriteHandle = ff_fopen( pcTempName, "wb" );
+				}
+
+				FreeRTOS_printf( ( "Upload file '%s': %s\n", pxClient->pcCurrentFilename,
+								   pxClient->pxWriteHandle != NULL ? "Ok" : strerror( stdioGET_ERRNO() ) ) );
+
+				if( pxClient->pxWriteHandle == NULL )
+				{
+					xCode = WEB_INTERNAL_SERVER_ERROR;
+				}
+			}
+
+			if( xCode != 0 )
+			{
+				/* The body has not been read, the connection will be closed. */
+				pxClient->bits.bKeepAlive = pdFALSE_UNSIGNED;
+				strcpy( pxClient->pxParent->pcExtraContents, "Content-Length: 0\r\n" );
+				xRc = prvSendReply( pxClient, xCode );
+			}
+			else
+			{
+				pxClient->ulBodyLeft = ulLength;
+
+				if( ulLength > 0u )
+				{
+					/* Extending the cluster chain in a single step makes it more
+					 * likely that the clusters are contiguous. */
+					if( ff_fallocate( pxClient->pxWriteHandle, ( size_t ) ulLength ) != 0 )
+					{
+						/* Not fatal: ff_fwrite() will try to extend the file itself. */
+						FreeRTOS_printf( ( "prvUploadStart: reserve %lu bytes: %s\n",
+										   ( unsigned long ) ulLength, strerror( stdioGET_ERRNO() ) ) );
+					}
+				}
+
+				pcValue = prvFindHeader( pxClient, "Expect" );
+
+				if( ( pcValue != NULL ) && ( strncasecmp( pcValue, "100-continue", 12 ) == 0 ) )
+				{
+					/* The client waits for this before it sends the body. */
+					xRc = FreeRTOS_send( pxClient->xSocket, "HTTP/1.1 100 Continue\r\n\r\n", 25u, 0 );
+				}
+
+				if( ( ulLength == 0u ) && ( pxClient->bits.bChunked == pdFALSE_UNSIGNED ) )
+				{
+					/* An empty file. */
+					xRc = prvUploadDone( pxClient, ( pxClient->bits.bCreated != pdFALSE_UNSIGNED ) ? WEB_CREATED : WEB_NO_CONTENT );
+				}
+				else
+				{
+					prvUploadWork( pxClient );
+				}
+			}
+
+			return xRc;
+		}
+/*-----------------------------------------------------------*/
+
+		static void prvUploadWork( HTTPClient_t * pxClient )
+		{
+			char pcLine[ httpCHUNK_LINE_SIZE ];
+			char * pcBuffer;
+			char * pcEnd;
+			BaseType_t xRc, xWritten;
+			BaseType_t xCode = 0;
+
+			while( xCode == 0 )
+			{
+				if( pxClient->ulBodyLeft > 0u )
+				{
+					/* The "zero-copy" method, as used by the FTP server. */
+					xRc = FreeRTOS_recv( pxClient->xSocket, ( void * ) &pcBuffer,
+										 0x20000u, FREERTOS_ZERO_COPY | FREERTOS_MSG_DONTWAIT );
+
+					if( xRc > 0 )
+					{
+						/* Whatever follows the body belongs to the next request,
+						 * data beyond the share of this client are read in a next
+						 * cycle. */
+						xRc = ( BaseType_t ) FreeRTOS_min_uint32( ( uint32_t ) xRc, pxClient->ulBodyLeft );
+						xRc = ( BaseType_t ) FreeRTOS_min_uint32( ( uint32_t ) xRc, uxTCPServerBudget( ( TCPClient_t * ) pxClient ) );
+					}
+
+					if( xRc < 0 )
+					{
+						xCode = httpUPLOAD_LOST;
+					}
+
+					if( xRc <= 0 )
+					{
+						break;
+					}
+
+					xWritten = ( BaseType_t ) ff_fwrite( pcBuffer, 1, ( size_t ) xRc, pxClient->pxWriteHandle );
+					FreeRTOS_recv( pxClient->xSocket, ( void * ) NULL, xRc, 0 );
+					vTCPServerBudgetUse( ( TCPClient_t * ) pxClient, ( size_t ) xRc );
+					httpACTIVITY( pxClient );
+					pxClient->ulBodyLeft -= ( uint32_t ) xRc;
+
+					if( xWritten != xRc )
+					{
+						xCode = WEB_INTERNAL_SERVER_ERROR;
+					}
+					else if( ( pxClient->ulBodyLeft == 0u ) && ( pxClient->bits.bChunked == pdFALSE_UNSIGNED ) )
+					{
+						xCode = ( pxClient->bits.bCreated != pdFALSE_UNSIGNED ) ? WEB_CREATED : WEB_NO_CONTENT;
+					}
+				}
+				else
+				{
+					/* The lines of a chunked body: the size of a chunk, the CRLF
+					 * after its data, and the trailer after the last chunk. */
+					xRc = prvUploadLine( pxClient, pcLine, sizeof( pcLine ) );
+
+					if( xRc == 0 )
+					{
+						break;
+					}
+
+					if( xRc < 0 )
+					{
+						xCode = WEB_BAD_REQUEST;
+					}
+					else if( pxClient->xChunkState == httpCHUNK_SIZE )
+					{
+						/* Chunk extensions after a ';' are ignored. */
+						pxClient->ulBodyLeft = ( uint32_t ) strtoul( pcLine, &pcEnd, 16 );
+
+						if( pcEnd == pcLine )
+						{
+							xCode = WEB_BAD_REQUEST;
+						}
+						else
+						{
+							pxClient->xChunkState = ( pxClient->ulBodyLeft != 0u ) ? httpCHUNK_DATA_END : httpCHUNK_TRAILER;
+						}
+					}
+					else if( pxClient->xChunkState == httpCHUNK_DATA_END )
+					{
+						if( pcLine[ 0 ] != '\0' )
+						{
+							xCode = WEB_BAD_REQUEST;
+						}
+						else
+						{
+							pxClient->xChunkState = httpCHUNK_SIZE;
+						}
+					}
+					else if( pcLine[ 0 ] == '\0' )
+					{
+						/* The empty line at the end of the trailer. */
+						xCode = ( pxClient->bits.bCreated != pdFALSE_UNSIGNED ) ? WEB_CREATED : WEB_NO_CONTENT;
+					}
+					else
+					{
+						/* Trailer fields are ignored. */
+					}
+				}
+			}
+
+			if( xCode != 0 )
+			{
+				prvUploadDone( pxClient, xCode );
+			}
+		}
+/*-----------------------------------------------------------*/
+
+		static BaseType_t prvUploadLine( HTTPClient_t * pxClient,
+										 char * pcLine,
+										 size_t uxSize )
+		{
+			BaseType_t xRc;
+			BaseType_t xIndex;
+			BaseType_t xLength = 0;
+
+			xRc = xTCPServerPeek( ( TCPClient_t * ) pxClient, pcLine, uxSize - 1u );
+
+			for( xIndex = 0; xIndex < xRc; xIndex++ )
+			{
+				if( pcLine[ xIndex ] == '\n' )
+				{
+					xLength = xIndex + 1;
+					break;
+				}
+			}
+
+			if( xLength > 0 )
+			{
+				prvSetRxLowWater( pxClient, 0u );
+				httpACTIVITY( pxClient );
+				xRc = xTCPServerTake( ( TCPClient_t * ) pxClient, pcLine, ( size_t ) xLength );
+
+				/* Strip the line ending. */
+				while( ( xLength > 0 ) && ( ( pcLine[ xLength - 1 ] == '\n' ) || ( pcLine[ xLength - 1 ] == '\r' ) ) )
+				{
+					xLength--;
+				}
+
+				pcLine[ xLength ] = '\0';
+				xRc = ( xRc > 0 ) ? xRc : -1;
+			}
+			else if( xRc >= ( BaseType_t ) uxSize - 1 )
+			{
+				/* The line does not fit in the buffer. */
+				xRc = -1;
+			}
+			else if( ( xRc > 0 ) && ( FreeRTOS_connstatus( pxClient->xSocket ) != ( BaseType_t ) eESTABLISHED ) )
+			{
+				/* The peer has closed its side, the line will never be
+				 * completed. */
+				xRc = -1;
+			}
+			else if( xRc > 0 )
+			{
+				/* Wait for the rest of the line, without being woken up for
+				 * the bytes that have been looked at already. */
+				#if ( ipconfigSELECT_USES_READY_LIST == 1 )
+					{
+						prvSetRxLowWater( pxClient, ( size_t ) xRc + 1u );
+					}
+				#else
+					{
+						vTCPServerKeep( ( TCPClient_t * ) pxClient, ( size_t ) xRc );
+					}
+				#endif
+				xRc = 0;
+			}
+			else
+			{
+				/* No data, or the connection has been closed. */
+			}
+
+			return xRc;
+		}
+/*-----------------------------------------------------------*/
+
+		static BaseType_t prvUploadTempName( HTTPClient_t * pxClient,
+											 char * pcBuffer,
+											 size_t uxBufferSize )
+		{
+			const char * pcSlash = strrchr( pxClient->pcCurrentFilename, '/' );
+			int iDirLength = ( pcSlash != NULL ) ? ( int ) ( pcSlash - pxClient->pcCurrentFilename + 1 ) : 0;
+			int iLength;
+
+			/* The address of the client makes the name unique among the
+			 * uploads that are in progress. */
+			iLength = snprintf( pcBuffer, uxBufferSize, "%.*s~up%08lx.tmp",
+								iDirLength, pxClient->pcCurrentFilename,
+								( unsigned long ) ( ( size_t ) pxClient & 0xffffffffu ) );
+
+			return ( ( iLength > 0 ) && ( ( size_t ) iLength < uxBufferSize ) ) ? pdTRUE : pdFALSE;
+		}
+/*-----------------------------------------------------------*/
+
+		static BaseType_t prvUploadDone( HTTPClient_t * pxClient,
+										 BaseType_t xCode )
+		{
+			char pcTempName[ ffconfigMAX_FILENAME ];
+			BaseType_t xRc = 0;
+
+			ff_fclose( pxClient->pxWriteHandle );
+			pxClient->pxWriteHandle = NULL;
+			( void ) prvUploadTempName( pxClient, pcTempName, sizeof( pcTempName ) );
+
+			if( ( xCode == WEB_CREATED ) || ( xCode == WEB_NO_CONTENT ) )
+			{
+				/* Only now the previous version of the file is replaced. */
+				if( ff_rename( pcTempName, pxClient->pcCurrentFilename, pdTRUE ) != 0 )
+				{
+					FreeRTOS_printf( ( "prvUploadDone: rename to '%s': %s\n", pxClient->pcCurrentFilename, strerror( stdioGET_ERRNO() ) ) );
+					ff_remove( pcTempName );
+					xCode = WEB_INTERNAL_SERVER_ERROR;
+				}
+			}
+			else
+			{
+				/* Do not leave an incomplete file, the previous version has not
+				 * been touched.  The rest of the body can not be found any more,
+				 * so the connection will be closed. */
+				FreeRTOS_printf( ( "prvUploadDone: '%s' failed (%ld)\n", pxClient->pcCurrentFilename, xCode ) );
+				ff_remove( pcTempName );
+				pxClient->bits.bKeepAlive = pdFALSE_UNSIGNED;
+			}
+
+			#if ( ipconfigHTTP_CACHE_COUNT > 0 )
+				{
+					/* Files have been created, replaced or removed, whatever the
+					 * outcome. */
+					FreeRTOS_HTTPCacheChanged();
+				}
+			#endif
+
+			if( xCode != httpUPLOAD_LOST )
+			{
+				strcpy( pxClient->pxParent->pcExtraContents, "Content-Length: 0\r\n" );
+				xRc = prvSendReply( pxClient, xCode );
+			}
+
+			return xRc;
+		}
+/*-----------------------------------------------------------*/
+
+	#endif /* ipconfigHTTP_HAS_UPLOAD */
+
+	static BaseType_t prvOpenURL( HTTPClient_t * pxClient )
+	{
+		BaseType_t xRc;
+
+		pxClient->bits.bReplySent = pdFALSE_UNSIGNED;
+
+		#if ( ipconfigHTTP_HAS_HANDLE_REQUEST_HOOK != 0 )
+			{
+				if( strchr( pxClient->pcUrlData, ipconfigHTTP_REQUEST_CHARACTER ) != NULL )
+				{
+					size_t xResult;
+
+					xResult = uxApplicationHTTPHandleRequestHook( pxClient->pcUrlData, pxClient->pcCurrentFilename, sizeof( pxClient->pcCurrentFilename ) );
+
+					if( xResult > 0 )
+					{
+						strcpy( pxClient->pxParent->pcContentsType, "text/html" );
+						snprintf( pxClient->pxParent->pcExtraContents, sizeof( pxClient->pxParent->pcExtraContents ),
+								  "Content-Length: %d\r\n", ( int ) xResult );
+						xRc = prvSendReply( pxClient, WEB_REPLY_OK ); /* "Requested file action OK" */
+
+						if( ( xRc > 0 ) && ( pxClient->bits.bHeadOnly == pdFALSE_UNSIGNED ) )
+						{
+							xRc = FreeRTOS_send( pxClient->xSocket, pxClient->pcCurrentFilename, xResult, 0 );
+						}
+
+						/* Although against the coding standard of FreeRTOS, a return is
+						 * done here  to simplify this conditional code. */
+						return xRc;
+					}
+				}
+			}
+		#endif /* ipconfigHTTP_HAS_HANDLE_REQUEST_HOOK */
+
+		if( prvMakeFilename( pxClient ) == pdFALSE )
+		{
+			#if ( ipconfigHTTP_HAS_VALIDATORS != 0 )
+				{
+					pxClient->pcValidators[ 0 ] = '\0';
+				}
+			#endif
+			strcpy( pxClient->pxParent->pcExtraContents, "Content-Length: 0\r\n" );
+			/* "403 Forbidden": the URL points outside the root directory. */
+			xRc = prvSendReply( pxClient, WEB_FORBIDDEN );
+		}
+		else
+		{
+			#if ( ipconfigHTTP_HAS_GZIP != 0 )
+				{
+					prvGzipSelect( pxClient );
+				}
+			#endif
+
+			#if ( ipconfigHTTP_HAS_VALIDATORS != 0 )
+				if( prvNotModified( pxClient ) != pdFALSE )
+				{
+					/* The client has the current version already. */
+					xRc = prvSendReply( pxClient, WEB_NOT_MODIFIED );
+				}
+				else
+			#endif
+			#if ( ipconfigHTTP_CACHE_COUNT > 0 )
+				if( prvCacheFind( pxClient ) != pdFALSE )
+				{
+					/* Sent from RAM, without accessing the file system. */
+					xRc = prvCacheSend( pxClient );
+				}
+				else
+			#endif
+			{
+				pxClient->pxFileHandle = ff_fopen( pxClient->pcCurrentFilename, "rb" );
+
+				FreeRTOS_printf( ( "Open file '%s': %s\n", pxClient->pcCurrentFilename,
+								   pxClient->pxFileHandle != NULL ? "Ok" : strerror( stdioGET_ERRNO() ) ) );
+
+				if( pxClient->pxFileHandle == NULL )
+				{
+					#if ( ipconfigHTTP_HAS_VALIDATORS != 0 )
+						{
+							pxClient->pcValidators[ 0 ] = '\0';
+						}
+					#endif
+					strcpy( pxClient->pxParent->pcExtraContents, "Content-Length: 0\r\n" );
+					/* "404 File not found". */
+					xRc = prvSendReply( pxClient, WEB_NOT_FOUND );
+				}
+				else
+				{
+					pxClient->uxBytesLeft = ( size_t ) pxClient->pxFileHandle->ulFileSize;
+
+					#if ( ipconfigHTTP_CACHE_COUNT > 0 )
+						if( prvCacheFill( pxClient ) != pdFALSE )
+						{
+							xRc = prvCacheSend( pxClient );
+						}
+						else
+					#endif
+					{
+						xRc = prvSendFile( pxClient );
+					}
+				}
+			}
+		}
+
+		return xRc;
+	}
+/*-----------------------------------------------------------*/
+
+	/* Look up the method of a request, returns ECMD_UNK if it is not known. */
+	static BaseType_t prvFindCommand( const char * pcCommand,
+									  BaseType_t xLength )
+	{
+		BaseType_t xIndex;
+
+		if( xWebCommandHash.ulMultiplier == 0u )
+		{
+			uint32_t ulKeys[ WEB_CMD_COUNT - 1 ];
+
+			/* The fake entry ECMD_UNK is not part of the table. */
+			for( xIndex = 0; xIndex < WEB_CMD_COUNT - 1; xIndex++ )
+			{
+				ulKeys[ xIndex ] = ulTCPServerCommandKey( xWebCommands[ xIndex ].pcCommandName, xWebCommands[ xIndex ].xCommandLength );
+			}
+
+			( void ) xTCPServerHashBuild( &xWebCommandHash, ulKeys, WEB_CMD_COUNT - 1 );
+		}
+
+		xIndex = xTCPServerHashFind( &xWebCommandHash, ulTCPServerCommandKey( pcCommand, xLength ) );
+
+		if( ( xIndex < 0 ) ||
+			( xWebCommands[ xIndex ].xCommandLength != xLength ) ||
+			( memcmp( xWebCommands[ xIndex ].pcCommandName, pcCommand, xLength ) != 0 ) )
+		{
+			xIndex = ECMD_UNK;
+		}
+
+		return xIndex;
+	}
+/*-----------------------------------------------------------*/
+
+	static BaseType_t prvProcessCmd( HTTPClient_t * pxClient,
+									 BaseType_t xIndex )
 	{
 		BaseType_t xResult = 0;
 
@@ -312,12 +2068,22 @@
 		switch( xIndex )
 		{
 			case ECMD_GET:
+			case ECMD_HEAD:
+				pxClient->bits.bHeadOnly = ( xIndex == ECMD_HEAD ) ? pdTRUE_UNSIGNED : pdFALSE_UNSIGNED;
 				xResult = prvOpenURL( pxClient );
 				break;
 
-			case ECMD_HEAD:
-			case ECMD_POST:
-			case ECMD_PUT:
+			#if ( ipconfigHTTP_HAS_UPLOAD != 0 )
+				case ECMD_POST:
+				case ECMD_PUT:
+					/* Both store the body in the file named by the URL. */
+					pxClient->bits.bReplySent = pdFALSE_UNSIGNED;
+					xResult = prvUploadStart( pxClient );
+					break;
+			#else
+				case ECMD_POST:
+				case ECMD_PUT:
+			#endif
 			case ECMD_DELETE:
 			case ECMD_TRACE:
 			case ECMD_OPTIONS:
@@ -326,6 +2092,12 @@
 			case ECMD_UNK:
 				FreeRTOS_printf( ( "prvProcessCmd: Not implemented: %s\n",
 								   xWebCommands[ xIndex ].pcCommandName ) );
+
+				/* A body that may follow can not be told apart from the next
+				 * request, so the connection is closed after the reply. */
+				pxClient->bits.bKeepAlive = pdFALSE_UNSIGNED;
+				strcpy( pxClient->pxParent->pcExtraContents, "Content-Length: 0\r\n" );
+				xResult = prvSendReply( pxClient, WEB_NOT_IMPLEMENTED );
 				break;
 		}
 
@@ -335,96 +2107,450 @@
 
 	BaseType_t xHTTPClientWork( TCPClient_t * pxTCPClient )
 	{
-		BaseType_t xRc;
+		BaseType_t xRc = 0;
+		BaseType_t xCount;
 		HTTPClient_t * pxClient = ( HTTPClient_t * ) pxTCPClient;
 
-		if( pxClient->pxFileHandle != NULL )
+		if( pxClient->xSelectBits == 0U )
 		{
-			prvSendFile( pxClient );
-		}
+			/* A new connection, the TCP server has selected these events. */
+			pxClient->xSelectBits = ( EventBits_t ) ( eSELECT_READ | eSELECT_EXCEPT );
+			httpACTIVITY( pxClient );
+
+			#if ( ipconfigSELECT_USES_READY_LIST == 1 )
+				{
+					/* eSELECT_WRITE means that a reply header, or the header of
+					 * a part in prvRangeNext(), fits in the TX stream. */
+					size_t uxLowWater = httpREPLY_HEADER_SIZE;
 
-		xRc = FreeRTOS_recv( pxClient->xSocket, ( void * ) pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), 0 );
+					( void ) FreeRTOS_setsockopt( pxClient->xSocket, 0, FREERTOS_SO_SELECT_SNDLOWAT, ( void * ) &uxLowWater, sizeof( uxLowWater ) );
+				}
+			#endif
+		}
 
-		if( xRc > 0 )
+		if( FreeRTOS_connstatus( pxClient->xSocket ) == ( BaseType_t ) eCLOSED )
 		{
-			BaseType_t xIndex;
-			const char * pcEndOfCmd;
-			const struct xWEB_COMMAND * curCmd;
-			char * pcBuffer = pcCOMMAND_BUFFER;
+			/* Reset, timed out, or closed by both sides: nothing can be sent
+			 * any more. */
+			xRc = -1;
+		}
+		else if( httpREPLY_BUSY( pxClient ) )
+		{
+			#if ( ipconfigHTTP_HAS_UPLOAD != 0 )
+				if( pxClient->pxWriteHandle != NULL )
+				{
+					prvUploadWork( pxClient );
+				}
+				else
+			#endif
+			#if ( ipconfigHTTP_CACHE_COUNT > 0 )
+				if( pxClient->pxCacheEntry != NULL )
+				{
+					prvCacheSend( pxClient );
+				}
+				else
+			#endif
+			{
+				prvSendFile( pxClient );
+			}
+
+			if( !httpREPLY_BUSY( pxClient ) )
+			{
+				prvRequestDone( pxClient );
+			}
+		}
 
-			if( xRc < ( BaseType_t ) sizeof( pcCOMMAND_BUFFER ) )
+		if( xRc < 0 )
+		{
+			/* The connection is gone. */
+		}
+		else if( pxClient->bits.bShutdown != pdFALSE_UNSIGNED )
+		{
+			/* Discard whatever arrives until the peer has closed the connection
+			 * as well, recv() will then return an error. */
+			xRc = FreeRTOS_recv( pxClient->xSocket, ( void * ) pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), 0 );
+		}
+		else
+		{
+			/* Pipelined requests are answered one after the other, but only once
+			 * the previous reply has been queued entirely, so that the replies
+			 * go out in the same order as the requests. */
+			for( xCount = 0; xCount < ipconfigHTTP_PIPELINE_COUNT; xCount++ )
 			{
-				pcBuffer[ xRc ] = '\0';
+				if( httpREPLY_BUSY( pxClient ) || ( pxClient->bits.bShutdown != pdFALSE_UNSIGNED ) )
+				{
+					break;
+				}
+
+				if( FreeRTOS_tx_space( pxClient->xSocket ) < httpREPLY_HEADER_SIZE )
+				{
+					/* Come back when the previous replies have been acknowledged. */
+					break;
+				}
+
+				xRc = prvReceiveRequest( pxClient );
+
+				if( xRc <= 0 )
+				{
+					break;
+				}
+
+				xRc = prvHandleRequest( pxClient, pcCOMMAND_BUFFER, xRc );
+
+				if( xRc < 0 )
+				{
+					break;
+				}
+
+				if( !httpREPLY_BUSY( pxClient ) )
+				{
+					prvRequestDone( pxClient );
+				}
 			}
+		}
 
-			while( xRc && ( pcBuffer[ xRc - 1 ] == 13 || pcBuffer[ xRc - 1 ] == 10 ) )
+		#if ( ipconfigHTTP_IDLE_TIMEOUT_MS > 0 )
+			if( ( xRc >= 0 ) &&
+				( ( xTaskGetTickCount() - pxClient->xLastActivity ) >= pdMS_TO_TICKS( ipconfigHTTP_IDLE_TIMEOUT_MS ) ) )
 			{
-				pcBuffer[ --xRc ] = '\0';
+				if( httpREPLY_BUSY( pxClient ) || ( pxClient->bits.bShutdown != pdFALSE_UNSIGNED ) )
+				{
+					/* A transfer has stalled, or the peer does not complete the
+					 * closure. */
+					xRc = -1;
+				}
+				else
+				{
+					/* Close the connection, the peer gets another period to do
+					 * the same. */
+					FreeRTOS_printf( ( "xHTTPClientWork: connection idle\n" ) );
+					pxClient->bits.bKeepAlive = pdFALSE_UNSIGNED;
+					prvRequestDone( pxClient );
+					httpACTIVITY( pxClient );
+				}
 			}
+		#endif /* ipconfigHTTP_IDLE_TIMEOUT_MS > 0 */
+
+		if( xRc < 0 )
+		{
+			/* The connection will be closed and the client will be deleted. */
+			FreeRTOS_printf( ( "xHTTPClientWork: rc = %ld\n", xRc ) );
+		}
+		else
+		{
+			prvSelectUpdate( pxClient );
+
+			#if ( ipconfigHTTP_IDLE_TIMEOUT_MS > 0 )
+				{
+					/* Be called again when the connection would become idle. */
+					vTCPServerSetDeadline( pxTCPClient, pxClient->xLastActivity + pdMS_TO_TICKS( ipconfigHTTP_IDLE_TIMEOUT_MS ) );
+				}
+			#endif
+		}
+
+		return xRc;
+	}
+/*-----------------------------------------------------------*/
 
-			pcEndOfCmd = pcBuffer + xRc;
+	static void prvSelectUpdate( HTTPClient_t * pxClient )
+	{
+		EventBits_t xWanted;
 
-			curCmd = xWebCommands;
+		if( pxClient->bits.bShutdown != pdFALSE_UNSIGNED )
+		{
+			/* Whatever arrives is discarded, until the peer closes. */
+			xWanted = ( EventBits_t ) ( eSELECT_READ | eSELECT_EXCEPT );
+			prvSetRxLowWater( pxClient, 0u );
+		}
+		else if( ( httpREPLY_BUSY( pxClient ) && !httpUPLOAD_BUSY( pxClient ) ) ||
+				 ( FreeRTOS_tx_space( pxClient->xSocket ) < httpREPLY_HEADER_SIZE ) )
+		{
+			/* A reply is being sent, or earlier replies still fill the TX
+			 * stream.  A next request may be waiting already, but it can
+			 * not be handled before there is space.  A peer that disappears
+			 * in the mean time is caught by ipconfigHTTP_IDLE_TIMEOUT_MS. */
+			xWanted = ( EventBits_t ) eSELECT_WRITE;
 
-			/* Pointing to "/index.html HTTP/1.1". */
-			pxClient->pcUrlData = pcBuffer;
+			if( FreeRTOS_connstatus( pxClient->xSocket ) != ( BaseType_t ) eCLOSE_WAIT )
+			{
+				/* Wake up when the connection breaks.  A peer that has only
+				 * closed its side may still receive the reply, that state
+				 * would be reported over and over. */
+				xWanted |= ( EventBits_t ) eSELECT_EXCEPT;
+			}
+		}
+		else
+		{
+			xWanted = ( EventBits_t ) ( eSELECT_READ | eSELECT_EXCEPT );
+		}
 
-			/* Pointing to "HTTP/1.1". */
-			pxClient->pcRestData = pcEmptyString;
+		if( xWanted != pxClient->xSelectBits )
+		{
+			/* Set the new events first: a socket without any events would be
+			 * taken out of the socket set. */
+			FreeRTOS_FD_SET( pxClient->xSocket, pxClient->pxParent->xSocketSet, xWanted );
+			FreeRTOS_FD_CLR( pxClient->xSocket, pxClient->pxParent->xSocketSet,
+							 ( ( EventBits_t ) ( eSELECT_READ | eSELECT_WRITE | eSELECT_EXCEPT ) ) & ~xWanted );
+			pxClient->xSelectBits = xWanted;
+		}
+	}
+/*-----------------------------------------------------------*/
 
-			/* Last entry is "ECMD_UNK". */
-			for( xIndex = 0; xIndex < WEB_CMD_COUNT - 1; xIndex++, curCmd++ )
+	static void prvSetRxLowWater( HTTPClient_t * pxClient,
+								  size_t uxLowWater )
+	{
+		#if ( ipconfigSELECT_USES_READY_LIST == 1 )
+			{
+				if( uxLowWater != pxClient->uxRxLowWater )
+				{
+					pxClient->uxRxLowWater = uxLowWater;
+					( void ) FreeRTOS_setsockopt( pxClient->xSocket, 0, FREERTOS_SO_SELECT_RCVLOWAT, ( void * ) &uxLowWater, sizeof( uxLowWater ) );
+				}
+			}
+		#else
 			{
-				BaseType_t xLength;
+				/* FreeRTOS_select() has no low-water marks. */
+				( void ) pxClient;
+				( void ) uxLowWater;
+			}
+		#endif
+	}
+/*-----------------------------------------------------------*/
 
-				xLength = curCmd->xCommandLength;
+	static BaseType_t prvReceiveRequest( HTTPClient_t * pxClient )
+	{
+		BaseType_t xRc;
+		BaseType_t xIndex;
+		BaseType_t xLength = 0;
+		char * pcBuffer = pcCOMMAND_BUFFER;
 
-				if( ( xRc >= xLength ) && ( memcmp( curCmd->pcCommandName, pcBuffer, xLength ) == 0 ) )
+		/* Look at the data without taking them: there may be more than one
+		 * request, or only a part of one. */
+		xRc = xTCPServerPeek( ( TCPClient_t * ) pxClient, pcBuffer, sizeof( pcCOMMAND_BUFFER ) - 1u );
+
+		if( xRc > 0 )
+		{
+			/* The header ends with an empty line, "\r\n\r\n" or "\n\n". */
+			for( xIndex = 1; xIndex < xRc; xIndex++ )
+			{
+				if( ( pcBuffer[ xIndex ] == '\n' ) &&
+					( ( pcBuffer[ xIndex - 1 ] == '\n' ) ||
+					  ( ( xIndex >= 2 ) && ( pcBuffer[ xIndex - 1 ] == '\r' ) && ( pcBuffer[ xIndex - 2 ] == '\n' ) ) ) )
 				{
-					char * pcLastPtr;
+					xLength = xIndex + 1;
+					break;
+				}
+			}
 
-					pxClient->pcUrlData += xLength + 1;
+			if( xLength != 0 )
+			{
+				prvSetRxLowWater( pxClient, 0u );
+				httpACTIVITY( pxClient );
+				xRc = xTCPServerTake( ( TCPClient_t * ) pxClient, pcBuffer, ( size_t ) xLength );
 
-					for( pcLastPtr = ( char * ) pxClient->pcUrlData; pcLastPtr < pcEndOfCmd; pcLastPtr++ )
-					{
-						char ch = *pcLastPtr;
+				if( xRc > 0 )
+				{
+					pcBuffer[ xRc ] = '\0';
+				}
+			}
+			else if( xRc >= ( BaseType_t ) sizeof( pcCOMMAND_BUFFER ) - 1 )
+			{
+				/* The header does not fit in the buffer, it can not be handled. */
+				FreeRTOS_printf( ( "prvReceiveRequest: header too long\n" ) );
+				pxClient->bits.bKeepAlive = pdFALSE_UNSIGNED;
+				strcpy( pxClient->pxParent->pcExtraContents, "Content-Length: 0\r\n" );
+				xRc = prvSendReply( pxClient, WEB_BAD_REQUEST );
 
-						if( ( ch == '\0' ) || ( strchr( "\n\r \t", ch ) != NULL ) )
-						{
-							*pcLastPtr = '\0';
-							pxClient->pcRestData = pcLastPtr + 1;
-							break;
-						}
+				if( xRc >= 0 )
+				{
+					prvRequestDone( pxClient );
+					xRc = 0;
+				}
+			}
+			else if( FreeRTOS_connstatus( pxClient->xSocket ) != ( BaseType_t ) eESTABLISHED )
+			{
+				/* The peer has closed its side, the header will never be
+				 * completed. */
+				xRc = -1;
+			}
+			else
+			{
+				/* Wait for the rest of the header, without being woken up for
+				 * the bytes that have been looked at already. */
+				#if ( ipconfigSELECT_USES_READY_LIST == 1 )
+					{
+						prvSetRxLowWater( pxClient, ( size_t ) xRc + 1u );
+					}
+				#else
+					{
+						vTCPServerKeep( ( TCPClient_t * ) pxClient, ( size_t ) xRc );
 					}
+				#endif
+				xRc = 0;
+			}
+		}
+
+		return xRc;
+	}
+/*-----------------------------------------------------------*/
+
+	static BaseType_t prvHandleRequest( HTTPClient_t * pxClient,
+										char * pcBuffer,
+										BaseType_t xRc )
+	{
+		BaseType_t xIndex, xLength;
+		const char * pcEndOfCmd;
+		const char * pcValue;
+		char * pcLine;
+
+		/* Empty lines may precede a request. */
+		while( ( *pcBuffer == '\r' ) || ( *pcBuffer == '\n' ) )
+		{
+			pcBuffer++;
+			xRc--;
+		}
+
+		/* The header lines follow the request line. */
+		pcLine = strchr( pcBuffer, '\n' );
+		pxClient->pcHeaders = ( pcLine != NULL ) ? pcLine + 1 : pcEmptyString;
+
+		/* Only the request line is parsed below. */
+		for( xLength = 0; xLength < xRc; xLength++ )
+		{
+			if( ( pcBuffer[ xLength ] == '\r' ) || ( pcBuffer[ xLength ] == '\n' ) )
+			{
+				break;
+			}
+		}
+
+		xRc = xLength;
+		pcEndOfCmd = pcBuffer + xRc;
+
+		/* Pointing to "/index.html HTTP/1.1". */
+		pxClient->pcUrlData = pcBuffer;
+
+		/* Pointing to "HTTP/1.1". */
+		pxClient->pcRestData = pcEmptyString;
+
+		/* The method ends at the first space. */
+		xLength = 0;
+
+		while( ( xLength < xRc ) && ( pcBuffer[ xLength ] != ' ' ) )
+		{
+			xLength++;
+		}
 
+		xIndex = prvFindCommand( pcBuffer, xLength );
+
+		if( xIndex < ( WEB_CMD_COUNT - 1 ) )
+		{
+			char * pcLastPtr;
+
+			pxClient->pcUrlData += xLength + 1;
+
+			for( pcLastPtr = ( char * ) pxClient->pcUrlData; pcLastPtr < pcEndOfCmd; pcLastPtr++ )
+			{
+				char ch = *pcLastPtr;
+
+				if( ( ch == '\0' ) || ( strchr( "\n\r \t", ch ) != NULL ) )
+				{
+					*pcLastPtr = '\0';
+					pxClient->pcRestData = pcLastPtr + 1;
 					break;
 				}
 			}
+		}
 
-			if( xIndex < ( WEB_CMD_COUNT - 1 ) )
+		/* HTTP/1.1 connections are persistent unless the client says
+		 * otherwise, HTTP/1.0 connections only when the client asks for it. */
+		pxClient->bits.bKeepAlive = ( strncmp( pxClient->pcRestData, "HTTP/1.1", 8 ) == 0 ) ? pdTRUE_UNSIGNED : pdFALSE_UNSIGNED;
+		pcValue = prvFindHeader( pxClient, "Connection" );
+
+		if( pcValue != NULL )
+		{
+			if( strncasecmp( pcValue, "close", 5 ) == 0 )
+			{
+				pxClient->bits.bKeepAlive = pdFALSE_UNSIGNED;
+			}
+			else if( strncasecmp( pcValue, "keep-alive", 10 ) == 0 )
 			{
-				xRc = prvProcessCmd( pxClient, xIndex );
+				pxClient->bits.bKeepAlive = pdTRUE_UNSIGNED;
 			}
 		}
-		else if( xRc < 0 )
+
+		pxClient->uxRequestCount++;
+
+		/* Nothing of the previous reply may end up in the next one. */
+		pxClient->bits.bGzip = pdFALSE_UNSIGNED;
+		#if ( ipconfigHTTP_HAS_VALIDATORS != 0 )
+			{
+				pxClient->pcValidators[ 0 ] = '\0';
+			}
+		#endif
+
+		if( pxClient->uxRequestCount >= ( UBaseType_t ) ipconfigHTTP_KEEP_ALIVE_MAX )
 		{
-			/* The connection will be closed and the client will be deleted. */
-			FreeRTOS_printf( ( "xHTTPClientWork: rc = %ld\n", xRc ) );
+			pxClient->bits.bKeepAlive = pdFALSE_UNSIGNED;
 		}
 
-		return xRc;
+		return prvProcessCmd( pxClient, xIndex );
+	}
+/*-----------------------------------------------------------*/
+
+	static const char * prvFindHeader( HTTPClient_t * pxClient,
+									   const char * pcName )
+	{
+		const char * pcLine = pxClient->pcHeaders;
+		const char * pcResult = NULL;
+		size_t uxLength = strlen( pcName );
+
+		while( ( pcLine != NULL ) && ( *pcLine != '\0' ) && ( *pcLine != '\r' ) && ( *pcLine != '\n' ) )
+		{
+			if( ( strncasecmp( pcLine, pcName, uxLength ) == 0 ) && ( pcLine[ uxLength ] == ':' ) )
+			{
+				pcResult = pcLine + uxLength + 1;
+
+				while( ( *pcResult == ' ' ) || ( *pcResult == '\t' ) )
+				{
+					pcResult++;
+				}
+
+				break;
+			}
+
+			pcLine = strchr( pcLine, '\n' );
+
+			if( pcLine != NULL )
+			{
+				pcLine++;
+			}
+		}
+
+		return pcResult;
 	}
 /*-----------------------------------------------------------*/
 
-	static const char * pcGetContentsType( const char * apFname )
+	static void prvRequestDone( HTTPClient_t * pxClient )
+	{
+		if( ( pxClient->bits.bKeepAlive == pdFALSE_UNSIGNED ) && ( pxClient->bits.bShutdown == pdFALSE_UNSIGNED ) )
+		{
+			/* The FIN is sent once all queued data has been acknowledged. */
+			FreeRTOS_shutdown( pxClient->xSocket, FREERTOS_SHUT_RDWR );
+			pxClient->bits.bShutdown = pdTRUE_UNSIGNED;
+		}
+	}
+/*-----------------------------------------------------------*/
+
+	static const TypeCouple_t * pxFindTypeCouple( const char * pcName,
+												  size_t uxLength )
 	{
 		const char * slash = NULL;
 		const char * dot = NULL;
 		const char * ptr;
-		const char * pcResult = "text/html";
+		const TypeCouple_t * pxResult = NULL;
 		BaseType_t x;
 
-		for( ptr = apFname; *ptr; ptr++ )
+		for( ptr = pcName; ptr < pcName + uxLength; ptr++ )
 		{
 			if( *ptr == '.' )
 			{
@@ -443,15 +2569,51 @@
 
 			for( x = 0; x < ARRAY_SIZE( pxTypeCouples ); x++ )
 			{
-				if( strcasecmp( dot, pxTypeCouples[ x ].pcExtension ) == 0 )
+				if( ( strncasecmp( dot, pxTypeCouples[ x ].pcExtension, ( size_t ) ( pcName + uxLength - dot ) ) == 0 ) &&
+					( pxTypeCouples[ x ].pcExtension[ pcName + uxLength - dot ] == '\0' ) )
 				{
-					pcResult = pxTypeCouples[ x ].pcType;
+					pxResult = &( pxTypeCouples[ x ] );
 					break;
 				}
 			}
 		}
 
-		return pcResult;
+		return pxResult;
+	}
+/*-----------------------------------------------------------*/
+
+	static const char * prvContentsType( HTTPClient_t * pxClient )
+	{
+		const TypeCouple_t * pxCouple;
+		size_t uxLength = strlen( pxClient->pcCurrentFilename );
+
+		if( pxClient->bits.bGzip != pdFALSE_UNSIGNED )
+		{
+			/* The type of 'name.js.gz' is the type of 'name.js'. */
+			uxLength -= 3u;
+		}
+
+		pxCouple = pxFindTypeCouple( pxClient->pcCurrentFilename, uxLength );
+
+		return ( pxCouple != NULL ) ? pxCouple->pcType : "text/html";
+	}
+/*-----------------------------------------------------------*/
+
+	static void prvFileHeaders( HTTPClient_t * pxClient,
+								char * pcBuffer,
+								size_t uxBufferSize )
+	{
+		const char * pcValidators = pcEmptyString;
+
+		#if ( ipconfigHTTP_HAS_VALIDATORS != 0 )
+			{
+				pcValidators = pxClient->pcValidators;
+			}
+		#endif
+
+		snprintf( pcBuffer, uxBufferSize, "%s%s",
+				  pcValidators,
+				  ( pxClient->bits.bGzip != pdFALSE_UNSIGNED ) ? "Content-Encoding: gzip\r\nVary: Accept-Encoding\r\n" : "" );
 	}
 
 #endif /* ipconfigUSE_HTTP */
@@ -68,6 +68,7 @@
 #define REPL_501			  "501 Syntax error in parameters or arguments.\r\n"
 #define REPL_502			  "502 Command not implemented.\r\n"
 #define REPL_503			  "503 Bad sequence of commands.\r\n"
+#define REPL_503_EPSV_ALL	  "503 Only EPSV is allowed after EPSV ALL.\r\n"
 #define REPL_504			  "504 Command not implemented for that parameter.\r\n"
 #define REPL_530			  "530 Not logged in.\r\n"
 #define REPL_532			  "532 Need account for storing files.\r\n"
@@ -76,6 +77,7 @@
 #define REPL_552			  "552 Requested file action aborted.\r\n"
 #define REPL_553			  "553 Requested action not taken.\r\n"
 #define REPL_553_READ_ONLY	  "553 Read-only file-system.\r\n"
+#define REPL_522			  "522 Network protocol not supported, use (1)\r\n"
 
 enum EFTPCommand
 {
@@ -111,12 +113,18 @@ enum EFTPCommand
 	ECMD_PWD,
 	ECMD_LIST,
 	ECMD_NLST,
+	ECMD_MLSD,
+	ECMD_MLST,
 	ECMD_SITE,
 	ECMD_SYST,
 	ECMD_FEAT,
 	ECMD_STAT,
 	ECMD_HELP,
 	ECMD_NOOP,
+	ECMD_OPTS,
+	ECMD_HASH,
+	ECMD_XCRC,
+	ECMD_XMD5,
 	ECMD_EMPTY,
 	ECMD_CLOSE,
 	ECMD_UNKNOWN,
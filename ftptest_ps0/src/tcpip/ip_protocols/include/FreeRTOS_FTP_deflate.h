@@ -0,0 +1,128 @@
+/*
+ * FreeRTOS+TCP V2.3.2
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/*
+ * A small streaming implementation of the zlib format (RFC 1950 / 1951), as
+ * used by the FTP 'MODE Z' transfer mode.  The compressor only produces blocks
+ * with the fixed Huffman codes, the decompressor accepts any valid stream.
+ * Both work on buffers of their own, the size of which is fixed when the
+ * object is created.
+ */
+
+#ifndef FREERTOS_FTP_DEFLATE_H
+	#define FREERTOS_FTP_DEFLATE_H
+
+	#ifdef __cplusplus
+		extern "C" {
+	#endif
+
+/*
+ * ipconfigFTP_HAS_MODE_Z : when non-zero, the FTP server accepts 'MODE Z',
+ * in which the data of RETR and STOR are sent as a zlib stream.
+ */
+	#ifndef ipconfigFTP_HAS_MODE_Z
+		#define ipconfigFTP_HAS_MODE_Z    0
+	#endif
+
+/*
+ * ipconfigFTP_DEFLATE_LEVEL : compression level from 1 (fast) to 9 (small),
+ * it determines how long the compressor searches for a repeated string.
+ */
+	#ifndef ipconfigFTP_DEFLATE_LEVEL
+		#define ipconfigFTP_DEFLATE_LEVEL    6
+	#endif
+
+/*
+ * ipconfigFTP_DEFLATE_WINDOW_BITS : 2-log of the distance over which the
+ * compressor looks back, 9 to 15.  A compressor needs about 5 times this
+ * amount of RAM.
+ */
+	#ifndef ipconfigFTP_DEFLATE_WINDOW_BITS
+		#define ipconfigFTP_DEFLATE_WINDOW_BITS    12
+	#endif
+
+/*
+ * ipconfigFTP_INFLATE_WINDOW_BITS : the largest window that a peer may use
+ * when compressing, 8 to 15.  A decompressor needs a little more than the
+ * window size of RAM.  Streams that announce a larger window are refused.
+ * Most clients use the default of zlib, which is 15.
+ */
+	#ifndef ipconfigFTP_INFLATE_WINDOW_BITS
+		#define ipconfigFTP_INFLATE_WINDOW_BITS    15
+	#endif
+
+/* Return values of xFTPDeflateRun() and xFTPInflateRun(). */
+	#define ftpZ_BUSY     0     /* More input, or more space for output is needed. */
+	#define ftpZ_DONE     1     /* The end of the stream has been reached. */
+	#define ftpZ_ERROR    ( -1 ) /* A corrupt stream, or out of memory. */
+
+	struct xFTP_DEFLATE;
+	struct xFTP_INFLATE;
+
+	typedef struct xFTP_DEFLATE   FTPDeflate_t;
+	typedef struct xFTP_INFLATE   FTPInflate_t;
+
+/*
+ * Compressor.  Call uxFTPDeflateInput() to get a pointer to free space in the
+ * window, store the data there and call vFTPDeflateInputDone().  The zlib
+ * stream produced by xFTPDeflateRun() is taken with uxFTPDeflateOutput() and
+ * vFTPDeflateOutputDone().  Pass xFinish = pdTRUE once all input has been
+ * given.
+ */
+	FTPDeflate_t * pxFTPDeflateCreate( BaseType_t xLevel );
+	void vFTPDeflateDelete( FTPDeflate_t * pxDeflate );
+	size_t uxFTPDeflateInput( FTPDeflate_t * pxDeflate,
+							  uint8_t ** ppucBuffer );
+	void vFTPDeflateInputDone( FTPDeflate_t * pxDeflate,
+							   size_t uxCount );
+	BaseType_t xFTPDeflateRun( FTPDeflate_t * pxDeflate,
+							   BaseType_t xFinish );
+	size_t uxFTPDeflateOutput( FTPDeflate_t * pxDeflate,
+							   const uint8_t ** ppucData );
+	void vFTPDeflateOutputDone( FTPDeflate_t * pxDeflate,
+								size_t uxCount );
+
+/*
+ * Decompressor.  uxFTPInflateWrite() copies compressed data and returns the
+ * number of bytes accepted.  The decompressed data, produced by
+ * xFTPInflateRun(), must be taken with uxFTPInflateOutput() and
+ * vFTPInflateOutputDone() before more can be produced.
+ */
+	FTPInflate_t * pxFTPInflateCreate( void );
+	void vFTPInflateDelete( FTPInflate_t * pxInflate );
+	size_t uxFTPInflateWrite( FTPInflate_t * pxInflate,
+							  const uint8_t * pucData,
+							  size_t uxLength );
+	BaseType_t xFTPInflateRun( FTPInflate_t * pxInflate );
+	size_t uxFTPInflateOutput( FTPInflate_t * pxInflate,
+							   const uint8_t ** ppucData );
+	void vFTPInflateOutputDone( FTPInflate_t * pxInflate,
+								size_t uxCount );
+
+	#ifdef __cplusplus
+		} /* extern "C" */
+	#endif
+
+#endif /* FREERTOS_FTP_DEFLATE_H */
@@ -0,0 +1,127 @@
+/*
+ * FreeRTOS+TCP V2.3.2
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/*
+ * The digests used by the FTP commands HASH, XCRC and XMD5: CRC-32 (the one
+ * of zip and Ethernet), MD5 and SHA-256.  The digests are calculated
+ * incrementally, so that a large file can be hashed in parts.
+ */
+
+#ifndef FREERTOS_FTP_HASH_H
+	#define FREERTOS_FTP_HASH_H
+
+	#ifdef __cplusplus
+		extern "C" {
+	#endif
+
+/*
+ * ipconfigFTP_HAS_HASH : when non-zero, the FTP server accepts the commands
+ * HASH, XCRC and XMD5, which return the digest of a file.
+ */
+	#ifndef ipconfigFTP_HAS_HASH
+		#define ipconfigFTP_HAS_HASH    0
+	#endif
+
+/*
+ * ipconfigFTP_HASH_ON_STORE : when non-zero, the digest of a file is also
+ * calculated while it is received with STOR.  A hash command about that file
+ * is then answered without reading it back.  The algorithm is the one that
+ * the client used last, CRC-32 at first.
+ */
+	#ifndef ipconfigFTP_HASH_ON_STORE
+		#define ipconfigFTP_HASH_ON_STORE    0
+	#endif
+
+/*
+ * ipconfigFTP_STORE_CRC : when non-zero, a CRC-32 is calculated of every file
+ * received with STOR.  It is shown by STAT and 'SITE CRC', and added to an
+ * index file in the same directory.  With 'SITE CRCCHECK', a client announces
+ * the CRC of its next upload, and a file that arrives damaged is refused.
+ */
+	#ifndef ipconfigFTP_STORE_CRC
+		#define ipconfigFTP_STORE_CRC    0
+	#endif
+
+/*
+ * ipconfigFTP_CRC_INDEX_NAME : the name of the index file, which has a line
+ * "CRC size cluster modified name" for every file stored in the directory.
+ * Like the HASH cache, a line is only valid while the size, the first cluster
+ * and the time of the last change of the file are the same.  After every
+ * upload the index is rewritten with one line per file, so it does not grow.
+ * Clients can not store, delete or rename the index.
+ */
+	#ifndef ipconfigFTP_CRC_INDEX_NAME
+		#define ipconfigFTP_CRC_INDEX_NAME    ".crc32"
+	#endif
+
+/* The algorithms. */
+	#define ftpHASH_CRC32			   0
+	#define ftpHASH_MD5				   1
+	#define ftpHASH_SHA256			   2
+
+/* The longest digest in hex, plus a terminating zero. */
+	#define ftpHASH_MAX_HEX_LENGTH	   65
+
+	typedef struct xFTP_HASH
+	{
+		BaseType_t xType;      /* One of the ftpHASH_xxx values. */
+		uint64_t ullLength;    /* The number of bytes hashed so far. */
+		uint32_t ulState[ 8 ]; /* The CRC in ulState[ 0 ], or the MD5/SHA-256 state. */
+		uint8_t ucBlock[ 64 ]; /* A partial block of MD5/SHA-256. */
+	} FTPHash_t;
+
+/*
+ * Update a CRC-32.  Start with ulCrc = 0, the result is the final CRC.
+ */
+	uint32_t ulFTPCrc32( uint32_t ulCrc,
+						 const uint8_t * pucData,
+						 size_t uxLength );
+
+	void vFTPHashInit( FTPHash_t * pxHash,
+					   BaseType_t xType );
+	void vFTPHashUpdate( FTPHash_t * pxHash,
+						 const void * pvData,
+						 size_t uxLength );
+
+/*
+ * Finish the digest and write it in hex to pcHex, which must have space for
+ * ftpHASH_MAX_HEX_LENGTH characters.  The CRC is written in upper case, as
+ * XCRC does.  After this call, the object must be initialised again.
+ */
+	void vFTPHashFinal( FTPHash_t * pxHash,
+						char * pcHex );
+
+/*
+ * The name of an algorithm as used by HASH and FEAT, e.g. "SHA-256", and the
+ * reverse, which returns -1 for an unknown name.
+ */
+	const char * pcFTPHashName( BaseType_t xType );
+	BaseType_t xFTPHashType( const char * pcName );
+
+	#ifdef __cplusplus
+		} /* extern "C" */
+	#endif
+
+#endif /* FREERTOS_FTP_HASH_H */
@@ -38,6 +38,69 @@
 		#define FTP_SERVER_USES_RELATIVE_DIRECTORY    0
 	#endif
 
+/* The maximum number of tasks that serve the clients of a TCP server,
+ * including the task that accepts new clients. */
+	#ifndef ipconfigTCP_SERVER_MAX_WORKERS
+		#define ipconfigTCP_SERVER_MAX_WORKERS    ( 1 )
+	#endif
+
+/* The HTTP server closes a connection on which nothing was received or sent
+ * during this number of ms.  Zero disables the time-out.  The server task is
+ * woken up when the time-out of one of its connections expires. */
+	#ifndef ipconfigHTTP_IDLE_TIMEOUT_MS
+		#define ipconfigHTTP_IDLE_TIMEOUT_MS    ( 0 )
+	#endif
+
+/* The maximum number of ranges in the 'Range' header of an HTTP request.  A
+ * request for more ranges is answered with the complete file.  Zero disables
+ * range requests. */
+	#ifndef ipconfigHTTP_MAX_RANGES
+		#define ipconfigHTTP_MAX_RANGES    0
+	#endif
+
+/* The number of small files that the HTTP server keeps in RAM together with
+ * the header of their reply, and the size of the largest file that is kept.
+ * Zero disables the cache. */
+	#ifndef ipconfigHTTP_CACHE_COUNT
+		#define ipconfigHTTP_CACHE_COUNT    0
+	#endif
+
+	#ifndef ipconfigHTTP_CACHE_MAX_FILE
+		#define ipconfigHTTP_CACHE_MAX_FILE    ( 16u * 1024u )
+	#endif
+
+/* Send ETag and Last-Modified headers with files, and answer a conditional GET
+ * or HEAD with '304 Not Modified' when the client's copy is still valid. */
+	#ifndef ipconfigHTTP_HAS_VALIDATORS
+		#define ipconfigHTTP_HAS_VALIDATORS    0
+	#endif
+
+/* When a client accepts gzip, send a precompressed 'name.gz' in stead of the
+ * requested file, if it exists, with 'Content-Encoding: gzip'. */
+	#ifndef ipconfigHTTP_HAS_GZIP
+		#define ipconfigHTTP_HAS_GZIP    0
+	#endif
+
+/* Store the body of a PUT or POST request in the file named by the URL.  The
+ * body may have a Content-Length or be chunked. */
+	#ifndef ipconfigHTTP_HAS_UPLOAD
+		#define ipconfigHTTP_HAS_UPLOAD    0
+	#endif
+
+/* Keep statistics of the sessions and transfers of the FTP server, see
+ * FreeRTOS_FTPGetStats() and 'SITE STATS'. */
+	#ifndef ipconfigFTP_HAS_STATS
+		#define ipconfigFTP_HAS_STATS    0
+	#endif
+
+/* A free running clock that measures the time spent in the file system and
+ * waiting for the network, and its frequency.  The tick count is too coarse
+ * to measure a single disk access, a hardware timer is better. */
+	#ifndef ipconfigFTP_STATS_CLOCK
+		#define ipconfigFTP_STATS_CLOCK()     ( ( uint32_t ) xTaskGetTickCount() )
+		#define ipconfigFTP_STATS_CLOCK_HZ    ( ( uint32_t ) configTICK_RATE_HZ )
+	#endif
+
 	enum eSERVER_TYPE
 	{
 		eSERVER_NONE,
@@ -91,6 +154,92 @@
 													   FTPUserProperties_t * pxProperties );
 	#endif /* ipconfigFTP_HAS_USER_PASSWORD_HOOK */
 
+/* The number of memory sinks that can be registered with
+ * FreeRTOS_FTPAddMemorySink(). */
+	#ifndef ipconfigFTP_MEMORY_SINK_COUNT
+		#define ipconfigFTP_MEMORY_SINK_COUNT    0
+	#endif
+
+/* The number of memory sources that can be registered with
+ * FreeRTOS_FTPAddMemorySource(). */
+	#ifndef ipconfigFTP_MEMORY_SOURCE_COUNT
+		#define ipconfigFTP_MEMORY_SOURCE_COUNT    0
+	#endif
+
+/* The virtual directory in which the memory sinks and sources appear to FTP
+ * clients. */
+	#ifndef ipconfigFTP_MEMORY_DIRECTORY
+		#define ipconfigFTP_MEMORY_DIRECTORY    "/mem"
+	#endif
+
+	#if ( ipconfigFTP_MEMORY_SINK_COUNT > 0 )
+
+		/*
+		 * A file that is stored with STOR as ipconfigFTP_MEMORY_DIRECTORY "/" pcName
+		 * is not written to the disk.  The data are copied straight from the
+		 * TCP reception buffer to pucBuffer, or passed to fWrite() when pucBuffer
+		 * is NULL.  ulOffset is non-zero after REST.  fWrite() returns pdFALSE to
+		 * abort the upload.  fDone(), when not NULL, is called once the upload has
+		 * ended, with the length of the data in the sink.
+		 */
+		typedef struct xFTP_MEMORY_SINK
+		{
+			const char * pcName;
+			uint8_t * pucBuffer;
+			size_t uxSize; /* Size of pucBuffer, or the maximum size passed to fWrite(). */
+			BaseType_t ( * fWrite )( void * pvContext,
+									 uint32_t ulOffset,
+									 const uint8_t * pucData,
+									 size_t uxLength );
+			void ( * fDone )( void * pvContext,
+							  uint32_t ulLength,
+							  BaseType_t xSuccess );
+			void * pvContext;
+		} FTPMemorySink_t;
+
+		/* The contents of *pxSink are copied, pcName must stay valid.  Returns
+		 * pdFALSE when the name is in use or when there is no free slot. */
+		BaseType_t FreeRTOS_FTPAddMemorySink( const FTPMemorySink_t * pxSink );
+
+		/* Returns pdFALSE when the sink does not exist, or while it is receiving. */
+		BaseType_t FreeRTOS_FTPRemoveMemorySink( const char * pcName );
+	#endif /* ipconfigFTP_MEMORY_SINK_COUNT > 0 */
+
+	#if ( ipconfigFTP_MEMORY_SOURCE_COUNT > 0 )
+
+		/*
+		 * A read-only file ipconfigFTP_MEMORY_DIRECTORY "/" pcName, which RETR,
+		 * SIZE and MDTM take from memory instead of from the disk.  RETR sends
+		 * pucData directly, or the data that fRead() produces when pucData is
+		 * NULL.  fRead() writes uxLength bytes at offset ulOffset of the file to
+		 * pucBuffer, which may be the TX stream of the socket, and returns the
+		 * number of bytes written.  A short count aborts the transfer.
+		 */
+		typedef struct xFTP_MEMORY_SOURCE
+		{
+			const char * pcName;
+			const uint8_t * pucData;
+			size_t uxSize;
+			size_t ( * fRead )( void * pvContext,
+								uint32_t ulOffset,
+								uint8_t * pucBuffer,
+								size_t uxLength );
+			void * pvContext;
+		} FTPMemorySource_t;
+
+		/* The contents of *pxSource are copied, pcName must stay valid.  The
+		 * time of the file, as shown by MDTM, is the time of registration. */
+		BaseType_t FreeRTOS_FTPAddMemorySource( const FTPMemorySource_t * pxSource );
+
+		/* Tell that the contents of a source have changed: set its size and
+		 * its time to now. */
+		BaseType_t FreeRTOS_FTPTouchMemorySource( const char * pcName,
+												  size_t uxSize );
+
+		/* Returns pdFALSE when the source does not exist, or while it is sent. */
+		BaseType_t FreeRTOS_FTPRemoveMemorySource( const char * pcName );
+	#endif /* ipconfigFTP_MEMORY_SOURCE_COUNT > 0 */
+
 	#if ( ipconfigHTTP_HAS_HANDLE_REQUEST_HOOK != 0 )
 
 		/*
@@ -119,6 +268,15 @@
 
 	TCPServer_t * FreeRTOS_CreateTCPServer( const struct xSERVER_CONFIG * pxConfigs,
 											BaseType_t xCount );
+
+	#if ( ipconfigTCP_SERVER_MAX_WORKERS > 1 )
+
+		/* Create a server whose clients are divided among 'xWorkerCount' tasks.
+		 * The calling task is the first worker, the others are created here. */
+		TCPServer_t * FreeRTOS_CreateTCPServerWorkers( const struct xSERVER_CONFIG * pxConfigs,
+													   BaseType_t xCount,
+													   BaseType_t xWorkerCount );
+	#endif
 	void FreeRTOS_TCPServerWork( TCPServer_t * pxServer,
 								 TickType_t xBlockingTime );
 
@@ -133,6 +291,48 @@
 													BaseType_t * pxHigherPriorityTaskWoken );
 	#endif
 
+	#if ( ipconfigUSE_HTTP != 0 ) && ( ipconfigHTTP_CACHE_COUNT > 0 )
+
+		/* Files may have been changed, removed or renamed: cached files will be
+		 * checked against the disk before they are sent again.  Changes made
+		 * through FreeRTOS+FAT are noticed without it, see ff_dirchanges(); it
+		 * is needed when the contents of a disk change in another way. */
+		void FreeRTOS_HTTPCacheChanged( void );
+	#endif
+
+	#if ( ipconfigFTP_HAS_STATS != 0 )
+
+		/* All times are in milliseconds. */
+		typedef struct xFTP_TRANSFER_STATS
+		{
+			uint32_t ulBytes;     /* The number of bytes sent or received. */
+			uint32_t ulDuration;  /* From the start of the transfer until the end, or until now. */
+			uint32_t ulDiskTime;  /* The time spent reading or writing the file. */
+			uint32_t ulWaitTime;  /* The time the TX stream was full (RETR) or the RX stream was empty (STOR). */
+			BaseType_t xSending;  /* pdTRUE for RETR, pdFALSE for STOR. */
+			BaseType_t xSuccess;  /* pdTRUE when the transfer ended normally. */
+		} FTPTransferStats_t;
+
+		typedef struct xFTP_SESSION_STATS
+		{
+			uint32_t ulClientIP;     /* In network byte order. */
+			uint16_t usClientPort;
+			TickType_t xConnectTime; /* The tick count when the client connected. */
+			uint32_t ulFilesSent;
+			uint32_t ulFilesReceived;
+			uint64_t ullBytesSent;
+			uint64_t ullBytesReceived;
+			BaseType_t xBusy;               /* pdTRUE while xTransfer is running. */
+			FTPTransferStats_t xTransfer;   /* The running or the last transfer. */
+		} FTPSessionStats_t;
+
+		/* Copy the statistics of at most xMaxCount FTP sessions of a server and
+		 * of its workers.  Returns the number of sessions copied. */
+		BaseType_t FreeRTOS_FTPGetStats( TCPServer_t * pxServer,
+										 FTPSessionStats_t * pxStats,
+										 BaseType_t xMaxCount );
+	#endif /* ipconfigFTP_HAS_STATS != 0 */
+
 	#ifdef __cplusplus
 		} /* extern "C" */
 	#endif
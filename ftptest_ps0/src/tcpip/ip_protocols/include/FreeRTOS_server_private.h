@@ -56,7 +56,83 @@
 	#define ipconfigTCP_FILE_BUFFER_SIZE    ( 2048 )
 #endif
 
+/*
+ * The FTP and HTTP clients are allocated with pvPortMallocClient().  When the
+ * slab allocator of FreeRTOS+TCP is used, they get a cache of their own.
+ */
+#ifndef pvPortMallocClient
+	#if ( ipconfigUSE_SLAB_ALLOCATOR == 1 )
+		#define pvPortMallocClient( x )    pvSlabMalloc( eSlabTCPClient, x )
+		#define vPortFreeClient( ptr )     vSlabFree( ptr )
+	#else
+		#define pvPortMallocClient( x )    pvPortMallocLarge( x )
+		#define vPortFreeClient( ptr )     vPortFreeLarge( ptr )
+	#endif
+#endif
+
+/*
+ * When FreeRTOS_select_ready() is available, the server only works on the
+ * clients that have events.  ipconfigTCP_SERVER_READY_COUNT is the maximum
+ * number of ready sockets handled in one cycle.
+ */
+#ifndef ipconfigTCP_SERVER_READY_COUNT
+	#define ipconfigTCP_SERVER_READY_COUNT    ( 8 )
+#endif
+
+/*
+ * The clients of a TCP server may be spread over a number of worker tasks,
+ * see FreeRTOS_CreateTCPServerWorkers().  Each worker has its own socket set
+ * and its own buffers.  A worker is woken up with a signal when a client is
+ * handed over to it.
+ */
+#if ( ipconfigTCP_SERVER_MAX_WORKERS > 1 )
+	#if ( ipconfigSUPPORT_SIGNALS == 0 )
+		#error ipconfigTCP_SERVER_MAX_WORKERS > 1 requires ipconfigSUPPORT_SIGNALS
+	#endif
+
+	#ifndef ipconfigTCP_SERVER_WORKER_STACK_SIZE
+		#define ipconfigTCP_SERVER_WORKER_STACK_SIZE    ( 1024 )
+	#endif
+
+	#ifndef ipconfigTCP_SERVER_WORKER_PRIORITY
+		#define ipconfigTCP_SERVER_WORKER_PRIORITY    ( tskIDLE_PRIORITY + 2 )
+	#endif
+
+/* The number of new clients that can wait to be taken by a worker. */
+	#ifndef ipconfigTCP_SERVER_HANDOVER_COUNT
+		#define ipconfigTCP_SERVER_HANDOVER_COUNT    ( 4 )
+	#endif
+#endif /* ipconfigTCP_SERVER_MAX_WORKERS > 1 */
+
+/*
+ * The bandwidth is shared among the clients of a server with a deficit round
+ * robin scheme: each time a client is called, ipconfigTCP_SERVER_QUANTUM bytes
+ * are added to its share, and the data transfers of the client stop as soon as
+ * the share is used up.  A share that is not used is not saved for later,
+ * bytes that are sent in excess are subtracted from the next share.  The
+ * quantum should be a multiple of the cluster size of the disk.  Zero means
+ * that a client may transfer as much as its sockets can take.
+ *
+ * ipconfigTCP_SERVER_RATE_LIMIT : when non-zero, the maximum number of bytes
+ * per second that each client may transfer.
+ */
+#ifndef ipconfigTCP_SERVER_QUANTUM
+	#define ipconfigTCP_SERVER_QUANTUM    ( 0 )
+#endif
+
+#ifndef ipconfigTCP_SERVER_RATE_LIMIT
+	#define ipconfigTCP_SERVER_RATE_LIMIT    ( 0 )
+#endif
+
+#if ( ipconfigTCP_SERVER_QUANTUM > 0 ) || ( ipconfigTCP_SERVER_RATE_LIMIT > 0 )
+	#define tcpserverHAS_BUDGET    1
+#else
+	#define tcpserverHAS_BUDGET    0
+#endif
+
 struct xTCP_CLIENT;
+/* A partial line that is kept by a client, see xTCPServerPeek(). */
+struct xTCP_LINE_BUFFER;
 
 typedef BaseType_t ( * FTCPWorkFunction ) ( struct xTCP_CLIENT * /* pxClient */ );
 typedef void ( * FTCPDeleteFunction ) ( struct xTCP_CLIENT * /* pxClient */ );
@@ -68,6 +144,14 @@ typedef void ( * FTCPDeleteFunction ) ( struct xTCP_CLIENT * /* pxClient */ );
 	const char * pcRootDir;				\
 	FTCPWorkFunction fWorkFunction;		\
 	FTCPDeleteFunction fDeleteFunction;	\
+	BaseType_t xIsReady;				\
+	int32_t lDeficit;					\
+	int32_t lTokens;					\
+	uint32_t ulRateLimit;				\
+	TickType_t xTokenTime;				\
+	TickType_t xDeadline;				\
+	BaseType_t xHasDeadline;			\
+	struct xTCP_LINE_BUFFER * pxKept;	\
 	struct xTCP_CLIENT * pxNextClient
 
 typedef struct xTCP_CLIENT
@@ -77,6 +161,8 @@ typedef struct xTCP_CLIENT
 	/* --- Keep at the top  --- */
 } TCPClient_t;
 
+struct xHTTP_CACHE_ENTRY;
+
 struct xHTTP_CLIENT
 {
 	/* This define contains fields which must come first within each of the client structs */
@@ -85,15 +171,58 @@ struct xHTTP_CLIENT
 
 	const char * pcUrlData;
 	const char * pcRestData;
+	const char * pcHeaders;     /* The header lines of the request, see prvFindHeader(). */
 	char pcCurrentFilename[ ffconfigMAX_FILENAME ];
 	size_t uxBytesLeft;
 	FF_FILE * pxFileHandle;
+	UBaseType_t uxRequestCount; /* The number of requests received on this connection. */
+	EventBits_t xSelectBits;    /* The events selected for xSocket, see prvSelectUpdate(). */
+	#if ( ipconfigSELECT_USES_READY_LIST == 1 )
+		size_t uxRxLowWater;    /* The FREERTOS_SO_SELECT_RCVLOWAT of xSocket. */
+	#endif
+	#if ( ipconfigHTTP_IDLE_TIMEOUT_MS > 0 )
+		TickType_t xLastActivity; /* The last time that a request came in, or that the transfer made progress. */
+	#endif
+	#if ( ipconfigHTTP_MAX_RANGES > 0 )
+		/* The ranges of a '206 Partial Content' reply.  When there is more than
+		 * one, each range is sent as a part of a multipart/byteranges body.
+		 * xRangeIndex is the next part to send, xRangeCount means the final
+		 * boundary. */
+		struct
+		{
+			uint32_t ulFirst;
+			uint32_t ulLast;
+		}
+		xRanges[ ipconfigHTTP_MAX_RANGES ];
+		BaseType_t xRangeCount;
+		BaseType_t xRangeIndex;
+	#endif
+	#if ( ipconfigHTTP_CACHE_COUNT > 0 )
+		/* The reply is sent from a cached copy, instead of from pxFileHandle. */
+		struct xHTTP_CACHE_ENTRY * pxCacheEntry;
+		size_t uxCacheOffset; /* The number of bytes of the cached reply sent. */
+	#endif
+	#if ( ipconfigHTTP_HAS_VALIDATORS != 0 )
+		/* The ETag and Last-Modified header lines of the requested file. */
+		char pcValidators[ 96 ];
+	#endif
+	#if ( ipconfigHTTP_HAS_UPLOAD != 0 )
+		FF_FILE * pxWriteHandle; /* PUT or POST: the file that receives the body. */
+		uint32_t ulBodyLeft;     /* The bytes left of the body, or of the current chunk. */
+		BaseType_t xChunkState;  /* The next line that is expected in a chunked body. */
+	#endif
 	union
 	{
 		struct
 		{
 			uint32_t
-				bReplySent : 1;
+				bReplySent : 1,
+				bKeepAlive : 1, /* The connection stays open after the reply. */
+				bHeadOnly : 1,  /* HEAD: send the header of the reply only. */
+				bShutdown : 1,  /* The last reply has been sent, the connection is closing. */
+				bGzip : 1,      /* pcCurrentFilename is the '.gz' version of the requested file. */
+				bChunked : 1,   /* The body of the request is chunked. */
+				bCreated : 1;   /* The uploaded file did not exist yet. */
 		};
 		uint32_t ulFlags;
 	}
@@ -102,6 +231,13 @@ struct xHTTP_CLIENT
 
 typedef struct xHTTP_CLIENT HTTPClient_t;
 
+struct xFTP_LIST_CACHE;
+struct xFTP_DEFLATE;
+struct xFTP_INFLATE;
+struct xFTP_FILE_DIGEST;
+struct xFTP_SINK_SLOT;
+struct xFTP_SOURCE_SLOT;
+
 struct xFTP_CLIENT
 {
 	/* This define contains fields which must come first within each of the client structs */
@@ -120,6 +256,35 @@ struct xFTP_CLIENT
 	FF_FindData_t xFindData;
 	FF_FILE * pxReadHandle;
 	FF_FILE * pxWriteHandle;
+	uint32_t ulAllocSize; /* Size announced by ALLO, used by the next STOR. */
+	uint32_t ulAllocated; /* Size for which clusters have been reserved. */
+	/* A directory listing that is being sent from, or stored in the cache. */
+	struct xFTP_LIST_CACHE * pxListCache;
+	size_t uxListOffset; /* Number of bytes of the cached listing sent. */
+	/* In MODE Z, the data of RETR are compressed, and of STOR decompressed. */
+	struct xFTP_DEFLATE * pxDeflate;
+	struct xFTP_INFLATE * pxInflate;
+	/* The last digest calculated for HASH, XCRC or XMD5, or while storing a file. */
+	struct xFTP_FILE_DIGEST * pxDigest;
+	/* STOR to a memory sink, or RETR from a memory source, instead of a file.
+	 * See FreeRTOS_FTPAddMemorySink() and FreeRTOS_FTPAddMemorySource(). */
+	struct xFTP_SINK_SLOT * pxSink;
+	struct xFTP_SOURCE_SLOT * pxSource;
+	uint32_t ulMemoryOffset; /* Offset of the next byte in the sink or source. */
+	/* The CRC-32 of the data received with the last STOR, see ipconfigFTP_STORE_CRC. */
+	uint32_t ulStoreCrc;
+	uint32_t ulStoreLength;
+	uint32_t ulExpectCrc; /* Announced with 'SITE CRCCHECK', checked after the next STOR. */
+	#if ( ipconfigSELECT_USES_READY_LIST == 1 )
+		size_t uxRxLowWater; /* The FREERTOS_SO_SELECT_RCVLOWAT of xSocket. */
+	#endif
+	#if ( ipconfigFTP_HAS_STATS != 0 )
+		FTPSessionStats_t xStats;
+		TickType_t xTransferStart; /* The tick count when the transfer started. */
+		uint64_t ullDiskClocks;    /* ipconfigFTP_STATS_CLOCK() units spent in ff_fread() or ff_fwrite(). */
+		uint64_t ullWaitClocks;    /* ipconfigFTP_STATS_CLOCK() units spent waiting for the network. */
+		uint32_t ulWaitStart;      /* The clock when it started waiting for the network, or zero. */
+	#endif
 	char pcCurrentDir[ ffconfigMAX_FILENAME ];
 	char pcFileName[ ffconfigMAX_FILENAME ];
 	char pcConnectionAck[ 128 ];
@@ -133,7 +298,10 @@ struct xFTP_CLIENT
 				bLoggedIn : 1,
 				bStatusUser : 1,
 				bInRename : 1,
-				bReadOnly : 1;
+				bReadOnly : 1,
+				bModeZ : 1,
+				bExpectCrc : 1, /* ulExpectCrc is valid. */
+				bEpsvAll : 1;   /* The client has sent 'EPSV ALL'. */
 		};
 		uint32_t ulFTPFlags;
 	}
@@ -147,7 +315,13 @@ struct xFTP_CLIENT
 				bDirHasEntry : 1,     /* pdTRUE if ff_findfirst() was successful. */
 				bClientConnected : 1, /* pdTRUE after connect() or accept() has succeeded. */
 				bEmptyFile : 1,       /* pdTRUE if a connection-without-data was received. */
-				bHadError : 1;        /* pdTRUE if a transfer got aborted because of an error. */
+				bHadError : 1,        /* pdTRUE if a transfer got aborted because of an error. */
+				bAborted : 1,         /* pdTRUE if the transfer got aborted with ABOR. */
+				bMachineList : 1,     /* pdTRUE if the listing was requested with MLSD. */
+				bListFromCache : 1,   /* pdTRUE if the listing is sent from the cache. */
+				bCrcFromStart : 1,    /* pdTRUE if ulStoreCrc covers the whole file, i.e. no REST. */
+				bCrcValid : 1,        /* pdTRUE if the stored file must be added to the CRC index. */
+				bCrcMismatch : 1;     /* pdTRUE if the stored file did not have the expected CRC. */
 		};
 		uint32_t ulConnFlags;
 	}
@@ -156,6 +330,89 @@ struct xFTP_CLIENT
 
 typedef struct xFTP_CLIENT FTPClient_t;
 
+#if ( tcpserverHAS_BUDGET != 0 )
+
+/*
+ * The number of bytes that a client may still transfer when it is called,
+ * and the accounting of the bytes that were transferred.
+ */
+	size_t uxTCPServerBudget( TCPClient_t * pxClient );
+	void vTCPServerBudgetUse( TCPClient_t * pxClient,
+							  size_t uxCount );
+#else
+	#define uxTCPServerBudget( pxClient )              ( ~( size_t ) 0u )
+	#define vTCPServerBudgetUse( pxClient, uxCount )    do {} while( ipFALSE_BOOL )
+#endif
+
+/*
+ * A client that must be called at a certain time, also when its sockets have
+ * no events, e.g. to close an idle connection, sets a deadline.  The server
+ * task blocks no longer than until the nearest deadline of its clients.  The
+ * deadline is cleared each time the client is called.
+ */
+void vTCPServerSetDeadline( TCPClient_t * pxClient,
+							TickType_t xTime );
+
+#if ( ipconfigSELECT_USES_READY_LIST == 1 )
+
+/*
+ * A partial line or request header is left in the RX stream, and the
+ * FREERTOS_SO_SELECT_RCVLOWAT of the socket makes select() wait for the rest.
+ */
+	#define xTCPServerPeek( pxClient, pcBuffer, uxSize ) \
+	FreeRTOS_recv( ( pxClient )->xSocket, ( void * ) ( pcBuffer ), ( uxSize ), FREERTOS_MSG_PEEK | FREERTOS_MSG_DONTWAIT )
+	#define xTCPServerTake( pxClient, pcBuffer, uxLength ) \
+	FreeRTOS_recv( ( pxClient )->xSocket, ( void * ) ( pcBuffer ), ( uxLength ), 0 )
+#else
+
+/*
+ * FreeRTOS_select() has no low-water marks: a partial line that is left in the
+ * RX stream would make it return at once, over and over.  vTCPServerKeep()
+ * moves the uxLength bytes that xTCPServerPeek() returned from the stream to
+ * pxKept, a buffer of
+ * ipconfigTCP_COMMAND_BUFFER_SIZE bytes that is allocated when a client needs
+ * it for the first time.  xTCPServerPeek() copies the kept bytes to pcBuffer,
+ * followed by the data in the stream, and xTCPServerTake() takes the first
+ * uxLength of those bytes.
+ */
+	struct xTCP_LINE_BUFFER
+	{
+		size_t uxLength;
+		char pcData[ ipconfigTCP_COMMAND_BUFFER_SIZE ];
+	};
+
+	BaseType_t xTCPServerPeek( TCPClient_t * pxClient,
+							   char * pcBuffer,
+							   size_t uxSize );
+	BaseType_t xTCPServerTake( TCPClient_t * pxClient,
+							   char * pcBuffer,
+							   size_t uxLength );
+	void vTCPServerKeep( TCPClient_t * pxClient,
+						 size_t uxLength );
+#endif /* ipconfigSELECT_USES_READY_LIST */
+
+/*
+ * The command verbs of FTP and HTTP are looked up in a perfect hash table: a
+ * multiplier is searched for that puts every verb of a protocol in a slot of
+ * its own.  A lookup costs one multiplication and one string compare.
+ */
+#define tcpserverHASH_BITS    8
+#define tcpserverHASH_SIZE    ( 1u << tcpserverHASH_BITS )
+
+typedef struct xCOMMAND_HASH
+{
+	uint32_t ulMultiplier;                 /* Zero as long as the table has not been built. */
+	uint8_t ucSlots[ tcpserverHASH_SIZE ]; /* The index of a command plus one, zero for an empty slot. */
+} CommandHash_t;
+
+uint32_t ulTCPServerCommandKey( const char * pcName,
+								BaseType_t xLength );
+BaseType_t xTCPServerHashBuild( CommandHash_t * pxHash,
+								const uint32_t * pulKeys,
+								BaseType_t xCount );
+BaseType_t xTCPServerHashFind( const CommandHash_t * pxHash,
+							   uint32_t ulKey );
+
 BaseType_t xHTTPClientWork( TCPClient_t * pxClient );
 BaseType_t xFTPClientWork( TCPClient_t * pxClient );
 
@@ -183,11 +440,25 @@ struct xTCP_SERVER
 		char pcNewDir[ ffconfigMAX_FILENAME ];
 	#endif
 	#if ( ipconfigUSE_HTTP != 0 )
-		char pcContentsType[ 40 ];  /* Space for the msg: "text/javascript" */
-		char pcExtraContents[ 40 ]; /* Space for the msg: "Content-Length: 346500" */
+		char pcContentsType[ 64 ];   /* Space for the msg: "multipart/byteranges; boundary=..." */
+		char pcExtraContents[ 128 ]; /* Space for the msgs: "Content-Range: ...", "Content-Length: 346500" */
 	#endif
 	BaseType_t xServerCount;
 	TCPClient_t * pxClients;
+	BaseType_t xClientCount;
+	#if ( ipconfigTCP_SERVER_MAX_WORKERS > 1 )
+		/* The servers among which the new clients are divided, the first one
+		 * is the accepting server itself. */
+		struct xTCP_SERVER * pxWorkers[ ipconfigTCP_SERVER_MAX_WORKERS ];
+		BaseType_t xWorkerCount;
+		BaseType_t xNextWorker;
+		/* A worker receives its new clients through this queue. */
+		QueueHandle_t xNewClients;
+	#endif
+	#if ( tcpserverHAS_BUDGET != 0 )
+		BaseType_t xThrottled; /* A client was stopped by the rate limit. */
+		BaseType_t xProgress;  /* A client has transferred data. */
+	#endif
 	struct xSERVER
 	{
 		enum eSERVER_TYPE eType; /* eSERVER_HTTP | eSERVER_FTP */
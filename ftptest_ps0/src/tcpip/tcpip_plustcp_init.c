@@ -34,6 +34,7 @@
 #include "tcpip_api_init.h"
 
 #include "ff_ramdisk.h"
+#include "ff_stdio.h"
 
 /******************************************************************************
  Constant and macro definitions
@@ -82,6 +83,16 @@
 #define mainIO_MANAGER_CACHE_SIZE		( 15UL * mainRAM_DISK_SECTOR_SIZE )		//<! Size of the RAM Disk cache
 
 #define mainRAM_DISK_NAME				"/ram"									//<! RAM Disk mount directory
+#define mainHTTP_ROOT_DIR				mainRAM_DISK_NAME "/websrc"				//<! Files served by the HTTP server
+
+/* Number of tasks that serve the FTP and HTTP clients, including tcpserver_task */
+#define TCP_SERVER_WORKER_COUNT         ipconfigTCP_SERVER_MAX_WORKERS
+
+/* When non-zero, the combined throughput of all FTP sessions is printed every
+ * this number of ms while transfers are running.  Start e.g. 8 RETR's at once
+ * and compare the figures for different values of TCP_SERVER_WORKER_COUNT. */
+#define FTP_THROUGHPUT_REPORT_MS        0
+#define FTP_THROUGHPUT_SESSIONS         16
 
 
 /******************************************************************************
@@ -140,7 +151,7 @@ static const struct xSERVER_CONFIG s_server_configuration[] =
         { eSERVER_FTP,      21,    				12,					    "/ram"    },
 #endif
 #if ipconfigUSE_HTTP == 1
-
+        { eSERVER_HTTP,     80,                 12,                     mainHTTP_ROOT_DIR },
 #endif
 };
 
@@ -160,6 +171,9 @@ static FF_Disk_t *pxRAMDisk;
 ******************************************************************************/
 static void tcpserver_task(void *pvParameters);
 static XStatus File_System_Init(void);
+#if ( FTP_THROUGHPUT_REPORT_MS > 0 ) && ( ipconfigFTP_HAS_STATS != 0 )
+static void throughput_task(void *pvParameters);
+#endif
 
 
 /******************************************************************************
@@ -263,6 +277,23 @@ UBaseType_t uxRand(void)
     return ulRandomValue;
 }
 
+/**************************************************************************//**
+*  Routine:     ulFTPStatsClock
+*  @brief       Returns the global timer in microseconds, it is used to
+*               measure the time that FTP transfers spend on the disk and on
+*               the network.
+*
+*  @return      The time in microseconds, wrapping around every 71 minutes
+******************************************************************************/
+uint32_t ulFTPStatsClock(void)
+{
+    XTime   xtimenow;
+
+    XTime_GetTime(&xtimenow);
+
+    return (uint32_t)(xtimenow / (COUNTS_PER_SECOND / 1000000UL));
+}
+
 /**************************************************************************//**
 *  Routine:     xApplicationGetRandomNumber
 *  @brief       Sets *pulNumber to a random number, and return pdTRUE. When
@@ -535,10 +566,24 @@ static void tcpserver_task(void *pvParameters)
     configASSERT(xStatus == XST_SUCCESS);
 
     // Creates the TCP server defined by s_server_configuration variable
+#if ( TCP_SERVER_WORKER_COUNT > 1 )
+    // The accepted clients are divided among tcpserver_task and the worker tasks
+    px_tcp_server = FreeRTOS_CreateTCPServerWorkers(s_server_configuration,
+                                        (sizeof(s_server_configuration)/sizeof(s_server_configuration[0])),
+                                        TCP_SERVER_WORKER_COUNT);
+#else
     px_tcp_server = FreeRTOS_CreateTCPServer(s_server_configuration,
                                         (sizeof(s_server_configuration)/sizeof(s_server_configuration[0])));
+#endif
+
+#if ( FTP_THROUGHPUT_REPORT_MS > 0 ) && ( ipconfigFTP_HAS_STATS != 0 )
+    xTaskCreate(throughput_task, "FtpRate", 512, px_tcp_server, 1, NULL);
+#endif
 
-    u32_blocking_time = pdMS_TO_TICKS(10UL);
+    // Block until a socket has an event: the IP-task wakes up the server as
+    // soon as data arrives, TX space is freed or a connection changes state.
+    // The server also wakes up when the time-out of a client expires.
+    u32_blocking_time = portMAX_DELAY;
 
     // Infinite loop
     while(1)
@@ -547,6 +592,53 @@ static void tcpserver_task(void *pvParameters)
     }
 }
 
+#if ( FTP_THROUGHPUT_REPORT_MS > 0 ) && ( ipconfigFTP_HAS_STATS != 0 )
+/**************************************************************************//**
+*  Routine:     throughput_task
+*  @brief       Prints the number of bytes per second that all FTP sessions,
+*               of all worker tasks, transfer together.
+*
+*  @param       pvParameters    [in] The TCP server
+*
+*  @return      None
+******************************************************************************/
+static void throughput_task(void *pvParameters)
+{
+    static FTPSessionStats_t    x_stats[FTP_THROUGHPUT_SESSIONS];
+    TCPServer_t *px_tcp_server = (TCPServer_t *) pvParameters;
+    uint64_t    u64_total, u64_previous = 0;
+    BaseType_t  x_count, x_index, x_running;
+
+    while(1)
+    {
+        vTaskDelay(pdMS_TO_TICKS(FTP_THROUGHPUT_REPORT_MS));
+
+        x_count = FreeRTOS_FTPGetStats(px_tcp_server, x_stats, FTP_THROUGHPUT_SESSIONS);
+        u64_total = 0;
+        x_running = 0;
+
+        for (x_index = 0; x_index < x_count; x_index++)
+        {
+            // A transfer that ends moves its bytes from xTransfer to the totals
+            u64_total += x_stats[x_index].ullBytesSent + x_stats[x_index].ullBytesReceived;
+            if (x_stats[x_index].xBusy != pdFALSE)
+            {
+                u64_total += x_stats[x_index].xTransfer.ulBytes;
+                x_running++;
+            }
+        }
+
+        // The bytes of a session that has been closed are no longer counted
+        if ((x_running > 0) && (u64_total >= u64_previous))
+        {
+            FreeRTOS_printf(("FTP: %ld transfers, %lu KB/sec together\n", (long) x_running,
+                             (unsigned long) (((u64_total - u64_previous) * 1000ull) / (1024ull * FTP_THROUGHPUT_REPORT_MS))));
+        }
+        u64_previous = u64_total;
+    }
+}
+#endif
+
 static XStatus File_System_Init(void)
 {
 	static uint8_t ucRAMDisk[ mainRAM_DISK_SECTORS * mainRAM_DISK_SECTOR_SIZE ];
@@ -566,5 +658,8 @@ static XStatus File_System_Init(void)
 	/* Print out information on the RAM disk. */
 	FF_RAMDiskShowPartition( pxRAMDisk );
 
+	/* The web pages are uploaded here with FTP. */
+	ff_mkdir( mainHTTP_ROOT_DIR );
+
 	return XST_SUCCESS;
 }